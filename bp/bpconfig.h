@@ -23,9 +23,22 @@
 #include <clicknet/ether.h>
 #include <clicknet/ip.h>
 #include <clicknet/udp.h>
+#include <click/packet_anno.hh>
 
 #define RTP_HEADER_LENGTH 12
 
 enum Layer {WIFIQOS, WIFI, ETHER, IP};
 
+// Class of an H.264 video packet, in order of importance
+enum FrameClass {FRAME_UNKNOWN, FRAME_I, FRAME_P, FRAME_OTHER};
+#define FRAME_CLASSES 3 // FRAME_I, FRAME_P and FRAME_OTHER
+
+// The FrameClass of a packet is set once by BPFrameClass and carried in
+// this annotation byte, which is otherwise only used by ICMPError.
+#ifndef FRAME_CLASS_ANNO_OFFSET
+#define FRAME_CLASS_ANNO_OFFSET ICMP_PARAMPROB_ANNO_OFFSET
+#endif
+#define FRAME_CLASS_ANNO(p) ((p)->anno_u8(FRAME_CLASS_ANNO_OFFSET))
+#define SET_FRAME_CLASS_ANNO(p, v) ((p)->set_anno_u8(FRAME_CLASS_ANNO_OFFSET, (v)))
+
 #endif
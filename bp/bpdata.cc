@@ -18,12 +18,13 @@
 #include <click/config.h>
 #include <click/confparse.hh>
 #include <click/error.hh>
+#include <click/straccum.hh>
 
 #include "bpdata.hh"
 
 CLICK_DECLS
 
-BPData::BPData() {}
+BPData::BPData() : _flow_cap(0), _version(0) {}
 
 BPData::~BPData() {}
 
@@ -36,34 +37,152 @@ int BPData::configure (Vector<String> &conf, ErrorHandler *errh) {
   return res;
 }
 
-Flow_BPInfo_Table* BPData::get_table(String neig) {
-  Flow_BPInfo_Table **fbp = _NFB.findp(neig);
-  Flow_BPInfo_Table *fb = fbp ? *fbp : new Flow_BPInfo_Table() ;
-  if (!fbp) _NFB.insert(neig, fb);
-  return fb;
+int BPData::add_neighbor(IPAddress neig, EtherAddress eth) {
+  int ni = _neigs.size();
+  _neigs.push_back(neig);
+  _neig_eths.push_back(eth);
+  _metrics.push_back(0);
+  _has_metric.push_back(false);
+  _matrix.resize((ni + 1) * _flow_cap, HostBPInfo());
+  return ni;
 }
 
-HostBPInfo* BPData::get_info(String neig, Flow f) {
-  Flow_BPInfo_Table **fbp = _NFB.findp(neig);
-  if (!fbp) return NULL;
-  Flow_BPInfo_Table *fb = *fbp;
-  return fb->findp(f);
+int BPData::neighbor_index(IPAddress neig, bool create) {
+  int *nip = _neig_index.findp(neig);
+  if (nip) return *nip;
+  if (!create) return -1;
+  int ni = add_neighbor(neig, EtherAddress());
+  _neig_index.insert(neig, ni);
+  return ni;
+}
+
+int BPData::neighbor_index(EtherAddress neig, bool create) {
+  int *nip = _eth_index.findp(neig);
+  if (nip) return *nip;
+  if (!create) return -1;
+  int ni = add_neighbor(IPAddress(), neig);
+  _eth_index.insert(neig, ni);
+  return ni;
+}
+
+int BPData::flow_index(Flow f, bool create) {
+  int *fip = _flow_index.findp(f);
+  if (fip) return *fip;
+  if (!create) return -1;
+
+  int fi = _flows.size();
+  if (fi == _flow_cap) {
+    // Widen every row; the matrix is rebuilt at most log(flows) times.
+    int new_cap = _flow_cap ? 2 * _flow_cap : 8;
+    Vector<HostBPInfo> m(_neigs.size() * new_cap, HostBPInfo());
+    for (int ni = 0; ni < _neigs.size(); ni++)
+      for (int i = 0; i < fi; i++)
+        m[ni * new_cap + i] = _matrix[ni * _flow_cap + i];
+    _matrix.swap(m);
+    _flow_cap = new_cap;
+  }
+  _flows.push_back(f);
+  _flow_index.insert(f, fi);
+  return fi;
+}
+
+void BPData::update(int ni, Flow f, uint32_t backlog, uint32_t distance) {
+  HostBPInfo *info = this->info(ni, flow_index(f, true));
+  // A distance written through the 'info' handler survives the next
+  // report only, as when the report replaced the whole entry
+  if (info->_static_distance) {
+    distance = info->_distance;
+    info->_static_distance = false;
+  }
+  if (!info->_valid || info->_backlog != backlog || info->_distance != distance) {
+    info->_backlog = backlog;
+    info->_distance = distance;
+    info->_valid = true;
+    _version++;
+  }
+}
+
+void BPData::set_metric(int ni, int64_t metric) {
+  if (!_has_metric[ni] || _metrics[ni] != metric) {
+    _metrics[ni] = metric;
+    _has_metric[ni] = true;
+    _version++;
+  }
+}
+
+HostBPInfo* BPData::get_info(IPAddress neig, Flow f) {
+  int ni = neighbor_index(neig, false);
+  int fi = flow_index(f, false);
+  if (ni < 0 || fi < 0) return NULL;
+  HostBPInfo *info = this->info(ni, fi);
+  return info->_valid ? info : NULL;
+}
+
+HostBPInfo* BPData::get_info(EtherAddress neig, Flow f) {
+  int ni = neighbor_index(neig, false);
+  int fi = flow_index(f, false);
+  if (ni < 0 || fi < 0) return NULL;
+  HostBPInfo *info = this->info(ni, fi);
+  return info->_valid ? info : NULL;
+}
+
+String BPData::unparse_matrix() {
+  // One row per neighbor, one column per flow, "-" where nothing was reported
+  StringAccum sa;
+  sa << "version " << _version << "\nneighbor metric";
+  for (int fi = 0; fi < _flows.size(); fi++)
+    sa << ' ' << _flows[fi]._dst;
+  sa << '\n';
+  for (int ni = 0; ni < _neigs.size(); ni++) {
+    if (_neigs[ni])
+      sa << _neigs[ni];
+    else
+      sa << _neig_eths[ni];
+    if (_has_metric[ni])
+      sa << ' ' << _metrics[ni];
+    else
+      sa << " -";
+    const HostBPInfo *row = &_matrix[ni * _flow_cap];
+    for (int fi = 0; fi < _flows.size(); fi++) {
+      if (!row[fi]._valid)
+        sa << " -";
+      else if (_enhanced)
+        sa << ' ' << row[fi]._backlog << '/' << row[fi]._distance;
+      else
+        sa << ' ' << row[fi]._backlog;
+    }
+    sa << '\n';
+  }
+  return sa.take_string();
 }
 
 
 // Setup handlers
-String BPData::read_handler(Element *e, void *) {
+enum {H_INFO, H_MATRIX, H_VERSION};
+
+String BPData::read_handler(Element *e, void *thunk) {
 
   BPData *b = static_cast<BPData *>(e);
   String ret = "";
 
-  for(Neig_Flow_BPInfo_Table::iterator nfb_iter = b->get_iterator(); nfb_iter.live(); nfb_iter++) {
-    ret += nfb_iter.key() + " : " + String(*(b->get_metric(nfb_iter.key()))) + " ; ";
-    for(Flow_BPInfo_Table::iterator fb_iter = nfb_iter.value()->begin(); fb_iter.live(); fb_iter++) {
+  switch ((intptr_t)thunk) {
+    case H_MATRIX:
+      return b->unparse_matrix();
+    case H_VERSION:
+      return String(b->_version);
+  }
+
+  for (int ni = 0; ni < b->nneighbors(); ni++) {
+    String neig = b->_neigs[ni] ? b->_neigs[ni].s() : b->_neig_eths[ni].unparse_colon();
+    ret += neig + " : " + (b->_has_metric[ni] ? String(b->_metrics[ni]) : String("-")) + " ; ";
+    for (int fi = 0; fi < b->nflows(); fi++) {
+      HostBPInfo *info = b->info(ni, fi);
+      if (!info->_valid)
+        continue;
       if(b->_enhanced)
-        ret += fb_iter.key()._dst.s() + " " + String(fb_iter.value()._backlog) + " " + String(fb_iter.value()._distance) + " ; ";
+        ret += b->_flows[fi]._dst.s() + " " + String(info->_backlog) + " " + String(info->_distance) + " ; ";
       else
-        ret += fb_iter.key()._dst.s() + " " + String(fb_iter.value()._backlog) + " ; ";
+        ret += b->_flows[fi]._dst.s() + " " + String(info->_backlog) + " ; ";
     }
     ret += "\n";
   }
@@ -77,20 +196,39 @@ int BPData::write_handler(const String &in_s, Element *e, void *vparam, ErrorHan
   Vector<String> args;
   cp_spacevec(in_s, args);
 
-  String neig = args[0];
-  Flow f = Flow(IPAddress(args[1]));
-
-  HostBPInfo *neig_info = b->get_info(neig, f);
-  neig_info->_backlog = atoi(args[2].c_str());
-  neig_info->_distance = atoi(args[3].c_str());
+  IPAddress neig_ip;
+  EtherAddress neig_eth;
+  IPAddress dst;
+  uint32_t backlog, distance;
+  if (args.size() != 4
+      || !cp_ip_address(args[1], &dst)
+      || !cp_integer(args[2], &backlog)
+      || !cp_integer(args[3], &distance))
+    return errh->error("expected 'NEIGHBOR DST BACKLOG DISTANCE'");
+
+  int ni;
+  if (cp_ip_address(args[0], &neig_ip))
+    ni = b->neighbor_index(neig_ip, true);
+  else if (cp_ethernet_address(args[0], &neig_eth))
+    ni = b->neighbor_index(neig_eth, true);
+  else
+    return errh->error("bad neighbor address");
+
+  HostBPInfo *neig_info = b->info(ni, b->flow_index(Flow(dst), true));
+  neig_info->_backlog = backlog;
+  neig_info->_distance = distance;
   neig_info->_static_distance = true;
+  neig_info->_valid = true;
+  b->_version++;
 
   return 0;
 }
 
 void BPData::add_handlers() {
-  add_read_handler("info", read_handler, 0);
-  add_write_handler("info", write_handler, 0);
+  add_read_handler("info", read_handler, (void *)H_INFO);
+  add_read_handler("matrix", read_handler, (void *)H_MATRIX);
+  add_read_handler("version", read_handler, (void *)H_VERSION);
+  add_write_handler("info", write_handler, (void *)H_INFO);
 }
 
 CLICK_ENDDECLS
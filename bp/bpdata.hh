@@ -5,6 +5,7 @@
 #include <click/etheraddress.hh>
 #include <click/ipaddress.hh>
 #include <click/hashmap.hh>
+#include <click/vector.hh>
 
 #include "bpconfig.h"
 #include "bpflow.hh"
@@ -18,15 +19,26 @@ public:
   uint32_t _distance;
 
   bool _static_distance;
+  bool _valid; // false until the neighbor has reported this flow
   
-  HostBPInfo() {};
-  HostBPInfo(uint32_t backlog, uint32_t distance) : _backlog(backlog), _distance(distance), _static_distance(false) {};
+  HostBPInfo() : _backlog(0), _distance(0), _static_distance(false), _valid(false) {};
+  HostBPInfo(uint32_t backlog, uint32_t distance) : _backlog(backlog), _distance(distance), _static_distance(false), _valid(true) {};
 };
 
-typedef HashMap<Flow, HostBPInfo> Flow_BPInfo_Table;
-typedef HashMap<String, Flow_BPInfo_Table*> Neig_Flow_BPInfo_Table;
-typedef HashMap<String, int64_t> Neig_Metric_Table;
-
+typedef HashMap<IPAddress, int> Neig_Index_Table;
+typedef HashMap<EtherAddress, int> Ether_Index_Table;
+typedef HashMap<Flow, int> Flow_Index_Table;
+
+/*
+ * The reported backlogs and distances are kept in a dense matrix, one row
+ * per neighbor and one column per flow.  Neighbors are known by their IP
+ * address (LAYER ip) or their Ethernet address (LAYER eth); both map to a row
+ * index.  Rows and columns are never removed, so indices stay valid for the
+ * lifetime of the element and callers may keep them.
+ *
+ * The version counter is bumped whenever a reported value changes, so
+ * consumers can cache metrics derived from the matrix.
+ */
 class BPData: public Element {
 public:
 
@@ -38,14 +50,24 @@ public:
 
   // Mutators
   void set_enhanced(bool enhanced) { _enhanced = enhanced; } 
+  int neighbor_index(IPAddress neig, bool create);
+  int neighbor_index(EtherAddress neig, bool create);
+  int flow_index(Flow f, bool create);
+  void update(int ni, Flow f, uint32_t backlog, uint32_t distance);
+  void set_metric(int ni, int64_t metric);
 
   // Accessors
-  Flow_BPInfo_Table* get_table(String neig);
-  HostBPInfo* get_info(String neig, Flow f);
-  Neig_Flow_BPInfo_Table::iterator get_iterator() { return _NFB.begin(); }
-  int64_t* get_metric(String neig) { return _NM.findp(neig); }
-  void set_metric(String neig, int64_t metric) { _NM.insert(neig, metric); }
-  Neig_Metric_Table::iterator get_metric_iterator() { return _NM.begin(); }
+  int nneighbors() const { return _neigs.size(); }
+  int nflows() const { return _flows.size(); }
+  IPAddress neighbor_ip(int ni) const { return _neigs[ni]; }
+  EtherAddress neighbor_eth(int ni) const { return _neig_eths[ni]; }
+  Flow flow(int fi) const { return _flows[fi]; }
+  HostBPInfo* info(int ni, int fi) { return &_matrix[ni * _flow_cap + fi]; }
+  HostBPInfo* get_info(IPAddress neig, Flow f);
+  HostBPInfo* get_info(EtherAddress neig, Flow f);
+  bool has_metric(int ni) const { return _has_metric[ni]; }
+  int64_t get_metric(int ni) const { return _metrics[ni]; }
+  uint32_t version() const { return _version; }
 
   static String read_handler(Element *, void *);
   static int write_handler(const String&, Element*, void*, ErrorHandler*);
@@ -53,9 +75,24 @@ public:
 
 private:
 
-  Neig_Flow_BPInfo_Table _NFB;
-  Neig_Metric_Table _NM;
+  Neig_Index_Table _neig_index;
+  Ether_Index_Table _eth_index;
+  Flow_Index_Table _flow_index;
+
+  Vector<IPAddress> _neigs;
+  Vector<EtherAddress> _neig_eths;
+  Vector<Flow> _flows;
+  Vector<int64_t> _metrics;
+  Vector<bool> _has_metric;
+
+  Vector<HostBPInfo> _matrix; // _neigs.size() rows of _flow_cap entries
+  int _flow_cap;
+
+  uint32_t _version;
   bool _enhanced; // Enhanced Backpressure
+
+  int add_neighbor(IPAddress neig, EtherAddress eth);
+  String unparse_matrix();
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,125 @@
+/*
+ * bpframeclass.{cc,hh} -- Classification of video packets by H.264 frame type
+ * Kostas Choumas
+ *
+ * Copyright (c) 2012, University of Thessaly
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <elements/wifi/sr/srpacket.hh>
+
+#include "bpframeclass.hh"
+
+CLICK_DECLS
+
+BPFrameClass::BPFrameClass() {}
+
+BPFrameClass::~BPFrameClass() {}
+
+int BPFrameClass::configure(Vector<String> &conf, ErrorHandler *errh) {
+
+  String maclayer = "wifiqos";
+  uint32_t ethtype = DEFAULT_ETHTYPE;
+  int res = cp_va_kparse(conf, this, errh,
+			"MACLAYER", cpkP, cpString, &maclayer,
+			"ETHTYPE", cpkP, cpUnsigned, &ethtype,
+			cpEnd);
+
+  if (res < 0) return res;
+
+  if (!maclayer.compare("wifiqos"))
+    _maclayer = WIFIQOS;
+  else if (!maclayer.compare("wifi"))
+    _maclayer = WIFI;
+  else if (!maclayer.compare("ether"))
+    _maclayer = ETHER;
+  else return errh->error("MACLAYER should be wifiqos, wifi or ether");
+
+  if (ethtype > 0xFFFF)
+    return errh->error("ETHTYPE should be a 16-bit ether type");
+  _ethtype = ethtype;
+
+  memset(_count, 0, sizeof(_count));
+  return res;
+}
+
+enum FrameClass BPFrameClass::classify(const Packet *p, enum Layer maclayer, uint16_t ethtype) {
+
+  uint32_t mac_header_length = maclayer == WIFIQOS ? sizeof(click_wifi) + 2 + sizeof(click_llc) : // 2 bytes QoS
+                              (maclayer == WIFI ? sizeof(click_wifi) + sizeof(click_llc) : sizeof(click_ether));
+  if (p->length() < mac_header_length)
+    return FRAME_OTHER;
+
+  // The ether type is the last field of both the LLC and the Ethernet header
+  const uint8_t *mac_end = p->data() + mac_header_length;
+  uint32_t offset = mac_header_length;
+  if (((mac_end[-2] << 8) | mac_end[-1]) == ethtype) {
+    if (p->length() < offset + srpacket::len_wo_data(0))
+      return FRAME_OTHER;
+    struct srpacket *pk = (struct srpacket *)mac_end;
+    offset += srpacket::len_wo_data(pk->num_links());
+  }
+
+  offset += sizeof(click_ip) + sizeof(click_udp) + RTP_HEADER_LENGTH;
+  if (p->length() <= offset)
+    return FRAME_OTHER;
+
+  switch (p->data()[offset] & 0x1F) { // The NAL type is the 5 last bits of the first byte of the NAL header
+    case 5: // I frame
+    case 6: // SEI frame
+    case 7: // SPS frame
+    case 8: // PPS frame
+      return FRAME_I;
+    case 1: // P or B frame
+      return FRAME_P;
+    default:
+      return FRAME_OTHER;
+  }
+}
+
+Packet* BPFrameClass::simple_action(Packet *p) {
+
+  enum FrameClass c = classify(p, _maclayer, _ethtype);
+  SET_FRAME_CLASS_ANNO(p, c);
+  _count[c - FRAME_I]++;
+  return p;
+}
+
+
+// Setup handlers
+enum {H_COUNT};
+
+String BPFrameClass::read_handler(Element *e, void *thunk) {
+
+  BPFrameClass *d = static_cast<BPFrameClass *>(e);
+  int which = reinterpret_cast<intptr_t>(thunk);
+  String ret = "";
+
+  switch (which) {
+    case H_COUNT:
+      ret = "I:" + String(d->_count[FRAME_I - FRAME_I]) + " P:" + String(d->_count[FRAME_P - FRAME_I]) + 
+            " other:" + String(d->_count[FRAME_OTHER - FRAME_I]);
+      break;
+  }
+  ret += "\n";
+  return ret;
+}
+
+void BPFrameClass::add_handlers() {
+  add_read_handler("count", read_handler, (void *)H_COUNT);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(BPFrameClass)
@@ -0,0 +1,52 @@
+#ifndef BPFRAMECLASS_HH
+#define BPFRAMECLASS_HH
+
+#include <click/element.hh>
+#include <click/packet.hh>
+
+#include "bpconfig.h"
+
+CLICK_DECLS
+
+/*
+ * BPFrameClass([MACLAYER, ETHTYPE])
+ *
+ * Sets the frame class annotation (FRAME_CLASS_ANNO) of each H.264/RTP
+ * video packet to FRAME_I (I, SEI, SPS and PPS NAL units), FRAME_P (P and
+ * B NAL units) or FRAME_OTHER, so that DataQueues with VIDEO true can
+ * steer it without parsing it again.  Packets start with a MACLAYER
+ * header (wifiqos, wifi or ether; default wifiqos) and carry a source
+ * route header when their ether type is ETHTYPE (default 0x0604).
+ */
+
+class BPFrameClass : public Element {
+public:
+
+  BPFrameClass();
+  ~BPFrameClass();
+
+  const char* class_name() const {return "BPFrameClass";}
+  const char* port_count() const {return PORTS_1_1;}
+  const char* processing() const {return AGNOSTIC;}
+  int configure(Vector<String> &, ErrorHandler *);
+
+  Packet* simple_action(Packet *p);
+
+  enum {DEFAULT_ETHTYPE = 0x0604};
+
+  static enum FrameClass classify(const Packet *p, enum Layer maclayer, uint16_t ethtype);
+
+  static String read_handler(Element*, void*);
+  virtual void add_handlers();
+
+protected:
+
+  enum Layer _maclayer;
+  uint16_t _ethtype;
+
+  uint32_t _count[FRAME_CLASSES];
+};
+
+CLICK_ENDDECLS
+
+#endif
@@ -26,6 +26,7 @@
 #include <clicknet/ether.h>
 #include <elements/wifi/sr/srpacket.hh>
 #include "bpforwarder.hh"
+#include "../roofnet/routecache.hh"
 #include <click/packet_anno.hh>
 CLICK_DECLS
 
@@ -34,7 +35,8 @@ CLICK_DECLS
 BPQuerier::BPQuerier()
   :  _en(),
      _sr_forwarder(0),
-     _link_table(0)
+     _link_table(0),
+     _route_cache(0)
 {
 
   // Pick a starting sequence number that we have not used before.
@@ -64,6 +66,7 @@ BPQuerier::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "LT", 0, cpElement, &_link_table,
 		     "DQ", 0, cpElement, &_dataqueues,
 		     /* below not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     "ROUTE_DAMPENING", 0, cpBool, &_route_dampening,
 		     "TIME_BEFORE_SWITCH", 0, cpUnsigned, &_time_before_switch_sec,
@@ -83,6 +86,8 @@ BPQuerier::configure (Vector<String> &conf, ErrorHandler *errh)
     return errh->error("SR element is not a BPForwarder");
   if (_link_table->cast("LinkTable") == 0) 
     return errh->error("LT element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RC element is not a RouteCache");
 
   return ret;
 }
@@ -147,7 +152,8 @@ BPQuerier::push(int port, Packet *p_in)
   
   
   if (!q->_best_metric || !q->_p.size() || expire < now) {
-	  Path best = _link_table->best_route(dst, true);
+	  Path best = (_route_cache ? _route_cache->best_route(dst, true)
+		       : _link_table->best_route(dst, true));
 	  bool valid = _link_table->valid_route(best);
 
 	  q->_last_switch = now;
@@ -156,7 +162,8 @@ BPQuerier::push(int port, Packet *p_in)
 			  q->_first_selected = now;
 		  }
 		  q->_p = best;
-		  q->_best_metric = _link_table->get_route_metric(best);
+		  q->_best_metric = (_route_cache ? _route_cache->get_route_metric(dst, true)
+				     : _link_table->get_route_metric(best));
 	  } else {
 		  do_query = true;
 		  q->_p = Path();
@@ -224,8 +231,11 @@ read_param(Element *e, void *thunk)
 	  sa << " [ ";
 	  sa << path_to_string(dst._p);
 	  sa << " ]";
-	  Path best = td->_link_table->best_route(dst._ip, true);
-	  int best_metric = td->_link_table->get_route_metric(best);
+	  Path best = (td->_route_cache ? td->_route_cache->best_route(dst._ip, true)
+		       : td->_link_table->best_route(dst._ip, true));
+	  int best_metric = (td->_route_cache
+			     ? td->_route_cache->get_route_metric(dst._ip, true)
+			     : td->_link_table->get_route_metric(best));
 	  sa << " best_metric " << best_metric;
 	  sa << " best_route [ ";
 	  sa << path_to_string(best);
@@ -63,6 +63,7 @@ class BPQuerier : public Element {
 
   class BPForwarder *_sr_forwarder; // Backpressure
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
   DataQueues *_dataqueues; // Backpressure
 
   bool _route_dampening;
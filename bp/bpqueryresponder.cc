@@ -24,6 +24,7 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include <elements/wifi/sr/srpacket.hh>
+#include "../roofnet/routecache.hh"
 CLICK_DECLS
 
 
@@ -33,6 +34,7 @@ BPQueryResponder::BPQueryResponder()
      _en(),
      _et(0),
      _link_table(0),
+     _route_cache(0),
      _arp_table(0)
 {
 }
@@ -54,6 +56,7 @@ BPQueryResponder::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "ARP", 0, cpElement, &_arp_table,
 		     "DQ", 0, cpElement, &_dataqueues,
 		     /* below not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     cpEnd);
 
@@ -72,6 +75,8 @@ BPQueryResponder::configure (Vector<String> &conf, ErrorHandler *errh)
 
   if (_link_table->cast("LinkTable") == 0) 
     return errh->error("LT element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RC element is not a RouteCache");
   if (_arp_table->cast("ARPTable") == 0) 
     return errh->error("ARP element is not a ARPTable");
   if (_dataqueues->cast("DataQueues") == 0)
@@ -118,6 +123,8 @@ BPQueryResponder::update_link(IPAddress from, IPAddress to, uint32_t seq, int me
 		  to.unparse().c_str());
     return false;
   }
+  if (_route_cache)
+    _route_cache->note_link(from, to, metric);
   return true;
 }
 
@@ -128,7 +135,8 @@ BPQueryResponder::forward_reply(struct srpacket *pk1)
   u_char type = pk1->_type;
   sr_assert(type == PT_REPLY);
 
-  _link_table->dijkstra(true);
+  if (!_route_cache)
+    _link_table->dijkstra(true);
   if (_debug) {
     click_chatter("%s : %{element}: forward_reply %s <- %s\n", _ip.unparse().c_str(),
 		  this,
@@ -268,7 +276,8 @@ BPQueryResponder::got_reply(struct srpacket *pk)
 		  _ip.unparse().c_str(),
 		  dst.unparse().c_str());
   }
-  _link_table->dijkstra(true);
+  if (!_route_cache)
+    _link_table->dijkstra(true);
 
 }
 
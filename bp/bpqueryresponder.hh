@@ -66,6 +66,7 @@ class BPQueryResponder : public Element {
   QUEUE_CLASS_NAME<Seen> _seen;
 
   class LinkTable *_link_table;
+  class RouteCache *_route_cache; // If given, LinkTable's host metrics go stale: give BPStat the same RC
   class ARPTable *_arp_table;
   class DataQueues *_dataqueues;
 
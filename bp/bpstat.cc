@@ -23,6 +23,7 @@
 #include <clicknet/wifi.h>
 
 #include "bpstat.hh"
+#include "../roofnet/routecache.hh"
 
 CLICK_DECLS
 
@@ -35,7 +36,7 @@ OmlMPDef BPStat::mp_bpstat[] = {
 };
 #endif
 
-BPStat::BPStat() : _timer(this) {}
+BPStat::BPStat() : _timer(this), _piggyback_timer(this) {}
 
 BPStat::~BPStat() {
 #ifdef CLICK_OML
@@ -55,10 +56,18 @@ int BPStat::configure(Vector<String> &conf, ErrorHandler *errh) {
   _bpdata = NULL;
   _dataqueues = NULL;
   _link_table = NULL;
+  _route_cache = NULL;
   _rtable = NULL;
   _layer = IP;
   String layer = "ip";
   _enhanced = true;
+  _delta = false;
+  _threshold = 0;
+  _full_every = 10;
+  _piggyback = false;
+  _piggyback_et = 0;
+  _piggyback_wait = 0;
+  _mtu = 1500;
   int res = cp_va_kparse(conf, this, errh,
 			"ETHTYPE", 0, cpUnsigned, &_et,
 			"IP", 0, cpIPAddress, &_ip,
@@ -67,9 +76,17 @@ int BPStat::configure(Vector<String> &conf, ErrorHandler *errh) {
 			"BPDATA", 0, cpElement, &_bpdata,
 			"DQ", 0, cpElement, &_dataqueues,
 			"LT", 0, cpElement, &_link_table,
+			"RC", 0, cpElement, &_route_cache,
 			"RT", 0, cpElement, &_rtable,
 			"LAYER", 0, cpString, &layer,
 			"ENHANCED", 0, cpBool, &_enhanced,
+			"DELTA", 0, cpBool, &_delta,
+			"THRESHOLD", 0, cpUnsigned, &_threshold,
+			"FULL_EVERY", 0, cpUnsigned, &_full_every,
+			"PIGGYBACK", 0, cpBool, &_piggyback,
+			"PIGGYBACK_ETHTYPE", 0, cpUnsignedShort, &_piggyback_et,
+			"PIGGYBACK_WAIT", 0, cpUnsigned, &_piggyback_wait,
+			"MTU", 0, cpUnsigned, &_mtu,
 			cpEnd);
 
   if (res < 0) return res;
@@ -93,6 +110,8 @@ int BPStat::configure(Vector<String> &conf, ErrorHandler *errh) {
     return errh->error("DQ element is not a DataQueues");
   if (_link_table && _link_table->cast("LinkTable") == 0)
     return errh->error("LT element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0)
+    return errh->error("RC element is not a RouteCache");
   if (_rtable && _rtable->cast("AvailableRates") == 0)
     return errh->error("RT element is not a AvailableRates");
 
@@ -102,6 +121,25 @@ int BPStat::configure(Vector<String> &conf, ErrorHandler *errh) {
     _layer = IP;
   else return errh->error("LAYER should be ETHER or IP");
 
+  if (!_full_every)
+    return errh->error("FULL_EVERY must be positive");
+  if (_piggyback) {
+    if (ninputs() < 2)
+      return errh->error("PIGGYBACK requires data frames on input 1");
+    if (!_piggyback_et)
+      return errh->error("PIGGYBACK requires PIGGYBACK_ETHTYPE");
+    if (!_piggyback_wait)
+      _piggyback_wait = _period / 4;
+    if (_piggyback_wait >= _period)
+      return errh->error("PIGGYBACK_WAIT must be less than PERIOD");
+  }
+
+  _probes_to_full = 1;
+  _advertised_valid = false;
+  _has_pending = false;
+  _broadcast_next = false;
+  reset_counters();
+
   _bpdata->set_enhanced(_enhanced);
 
 #ifdef CLICK_OML
@@ -137,14 +175,29 @@ int BPStat::initialize(ErrorHandler *errh) {
     add_jitter_bp(max_jitter, &_next);
 
     _timer.schedule_at(_next);
+    _piggyback_timer.initialize(this);
   }
 
   return 0;
 }
 
-void BPStat::run_timer(Timer *) {
+void BPStat::reset_counters() {
+  _nprobes = _nfull = _nsuppressed = _npiggybacked = _nreceived = 0;
+  _control_bytes = _full_bytes = 0;
+}
+
+void BPStat::run_timer(Timer *t) {
   unsigned max_jitter = _period / 10;
 
+  if (t == &_piggyback_timer) {
+    // no data frame had room for the advertisement; broadcast it
+    if (_has_pending) {
+      output_probe(_pending, _pending_metric);
+      _has_pending = false;
+    }
+    return;
+  }
+
   send_probe();
 
 #ifdef CLICK_OML
@@ -179,27 +232,110 @@ void BPStat::run_timer(Timer *) {
 }
 
 
-void BPStat::send_probe() {
+void BPStat::collect_batches(bool full, uint32_t *nflows) {
 
-  Vector<FlowBatch> batches;
+  _batches.clear();
+  *nflows = 0;
   for (Flow_Queue_Table::iterator fq_iter = _dataqueues->get_iterator(); fq_iter.live(); fq_iter++) {
 
     Flow f = fq_iter.key();
     uint32_t backlog = fq_iter.value()->size();
-    uint32_t distance = _enhanced ? _link_table->get_host_metric_from_me(f._dst) : 0; // Length measured as sum of ett values.
+    uint32_t distance = 0; // Length measured as sum of ett values.
+    if (_enhanced)
+      distance = _route_cache ? _route_cache->get_route_metric(f._dst, true) : _link_table->get_host_metric_from_me(f._dst);
     //uint32_t distance = _link_table->best_route(f._dst, true).size(); // Length measured as hop count.
     if (_enhanced && !distance) distance = ~0;
-    
-    FlowBatch batch = FlowBatch(f, backlog, distance);
-    batches.push_front(batch);
+    (*nflows)++;
+
+    if (!full) {
+      FlowBatch *a = _advertised.findp(f);
+      if (a && a->_distance == distance
+          && (backlog > a->_backlog ? backlog - a->_backlog : a->_backlog - backlog) <= _threshold)
+        continue;
+    }
+    _batches.push_back(FlowBatch(f, backlog, distance));
   }
+}
 
-  int size = sizeof(click_ether);
+uint32_t BPStat::advert_length(int nbatches) const {
+  uint32_t size = 0;
   if (_layer == IP) size += 4; // 4 bytes for the IP address (if it is required)
-  size += 8; // 4 bytes for the maximum metric
+  size += 8; // 8 bytes for the maximum metric
   size += 2; // 2 bytes for the number of flow batches
-  size += batches.size() * (_enhanced ? 12 : 8); // 12 or 8 bytes for each flow batch
+  size += nbatches * (_enhanced ? 12 : 8); // 12 or 8 bytes for each flow batch
+  return size;
+}
+
+void BPStat::write_advert(uint8_t *ptr, const Vector<FlowBatch> &batches, int64_t metric) const {
 
+  // Fields are copied byte by byte, since a piggybacked advertisement
+  // starts wherever the data frame ends.
+
+  // fill in the IP address of this node (if _layer is IP)
+  if (_layer == IP) {
+    uint32_t addr = _ip.addr();
+    memcpy(ptr, &addr, 4);
+    ptr += 4;
+  }
+
+  // fill in the minimum metric of this node
+  memcpy(ptr, &metric, 8);
+  ptr += 8;
+
+  // fill in the information of the known flows of this node
+  uint16_t nbatches = batches.size(); //number of flow batches
+  memcpy(ptr, &nbatches, 2);
+  ptr += 2;
+
+  for (Vector<FlowBatch>::const_iterator batches_iter = batches.begin(); batches_iter < batches.end(); batches_iter++) {
+    const FlowBatch *b = batches_iter;
+    uint32_t field[3] = { b->_f._dst.addr(), b->_backlog, b->_distance };
+    int n = _enhanced ? 12 : 8;
+    memcpy(ptr, field, n);
+    ptr += n;
+  }
+}
+
+void BPStat::mark_advertised(const Vector<FlowBatch> &batches, int64_t metric) {
+  for (Vector<FlowBatch>::const_iterator batches_iter = batches.begin(); batches_iter < batches.end(); batches_iter++)
+    _advertised.insert(batches_iter->_f, *batches_iter);
+  _advertised_metric = metric;
+  _advertised_valid = true;
+}
+
+void BPStat::send_probe() {
+
+  if (_has_pending) { // still waiting for a data frame; it is stale now
+    output_probe(_pending, _pending_metric);
+    _has_pending = false;
+  }
+
+  bool full = !_delta || !--_probes_to_full;
+  if (full) _probes_to_full = _full_every;
+
+  uint32_t nflows;
+  collect_batches(full, &nflows);
+  int64_t metric = _dataqueues->get_metric();
+  _full_bytes += sizeof(click_ether) + advert_length(nflows);
+  if (full) _nfull++;
+
+  if (!full && _batches.empty() && _advertised_valid && metric == _advertised_metric) {
+    _nsuppressed++;
+    return;
+  }
+
+  if (_piggyback && !_broadcast_next) {
+    _pending.swap(_batches);
+    _pending_metric = metric;
+    _has_pending = true;
+    _piggyback_timer.schedule_after_msec(_piggyback_wait);
+  } else
+    output_probe(_batches, metric);
+}
+
+void BPStat::output_probe(const Vector<FlowBatch> &batches, int64_t metric) {
+
+  int size = sizeof(click_ether) + advert_length(batches.size());
 
   WritablePacket *p = Packet::make(size);
   if (p == 0) {
@@ -219,26 +355,9 @@ void BPStat::send_probe() {
   memcpy(eh->ether_shost, _eth.data(), 6);
   eh->ether_type = htons(_et);
 
-  // fill in the IP address of this node (if _layer is IP)
-  uint32_t *ptr32 = (uint32_t *) (eh + 1);
-  if (_layer == IP) *ptr32++ = _ip.addr();
-
-  // fill in the minimum metric of this node
-  int64_t *ptr64 = (int64_t *) ptr32;
-  *ptr64++ = _dataqueues->get_metric();
-
-  // fill in the information of the known flows of this node
-  uint16_t *ptr16 = (uint16_t *) ptr64;
-  *ptr16++ = batches.size(); //number of flow batches
-
-  ptr32 = (uint32_t *)ptr16;
-
-  for (Vector<FlowBatch>::const_iterator batches_iter = batches.begin(); batches_iter < batches.end(); batches_iter++) {
-    const FlowBatch *b = batches_iter;
-    *ptr32++ = b->_f._dst.addr();
-    *ptr32++ = b->_backlog;
-    if(_enhanced) *ptr32++ = b->_distance;
-  }
+  write_advert((uint8_t *) (eh + 1), batches, metric);
+  mark_advertised(batches, metric);
+  _broadcast_next = false;
 
   if (_rtable) {
     click_wifi_extra *ceh = (click_wifi_extra *) p->user_anno();
@@ -246,48 +365,179 @@ void BPStat::send_probe() {
     ceh->rate = _rtable->lookup(_eth)[0];
   }
 
+  _nprobes++;
+  _control_bytes += size;
   checked_output_push(0, p);
 }
 
-Packet* BPStat::simple_action(Packet *p) {
+Packet* BPStat::piggyback(Packet *p) {
+
+  uint32_t len = advert_length(_pending.size());
+  if (p->length() < sizeof(click_ether) || p->length() + len + 8 > _mtu)
+    return p;
+
+  WritablePacket *q = p->put(len + 8);
+  if (!q) return 0;
+
+  // the trailer keeps the frame's ether type, which now marks the trailer
+  click_ether *eh = (click_ether *) q->data();
+  uint8_t *trailer = q->end_data() - (len + 8);
+  uint16_t len16 = htons(len);
+  uint32_t magic = htonl(BPSTAT_TRAILER_MAGIC);
+  write_advert(trailer, _pending, _pending_metric);
+  memcpy(trailer + len, &eh->ether_type, 2);
+  memcpy(trailer + len + 2, &len16, 2);
+  memcpy(trailer + len + 4, &magic, 4);
+  eh->ether_type = htons(_piggyback_et);
+
+  // only the next hop hears this; the next advertisement is broadcast and
+  // repeats these flows, since they are not marked as advertised
+  _has_pending = false;
+  _broadcast_next = true;
+  _piggyback_timer.unschedule();
+  _npiggybacked++;
+  _control_bytes += len + 8;
+  return q;
+}
+
+Packet* BPStat::strip_piggyback(Packet *p) {
+
+  if (!_piggyback_et || p->length() < sizeof(click_ether) + 8)
+    return p;
+  const click_ether *eh = (const click_ether *) p->data();
+  if (eh->ether_type != htons(_piggyback_et))
+    return p;
+
+  uint16_t len16;
+  uint32_t magic;
+  const uint8_t *tail = p->end_data() - 8;
+  memcpy(&len16, tail + 2, 2);
+  memcpy(&magic, tail + 4, 4);
+  len16 = ntohs(len16);
+  if (magic != htonl(BPSTAT_TRAILER_MAGIC) || len16 < advert_length(0)
+      || p->length() < sizeof(click_ether) + len16 + 8)
+    return p;
+
+  WritablePacket *q = p->uniqueify();
+  if (!q) return 0;
+  eh = (const click_ether *) q->data();
+  tail = q->end_data() - 8;
+  receive_advert(eh, tail - len16, tail);
+  memcpy(&((click_ether *) q->data())->ether_type, tail, 2);
+
+  q->take(len16 + 8);
+  return q;
+}
+
+void BPStat::receive_advert(const click_ether *eh, const uint8_t *ptr, const uint8_t *end) {
+
+  // read the IP address of the node that sent this advertisement (if _layer is IP)
+  int neig;
+  if (_layer == IP) {
+    if (ptr + 4 > end) return;
+    uint32_t addr;
+    memcpy(&addr, ptr, 4);
+    ptr += 4;
+    neig = _bpdata->neighbor_index(IPAddress(addr), true);
+  } else
+    neig = _bpdata->neighbor_index(EtherAddress(eh->ether_shost), true);
+
+  if (ptr + 10 > end) return;
+  int64_t metric;
+  memcpy(&metric, ptr, 8);
+  _bpdata->set_metric(neig, metric);
+  ptr += 8;
+
+  uint16_t nof_flow_batches_left;
+  memcpy(&nof_flow_batches_left, ptr, 2);
+  ptr += 2;
+
+  int n = _enhanced ? 12 : 8;
+  for (; nof_flow_batches_left >= 1 && ptr + n <= end; nof_flow_batches_left--, ptr += n) {
+    uint32_t field[3] = { 0, 0, 0 };
+    memcpy(field, ptr, n);
+    _bpdata->update(neig, Flow(field[0]), field[1], field[2]); //update neighbor's info
+  }
+  _nreceived++;
+}
+
+void BPStat::push(int port, Packet *p) {
+
+  if (port == 1) { // Outgoing data frames
+    if (_has_pending) p = piggyback(p);
+    if (p) output(1).push(p);
+    return;
+  }
+  else if (port == 2) { // Incoming data frames
+    if ((p = strip_piggyback(p)))
+      output(2).push(p);
+    return;
+  }
 
   // read the ethernet header
   click_ether *eh = (click_ether *) p->data();
   if (ntohs(eh->ether_type) != _et) {
     click_chatter("%{element}: got non-BPStat packet type", this);
     p->kill();
-    return 0;
+    return;
   }
 
-  // read the IP address of the node that sent this probe (if _layer is IP)
-  uint32_t *ptr32 = (uint32_t *) (eh + 1);
-
-  String neig = _layer == IP ? IPAddress(*ptr32++).s() : EtherAddress(eh->ether_shost).unparse_colon();
-  Flow_BPInfo_Table *fb = _bpdata->get_table(neig);
+  receive_advert(eh, (const uint8_t *) (eh + 1), p->end_data());
 
-  int64_t *ptr64 = (int64_t *) ptr32;
-  _bpdata->set_metric(neig, *ptr64++);
+  p->kill();
+}
 
-  uint16_t *ptr16 = (uint16_t *) ptr64;
-  int nof_flow_batches_left = *ptr16++;
 
-  ptr32 = (uint32_t *) ptr16;
-  
-  while ((nof_flow_batches_left-- >= 1) && (ptr32 < (uint32_t *)(p->data() + p->length()))) {
-    uint32_t dst = *ptr32++;
-    uint32_t backlog = *ptr32++;
-    uint32_t distance = _enhanced ? *ptr32++ : 0;
-    HostBPInfo *neig_info = fb->findp(Flow(dst));
-    if (neig_info && neig_info->_static_distance)
-      fb->insert(Flow(dst), HostBPInfo(backlog, neig_info->_distance));
-    else
-      fb->insert(Flow(dst), HostBPInfo(backlog, distance)); //update neighbor's info
+// Setup handlers
+enum {H_PROBES, H_FULL_PROBES, H_SUPPRESSED, H_PIGGYBACKED, H_RECEIVED, H_CONTROL_BYTES, H_BYTES_SAVED, H_RESET};
+
+String BPStat::read_handler(Element *e, void *thunk) {
+
+  BPStat *b = static_cast<BPStat *>(e);
+
+  switch ((intptr_t)thunk) {
+    case H_PROBES:
+      return String(b->_nprobes);
+    case H_FULL_PROBES:
+      return String(b->_nfull);
+    case H_SUPPRESSED:
+      return String(b->_nsuppressed);
+    case H_PIGGYBACKED:
+      return String(b->_npiggybacked);
+    case H_RECEIVED:
+      return String(b->_nreceived);
+    case H_CONTROL_BYTES:
+      return String(b->_control_bytes);
+    case H_BYTES_SAVED:
+      return String((int64_t) (b->_full_bytes - b->_control_bytes));
   }
+  return "";
+}
 
-  p->kill();
+int BPStat::write_handler(const String &, Element *e, void *thunk, ErrorHandler *) {
+
+  BPStat *b = static_cast<BPStat *>(e);
+
+  switch ((intptr_t)thunk) {
+    case H_RESET:
+      b->reset_counters();
+      break;
+  }
   return 0;
 }
 
+void BPStat::add_handlers() {
+  add_read_handler("probes", read_handler, (void *)H_PROBES);
+  add_read_handler("full_probes", read_handler, (void *)H_FULL_PROBES);
+  add_read_handler("suppressed", read_handler, (void *)H_SUPPRESSED);
+  add_read_handler("piggybacked", read_handler, (void *)H_PIGGYBACKED);
+  add_read_handler("received", read_handler, (void *)H_RECEIVED);
+  add_read_handler("control_bytes", read_handler, (void *)H_CONTROL_BYTES);
+  add_read_handler("bytes_saved", read_handler, (void *)H_BYTES_SAVED);
+
+  add_write_handler("reset", write_handler, (void *)H_RESET);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(BPStat)
 #ifdef CLICK_OML
@@ -6,6 +6,8 @@
 #include <click/ipaddress.hh>
 #include <click/timer.hh>
 #include <click/packet.hh>
+#include <click/hashmap.hh>
+#include <clicknet/ether.h>
 #include <elements/wifi/linktable.hh>
 #include <elements/wifi/availablerates.hh>
 
@@ -15,6 +17,39 @@
 
 CLICK_DECLS
 
+#define BPSTAT_TRAILER_MAGIC 0x42505354U
+
+//  ==== probe format =====
+//   click_ether
+//   -- 4 optional bytes (IP of this node)
+//   -- 8 bytes (metric of this node)
+//   -- 2 bytes (number of flows)
+//   -- 12 or 8 bytes (flow dst & backlog & distance or flow dst & backlog)
+//   -- ...
+//  =======================
+//
+//  A piggybacked advertisement is the probe without its click_ether,
+//  appended to a data frame and followed by 2 bytes (the frame's own ether
+//  type), 2 bytes (the advertisement's length, network order) and 4 bytes
+//  (BPSTAT_TRAILER_MAGIC).  The frame's ether type is set to
+//  PIGGYBACK_ETHTYPE, which marks it as carrying the trailer; the receiver
+//  strips the trailer and restores the ether type.  A piggybacked
+//  advertisement reaches only the frame's next hop, so its flows are not
+//  taken as advertised, and the next advertisement is always broadcast.
+
+class FlowBatch {
+public:
+
+  Flow _f;
+  uint32_t _backlog;
+  uint32_t _distance;
+
+  FlowBatch() {}
+  FlowBatch(Flow f, uint32_t backlog, uint32_t distance) : _f(f), _backlog(backlog), _distance(distance) {}
+};
+
+typedef HashMap<Flow, FlowBatch> Flow_Batch_Table;
+
 class BPStat : public Element {
 public:
   
@@ -22,12 +57,19 @@ public:
   ~BPStat();
 
   const char* class_name() const { return "BPStat"; }
-  const char* port_count() const { return "1/1"; }
+  const char* port_count() const { return "1-3/="; }
   const char* processing() const { return PUSH; }
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
 
-  Packet *simple_action(Packet *);
+  // Input 0: received probes.  Inputs 1 and 2 (optional) pass outgoing and
+  // incoming data frames, which may carry piggybacked advertisements, on to
+  // the same numbered outputs.
+  void push(int, Packet *);
+
+  static String read_handler(Element *, void *);
+  static int write_handler(const String &, Element *, void *, ErrorHandler *);
+  void add_handlers();
 
 private:
 
@@ -37,6 +79,7 @@ private:
   BPData *_bpdata;
   DataQueues *_dataqueues;
   LinkTable *_link_table;
+  class RouteCache *_route_cache; // Distances from the RouteCache, if given, instead of LinkTable
   AvailableRates *_rtable; // Used (if given) on the retrieval of the basic transmission rate (2Mbps or 6Mbps)
   enum Layer _layer;
   bool _enhanced; // Enhanced Backpressure
@@ -46,6 +89,39 @@ private:
   Timer _timer;
   Timestamp _next;
 
+  // Delta advertisements: only flows whose backlog moved by more than
+  // _threshold (or whose distance changed) since they were last advertised
+  // are sent, with a full snapshot every _full_every probes.
+  bool _delta;
+  uint32_t _threshold;
+  uint32_t _full_every;
+  uint32_t _probes_to_full;
+  Flow_Batch_Table _advertised;
+  int64_t _advertised_metric;
+  bool _advertised_valid;
+  Vector<FlowBatch> _batches;
+
+  // Piggybacking: a due advertisement waits up to _piggyback_wait msecs
+  // for a data frame on input 1 with room for it before it is broadcast.
+  bool _piggyback;
+  uint16_t _piggyback_et; // ether type of frames carrying a trailer
+  unsigned _piggyback_wait; // msecs
+  bool _broadcast_next; // the last advertisement was piggybacked
+  unsigned _mtu;
+  Vector<FlowBatch> _pending;
+  int64_t _pending_metric;
+  bool _has_pending;
+  Timer _piggyback_timer;
+
+  // Counters
+  uint32_t _nprobes;
+  uint32_t _nfull;
+  uint32_t _nsuppressed;
+  uint32_t _npiggybacked;
+  uint32_t _nreceived;
+  uint64_t _control_bytes; // bytes of probes and trailers actually sent
+  uint64_t _full_bytes; // bytes that full snapshot probes would have needed
+
 #ifdef CLICK_OML
   OmlMP* mp;
   static OmlMPDef mp_bpstat[];
@@ -58,25 +134,15 @@ private:
 
   void run_timer(Timer *);
   void send_probe();
-};
-
-//  ==== probe format =====
-//   click_ether
-//   -- 4 optional bytes (IP of this node)
-//   -- 2 bytes (number of flows)
-//   -- 12 or 8 bytes (flow dst & backlog & distance or flow dst & backlog)
-//   -- ...
-//  =======================
-
-class FlowBatch {
-public:
-
-  Flow _f;
-  uint32_t _backlog;
-  uint32_t _distance;
-
-  FlowBatch() {}
-  FlowBatch(Flow f, uint32_t backlog, uint32_t distance) : _f(f), _backlog(backlog), _distance(distance) {}
+  void collect_batches(bool full, uint32_t *nflows);
+  uint32_t advert_length(int nbatches) const;
+  void write_advert(uint8_t *ptr, const Vector<FlowBatch> &batches, int64_t metric) const;
+  void mark_advertised(const Vector<FlowBatch> &batches, int64_t metric);
+  void output_probe(const Vector<FlowBatch> &batches, int64_t metric);
+  Packet *piggyback(Packet *);
+  Packet *strip_piggyback(Packet *);
+  void receive_advert(const click_ether *eh, const uint8_t *ptr, const uint8_t *end);
+  void reset_counters();
 };
 
 CLICK_ENDDECLS
@@ -1,14 +1,6 @@
 #ifndef DATAQUEUE_HH
 #define DATAQUEUE_HH
 
-#if CLICK_VERSION_CODE >= CLICK_MAKE_VERSION_CODE(2,0,1)
-#include <click/deque.hh>
-#define QUEUE_CLASS_NAME Deque
-#else
-#include <click/dequeue.hh>
-#define QUEUE_CLASS_NAME DEQueue
-#endif
-
 #include <click/packet.hh>
 #include <elements/wifi/sr/srpacket.hh>
 
@@ -34,96 +26,120 @@ protected:
 
 //// Unicast
 
-class DataQueue : public BPQueue {
+// A FIFO of packets linked through their next() pointers, so it needs no
+// memory beyond the packets themselves
+class PacketList {
 public:
 
-  Packet* front() { 
-    if (_video) {
-      if (sizeQI()) {return _QI.front();}
-      else if (sizeQP()) {return _QP.front();}
-    } 
-    return _Q.front();
+  PacketList() : _head(NULL), _tail(NULL), _size(0) {}
+
+  uint32_t size() const { return _size; }
+  Packet* front() const { return _head; }
+  Packet* back() const { return _tail; }
+  void push_back(Packet *p) {
+    p->set_next(NULL);
+    if (_tail) _tail->set_next(p);
+    else _head = p;
+    _tail = p;
+    _size++;
+  }
+  Packet* pop_front() {
+    Packet *p = _head;
+    _head = p->next();
+    if (!_head) _tail = NULL;
+    p->set_next(NULL);
+    _size--;
+    return p;
   }
+
+private:
+
+  Packet *_head;
+  Packet *_tail;
+  uint32_t _size;
+
+  PacketList(const PacketList &);
+  PacketList &operator=(const PacketList &);
+};
+
+// With video awareness, packets are kept in one list per FrameClass, as
+// read from FRAME_CLASS_ANNO.  They are served I frames first, then P
+// frames, then the rest, and dropped in the opposite order.  Bit c of
+// _nonempty is set when list c (FRAME_I + c) holds packets, so both
+// orders are a bit scan.  Without video awareness all packets share the
+// FRAME_OTHER list.  The lists share one limit of cap packets, and since
+// they are linked through the packets a queue costs the same with or
+// without video awareness.
+class DataQueue : public BPQueue {
+public:
+
+  Packet* front() { return _nonempty ? _Q[serve_class()].front() : NULL; }
   Packet* pop_front() { 
-    if (_video) {
-      if (sizeQI()) {Packet *p = _QI.front(); _QI.pop_front(); return p;}
-      else if (sizeQP()) {Packet *p = _QP.front(); _QP.pop_front(); return p;}
-    }
-    Packet *p = _Q.front(); _Q.pop_front(); return p;
+    if (!_nonempty) return NULL;
+    int c = serve_class();
+    Packet *p = _Q[c].pop_front();
+    if (!_Q[c].size()) _nonempty &= ~(1 << c);
+    return p;
   }
-  void drop_front() { 
-    add_drop();
-    if (_video) {
-      Packet *p;
-      if (sizeQ()) {p = _Q.front(); _Q.pop_front();}
-      else if (sizeQP()) {p = _QP.front(); _QP.pop_front();}
-      else {p = _QI.front(); _QI.pop_front();}
-      p->kill(); 
-      return;
-    }
-    Packet *p = _Q.front(); _Q.pop_front(); p->kill();
+  bool drop_front() { // drops the least important packet
+    if (!_nonempty) return false;
+    int c = drop_class();
+    _Q[c].pop_front()->kill();
+    if (!_Q[c].size()) _nonempty &= ~(1 << c);
+    _class_drops[c]++;
+    return true;
   }
-  Packet* back() { return _Q.back(); }
-  void push_back(Packet *p) {
-    if (_video) {
-      uint8_t ether_type_offset = _maclayer == WIFIQOS ? sizeof(click_wifi) + 2 + 6 : // 2 bytes QoS + 6 bytes ether_type offset in LLC
-                                 (_maclayer == WIFI ? sizeof(click_wifi) + 6 : 12);
-      uint16_t ether_type = *((uint16_t*)p->data() + ether_type_offset);
-      uint8_t mac_header_length = _maclayer == WIFIQOS ? sizeof(click_wifi) + 2 + sizeof(click_llc) : 
-                                 (_maclayer == WIFI ? sizeof(click_wifi) + sizeof(click_llc) : sizeof(click_ether));
-      void *data = NULL;
-      if (ether_type == 0x604) {
-        struct srpacket *pk = (struct srpacket *)(p->data() + mac_header_length);
-        data = (void *)pk->data();
-      } 
-      else { //if (ether_type == 0x800) {
-        data = (void *)(p->data() + mac_header_length);
-      }
-      //uint32_t iperf_seq = ntohl(*(uint32_t *)(data + sizeof(click_ip) + sizeof(click_udp)));
-      //click_chatter("iperf sequence number : %d", iperf_seq);
-      uint8_t nal_type = *(uint8_t *)(data + sizeof(click_ip) + sizeof(click_udp) + RTP_HEADER_LENGTH);
-      nal_type = nal_type & 0x1F; // The NAL type is the 5 last bits of the first byte of the NAL header
-      //click_chatter("H264 NAL type : %d", nal_type);
-
-      switch (nal_type) {
-        case 5: // I frame
-        case 6: // SEI frame
-        case 7: // SPS frame
-        case 8: // PPS frame
-          _QI.push_back(p);
-          return;
-        case 1: // P or B frame
-          _QP.push_back(p);
-          return;
-      }
+  Packet* back() { return _nonempty ? _Q[drop_class()].back() : NULL; } // the packet to be served last
+  bool push_back(Packet *p) {
+    int c = packet_class(p);
+    if (size() >= _capacity) {
+      reject(p);
+      return false;
     }
-    _Q.push_back(p); 
+    _Q[c].push_back(p);
+    _nonempty |= 1 << c;
+    return true;
+  }
+  void reject(Packet *p) { // drops a packet that does not fit
+    _class_drops[packet_class(p)]++;
+    add_drop();
+    p->kill();
   }
 
-  uint32_t size() { return _video ? _QI.size() + _QP.size() + _Q.size() : _Q.size(); }
-  uint32_t sizeQ() { return _Q.size(); }
-  uint32_t sizeQI() { return _QI.size(); }
-  uint32_t sizeQP() { return _QP.size(); }
+  uint32_t size() { return _Q[0].size() + _Q[1].size() + _Q[2].size(); }
+  uint32_t sizeQ() { return _Q[FRAME_OTHER - FRAME_I].size(); }
+  uint32_t sizeQI() { return _Q[FRAME_I - FRAME_I].size(); }
+  uint32_t sizeQP() { return _Q[FRAME_P - FRAME_I].size(); }
 
   uint32_t drops() { return _drops; }
   void add_drop() { _drops++; }
   void add_drops(uint32_t drops) { _drops += drops; }
   void remove_drops(uint32_t drops) { _drops = _drops > drops ? _drops - drops : 0 ; }
 
+  // Packets actually dropped, per FrameClass
+  uint32_t class_drops(enum FrameClass c) { return _class_drops[c - FRAME_I]; }
+
   uint32_t highwater_length() { return _highwater_length; }
   void set_highwater_length(uint32_t new_value) { _highwater_length = new_value; }
 
-  DataQueue(String key, uint32_t cap, enum Layer maclayer, uint32_t drops, bool video) : BPQueue(key, maclayer, video), _Q(), _QI(), _QP(),
-    _drops(drops), _highwater_length(0) { 
-    if (video) { _QI.reserve(cap/3); _QP.reserve(cap/3); _Q.reserve(cap/3); }
-    else { _Q.reserve(cap); }
+  DataQueue(String key, uint32_t cap, enum Layer maclayer, uint32_t drops, bool video) : BPQueue(key, maclayer, video), 
+    _capacity(cap), _nonempty(0), _drops(drops), _highwater_length(0) { 
+    memset(_class_drops, 0, sizeof(_class_drops));
   }
 
 private:
 
-  QUEUE_CLASS_NAME<Packet*> _Q;
-  QUEUE_CLASS_NAME<Packet*> _QI;
-  QUEUE_CLASS_NAME<Packet*> _QP;
+  int packet_class(Packet *p) {
+    uint8_t c = _video ? FRAME_CLASS_ANNO(p) : FRAME_OTHER;
+    return (c == FRAME_I || c == FRAME_P ? c : FRAME_OTHER) - FRAME_I;
+  }
+  int serve_class() { return __builtin_ctz(_nonempty); }
+  int drop_class() { return 31 - __builtin_clz(_nonempty); }
+
+  PacketList _Q[FRAME_CLASSES];
+  uint32_t _capacity;
+  uint32_t _nonempty;
+  uint32_t _class_drops[FRAME_CLASSES];
 
   uint32_t _drops;
   uint32_t _highwater_length;
@@ -26,6 +26,7 @@
 #include <typeinfo>
 
 #include "dataqueues.hh"
+#include "../roofnet/routecache.hh"
 
 CLICK_DECLS
 
@@ -83,6 +84,7 @@ int DataQueues::configure(Vector<String> &conf, ErrorHandler *errh) {
   _eth = EtherAddress();
   _bpdata = NULL;
   _link_table = NULL;
+  _route_cache = NULL;
   _arp_table = NULL;
   _capacity = _period = 0;
   _video = false;
@@ -100,6 +102,7 @@ int DataQueues::configure(Vector<String> &conf, ErrorHandler *errh) {
 			"ETH", 0, cpEtherAddress, &_eth,
 			"BPDATA", 0, cpElement, &_bpdata,
 			"LT", 0, cpElement, &_link_table,
+			"RC", 0, cpElement, &_route_cache,
 			"ARP", 0, cpElement, &_arp_table,
 			"CAPACITY", 0, cpUnsigned, &_capacity,
 			"PERIOD", 0, cpUnsigned, &_period,
@@ -136,6 +139,8 @@ int DataQueues::configure(Vector<String> &conf, ErrorHandler *errh) {
     return errh->error("BPDATA element is not a BPData");
   if (_routing == UNICAST && _link_table->cast("LinkTable") == 0) 
     return errh->error("LT element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RC element is not a RouteCache");
   if (_routing == UNICAST && _arp_table->cast("ARPTable") == 0) 
     return errh->error("ARP element is not a ARPTable");
   
@@ -204,8 +209,8 @@ IPAddress DataQueues::get_best_neighbor(Flow f, uint32_t *metric) {
   IPAddress dst(f._dst);
 
   uint32_t my_backlog = get_backlog(f);
-  Path shortest = _link_table->best_route(dst, true);
-  uint32_t my_distance = _link_table->get_route_metric(shortest);
+  Path shortest = _route_cache ? _route_cache->best_route(dst, true) : _link_table->best_route(dst, true);
+  uint32_t my_distance = _route_cache ? _route_cache->get_route_metric(dst, true) : _link_table->get_route_metric(shortest);
 
   if (!my_backlog || !my_distance || !_link_table->valid_route(shortest)) {
     *metric = 0;
@@ -223,10 +228,15 @@ IPAddress DataQueues::get_best_neighbor(Flow f, uint32_t *metric) {
 
   IPAddress best_neig = IPAddress(0);
   uint32_t max_bp_metric = 0;
-  for (Neig_Flow_BPInfo_Table::iterator nfb_iter = _bpdata->get_iterator(); nfb_iter.live(); nfb_iter++) {
+  int fi = _bpdata->flow_index(f, false);
+  for (int ni = 0; ni < _bpdata->nneighbors(); ni++) {
 
-    IPAddress neig(nfb_iter.key());
-    HostBPInfo *neig_info = nfb_iter.value()->findp(f);
+    // rows of neighbors known by Ethernet address (LAYER eth) have no IP
+    IPAddress neig = _bpdata->neighbor_ip(ni);
+    if (!neig)
+      continue;
+    HostBPInfo *neig_info = fi >= 0 ? _bpdata->info(ni, fi) : NULL;
+    if (neig_info && !neig_info->_valid) neig_info = NULL;
 
     uint32_t bp_metric = 0, diff_backlog = 0, diff_distance = 0;
     uint32_t ett_metric = _link_table->get_link_metric(_ip, neig);
@@ -292,8 +302,8 @@ DataQueue* DataQueues::next_pull_queue(IPAddress *max_neig) {
   /* 
    * Distributed Scheduling (MUST NOT BE ENABLED in nodes with both ethernet and wireless interfaces)
    *
-  for (Neig_Metric_Table::iterator nm_iter = _bpdata->get_metric_iterator(); nm_iter.live(); nm_iter++)
-    if (nm_iter.value() > _metric) 
+  for (int ni = 0; ni < _bpdata->nneighbors(); ni++)
+    if (_bpdata->has_metric(ni) && _bpdata->get_metric(ni) > _metric) 
       max_q = NULL;
   */
 
@@ -314,7 +324,6 @@ void DataQueues::do_periodically() {
     uint32_t q_drops = q->drops();
 
     uint32_t added_drops = 0;
-    Packet *dropped_packet;
     if (q_size > q_drops)
       added_drops = q_size < _dmax ? q_size : _dmax;
     q->add_drops(added_drops);
@@ -328,7 +337,7 @@ void DataQueues::do_periodically() {
       _dropped101 += added_drops;
     }
 #endif
-    while (added_drops-- && (dropped_packet = q->pop_front())) dropped_packet->kill();
+    while (added_drops-- && q->drop_front()) ;
 
     uint32_t removed_drops = 0;
     if (q_drops > _V)
@@ -426,6 +435,8 @@ DataQueue* DataQueues::get_related_queue(Packet *p) {
 void DataQueues::push(int port, Packet *p) {
 
   if (port == 0) { // Packets to be forwarded pass from here
+    if (_video && FRAME_CLASS_ANNO(p) == FRAME_UNKNOWN) // no BPFrameClass upstream
+      SET_FRAME_CLASS_ANNO(p, BPFrameClass::classify(p, _maclayer, BPFrameClass::DEFAULT_ETHTYPE));
     DataQueue *q = get_related_queue(p);
     uint32_t queue_size = q->size();  
 
@@ -448,8 +459,7 @@ void DataQueues::push(int port, Packet *p) {
         _dropped101++;
       }
 #endif
-      p->kill();  
-      q->add_drop();
+      q->reject(p);
     }
   } 
   else if (port == 1) { // Received packets pass from here
@@ -524,7 +534,9 @@ String DataQueues::read_handler(Element *e, void *thunk) {
         else ret += String(q->size()) + " (Q:" + String(q->sizeQ()) + ",QI:" + String(q->sizeQI()) + ",QP:" + String(q->sizeQP()) + ")"; 
         break;
       case H_DROPS:
-        ret += String(q->drops()); break;
+        if (!d->_video) ret += String(q->drops());
+        else ret += String(q->drops()) + " (Q:" + String(q->class_drops(FRAME_OTHER)) + ",QI:" + String(q->class_drops(FRAME_I)) + ",QP:" + String(q->class_drops(FRAME_P)) + ")"; 
+        break;
       case H_HIGHWATER_LENGTH:
         ret += String(q->highwater_length()); break;
     }
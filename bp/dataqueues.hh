@@ -16,6 +16,7 @@
 #include "bpdata.hh"
 #include "bpflow.hh"
 #include "dataqueue.hh"
+#include "bpframeclass.hh"
 
 #include <click/config.h>
 #ifdef CLICK_OML
@@ -77,6 +78,7 @@ protected:
   EtherAddress _eth; 
   BPData *_bpdata;
   LinkTable *_link_table;
+  class RouteCache *_route_cache; // Routes from the RouteCache, if given, instead of LinkTable
   ARPTable *_arp_table;
   bool _video; // Video awareness
   enum Layer _maclayer; // The MAC Layer of the received packets (Ethernet, WiFi, WiFiQos)
@@ -145,7 +145,7 @@ DataQueue* DataQueuesMulticast::next_pull_queue() {
       uint32_t *wp = _weights.findp(q->key());
       assert(wp);
       int64_t my_backlog = (*wp) * q->size();
-      HostBPInfo *neig_info = _bpdata->get_info(neig.unparse_colon(), f);
+      HostBPInfo *neig_info = _bpdata->get_info(neig, f);
       int64_t neig_backlog = neig_info ? (int32_t)(neig_info->_backlog) : 0 ;
 
       int64_t diff = (my_backlog - neig_backlog) * rate;
@@ -162,8 +162,8 @@ DataQueue* DataQueuesMulticast::next_pull_queue() {
   /* 
    * Distributed Scheduling (MUST NOT BE ENABLED in nodes with both ethernet and wireless interfaces)
    *
-  for (Neig_Metric_Table::iterator nm_iter = _bpdata->get_metric_iterator(); nm_iter.live(); nm_iter++)
-    if (nm_iter.value() > _metric) 
+  for (int ni = 0; ni < _bpdata->nneighbors(); ni++)
+    if (_bpdata->has_metric(ni) && _bpdata->get_metric(ni) > _metric) 
       max_q = NULL;
   */
 
@@ -188,14 +188,13 @@ void DataQueuesMulticast::do_periodically() {
         uint32_t q_drops = q->drops();
 
         uint32_t added_drops = 0;
-        Packet *dropped_packet;
         if (q_size > q_drops)
           added_drops = q_size < _dmax ? q_size : _dmax;
         q->add_drops(added_drops);
 #ifdef CLICK_OML
         dropped += added_drops;
 #endif
-        while (added_drops-- && (dropped_packet = q->pop_front())) dropped_packet->kill();
+        while (added_drops-- && q->drop_front()) ;
 
         uint32_t removed_drops = 0;
         if (q_drops > (_policy == MMT ? _V : _V * _theta))
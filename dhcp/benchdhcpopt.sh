@@ -0,0 +1,89 @@
+#! /bin/sh
+
+# benchdhcpopt.sh -- compare DHCP option lookups on captured DHCP traffic
+#
+# Replays tcpdump captures of DHCP traffic through DHCPOptionBench, which
+# looks up the same options in each packet by rescanning the options for
+# every lookup (DHCPOptionUtil::fetch_next) and through the one-pass index
+# (DHCPOptionUtil::Options).  Reports mean CPU cycles per packet each way,
+# the speedup, and packets where the two disagree.
+#
+# Needs a click built with the dhcp package installed.
+
+usage () {
+    echo "Usage: benchdhcpopt.sh [--rounds N] [--options 'CODE...'] [--workdir DIR] CAPTURE..." 1>&2
+    exit 1
+}
+
+workdir="${TMPDIR:-/tmp}/benchdhcpopt.$$"
+keepwork=0
+rounds=100
+options=''
+
+while test $# -gt 0; do
+    case "$1" in
+      --rounds)
+	test $# -ge 2 || usage
+	rounds="$2"; shift 2;;
+      --options)
+	test $# -ge 2 || usage
+	options="$2"; shift 2;;
+      --workdir)
+	test $# -ge 2 || usage
+	workdir="$2"; keepwork=1; shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+test $# -ge 1 || usage
+
+mkdir -p "$workdir" || exit 1
+test $keepwork = 1 || trap 'rm -rf "$workdir"' 0
+
+# makeconfig CAPTURE
+makeconfig () {
+    optarg=""
+    test -n "$options" && optarg=", OPTIONS $options"
+    echo "
+require(dhcp)
+FromDump(\"$1\", STOP true, FORCE_IP true)
+    -> c :: IPClassifier(udp port 67 or udp port 68, -);
+c[0] -> bench :: DHCPOptionBench(ROUNDS $rounds$optarg) -> Discard;
+c[1] -> Discard;
+DriverManager(wait, print bench.stats)"
+}
+
+# field FILE KEY -- value of the "KEY value" line in FILE
+field () {
+    awk -v k="$2" '$1 == k { print $2; exit }' "$1"
+}
+
+status=0
+printf '%-24s %9s %9s %7s %10s %10s %7s %10s\n' \
+    capture packets dhcp found scan_cyc index_cyc speedup mismatches
+
+for cap in "$@"; do
+    name=`basename "$cap"`
+    out="$workdir/$name.out"
+    if ! click -e "`makeconfig "$cap"`" > "$out"; then
+	echo "benchdhcpopt.sh: $cap: click failed" 1>&2
+	status=1
+	continue
+    fi
+
+    mismatches=`field $out mismatches`
+    if test "$mismatches" != 0; then
+	echo "benchdhcpopt.sh: $cap: $mismatches packets where the index disagrees with fetch_next" 1>&2
+	status=1
+    fi
+    echo "`field $out packets` `field $out dhcp` `field $out found` `field $out scan_cycles` `field $out index_cycles` $mismatches" \
+	| awk -v n="$name" '{
+	    speedup = ($5 > 0 ? sprintf("%.1f", $4 / $5) : "-");
+	    printf "%-24s %9d %9d %7.2f %10d %10d %7s %10d\n", n, $1, $2, $3, $4, $5, speedup, $6
+	}'
+done
+
+exit $status
@@ -78,7 +78,8 @@ void DHCPClient::save_lease(Packet *p)
     const dhcpMessage *dm = reinterpret_cast<const dhcpMessage *>(p->transport_header() + sizeof(click_udp));
     _my_ip = IPAddress(dm->yiaddr);
 
-    if (const uint8_t *leaseo = DHCPOptionUtil::fetch(p, DHO_DHCP_LEASE_TIME, 4)) {
+    // push has parsed p's options into _opts
+    if (const uint8_t *leaseo = _opts.fetch(DHO_DHCP_LEASE_TIME, 4)) {
 	_lease_duration = (leaseo[0] << 24) | (leaseo[1] << 16) | (leaseo[2] << 8) | leaseo[3];
   
 	// set up T1 , T2  and the lease expiration timers 
@@ -99,7 +100,7 @@ void DHCPClient::save_lease(Packet *p)
 	    _timers[i].unschedule();
     }
 
-    if (const uint8_t *srvo = DHCPOptionUtil::fetch(p, DHO_DHCP_SERVER_IDENTIFIER, 4))
+    if (const uint8_t *srvo = _opts.fetch(DHO_DHCP_SERVER_IDENTIFIER, 4))
 	_server_ip = IPAddress(srvo);
     else
 	_server_ip = IPAddress();
@@ -114,7 +115,8 @@ void DHCPClient::save_lease(Packet *p)
 void 
 DHCPClient::push(int, Packet *p)
 {
-    const uint8_t *mtype = DHCPOptionUtil::fetch(p, DHO_DHCP_MESSAGE_TYPE, 1);
+    _opts.parse(p);
+    const uint8_t *mtype = _opts.fetch(DHO_DHCP_MESSAGE_TYPE, 1);
     const dhcpMessage *dm = reinterpret_cast<const dhcpMessage *>(p->transport_header() + sizeof(click_udp));
 
     if (!mtype || dm->xid != _curr_xid || dm->htype != ARPHRD_ETHER
@@ -324,7 +326,8 @@ Packet *DHCPClient::make_request(Packet *offer)
     }
     
     // request lease time
-    const uint8_t *leaseo = DHCPOptionUtil::fetch(offer, DHO_DHCP_LEASE_TIME, 4);
+    _opts.parse(offer);
+    const uint8_t *leaseo = _opts.fetch(DHO_DHCP_LEASE_TIME, 4);
     if (!leaseo)  
 	click_chatter("\tno lease time specified!!!!!!");
     else {
@@ -336,7 +339,7 @@ Packet *DHCPClient::make_request(Packet *offer)
   
     // server identifier
     if (_state == DHCP_CLIENT_SELECTING_STATE)
-	if (const uint8_t *servero = DHCPOptionUtil::fetch(offer, DHO_DHCP_SERVER_IDENTIFIER, 4)) {
+	if (const uint8_t *servero = _opts.fetch(DHO_DHCP_SERVER_IDENTIFIER, 4)) {
 	    *o++ = DHO_DHCP_SERVER_IDENTIFIER;
 	    *o++ = 4;
 	    memcpy(o, servero, 4);
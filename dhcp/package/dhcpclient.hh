@@ -1,6 +1,7 @@
 #ifndef DHCPCLIENT_HH
 #define DHCPCLIENT_HH
 #include "dhcp_common.hh"
+#include "dhcpoptionutil.hh"
 #include <click/element.hh>
 #include <click/timer.hh>
 #include <click/etheraddress.hh>
@@ -159,6 +160,8 @@ private:
 
     HandlerCall *_lease_call;
 
+    DHCPOptionUtil::Options _opts;	// of the packet being handled
+
     WritablePacket *make_bootrequest(int mtype, uint32_t ciaddr, uint32_t xid);
     void choose_offer();
     void save_lease(Packet *p);
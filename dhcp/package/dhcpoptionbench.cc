@@ -0,0 +1,154 @@
+/*
+ * dhcpoptionbench.{cc,hh} -- time DHCP option lookups
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/error.hh>
+#include <click/args.hh>
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <clicknet/udp.h>
+#include "dhcp_common.hh"
+#include "dhcpoptionbench.hh"
+CLICK_DECLS
+
+DHCPOptionBench::DHCPOptionBench()
+{
+    reset();
+}
+
+DHCPOptionBench::~DHCPOptionBench()
+{
+}
+
+int
+DHCPOptionBench::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String options = "53 54 50 51 1 3 6 12 55 61";
+    _rounds = 100;
+    if (Args(conf, this, errh)
+	.read("OPTIONS", AnyArg(), options)
+	.read("ROUNDS", _rounds)
+	.complete() < 0)
+	return -1;
+
+    Vector<String> words;
+    cp_spacevec(options, words);
+    _options.clear();
+    for (int i = 0; i < words.size(); i++) {
+	int o;
+	if (!IntArg().parse(words[i], o) || o <= DHO_PAD || o >= DHO_END)
+	    return errh->error("bad option code %<%s%>", words[i].c_str());
+	_options.push_back(o);
+    }
+    if (!_options.size() || !_rounds)
+	return errh->error("OPTIONS and ROUNDS must not be empty");
+    if (_options.size() > MAX_OPTIONS)
+	return errh->error("at most %d OPTIONS", (int) MAX_OPTIONS);
+    return 0;
+}
+
+Packet *
+DHCPOptionBench::simple_action(Packet *p)
+{
+    _packets++;
+    int n = _options.size();
+    const uint8_t *scanned[MAX_OPTIONS];
+
+    click_cycles_t start = click_get_cycles();
+    for (uint32_t r = 0; r < _rounds; r++)
+	for (int i = 0; i < n; i++) {
+	    int overload;
+	    scanned[i] = DHCPOptionUtil::fetch_next(p, _options[i], overload);
+	}
+    click_cycles_t middle = click_get_cycles();
+    bool dhcp = false;
+    uintptr_t sink = 0;
+    for (uint32_t r = 0; r < _rounds; r++) {
+	dhcp = _opts.parse(p);
+	for (int i = 0; i < n; i++)
+	    sink += (uintptr_t) _opts.find(_options[i]);
+    }
+    click_cycles_t end = click_get_cycles();
+    _sink += sink;
+
+    _scan_cycles += middle - start;
+    _index_cycles += end - middle;
+    if (dhcp) {
+	_dhcp++;
+	bool same = true;
+	for (int i = 0; i < n; i++) {
+	    const uint8_t *o = _opts.find(_options[i]);
+	    same = same && o == scanned[i];
+	    _found += (o != 0);
+	}
+	if (!same)
+	    _mismatches++;
+    }
+    return p;
+}
+
+void
+DHCPOptionBench::reset()
+{
+    _packets = _dhcp = _mismatches = 0;
+    _found = _scan_cycles = _index_cycles = 0;
+    _sink = 0;
+}
+
+enum { H_STATS, H_RESET };
+
+String
+DHCPOptionBench::read_handler(Element *e, void *thunk)
+{
+    DHCPOptionBench *b = (DHCPOptionBench *)e;
+    switch ((uintptr_t) thunk) {
+    case H_STATS: {
+	uint64_t lookups = (uint64_t) b->_packets * b->_rounds;
+	StringAccum sa;
+	sa << "packets " << b->_packets << "\n";
+	sa << "dhcp " << b->_dhcp << "\n";
+	sa << "found " << (b->_dhcp ? (double) b->_found / b->_dhcp : 0) << "\n";
+	sa << "scan_cycles " << (lookups ? b->_scan_cycles / lookups : 0) << "\n";
+	sa << "index_cycles " << (lookups ? b->_index_cycles / lookups : 0) << "\n";
+	sa << "mismatches " << b->_mismatches << "\n";
+	return sa.take_string();
+    }
+    default:
+	return String();
+    }
+}
+
+int
+DHCPOptionBench::write_handler(const String &, Element *e, void *thunk, ErrorHandler *)
+{
+    DHCPOptionBench *b = (DHCPOptionBench *)e;
+    switch ((uintptr_t) thunk) {
+    case H_RESET:
+	b->reset();
+	return 0;
+    default:
+	return -1;
+    }
+}
+
+void
+DHCPOptionBench::add_handlers()
+{
+    add_read_handler("stats", read_handler, (void *) H_STATS);
+    add_write_handler("reset", write_handler, (void *) H_RESET);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(DHCPOptionBench)
+ELEMENT_REQUIRES(DHCPOptionUtil)
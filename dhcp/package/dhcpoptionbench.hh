@@ -0,0 +1,96 @@
+#ifndef DHCPOPTIONBENCH_HH
+#define DHCPOPTIONBENCH_HH
+#include <click/element.hh>
+#include <click/vector.hh>
+#include "dhcpoptionutil.hh"
+CLICK_DECLS
+
+/*
+ * =c
+ * DHCPOptionBench([I<keywords>])
+ *
+ * =s DHCP
+ * Times DHCP option lookups.
+ *
+ * =d
+ *
+ * Looks up a list of options in each DHCP packet that passes, ROUNDS times
+ * with DHCPOptionUtil::fetch_next, which rescans the options for every
+ * option, and ROUNDS times with DHCPOptionUtil::Options, which indexes them
+ * once per packet, and counts the CPU cycles each way takes.  Both must
+ * find the same options; packets where they do not are counted as
+ * mismatches.  Packets leave unchanged.  Expects packets with their IP and
+ * transport header annotations set.
+ *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item OPTIONS
+ *
+ * Space-separated list of at most 64 option codes.  Defaults to the
+ * options the DHCP elements look for plus a few clients often send: 53 54
+ * 50 51 1 3 6 12 55 61.
+ *
+ * =item ROUNDS
+ *
+ * Unsigned.  Times each packet is looked up each way.  Defaults to 100.
+ *
+ * =back
+ *
+ * =h stats read-only
+ *
+ * Packets seen and parsed as DHCP, options found per packet, mean CPU
+ * cycles per packet each way, and mismatches.
+ *
+ * =h reset write-only
+ *
+ * Zeroes the counters.
+ *
+ * =e
+ * FromDump(dhcp.pcap, STOP true, FORCE_IP true)
+ *   -> IPClassifier(udp port 67 or udp port 68)
+ *   -> bench :: DHCPOptionBench
+ *   -> Discard;
+ * DriverManager(wait, print bench.stats)
+ *
+ * =a
+ * DHCPClassifier
+ */
+
+class DHCPOptionBench : public Element {
+public:
+    DHCPOptionBench();
+    ~DHCPOptionBench();
+
+    const char *class_name() const	{ return "DHCPOptionBench"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+    const char *processing() const	{ return AGNOSTIC; }
+
+    int configure(Vector<String> &conf, ErrorHandler *errh);
+    Packet *simple_action(Packet *p);
+    void add_handlers();
+
+    void reset();
+
+private:
+    enum { MAX_OPTIONS = 64 };
+
+    Vector<int> _options;
+    uint32_t _rounds;
+    DHCPOptionUtil::Options _opts;
+
+    uint32_t _packets;
+    uint32_t _dhcp;
+    uint64_t _found;
+    uint64_t _scan_cycles;
+    uint64_t _index_cycles;
+    uint32_t _mismatches;
+    uintptr_t _sink;		// keeps the timed lookups from being optimized out
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+};
+
+CLICK_ENDDECLS
+#endif
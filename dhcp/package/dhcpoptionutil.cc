@@ -14,7 +14,7 @@ const uint8_t *fetch_next(Packet *p, int want_option, int &overload,
 
     // find currently relevant options area
     if (!o) {
-	if (p->transport_length() < sizeof(dhcpMessage) - DHCP_OPTIONS_SIZE
+	if (p->transport_length() < sizeof(click_udp) + sizeof(dhcpMessage) - DHCP_OPTIONS_SIZE
 	    || dm->magic != DHCP_MAGIC)
 	    return 0;
 	o = dm->options;
@@ -67,6 +67,56 @@ const uint8_t *fetch(Packet *p, int want_option, int expected_length)
     return (o && o[1] == expected_length ? o + 2 : 0);
 }
 
+Options::Options()
+    : _base(0), _n(0)
+{
+    memset(_off, 0, sizeof(_off));
+}
+
+bool
+Options::parse(Packet *p)
+{
+    for (int i = 0; i < _n; i++)
+	_off[_codes[i]] = 0;
+    _n = 0;
+
+    const dhcpMessage *dm = reinterpret_cast<const dhcpMessage *>(p->transport_header() + sizeof(click_udp));
+    _base = reinterpret_cast<const uint8_t *>(dm);
+    if (p->transport_length() < sizeof(click_udp) + sizeof(dhcpMessage) - DHCP_OPTIONS_SIZE
+	|| dm->magic != DHCP_MAGIC)
+	return false;
+
+    int overload = 0;
+    scan(dm->options, p->end_data(), &overload);
+    if (overload == 1 || overload == 3)
+	scan(dm->file, dm->file + sizeof(dm->file), 0);
+    if (overload == 2 || overload == 3)
+	scan(dm->sname, dm->sname + sizeof(dm->sname), 0);
+    return true;
+}
+
+// Records the options in [o, oend), and the overload option's value in
+// *overload if overload is not null
+void
+Options::scan(const uint8_t *o, const uint8_t *oend, int *overload)
+{
+    while (o + 1 < oend)
+	if (*o == DHO_PAD)
+	    ++o;
+	else if (*o == DHO_END || o + 2 + o[1] > oend)
+	    break;
+	else {
+	    if (!_off[*o]) {
+		_off[*o] = o - _base + 1;
+		_codes[_n++] = *o;
+	    }
+	    if (*o == DHO_DHCP_OPTION_OVERLOAD && overload && *overload == 0
+		&& o[1] == 1 && o[2] <= 3)
+		*overload = o[2];
+	    o += 2 + o[1];
+	}
+}
+
 uint32_t rand_exp_backoff(uint32_t backoff_center)
 {
     uint32_t dice = click_random();
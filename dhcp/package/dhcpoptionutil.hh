@@ -9,6 +9,45 @@ const uint8_t *fetch_next(Packet *p, int want_option, int &overload,
 			  const uint8_t *o = 0);
 const uint8_t *fetch(Packet *p, int want_option, int expected_length);
 
+/*
+ * Options indexes the options of one DHCP message in a single pass over
+ * the options area and, if the overload option asks for them, the file and
+ * sname fields, in the order fetch_next searches them; the first instance
+ * of each option wins.  After parse, find and fetch are a table lookup.
+ * One Options object serves packet after packet: parse only clears the
+ * entries the previous packet set.
+ */
+class Options { public:
+
+    Options();
+
+    // Returns false, with no options found, if p is not a DHCP message
+    bool parse(Packet *p);
+
+    // The option's code byte, or 0 if the message does not have it
+    const uint8_t *find(int option) const {
+	return _off[option] ? _base + _off[option] - 1 : 0;
+    }
+
+    // The option's data if its length is expected_length, else 0
+    const uint8_t *fetch(int option, int expected_length) const {
+	const uint8_t *o = find(option);
+	return (o && o[1] == expected_length ? o + 2 : 0);
+    }
+
+    int size() const			{ return _n; }
+
+  private:
+
+    const uint8_t *_base;		// start of the dhcpMessage
+    uint16_t _off[256];			// option's offset from _base + 1, or 0
+    uint8_t _codes[256];		// options set in _off
+    int _n;
+
+    void scan(const uint8_t *o, const uint8_t *oend, int *overload);
+
+};
+
 uint32_t rand_exp_backoff(uint32_t backoff_center);
 
 Packet *push_dhcp_udp_header(Packet *, IPAddress);
@@ -58,11 +58,12 @@ DHCPServerACKorNAK::push(int, Packet *p)
 	IPAddress requested_ip = IPAddress(0);
 	Lease *lease = _leases->rev_lookup(eth);
 	IPAddress server = IPAddress(0);
-	const uint8_t *o = DHCPOptionUtil::fetch(p, DHO_DHCP_SERVER_IDENTIFIER, 4);
+	_opts.parse(p);
+	const uint8_t *o = _opts.fetch(DHO_DHCP_SERVER_IDENTIFIER, 4);
 	if (o)
 	    server = IPAddress(o);
 	
-	o = DHCPOptionUtil::fetch(p, DHO_DHCP_REQUESTED_ADDRESS, 4);
+	o = _opts.fetch(DHO_DHCP_REQUESTED_ADDRESS, 4);
 	if (o)
 	    requested_ip = IPAddress(o);
 
@@ -78,8 +79,9 @@ DHCPServerACKorNAK::push(int, Packet *p)
 	} else if (server && !ciaddr && requested_ip) {
 		/* SELECTING */
 		if(lease && lease->_ip == requested_ip) {
-			q = make_ack_packet(p, lease);
 			lease->_valid = true;
+			_leases->extend(lease);
+			q = make_ack_packet(p, lease);
 		}
 	} else if (!server && requested_ip && !ciaddr) {
 		/* INIT-REBOOT */
@@ -92,6 +94,7 @@ DHCPServerACKorNAK::push(int, Packet *p)
 					q = make_nak_packet(p, lease);
 				} else {
 					lease->_valid = true;
+					_leases->extend(lease);
 					q = make_ack_packet(p, lease);
 				}
 			}
@@ -100,7 +103,7 @@ DHCPServerACKorNAK::push(int, Packet *p)
 		/* RENEW or REBIND */
 		if (lease) {
 			lease->_valid = true;
-			lease->extend();
+			_leases->extend(lease);
 			q = make_ack_packet(p, lease);
 		}
 	} else {
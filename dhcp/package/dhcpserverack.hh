@@ -3,6 +3,7 @@
 
 #include <click/element.hh>
 #include "leasetable.hh"
+#include "dhcpoptionutil.hh"
 
 /*
  * =c
@@ -41,5 +42,6 @@ public:
 
 private:
   DHCPLeaseTable *_leases;
+  DHCPOptionUtil::Options _opts;
 };
 #endif
@@ -0,0 +1,97 @@
+#ifndef LEASEBITMAP_HH
+#define LEASEBITMAP_HH
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <click/integers.hh>
+CLICK_DECLS
+
+/*
+ * LeaseBitmap tracks which of the N addresses of a pool are taken, one bit
+ * per address, plus one summary bit per 32-address word that is set when
+ * the word is full.  Taking and freeing an address are constant time;
+ * find_free() looks at the word it starts in and then at the summary, so a
+ * search skips full stretches of the pool 1024 addresses at a time.
+ */
+class LeaseBitmap { public:
+
+    LeaseBitmap()
+	: _n(0), _nfree(0) {
+    }
+
+    // Sizes the bitmap for n addresses, all free
+    void resize(uint32_t n) {
+	_n = _nfree = n;
+	_bits.assign((n + 31) / 32, 0);
+	_full.assign((_bits.size() + 31) / 32, 0);
+	// bits past the end of the pool read as taken
+	if (n % 32) {
+	    _bits.back() = ~0U << (n % 32);
+	}
+    }
+
+    uint32_t size() const		{ return _n; }
+    uint32_t nfree() const		{ return _nfree; }
+
+    bool taken(uint32_t i) const {
+	return _bits[i / 32] & (1U << (i % 32));
+    }
+
+    void take(uint32_t i) {
+	if (!taken(i)) {
+	    _bits[i / 32] |= 1U << (i % 32);
+	    _nfree--;
+	    if (_bits[i / 32] == ~0U)
+		_full[i / 1024] |= 1U << ((i / 32) % 32);
+	}
+    }
+
+    void release(uint32_t i) {
+	if (taken(i)) {
+	    _bits[i / 32] &= ~(1U << (i % 32));
+	    _full[i / 1024] &= ~(1U << ((i / 32) % 32));
+	    _nfree++;
+	}
+    }
+
+    // The first free address at or after 'from', wrapping around to the
+    // start of the pool; -1 if the pool is full
+    int32_t find_free(uint32_t from) const {
+	if (!_nfree)
+	    return -1;
+	if (from >= _n)
+	    from = 0;
+	uint32_t w = from / 32;
+	uint32_t free = ~_bits[w] & (~0U << (from % 32));
+	if (free)
+	    return w * 32 + ffs_lsb(free) - 1;
+	uint32_t nwords = _bits.size();
+	for (uint32_t k = 1; k <= nwords; k++) {
+	    uint32_t x = (w + k) % nwords;
+	    // skip to the next word the summary says is not full
+	    uint32_t notfull = ~_full[x / 32] & (~0U << (x % 32));
+	    if (!notfull) {
+		k += 31 - x % 32;
+		continue;
+	    }
+	    uint32_t y = (x / 32) * 32 + ffs_lsb(notfull) - 1;
+	    if (y >= nwords) {
+		k += nwords - 1 - x;
+		continue;
+	    }
+	    k += y - x;
+	    return y * 32 + ffs_lsb(~_bits[y]) - 1;
+	}
+	return -1;
+    }
+
+  private:
+
+    uint32_t _n;
+    uint32_t _nfree;
+    Vector<uint32_t> _bits;	// bit set: address taken
+    Vector<uint32_t> _full;	// bit set: word of _bits full
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -18,16 +18,27 @@
 #include <click/config.h>
 #include <click/error.hh>
 #include <click/args.hh>
+#include <click/confparse.hh>
 #include <click/etheraddress.hh>
 #include <clicknet/ip.h>
 #include <clicknet/udp.h>
 #include <click/straccum.hh>
 #include "leasepool.hh"
+#if CLICK_USERLEVEL
+# include <stdio.h>
+# include <errno.h>
+# include <unistd.h>
+#endif
 
 CLICK_DECLS
 
 LeasePool::LeasePool()
+    : _next(0), _wheel_now(0), _expire_timer(this), _nexpired(0),
+      _compact_timer(this), _journal_records(0)
 {
+#if CLICK_USERLEVEL
+    _journal = 0;
+#endif
 }
 
 LeasePool::~LeasePool()
@@ -43,6 +54,19 @@ LeasePool::cast(const char *n)
         return DHCPLeaseTable::cast(n);
 }
 
+bool
+LeasePool::in_pool(IPAddress ip) const
+{
+    uint32_t x = ntohl(ip.addr());
+    return x >= ntohl(_start.addr()) && x <= ntohl(_end.addr());
+}
+
+uint32_t
+LeasePool::offset(IPAddress ip) const
+{
+    return ntohl(ip.addr()) - ntohl(_start.addr());
+}
+
 Lease *
 LeasePool::new_lease_any(EtherAddress eth)
 {
@@ -50,14 +74,12 @@ LeasePool::new_lease_any(EtherAddress eth)
     if (l) {
         return l;
     }
-    while (_free_list.size()) {
-        IPAddress next = _free_list[0];
-        _free_list.pop_front();
-        if (_free.find(next)) {
-            return new_lease(eth, next);
-        }
+    int32_t i = _taken.find_free(_next);
+    if (i < 0) {
+        return 0;
     }
-    return 0;
+    _next = i + 1;
+    return new_lease(eth, IPAddress(htonl(ntohl(_start.addr()) + i)));
 }
 
 Lease *
@@ -67,13 +89,14 @@ LeasePool::new_lease(EtherAddress eth, IPAddress ip)
     if (l) {
         return l;
     }
-    if (_free.get(ip)) {
+    if (in_pool(ip) && !_taken.taken(offset(ip))) {
         Lease l;
         l._eth = eth;
         l._ip = ip;
         l._start = Timestamp::now();
-        l._end = l._start + Timestamp(60, 0);
-        l._duration = l._end - l._start;
+        l._duration = Timestamp(_default_duration, 0);
+        l._end = l._start + l._duration;
+        l._valid = false;
         insert(l);
         return lookup(ip);
     }
@@ -82,38 +105,390 @@ LeasePool::new_lease(EtherAddress eth, IPAddress ip)
 
 bool
 LeasePool::insert(Lease l) {
-    _free.erase(l._ip);
+    Lease *old = rev_lookup(l._eth);
+    if (old && old->_ip != l._ip) {
+        release(old);
+    }
+    if (in_pool(l._ip)) {
+        uint32_t off = offset(l._ip);
+        _taken.take(off);
+        schedule(off, l._end.sec());
+    }
+    journal_lease(&l);
     return DHCPLeaseTable::insert(l);
 }
 
+void
+LeasePool::extend(Lease *l)
+{
+    l->extend();
+    if (in_pool(l->_ip)) {
+        schedule(offset(l->_ip), l->_end.sec());
+    }
+    journal_lease(l);
+}
+
 void
 LeasePool::remove(EtherAddress eth) {
     if (Lease *l = rev_lookup(eth)) {
-        _free.set(l->_ip, l->_ip);
-        _free_list.push_back(l->_ip);
+        release(l);
+    }
+}
+
+void
+LeasePool::release(Lease *l)
+{
+    IPAddress ip = l->_ip;
+    EtherAddress eth = l->_eth;
+    if (in_pool(ip)) {
+        uint32_t off = offset(ip);
+        _taken.release(off);
+        unschedule(off);
+    }
+    journal_free(ip);
+    DHCPLeaseTable::remove(eth);
+}
+
+/*
+ * The timing wheel.  A lease ending in second s sits in slot
+ * s % WHEEL_SLOTS; each tick looks at one slot and expires the leases in
+ * it whose end has come, leaving those a whole turn or more away.
+ * _wend[off] is 0 for an address that is not on the wheel.
+ */
+void
+LeasePool::schedule(uint32_t off, uint32_t end_sec)
+{
+    unschedule(off);
+    if (end_sec <= _wheel_now) {
+        end_sec = _wheel_now + 1;
+    }
+    uint32_t *head = &_slot[end_sec % WHEEL_SLOTS];
+    _wend[off] = end_sec;
+    _wprev[off] = NIL;
+    _wnext[off] = *head;
+    if (*head != NIL) {
+        _wprev[*head] = off;
+    }
+    *head = off;
+}
+
+void
+LeasePool::unschedule(uint32_t off)
+{
+    if (!_wend[off]) {
+        return;
+    }
+    if (_wprev[off] != NIL) {
+        _wnext[_wprev[off]] = _wnext[off];
+    } else {
+        _slot[_wend[off] % WHEEL_SLOTS] = _wnext[off];
+    }
+    if (_wnext[off] != NIL) {
+        _wprev[_wnext[off]] = _wprev[off];
+    }
+    _wend[off] = 0;
+}
+
+void
+LeasePool::expire(uint32_t now)
+{
+    // after a stall, one turn of the wheel catches up with every slot
+    if (now - _wheel_now > WHEEL_SLOTS) {
+        _wheel_now = now - WHEEL_SLOTS;
+    }
+    while (_wheel_now < now) {
+        _wheel_now++;
+        uint32_t off = _slot[_wheel_now % WHEEL_SLOTS];
+        while (off != NIL) {
+            uint32_t next = _wnext[off];
+            if (_wend[off] <= _wheel_now) {
+                if (Lease *l = lookup(IPAddress(htonl(ntohl(_start.addr()) + off)))) {
+                    release(l);
+                    _nexpired++;
+                } else {
+                    unschedule(off);
+                }
+            }
+            off = next;
+        }
     }
-    return DHCPLeaseTable::remove(eth);
+}
+
+void
+LeasePool::run_timer(Timer *t)
+{
+    if (t == &_expire_timer) {
+        expire(Timestamp::now().sec());
+        _expire_timer.reschedule_after_sec(1);
+    } else if (t == &_compact_timer) {
+        if (_journal_records > 2 * (uint32_t) _leases.size()) {
+            compact(ErrorHandler::default_handler());
+        }
+        _compact_timer.reschedule_after_sec(_compact_interval);
+    }
+}
+
+/*
+ * The journal.  Each line is a record:
+ *
+ *   lease IP ETH START END	IP is leased to ETH from START to END
+ *   free IP			IP is free again
+ *
+ * START and END are in seconds since the epoch.  Later records override
+ * earlier ones.
+ */
+#if CLICK_USERLEVEL
+static void
+write_lease(FILE *f, const Lease &l)
+{
+    fprintf(f, "lease %s %s %u %u\n", l._ip.unparse().c_str(),
+            l._eth.unparse().c_str(), (uint32_t) l._start.sec(),
+            (uint32_t) l._end.sec());
+}
+#endif
+
+void
+LeasePool::journal_lease(const Lease *l)
+{
+#if CLICK_USERLEVEL
+    if (_journal) {
+        write_lease(_journal, *l);
+        fflush(_journal);
+        _journal_records++;
+    }
+#else
+    (void) l;
+#endif
+}
+
+void
+LeasePool::journal_free(IPAddress ip)
+{
+#if CLICK_USERLEVEL
+    if (_journal) {
+        fprintf(_journal, "free %s\n", ip.unparse().c_str());
+        fflush(_journal);
+        _journal_records++;
+    }
+#else
+    (void) ip;
+#endif
+}
+
+int
+LeasePool::replay(ErrorHandler *errh)
+{
+#if CLICK_USERLEVEL
+    FILE *f = fopen(_journal_file.c_str(), "r");
+    if (!f) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        return errh->error("%s: %s", _journal_file.c_str(), strerror(errno));
+    }
+
+    uint32_t now = Timestamp::now().sec();
+    int bad = 0;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), f)) {
+        Vector<String> words;
+        cp_spacevec(String(buf), words);
+        IPAddress ip;
+        if (words.size() == 0) {
+            continue;
+        } else if (words.size() == 5 && words[0] == "lease") {
+            Lease l;
+            uint32_t start, end;
+            if (!IPAddressArg().parse(words[1], ip)
+                || !EtherAddressArg().parse(words[2], l._eth)
+                || !IntArg().parse(words[3], start)
+                || !IntArg().parse(words[4], end)
+                || end < start) {
+                bad++;
+                continue;
+            }
+            if (!in_pool(ip)) {
+                continue;
+            }
+            if (Lease *old = lookup(ip)) {
+                release(old);
+            }
+            if (end > now) {
+                l._ip = ip;
+                l._start = Timestamp(start, 0);
+                l._end = Timestamp(end, 0);
+                l._duration = l._end - l._start;
+                l._valid = true;
+                insert(l);
+            }
+        } else if (words.size() == 2 && words[0] == "free"
+                   && IPAddressArg().parse(words[1], ip)) {
+            if (Lease *old = lookup(ip)) {
+                release(old);
+            }
+        } else {
+            bad++;
+        }
+    }
+    fclose(f);
+    if (bad) {
+        errh->warning("%s: skipped %d bad records", _journal_file.c_str(), bad);
+    }
+#else
+    (void) errh;
+#endif
+    return 0;
+}
+
+/*
+ * compact: rewrites the journal with one record per live lease, through a
+ * temporary file that replaces it once complete.
+ */
+int
+LeasePool::compact(ErrorHandler *errh)
+{
+#if CLICK_USERLEVEL
+    if (!_journal_file) {
+        return 0;
+    }
+    String tmp = _journal_file + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (!f) {
+        return errh->error("%s: %s", tmp.c_str(), strerror(errno));
+    }
+    for (LeaseIter it = _leases.begin(); it.live(); it++) {
+        write_lease(f, it.value());
+    }
+    bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0 || !ok || rename(tmp.c_str(), _journal_file.c_str()) < 0) {
+        int e = errno;
+        unlink(tmp.c_str());
+        return errh->error("%s: %s", _journal_file.c_str(), strerror(e));
+    }
+    if (_journal) {
+        fclose(_journal);
+    }
+    _journal = fopen(_journal_file.c_str(), "a");
+    if (!_journal) {
+        return errh->error("%s: %s", _journal_file.c_str(), strerror(errno));
+    }
+    _journal_records = _leases.size();
+#else
+    (void) errh;
+#endif
+    return 0;
 }
 
 int
 LeasePool::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    _default_duration = 60;
+    _compact_interval = 300;
     if (Args(conf, this, errh)
         .read_mp("ETH", _eth)
         .read_mp("IP", _ip)
         .read_mp("MASK", _subnet)
         .read("START", _start)
         .read("END", _end)
+        .read("DURATION", _default_duration)
+        .read("JOURNAL", FilenameArg(), _journal_file)
+        .read("COMPACT_INTERVAL", _compact_interval)
         .complete() < 0)
         return -1;
+    _max_duration = _default_duration;
 
-    for (uint32_t x = ntohl(_start.addr()); x <= ntohl(_end.addr()); x++) {
-        IPAddress ip = IPAddress(htonl(x));
-        _free.set(ip, ip);
-        _free_list.push_back(ip);
+#if !CLICK_USERLEVEL
+    if (_journal_file) {
+        return errh->error("JOURNAL requires user level");
+    }
+#endif
+    if (_default_duration == 0 || _compact_interval == 0) {
+        return errh->error("DURATION and COMPACT_INTERVAL must be positive");
+    }
+    if (ntohl(_end.addr()) < ntohl(_start.addr())) {
+        return errh->error("END is before START");
+    }
+    uint32_t n = ntohl(_end.addr()) - ntohl(_start.addr()) + 1;
+    if (n == 0 || n > (1U << 24)) {
+        return errh->error("pool too large");
+    }
+
+    _taken.resize(n);
+    _wnext.assign(n, NIL);
+    _wprev.assign(n, NIL);
+    _wend.assign(n, 0);
+    for (int i = 0; i < WHEEL_SLOTS; i++) {
+        _slot[i] = NIL;
     }
     return 0;
 }
 
+int
+LeasePool::initialize(ErrorHandler *errh)
+{
+    _wheel_now = Timestamp::now().sec();
+    _expire_timer.initialize(this);
+    _expire_timer.schedule_after_sec(1);
+    if (_journal_file) {
+        if (replay(errh) < 0 || compact(errh) < 0) {
+            return -1;
+        }
+        _compact_timer.initialize(this);
+        _compact_timer.schedule_after_sec(_compact_interval);
+    }
+    return 0;
+}
+
+void
+LeasePool::cleanup(CleanupStage)
+{
+#if CLICK_USERLEVEL
+    if (_journal) {
+        fclose(_journal);
+    }
+    _journal = 0;
+#endif
+}
+
+enum { H_STATS, H_COMPACT };
+
+String
+LeasePool::read_handler(Element *e, void *thunk)
+{
+    LeasePool *lp = (LeasePool *)e;
+    switch ((uintptr_t) thunk) {
+    case H_STATS: {
+        StringAccum sa;
+        sa << "free " << lp->_taken.nfree() << "\n";
+        sa << "allocated " << lp->_leases.size() << "\n";
+        sa << "expired " << lp->_nexpired << "\n";
+        sa << "journal " << lp->_journal_records << "\n";
+        return sa.take_string();
+    }
+    default:
+        return String();
+    }
+}
+
+int
+LeasePool::write_handler(const String &, Element *e, void *thunk, ErrorHandler *errh)
+{
+    LeasePool *lp = (LeasePool *)e;
+    switch ((uintptr_t) thunk) {
+    case H_COMPACT:
+        return lp->compact(errh);
+    default:
+        return -1;
+    }
+}
+
+void
+LeasePool::add_handlers()
+{
+    DHCPLeaseTable::add_handlers();
+    add_read_handler("stats", read_handler, (void *) H_STATS);
+    add_write_handler("compact", write_handler, (void *) H_COMPACT);
+}
+
 EXPORT_ELEMENT(LeasePool LeasePool-LeasePool)
 CLICK_ENDDECLS
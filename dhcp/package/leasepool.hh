@@ -4,12 +4,12 @@
 #include <click/element.hh>
 #include <click/hashtable.hh>
 #include <click/vector.hh>
-#include <click/deque.hh>
 #include <click/etheraddress.hh>
 #include <click/ipaddress.hh>
 #include <click/timer.hh>
 #include <click/timestamp.hh>
 #include "leasetable.hh"
+#include "leasebitmap.hh"
 
 /*
  * =c
@@ -24,6 +24,50 @@
  * LeasePool is responsible of keeping track of free,
  * reservered, and allocated leases.
  *
+ * Free addresses in START..END are kept in a bitmap, and leases expire off
+ * a timing wheel with one slot per second, so handing out, renewing and
+ * expiring a lease take about the same time whatever the size of the pool.
+ *
+ * At user level the leases can be kept in a JOURNAL file, to which every
+ * lease, renewal and release is appended.  The journal is read back when
+ * the router starts, and rewritten with only the live leases then and
+ * whenever it has grown to more than twice their number.
+ *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item START
+ *
+ * IP address. First address of the pool.
+ *
+ * =item END
+ *
+ * IP address. Last address of the pool.
+ *
+ * =item DURATION
+ *
+ * Unsigned. Lease time in seconds. Defaults to 60.
+ *
+ * =item JOURNAL
+ *
+ * Filename. Lease journal. Defaults to none.
+ *
+ * =item COMPACT_INTERVAL
+ *
+ * Unsigned. Seconds between checks of the journal size. Defaults to 300.
+ *
+ * =back
+ *
+ * =h stats read-only
+ *
+ * Free and allocated addresses, leases expired so far, and records in the
+ * journal.
+ *
+ * =h compact write-only
+ *
+ * Rewrites the journal now.
+ *
  * =e
  * LeasePool(11:22:33:44:55:66, 192.168.10.1, 192.168.10.0, START 192.168.10.10, END 192.168.10.250);
  *
@@ -42,15 +86,16 @@ public:
     const char *processing() const { return AGNOSTIC; }
     void *cast(const char *);
     int configure(Vector<String> &conf, ErrorHandler *errh);
+    int initialize(ErrorHandler *errh);
+    void cleanup(CleanupStage);
+    void run_timer(Timer *);
+    void add_handlers();
 
     uint32_t get_default_duration();
     uint32_t get_max_duration();
     IPAddress get_server_ip_addr();
     IPAddress get_subnet_mask();
 
-    void free_list_push(IPAddress);
-    IPAddress free_list_pop();
-
     bool _read_conf_file;
     bool _read_leases_file;
     uint32_t _default_duration;
@@ -61,14 +106,52 @@ public:
     void remove(EtherAddress);
     Lease *new_lease(EtherAddress, IPAddress);
     Lease *new_lease_any(EtherAddress);
+    void extend(Lease *);
     IPAddress get_server_ip();
     bool insert(Lease);
 
+    int compact(ErrorHandler *);
+
 private:
-    Deque<IPAddress> _free_list;
-    HashTable<IPAddress, IPAddress> _free;
+    enum { WHEEL_SLOTS = 1024, NIL = 0xFFFFFFFFU };
+
     IPAddress _start;
     IPAddress _end;
+
+    LeaseBitmap _taken;
+    uint32_t _next;		/* next-fit cursor for new_lease_any */
+
+    /* Timing wheel: the leases ending in second s are linked from
+       _slot[s % WHEEL_SLOTS] through _wnext/_wprev, indexed by pool
+       offset; _wend holds each lease's end second. */
+    uint32_t _slot[WHEEL_SLOTS];
+    Vector<uint32_t> _wnext;
+    Vector<uint32_t> _wprev;
+    Vector<uint32_t> _wend;
+    uint32_t _wheel_now;
+    Timer _expire_timer;
+    uint32_t _nexpired;
+
+    String _journal_file;
+    uint32_t _compact_interval;
+    Timer _compact_timer;
+    uint32_t _journal_records;
+#if CLICK_USERLEVEL
+    FILE *_journal;
+#endif
+
+    bool in_pool(IPAddress ip) const;
+    uint32_t offset(IPAddress ip) const;
+    void schedule(uint32_t off, uint32_t end_sec);
+    void unschedule(uint32_t off);
+    void expire(uint32_t now);
+    void release(Lease *);
+    int replay(ErrorHandler *);
+    void journal_lease(const Lease *);
+    void journal_free(IPAddress);
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
 };
 
 #endif /* LEASEPOOL_HH */
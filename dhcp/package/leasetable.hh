@@ -20,11 +20,8 @@ class Lease {
 	Timestamp _duration;
 	bool _valid;
 	void extend() {
-		Timestamp now = Timestamp::now();
-		_start.set_sec(now.sec());
-		_start.set_subsec(now.subsec());
-		_end.set_sec( _start.sec() + now.sec() );
-		_end.set_subsec( _start.subsec() + now.subsec() );
+		_start = Timestamp::now();
+		_end = _start + _duration;
 	}
 };
 
@@ -55,6 +52,10 @@ public:
 	  return 0;
   }
   virtual bool insert(Lease);
+  /* restarts the lease for another _duration */
+  virtual void extend(Lease *l) {
+	  l->extend();
+  }
 
 
   IPAddress _ip;
@@ -0,0 +1,110 @@
+#! /bin/sh
+
+# benchpptp.sh -- load test PPTPServer with many simulated PPTP clients
+#
+# For each number of calls, starts a click running PPTPServer with its
+# outputs fed back into its inputs, so that every PPP frame it receives is
+# sent back to the client, and a second click running PPTPLoadClient, which
+# opens the calls from 127.0.0.2 to the server on 127.0.0.1 and sends LIMIT
+# frames over them.  Reports frames echoed per second, frames lost, and the
+# frames per recvmmsg and sendmmsg call on the server.  On loopback the
+# server also reads its own GRE packets back and drops them; the report
+# leaves those out.
+#
+# Needs root, for the raw GRE sockets, and a click built with the iias
+# packages installed.
+
+usage () {
+    echo "Usage: benchpptp.sh [--limit N] [--length BYTES] [--workdir DIR] [CALLS...]" 1>&2
+    echo "CALLS defaults to 1 10 100 500" 1>&2
+    exit 1
+}
+
+workdir="${TMPDIR:-/tmp}/benchpptp.$$"
+keepwork=0
+limit=1000000
+length=64
+
+while test $# -gt 0; do
+    case "$1" in
+      --limit)
+	test $# -ge 2 || usage
+	limit="$2"; shift 2;;
+      --length)
+	test $# -ge 2 || usage
+	length="$2"; shift 2;;
+      --workdir)
+	test $# -ge 2 || usage
+	workdir="$2"; keepwork=1; shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+ncalls="$*"
+test -z "$ncalls" && ncalls="1 10 100 500"
+
+mkdir -p "$workdir" || exit 1
+serverpid=
+cleanup () {
+    test -n "$serverpid" && kill $serverpid 2>/dev/null
+    test $keepwork = 1 || rm -rf "$workdir"
+}
+trap cleanup 0
+
+# serverconfig CALLS
+serverconfig () {
+    echo "require(ppp)"
+    echo "pptpd :: PPTPServer;"
+    i=0
+    while test $i -lt $1; do
+	echo "pptpd[$i] -> [$i]pptpd;"
+	i=`expr $i + 1`
+    done
+    echo "DriverManager(wait_stop, print pptpd.stats);"
+}
+
+# field FILE KEY -- value of the "KEY value" line in FILE
+field () {
+    awk -v k="$2" '$1 == k { print $2; exit }' "$1"
+}
+
+status=0
+printf '%6s %9s %9s %8s %10s %9s %9s\n' \
+    calls sent echoed lost frames/sec per_recv per_send
+
+for n in $ncalls; do
+    click -e "`serverconfig $n`" > "$workdir/server.$n.out" 2>&1 &
+    serverpid=$!
+    sleep 1
+
+    if ! click -e "require(ppp)
+client :: PPTPLoadClient(127.0.0.1, LOCAL 127.0.0.2, CALLS $n, LENGTH $length, LIMIT $limit, STOP true);
+DriverManager(wait, print client.stats)" > "$workdir/client.$n.out"; then
+	echo "benchpptp.sh: $n calls: client failed" 1>&2
+	status=1
+    fi
+
+    # let the server print its stats
+    kill -INT $serverpid 2>/dev/null
+    wait $serverpid
+    serverpid=
+
+    c="$workdir/client.$n.out"
+    s="$workdir/server.$n.out"
+    if test "`field $c calls`" != $n; then
+	echo "benchpptp.sh: $n calls: only `field $c calls` established" 1>&2
+	status=1
+    fi
+    echo "`field $c sent` `field $c received` `field $c rate` `field $s received` `field $s recv_calls` `field $s sent` `field $s send_calls` `field $s dropped`" \
+	| awk -v n=$n '{
+	    # leave out the server reading its own packets back
+	    inbound = $4 - $8;
+	    printf "%6d %9d %9d %8d %10.0f %9.1f %9.1f\n", n, $1, $2, $1 - $2, $3,
+		($5 > 0 ? inbound / $5 : 0), ($7 > 0 ? $6 / $7 : 0)
+	}'
+done
+
+exit $status
@@ -68,6 +68,7 @@ GREEncap::configure(Vector<String> &conf, ErrorHandler *errh)
     _greh.flags |= htons(GRE_SP);
     *options++ = htonl(0);
   }
+  _seq = 0;
   _len = (char *)options - (char *)&_greh;
 
 #if HAVE_FAST_CHECKSUM && FAST_CHECKSUM_ALIGNED
@@ -93,18 +94,14 @@ GREEncap::simple_action(Packet *p_in)
   if (!p) return 0;
 
   click_gre *greh = reinterpret_cast<click_gre *>(p->data());
-  uint32_t *options = _greh.options;
-
-  if (_greh.flags & htons(GRE_CP))
-    *options++ = 0;
-  if (_greh.flags & htons(GRE_KP))
-    options++;
-  if (_greh.flags & htons(GRE_SP))
-    *options++ = htonl(ntohl(*options) + 1);
-  assert(((char *)options - (char *)&_greh) == _len);
-
   memcpy(greh, &_greh, _len);
 
+  // the template is shared by all threads; number the packet in place
+  if (_greh.flags & htons(GRE_SP)) {
+    uint32_t seq = htonl(_seq.fetch_and_add(1) + 1);
+    memcpy((char *)greh + _len - sizeof(seq), &seq, sizeof(seq));
+  }
+
   if (_greh.flags & htons(GRE_CP)) {
     uint16_t checksum;
 #if HAVE_FAST_CHECKSUM && FAST_CHECKSUM_ALIGNED
@@ -85,6 +85,7 @@ private:
 
   click_gre _greh;	// GRE header to append to each packet
   int _len;		// length of GRE header
+  uatomic32_t _seq;	// last sequence number sent
 #if HAVE_FAST_CHECKSUM && FAST_CHECKSUM_ALIGNED
   bool _aligned;
 #endif
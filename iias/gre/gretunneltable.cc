@@ -0,0 +1,346 @@
+// -*- mode: c++; c-basic-offset: 2 -*-
+/*
+ * gretunneltable.cc -- element encapsulates and demultiplexes many keyed
+ * GRE-in-IP tunnels
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "gretunneltable.hh"
+#include "gre.h"
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <click/packet_anno.hh>
+CLICK_DECLS
+
+GRETunnelTable::GRETunnelTable()
+  : _tunnels(0), _ntunnels(0), _checksum(false), _checkseq(false)
+{
+  _drops = 0;
+}
+
+GRETunnelTable::~GRETunnelTable()
+{
+  delete[] _tunnels;
+}
+
+int
+GRETunnelTable::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  IPAddress local;
+  uint16_t protocol = 0x0800;
+  unsigned ttl = 250;
+
+  if (cp_va_kparse_remove_keywords(conf, this, errh,
+		"LOCAL", cpkM, cpIPAddress, &local,
+		"PROTOCOL", 0, cpShort, &protocol,
+		"CHECKSUM", 0, cpBool, &_checksum,
+		"SEQUENCE", 0, cpBool, &_checkseq,
+		"TTL", 0, cpUnsigned, &ttl,
+		cpEnd) < 0)
+    return -1;
+
+  if (conf.size() == 0)
+    return errh->error("no tunnels given");
+  if (ttl > 255)
+    return errh->error("TTL must be between 0 and 255");
+
+  delete[] _tunnels;
+  _tunnels = new Tunnel[conf.size()];
+  _ntunnels = conf.size();
+  _index.clear();
+
+  for (int i = 0; i < conf.size(); i++) {
+    Tunnel &t = _tunnels[i];
+    Vector<String> words;
+    cp_spacevec(conf[i], words);
+    uint32_t key = 0;
+    if (words.size() < 1 || words.size() > 2
+	|| !cp_ip_address(words[0], &t.id.remote, this)
+	|| (words.size() == 2 && !cp_unsigned(words[1], &key)))
+      return errh->error("tunnel %d: expected `REMOTE [KEY]'", i);
+    t.id.key = key;
+    if (_index.find(t.id))
+      return errh->error("tunnel %d: %s key %u given twice", i,
+			 t.id.remote.unparse().c_str(), key);
+    _index.set(t.id, i);
+
+    // outer IP header; ip_len, ip_id and ip_sum are filled per packet
+    memset(t.header, 0, sizeof(t.header));
+    click_ip *ip = reinterpret_cast<click_ip *>(t.header);
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(click_ip) >> 2;
+    ip->ip_ttl = ttl;
+    ip->ip_p = IP_PROTO_GRE;
+    ip->ip_src = local.in_addr();
+    ip->ip_dst = t.id.remote.in_addr();
+
+    click_gre *greh = reinterpret_cast<click_gre *>(ip + 1);
+    uint32_t *options = greh->options;
+    greh->protocol = htons(protocol);
+    if (_checksum) {
+      greh->flags |= htons(GRE_CP);
+      options++;
+    }
+    if (key) {
+      greh->flags |= htons(GRE_KP);
+      *options++ = htonl(key);
+    }
+    if (_checkseq) {
+      greh->flags |= htons(GRE_SP);
+      options++;
+    }
+    t.hlen = (unsigned char *)options - t.header;
+
+    t.seq_out = t.seq_in = 0;
+    t.packets_out = t.bytes_out = t.packets_in = t.bytes_in = 0;
+  }
+
+  return 0;
+}
+
+// One's complement sum of len bytes, added eight bytes at a time with
+// end-around carry and folded at the end.  Gives the same result as
+// click_in_cksum() in about a quarter of the additions, whatever the
+// alignment of data, and unlike ip_fast_csum() counts a trailing partial
+// word.
+static inline uint16_t
+gre_cksum(const unsigned char *data, unsigned len)
+{
+  uint64_t sum = 0, w;
+  for (; len >= 8; data += 8, len -= 8) {
+    memcpy(&w, data, 8);
+    sum += w;
+    sum += (sum < w);
+  }
+  if (len >= 4) {
+    uint32_t w4;
+    memcpy(&w4, data, 4);
+    sum += w4;
+    sum += (sum < w4);
+    data += 4;
+    len -= 4;
+  }
+  if (len) {
+    // the last one to three bytes, zero padded as a 16 bit word would be
+    uint32_t w4 = 0;
+    memcpy(&w4, data, len);
+    sum += w4;
+    sum += (sum < w4);
+  }
+  sum = (sum & 0xFFFFFFFFU) + (sum >> 32);
+  sum = (sum & 0xFFFFFFFFU) + (sum >> 32);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return ~sum & 0xFFFF;
+}
+
+void
+GRETunnelTable::drop(Packet *p)
+{
+  _drops++;
+  if (noutputs() == 3)
+    output(2).push(p);
+  else
+    p->kill();
+}
+
+void
+GRETunnelTable::encap(Packet *p_in)
+{
+  uint32_t i = AGGREGATE_ANNO(p_in);
+  if (i >= (uint32_t)_ntunnels) {
+    drop(p_in);
+    return;
+  }
+  Tunnel &t = _tunnels[i];
+
+  WritablePacket *p = p_in->push(t.hlen);
+  if (!p)
+    return;
+  memcpy(p->data(), t.header, t.hlen);
+
+  click_ip *ip = reinterpret_cast<click_ip *>(p->data());
+  click_gre *greh = reinterpret_cast<click_gre *>(ip + 1);
+  uint32_t *options = greh->options;
+  uint32_t n = t.packets_out.fetch_and_add(1);
+  t.bytes_out += p->length();
+
+  // the GRE checksum field is already zero in the template
+  if (_checksum)
+    options++;
+  if (t.id.key)
+    options++;
+  if (_checkseq) {
+    uint32_t seq = htonl(t.seq_out.fetch_and_add(1) + 1);
+    memcpy(options, &seq, sizeof(seq));
+  }
+  if (_checksum) {
+    uint16_t checksum = gre_cksum((unsigned char *)greh,
+				  p->length() - sizeof(click_ip));
+    memcpy(greh->options, &checksum, sizeof(checksum));
+  }
+
+  ip->ip_len = htons(p->length());
+  ip->ip_id = htons(n);
+  ip->ip_sum = click_in_cksum((unsigned char *)ip, sizeof(click_ip));
+
+  p->set_ip_header(ip, sizeof(click_ip));
+  p->set_dst_ip_anno(t.id.remote);
+  output(0).push(p);
+}
+
+void
+GRETunnelTable::decap(Packet *p)
+{
+  const click_ip *ip = reinterpret_cast<const click_ip *>(p->data());
+  unsigned len = p->length();
+  unsigned iphlen;
+
+  if (len < sizeof(click_ip) + 4 || ip->ip_p != IP_PROTO_GRE
+      || (iphlen = ip->ip_hl << 2) < sizeof(click_ip)) {
+    drop(p);
+    return;
+  }
+  // go by the IP length; the packet may end in link-level padding
+  if (ntohs(ip->ip_len) > len || ntohs(ip->ip_len) < iphlen + 4) {
+    drop(p);
+    return;
+  }
+  len = ntohs(ip->ip_len);
+
+  const click_gre *greh = reinterpret_cast<const click_gre *>(p->data() + iphlen);
+  const uint32_t *options = greh->options;
+  unsigned plen = len - iphlen;
+  unsigned hlen = 4;
+  uint16_t flags;
+  uint32_t key = 0, seq = 0;
+
+  // avoid alignment issues
+  memcpy(&flags, &greh->flags, sizeof(greh->flags));
+  // a routing field would change where the options end
+  if ((flags & htons(GRE_VERSION | GRE_RP)) != 0) {
+    drop(p);
+    return;
+  }
+  if (flags & htons(GRE_CP))
+    hlen += 4;
+  if (flags & htons(GRE_KP))
+    hlen += 4;
+  if (flags & htons(GRE_SP))
+    hlen += 4;
+  if (plen < hlen) {
+    drop(p);
+    return;
+  }
+
+  if (flags & htons(GRE_CP))
+    options++;
+  if (flags & htons(GRE_KP))
+    memcpy(&key, options++, sizeof(key));
+  if (flags & htons(GRE_SP))
+    memcpy(&seq, options++, sizeof(seq));
+
+  HashTable<GRETunnelKey, int>::iterator it =
+    _index.find(GRETunnelKey(IPAddress(ip->ip_src), ntohl(key)));
+  if (!it) {
+    drop(p);
+    return;
+  }
+  Tunnel &t = _tunnels[it.value()];
+
+  if (_checksum
+      && (!(flags & htons(GRE_CP))
+	  || gre_cksum((const unsigned char *)greh, plen) != 0)) {
+    drop(p);
+    return;
+  }
+
+  if (_checkseq) {
+    // Accept only a sequence number later than the last accepted, and
+    // advance seq_in in the same compare-and-swap, so two threads can
+    // neither accept the same number nor move seq_in backwards.
+    if (!(flags & htons(GRE_SP))) {
+      drop(p);
+      return;
+    }
+    seq = ntohl(seq);
+    uint32_t last = t.seq_in;
+    while (1) {
+      if ((int32_t)(seq - last) <= 0) {
+	drop(p);
+	return;
+      }
+      uint32_t old = t.seq_in.compare_swap(last, seq);
+      if (old == last)
+	break;
+      last = old;
+    }
+  }
+
+  t.packets_in++;
+  t.bytes_in += len;
+
+  if (p->length() > len)
+    p->take(p->length() - len);
+  p->pull(iphlen + hlen);
+  SET_AGGREGATE_ANNO(p, it.value());
+  output(1).push(p);
+}
+
+void
+GRETunnelTable::push(int port, Packet *p)
+{
+  if (port == 0)
+    encap(p);
+  else
+    decap(p);
+}
+
+String
+GRETunnelTable::read_handler(Element *e, void *thunk)
+{
+  GRETunnelTable *gt = reinterpret_cast<GRETunnelTable *>(e);
+  switch ((intptr_t)thunk) {
+
+   case 0: {			// tunnels
+     StringAccum sa;
+     for (int i = 0; i < gt->_ntunnels; i++) {
+       Tunnel &t = gt->_tunnels[i];
+       sa << i << ' ' << t.id.remote << ' ' << t.id.key << ' '
+	  << t.packets_out << ' ' << t.bytes_out << ' '
+	  << t.packets_in << ' ' << t.bytes_in << '\n';
+     }
+     return sa.take_string();
+   }
+
+   case 1:			// drops
+    return String(gt->_drops) + "\n";
+
+   default:
+    return String("<error>\n");
+
+  }
+}
+
+void
+GRETunnelTable::add_handlers()
+{
+  add_read_handler("tunnels", read_handler, (void *)0);
+  add_read_handler("drops", read_handler, (void *)1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(GRETunnelTable)
+ELEMENT_MT_SAFE(GRETunnelTable)
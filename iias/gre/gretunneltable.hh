@@ -0,0 +1,187 @@
+// -*- mode: c++; c-basic-offset: 2 -*-
+/*
+ * gretunneltable.hh -- element encapsulates and demultiplexes many keyed
+ * GRE-in-IP tunnels
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#ifndef CLICK_GRETUNNELTABLE_HH
+#define CLICK_GRETUNNELTABLE_HH
+#include <click/element.hh>
+#include <click/glue.hh>
+#include <click/atomic.hh>
+#include <click/ipaddress.hh>
+#include <click/hashtable.hh>
+#include <clicknet/ip.h>
+#include "gre.h"
+CLICK_DECLS
+
+/*
+=c
+
+GRETunnelTable(TUNNEL, ..., I<KEYWORDS>)
+
+=s GRE
+
+encapsulates in and demultiplexes many keyed GRE-in-IP tunnels
+
+=d
+
+Terminates a set of GRE-in-IP tunnels, each named by a TUNNEL argument of
+the form `REMOTE [KEY]': the remote endpoint's IP address and the GRE key
+(0, the default, means the tunnel carries no key).  Tunnels are numbered
+from 0 in the order given, and that number travels with the packet in its
+aggregate annotation.
+
+Packets arriving on input 0 are encapsulated in the tunnel named by their
+aggregate annotation and leave on output 0 as complete IP packets, with the
+destination IP address annotation set to the tunnel's remote end.  Each
+tunnel has its own prebuilt IP and GRE header, so encapsulation is one copy
+and a few stores however many tunnels there are.
+
+GRE-in-IP packets arriving on input 1, starting with their IP header (for
+instance from CheckIPHeader), are looked up by source address and GRE key in
+a hash table, stripped of both headers, and leave on output 1 with their
+aggregate annotation set to the tunnel number.
+
+Octets past the IP length of a received packet, such as link-level padding,
+are ignored, and removed from the packet emitted.  Packets for unknown
+tunnels, received packets that are malformed, carry a GRE routing field or
+fail the checks below, are dropped, or emitted on output 2 if it is
+connected.
+
+Sequence numbers and the per-tunnel counters are updated atomically, so
+GRETunnelTable may be used from several threads at once.  When SEQUENCE is
+true, a received packet is accepted only if its sequence number is later
+than the last one accepted on its tunnel, even when packets of one tunnel
+are handled on several threads at once.
+
+Keyword arguments are:
+
+=over 8
+
+=item LOCAL
+
+IP address. Source address of encapsulated packets.  Required.
+
+=item PROTOCOL
+
+Integer. GRE protocol of encapsulated packets.  Defaults to 0x0800 (IPv4).
+
+=item CHECKSUM
+
+Boolean. If true, encapsulated packets carry a GRE checksum, and received
+packets are dropped unless they carry a correct one.  Defaults to false.
+
+=item SEQUENCE
+
+Boolean. If true, encapsulated packets carry a per-tunnel sequence number,
+and received packets are dropped unless they carry one later than the last
+accepted on their tunnel.  Defaults to false.
+
+=item TTL
+
+Integer. IP time-to-live of encapsulated packets.  Defaults to 250.
+
+=back
+
+=h tunnels read-only
+
+One line per tunnel: number, remote address, key, and packets and bytes
+sent and received.
+
+=h drops read-only
+
+Packets dropped so far.
+
+=e
+
+Terminates three customer tunnels and hands filtered customer traffic back
+through the tunnel it came in on, which the aggregate annotation remembers:
+
+  gt :: GRETunnelTable(10.1.0.1 100, 10.1.0.2 100, 10.1.0.2 200,
+                       LOCAL 192.168.0.1, SEQUENCE true);
+  FromDevice(eth0) -> Strip(14) -> CheckIPHeader
+    -> IPClassifier(ip proto 47) -> [1]gt;
+  gt[1] -> CheckIPHeader -> IPFilter(allow tcp, deny all) -> [0]gt;
+  gt[0] -> EtherEncap(0x0800, 1:1:1:1:1:1, 2:2:2:2:2:2) -> Queue -> ToDevice(eth0);
+
+=a GREEncap, CheckGREHeader, StripGREHeader, IPEncap */
+
+struct GRETunnelKey {
+  IPAddress remote;
+  uint32_t key;
+
+  GRETunnelKey() : key(0) { }
+  GRETunnelKey(IPAddress r, uint32_t k) : remote(r), key(k) { }
+
+  inline size_t hashcode() const {
+    return CLICK_NAME(hashcode)(remote) * 31 + key;
+  }
+};
+
+inline bool
+operator==(const GRETunnelKey &a, const GRETunnelKey &b)
+{
+  return a.remote == b.remote && a.key == b.key;
+}
+
+class GRETunnelTable : public Element { public:
+
+  GRETunnelTable();
+  ~GRETunnelTable();
+
+  const char *class_name() const		{ return "GRETunnelTable"; }
+  const char *port_count() const		{ return "2/2-3"; }
+  const char *processing() const		{ return PUSH; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  void add_handlers();
+
+  void push(int, Packet *);
+
+  int ntunnels() const				{ return _ntunnels; }
+
+private:
+
+  enum { MAX_HLEN = sizeof(click_ip) + sizeof(click_gre) };
+
+  struct Tunnel {
+    GRETunnelKey id;
+    unsigned char header[MAX_HLEN];	// IP and GRE header to prepend
+    int hlen;				// length of header
+    uatomic32_t seq_out;		// last sequence number sent
+    uatomic32_t seq_in;			// last sequence number accepted
+    uatomic32_t packets_out;
+    uatomic32_t bytes_out;
+    uatomic32_t packets_in;
+    uatomic32_t bytes_in;
+  };
+
+  Tunnel *_tunnels;
+  int _ntunnels;
+  HashTable<GRETunnelKey, int> _index;	// (remote, key) -> _tunnels[]
+
+  bool _checksum;
+  bool _checkseq;
+  uatomic32_t _drops;
+
+  void encap(Packet *);
+  void decap(Packet *);
+  void drop(Packet *);
+
+  static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
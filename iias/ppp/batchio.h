@@ -0,0 +1,51 @@
+// -*- mode: c++; c-basic-offset: 2 -*-
+#ifndef BATCHIO_H
+#define BATCHIO_H
+#include <sys/types.h>
+#include <time.h>
+#include <sys/socket.h>
+
+/*
+ * recvmmsg and sendmmsg, for systems that lack them: one recvmsg or
+ * sendmsg per message, stopping at the first that fails.  configure
+ * defines HAVE_RECVMMSG and HAVE_SENDMMSG where the C library has them.
+ */
+
+#if !defined(HAVE_RECVMMSG) && !defined(HAVE_SENDMMSG)
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned msg_len;
+};
+#endif
+
+#ifndef HAVE_RECVMMSG
+static inline int
+recvmmsg(int fd, struct mmsghdr *msgs, unsigned n, int flags, struct timespec *)
+{
+  unsigned i;
+  for (i = 0; i < n; i++) {
+    ssize_t r = recvmsg(fd, &msgs[i].msg_hdr, flags);
+    if (r < 0)
+      return (i ? (int)i : -1);
+    msgs[i].msg_len = r;
+  }
+  return i;
+}
+#endif
+
+#ifndef HAVE_SENDMMSG
+static inline int
+sendmmsg(int fd, struct mmsghdr *msgs, unsigned n, int flags)
+{
+  unsigned i;
+  for (i = 0; i < n; i++) {
+    ssize_t w = sendmsg(fd, &msgs[i].msg_hdr, flags);
+    if (w < 0)
+      return (i ? (int)i : -1);
+    msgs[i].msg_len = w;
+  }
+  return i;
+}
+#endif
+
+#endif
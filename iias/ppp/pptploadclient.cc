@@ -0,0 +1,447 @@
+// -*- mode: c++; c-basic-offset: 2 -*-
+/*
+ * pptploadclient.{cc,hh} -- simulated PPTP clients for load tests
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/error.hh>
+#include <click/confparse.hh>
+#include <click/glue.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+
+#include "batchio.h"
+#include "pptploadclient.hh"
+
+CLICK_DECLS
+
+#define RBUF_LEN	2048
+
+PPTPLoadClient::PPTPLoadClient()
+  : _gre_fd(-1), _next(0), _sbuf(NULL), _rbuf(NULL),
+    _established(0), _sent(0), _received(0), _acks(0),
+    _task(this), _stop_timer(stop_driver, this)
+{
+}
+
+PPTPLoadClient::~PPTPLoadClient()
+{
+}
+
+int
+PPTPLoadClient::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _local = IPAddress();
+  _ncalls = 10;
+  _length = 64;
+  _limit = 100000;
+  _burst = 32;
+  _stop = false;
+  if (cp_va_kparse(conf, this, errh,
+		   "SERVER", cpkP+cpkM, cpIPAddress, &_server,
+		   "CALLS", 0, cpUnsigned, &_ncalls,
+		   "LOCAL", 0, cpIPAddress, &_local,
+		   "LENGTH", 0, cpUnsigned, &_length,
+		   "LIMIT", 0, cpUnsigned, &_limit,
+		   "BURST", 0, cpUnsigned, &_burst,
+		   "STOP", 0, cpBool, &_stop,
+		   cpEnd) < 0)
+    return -1;
+  if (_ncalls == 0 || _ncalls > 0xFFFF)
+    return errh->error("CALLS must be between 1 and 65535");
+  if (_length < sizeof(struct ppp_header) || _length > PACKET_MAX)
+    return errh->error("LENGTH must be between %d and %d", (int)sizeof(struct ppp_header), PACKET_MAX);
+  if (_burst == 0)
+    return errh->error("BURST must be positive");
+  return 0;
+}
+
+int
+PPTPLoadClient::initialize(ErrorHandler *errh)
+{
+  _task.initialize(this, false);
+  _stop_timer.initialize(this);
+
+  _sbuf = new unsigned char[BATCH * (GRE_MAX + _length)];
+  _rbuf = new unsigned char[BATCH * RBUF_LEN];
+
+  // one raw socket carries the GRE packets of every call
+  _gre_fd = socket(PF_INET, SOCK_RAW, PPTP_PROTO);
+  if (_gre_fd < 0)
+    return errh->error("socket: %s", strerror(errno));
+  if (_local.addr()) {
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = PF_INET;
+    sin.sin_addr = _local.in_addr();
+    if (bind(_gre_fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+      return errh->error("bind: %s", strerror(errno));
+  }
+  fcntl(_gre_fd, F_SETFL, O_NONBLOCK);
+  fcntl(_gre_fd, F_SETFD, FD_CLOEXEC);
+  add_select(_gre_fd, SELECT_READ);
+
+  Call empty;
+  memset(&empty, 0, sizeof(empty));
+  empty.fd = -1;
+  _calls.assign(_ncalls, empty);
+  for (uint32_t i = 0; i < _ncalls; i++)
+    if (open_call(i, errh) < 0)
+      return -1;
+  return 0;
+}
+
+void
+PPTPLoadClient::cleanup(CleanupStage)
+{
+  for (int i = 0; i < _calls.size(); i++)
+    if (_calls[i].fd >= 0)
+      close_call(i);
+  if (_gre_fd >= 0) {
+    close(_gre_fd);
+    _gre_fd = -1;
+  }
+  delete[] _sbuf;
+  delete[] _rbuf;
+  _sbuf = _rbuf = NULL;
+}
+
+// Starts connecting call i's control connection
+int
+PPTPLoadClient::open_call(int i, ErrorHandler *errh)
+{
+  struct sockaddr_in sin;
+  Call &call = _calls[i];
+
+  int fd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0)
+    return errh->error("socket: %s", strerror(errno));
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = PF_INET;
+  if (_local.addr()) {
+    sin.sin_addr = _local.in_addr();
+    if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+      close(fd);
+      return errh->error("bind: %s", strerror(errno));
+    }
+  }
+  sin.sin_addr = _server.in_addr();
+  sin.sin_port = htons(PPTP_PORT);
+  if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0
+      && errno != EINPROGRESS) {
+    close(fd);
+    return errh->error("connect: %s", strerror(errno));
+  }
+
+  call.fd = fd;
+  call.state = CALL_CONNECTING;
+  while (fd >= _fd_call.size())
+    _fd_call.push_back(-1);
+  _fd_call[fd] = i;
+  add_select(fd, SELECT_WRITE);
+  return 0;
+}
+
+void
+PPTPLoadClient::close_call(int i)
+{
+  Call &call = _calls[i];
+  if (call.fd >= 0) {
+    remove_select(call.fd, SELECT_READ | SELECT_WRITE);
+    close(call.fd);
+    _fd_call[call.fd] = -1;
+    call.fd = -1;
+  }
+  if (call.state == CALL_ESTABLISHED)
+    _established--;
+  call.state = CALL_CLOSED;
+}
+
+int
+PPTPLoadClient::send_ctrl(int i, int ctrl_type)
+{
+  unsigned char buf[PPTP_MAX_CTRL_PCKT_SIZE];
+  struct pptp_header *hdr = (struct pptp_header *)buf;
+  unsigned len;
+
+  memset(buf, 0, sizeof(buf));
+  if (ctrl_type == START_CTRL_CONN_RQST) {
+    struct pptp_start_ctrl_conn_rqst *rqst = (struct pptp_start_ctrl_conn_rqst *)buf;
+    len = sizeof(*rqst);
+    rqst->version = htons(PPTP_VERSION);
+    rqst->framing_cap = htonl(OUR_FRAMING);
+    rqst->bearer_cap = htonl(OUR_BEARER);
+    rqst->max_channels = htons(MAX_CHANNELS);
+    rqst->firmware_rev = htons(PPTP_FIRMWARE_VERSION);
+  } else {
+    struct pptp_out_call_rqst *rqst = (struct pptp_out_call_rqst *)buf;
+    len = sizeof(*rqst);
+    rqst->call_id = htons(i + 1);
+    rqst->call_serial = htons(i);
+    rqst->max_bps = htonl(100000000);
+    rqst->pckt_recv_size = htons(PCKT_RECV_WINDOW_SIZE);
+  }
+  hdr->length = htons(len);
+  hdr->pptp_type = htons(PPTP_CTRL_MESSAGE);
+  hdr->magic = htonl(PPTP_MAGIC_COOKIE);
+  hdr->ctrl_type = htons(ctrl_type);
+
+  // short enough to go out in one write on a fresh connection
+  if (write(_calls[i].fd, buf, len) != (ssize_t)len) {
+    click_chatter("%s: write: %s", declaration().c_str(), strerror(errno));
+    close_call(i);
+    return -1;
+  }
+  return 0;
+}
+
+void
+PPTPLoadClient::handle_ctrl(int i)
+{
+  Call &call = _calls[i];
+
+  if (call.state == CALL_CONNECTING) {
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    getsockopt(call.fd, SOL_SOCKET, SO_ERROR, &err, &errlen);
+    if (err) {
+      click_chatter("%s: connect: %s", declaration().c_str(), strerror(err));
+      close_call(i);
+      return;
+    }
+    remove_select(call.fd, SELECT_WRITE);
+    add_select(call.fd, SELECT_READ);
+    if (send_ctrl(i, START_CTRL_CONN_RQST) == 0)
+      call.state = CALL_STARTING;
+    return;
+  }
+
+  int r = read(call.fd, call.rbuf + call.rlen, sizeof(call.rbuf) - call.rlen);
+  if (r <= 0) {
+    if (r == 0 || (errno != EAGAIN && errno != EINTR))
+      close_call(i);
+    return;
+  }
+  call.rlen += r;
+
+  // handle each complete message
+  while (call.rlen >= sizeof(struct pptp_header)) {
+    struct pptp_header *hdr = (struct pptp_header *)call.rbuf;
+    unsigned len = ntohs(hdr->length);
+    if (len < sizeof(struct pptp_header) || len > sizeof(call.rbuf)) {
+      click_chatter("%s: bad message length %d", declaration().c_str(), len);
+      close_call(i);
+      return;
+    }
+    if (call.rlen < len)
+      break;
+
+    int ctrl_type = ntohs(hdr->ctrl_type);
+    if (ctrl_type == START_CTRL_CONN_RPLY && call.state == CALL_STARTING) {
+      if (send_ctrl(i, OUT_CALL_RQST) < 0)
+	return;
+      call.state = CALL_CALLING;
+    } else if (ctrl_type == OUT_CALL_RPLY && call.state == CALL_CALLING
+	       && len >= sizeof(struct pptp_out_call_rply)) {
+      struct pptp_out_call_rply *rply = (struct pptp_out_call_rply *)hdr;
+      if (rply->result_code != CONNECTED) {
+	click_chatter("%s: call %d refused", declaration().c_str(), i + 1);
+	close_call(i);
+	return;
+      }
+      call.peer_call_id = ntohs(rply->call_id);
+      call.state = CALL_ESTABLISHED;
+      _established++;
+      _task.reschedule();
+    }
+
+    memmove(call.rbuf, call.rbuf + len, call.rlen - len);
+    call.rlen -= len;
+  }
+}
+
+bool
+PPTPLoadClient::run_task(Task *)
+{
+  if (!_established)
+    return false;
+  if (_limit && _sent >= _limit) {
+    if (_stop && !_stop_timer.scheduled())
+      _stop_timer.schedule_after_msec(1000);
+    return false;
+  }
+
+  uint32_t n = _burst;
+  if (_limit && _limit - _sent < n)
+    n = _limit - _sent;
+  if (_sent == 0)
+    _first = Timestamp::now();
+
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = PF_INET;
+  sin.sin_addr = _server.in_addr();
+
+  while (n) {
+    uint32_t k = (n < BATCH ? n : BATCH);
+
+    for (uint32_t j = 0; j < k; j++) {
+      // next established call, round-robin
+      while (_calls[_next].state != CALL_ESTABLISHED)
+	_next = (_next + 1) % _ncalls;
+      Call &call = _calls[_next];
+      _next = (_next + 1) % _ncalls;
+
+      unsigned char *data = _sbuf + j * (GRE_MAX + _length);
+      struct pptp_gre_header *gre = (struct pptp_gre_header *)data;
+      unsigned header_len = offsetof(struct pptp_gre_header, seq) + sizeof(gre->seq);
+      gre->flags = PPTP_GRE_FLAG_K | PPTP_GRE_FLAG_S;
+      gre->ver = PPTP_GRE_VER;
+      gre->protocol = htons(PPTP_GRE_PROTO);
+      gre->payload_len = htons(_length);
+      gre->call_id = htons(call.peer_call_id);
+      gre->seq = htonl(call.seq_sent++);
+      if (call.ack_sent != call.seq_recv) {
+	gre->ver |= PPTP_GRE_FLAG_A;
+	gre->ack = htonl(call.seq_recv);
+	call.ack_sent = call.seq_recv;
+	header_len += sizeof(gre->ack);
+      }
+
+      // PPP frame: IP protocol, zero payload
+      struct ppp_header *ppp = (struct ppp_header *)(data + header_len);
+      ppp->address = PPP_ALLSTATIONS;
+      ppp->control = PPP_UI;
+      ppp->protocol = htons(PPP_IP);
+      memset(ppp + 1, 0, _length - sizeof(*ppp));
+
+      iov[j].iov_base = data;
+      iov[j].iov_len = header_len + _length;
+      memset(&msgs[j].msg_hdr, 0, sizeof(msgs[j].msg_hdr));
+      msgs[j].msg_hdr.msg_name = &sin;
+      msgs[j].msg_hdr.msg_namelen = sizeof(sin);
+      msgs[j].msg_hdr.msg_iov = &iov[j];
+      msgs[j].msg_hdr.msg_iovlen = 1;
+    }
+
+    int w = sendmmsg(_gre_fd, msgs, k, 0);
+    if (w < 0) {
+      if (errno != EAGAIN && errno != EINTR && errno != ENOBUFS)
+	click_chatter("%s: sendmmsg: %s", declaration().c_str(), strerror(errno));
+      break;
+    }
+    _sent += w;
+    n -= w;
+    if ((uint32_t)w < k)
+      break;
+  }
+
+  _task.fast_reschedule();
+  return true;
+}
+
+void
+PPTPLoadClient::handle_gre()
+{
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  int r;
+
+  for (int j = 0; j < BATCH; j++) {
+    iov[j].iov_base = _rbuf + j * RBUF_LEN;
+    iov[j].iov_len = RBUF_LEN;
+    memset(&msgs[j].msg_hdr, 0, sizeof(msgs[j].msg_hdr));
+    msgs[j].msg_hdr.msg_iov = &iov[j];
+    msgs[j].msg_hdr.msg_iovlen = 1;
+  }
+
+  do {
+    r = recvmmsg(_gre_fd, msgs, BATCH, MSG_DONTWAIT, NULL);
+    for (int j = 0; j < r; j++) {
+      const unsigned char *data = _rbuf + j * RBUF_LEN;
+      const click_ip *ip = (const click_ip *)data;
+      unsigned ip_len = ip->ip_hl << 2;
+      unsigned len = msgs[j].msg_len;
+      if (len < ip_len + offsetof(struct pptp_gre_header, seq)
+	  || IPAddress(ip->ip_src) != _server)
+	continue;
+
+      const struct pptp_gre_header *gre = (const struct pptp_gre_header *)(data + ip_len);
+      unsigned call_id = ntohs(gre->call_id);
+      if (call_id < 1 || call_id > _ncalls
+	  || _calls[call_id - 1].state != CALL_ESTABLISHED)
+	continue;
+      Call &call = _calls[call_id - 1];
+
+      if (PPTP_GRE_IS_A(gre->ver))
+	_acks++;
+      if (PPTP_GRE_IS_S(gre->flags) && gre->payload_len) {
+	call.seq_recv = ntohl(gre->seq);
+	_received++;
+	_last = Timestamp::now();
+      }
+    }
+  } while (r == BATCH);
+}
+
+void
+PPTPLoadClient::selected(int fd)
+{
+  if (fd == _gre_fd)
+    handle_gre();
+  else if (fd < _fd_call.size() && _fd_call[fd] >= 0)
+    handle_ctrl(_fd_call[fd]);
+}
+
+void
+PPTPLoadClient::stop_driver(Timer *, void *thunk)
+{
+  PPTPLoadClient *lc = (PPTPLoadClient *)thunk;
+  lc->router()->please_stop_driver();
+}
+
+String
+PPTPLoadClient::read_handler(Element *e, void *)
+{
+  PPTPLoadClient *lc = (PPTPLoadClient *)e;
+  double sec = (lc->_last > lc->_first ? (lc->_last - lc->_first).doubleval() : 0);
+  StringAccum sa;
+  sa << "calls " << lc->_established << "\n";
+  sa << "sent " << lc->_sent << "\n";
+  sa << "received " << lc->_received << "\n";
+  sa << "acks " << lc->_acks << "\n";
+  sa << "seconds " << sec << "\n";
+  sa << "rate " << (sec > 0 ? lc->_received / sec : 0) << "\n";
+  return sa.take_string();
+}
+
+void
+PPTPLoadClient::add_handlers()
+{
+  add_read_handler("stats", read_handler, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(PPTPLoadClient)
@@ -0,0 +1,163 @@
+// -*- mode: c++; c-basic-offset: 2 -*-
+#ifndef CLICK_PPTPLOADCLIENT_HH
+#define CLICK_PPTPLOADCLIENT_HH
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/timestamp.hh>
+#include "ppp_defs.h"
+#include "pptpdefs.h"
+CLICK_DECLS
+
+/*
+=title PPTPLoadClient
+
+=c
+
+PPTPLoadClient(SERVER, [I<KEYWORDS>])
+
+=s comm
+
+Simulates many PPTP clients, for load testing PPTPServer.
+
+=d
+
+Opens CALLS PPTP control connections to the PPTP server at address SERVER
+and places one outgoing call on each. Then sends PPP frames round-robin
+over the calls, GRE encapsulated, BURST at a time through one raw GRE
+socket. GRE packets coming back from the server are counted. A PPTPServer
+whose outputs feed straight back into its inputs echoes every frame, so
+the two together measure the server's throughput.
+
+Keyword arguments are:
+
+=over 8
+
+=item CALLS
+
+Unsigned. Number of simulated clients. Default is 10.
+
+=item LOCAL
+
+IP address. Address to connect from. When client and server share a host,
+use a loopback address other than SERVER, such as 127.0.0.2 for SERVER
+127.0.0.1, so that each side can tell the other's GRE packets from its
+own. Default is chosen by the kernel.
+
+=item LENGTH
+
+Unsigned. PPP frame length, PPP header included. Default is 64.
+
+=item LIMIT
+
+Unsigned. Frames to send over all calls. Default is 100000.
+
+=item BURST
+
+Unsigned. Frames sent per task run. Default is 32.
+
+=item STOP
+
+Boolean. If true, stop the driver one second after the last frame is sent.
+Default is false.
+
+=back
+
+=h stats read-only
+
+Calls established, frames sent, frames and acknowledgements received,
+seconds from the first frame sent to the last frame received, and frames
+received per second.
+
+=e
+
+The server echoes each of 4 calls back to its client:
+
+pptpd :: PPTPServer;
+pptpd[0] -> [0]pptpd;
+pptpd[1] -> [1]pptpd;
+pptpd[2] -> [2]pptpd;
+pptpd[3] -> [3]pptpd;
+
+In another router on the same host:
+
+client :: PPTPLoadClient(127.0.0.1, LOCAL 127.0.0.2, CALLS 4, STOP true);
+DriverManager(wait, print client.stats);
+
+=a PPTPServer */
+
+class PPTPLoadClient : public Element { public:
+
+  PPTPLoadClient();
+  ~PPTPLoadClient();
+
+  const char *class_name() const	{ return "PPTPLoadClient"; }
+  const char *port_count() const	{ return "0/0"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void selected(int);
+  bool run_task(Task *);
+
+ private:
+
+  enum { BATCH = 32,		// packets per recvmmsg/sendmmsg
+	 GRE_MAX = 16 };	// largest PPTP GRE header
+
+  enum { CALL_CLOSED, CALL_CONNECTING, CALL_STARTING, CALL_CALLING, CALL_ESTABLISHED };
+
+  // one simulated client
+  struct Call {
+    int fd;			// PPTP control connection
+    int state;
+    uint16_t peer_call_id;	// call ID the server chose
+    uint32_t seq_sent;		// last sequence number sent
+    uint32_t seq_recv;		// last sequence number received
+    uint32_t ack_sent;		// last acknowledgement number sent
+    unsigned char rbuf[PPTP_MAX_CTRL_PCKT_SIZE];
+    unsigned rlen;		// bytes in rbuf
+  };
+
+  IPAddress _server;
+  IPAddress _local;
+  uint32_t _ncalls;
+  uint32_t _length;
+  uint32_t _limit;
+  uint32_t _burst;
+  bool _stop;
+
+  // our call ID for _calls[i] is i + 1
+  Vector<Call> _calls;
+  // call index by control socket descriptor
+  Vector<int> _fd_call;
+  int _gre_fd;
+  uint32_t _next;		// next call to send on
+
+  unsigned char *_sbuf;		// BATCH frames being sent
+  unsigned char *_rbuf;		// BATCH packets being received
+
+  uint32_t _established;
+  uint32_t _sent;
+  uint32_t _received;
+  uint32_t _acks;
+  Timestamp _first;
+  Timestamp _last;
+
+  Task _task;
+  Timer _stop_timer;
+
+  int open_call(int i, ErrorHandler *);
+  void close_call(int i);
+  int send_ctrl(int i, int ctrl_type);
+  void handle_ctrl(int i);
+  void handle_gre();
+  static void stop_driver(Timer *, void *);
+  static String read_handler(Element *, void *);
+};
+
+CLICK_ENDDECLS
+#endif
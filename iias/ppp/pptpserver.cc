@@ -32,20 +32,47 @@
 #include <click/confparse.hh>
 #include <click/glue.hh>
 #include <click/packet.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 
 #include "pptpdefs.h"
+#include "batchio.h"
 #include "pptpserver.hh"
 
 CLICK_DECLS
 
+// receive buffers hold the IP header and the largest GRE header too
+#define RBUF_HEADROOM	48
+#define RBUF_LEN	(60 + sizeof(struct pptp_gre_header) + PACKET_MAX)
+
+static WritablePacket *
+make_rbuf()
+{
+  return Packet::make(RBUF_HEADROOM, 0, RBUF_LEN, 0);
+}
+
+// undoes what handling the last packet read into p did to it
+static WritablePacket *
+reset_rbuf(WritablePacket *p)
+{
+  p = p->push(p->headroom() - RBUF_HEADROOM);
+  return p->put(RBUF_LEN - p->length());
+}
+
 PPTPServer::PPTPServer()
-  : _verbose(false), _fd(-1)
+  : _verbose(false), _fd(-1), _gre_fd(-1),
+    _sendq_head(0), _write_selected(false), _send_task(this),
+    _ack_timer(send_acks, this),
+    _nrecv(0), _nrecv_calls(0), _nsent(0), _nsend_calls(0), _ndropped(0)
 {
+  for (int i = 0; i < BATCH; i++)
+    _rbuf[i] = NULL;
 }
 
 PPTPServer::~PPTPServer()
@@ -87,11 +114,18 @@ PPTPServer::initialize(ErrorHandler *errh)
   for (int i = 0; i < ninputs(); i++)
     _inputs.push_back(NULL);
 
+  _send_task.initialize(this, false);
+  _ack_timer.initialize(this);
+
   // open socket, set options, bind to address
   _fd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
   if (_fd < 0)
     return initialize_socket_error(errh, "socket");
 
+  // allow restarting while old connections linger in TIME_WAIT
+  int one = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
   sin.sin_family = PF_INET;
   sin.sin_port = htons(PPTP_PORT);
   sin.sin_addr = inet_makeaddr(0, 0);
@@ -101,7 +135,7 @@ PPTPServer::initialize(ErrorHandler *errh)
     return initialize_socket_error(errh, "bind");
 
   // start listening
-  if (listen(_fd, 2) < 0)
+  if (listen(_fd, 128) < 0)
     return initialize_socket_error(errh, "listen");
 
   // nonblocking I/O and close-on-exec for the socket
@@ -137,30 +171,30 @@ PPTPServer::cleanup_connection(Connection *c)
       cleanup_connection(c->gre);
       c->gre = NULL;
     }
+    // free from hash by socket descriptor
+    assert(_connections.size() > fd);
+    assert(_connections[fd] == c);
+    _connections[fd] = NULL;
+    if (_verbose)
+      click_chatter("%s: closed connection %d", declaration().c_str(), fd);
   }
   else {
-    // delete acknowledgement timer
-    if (c->ack_timer) {
-      delete c->ack_timer;
-      c->ack_timer = NULL;
-    }
+    // forget any acknowledgement still owed
+    if (c->ack_queued)
+      for (int i = 0; i < _ack_queue.size(); i++)
+	if (_ack_queue[i] == c)
+	  _ack_queue[i] = NULL;
     // free from hash by input number
     assert(_inputs.size() > c->input);
     assert(_inputs[c->input] == c);
     _inputs[c->input] = NULL;
+    if (_verbose)
+      click_chatter("%s: closed call to %s", declaration().c_str(), c->peer.unparse().c_str());
   }
 
-  // free from hash by socket descriptor
-  assert(_connections.size() > fd);
-  assert(_connections[fd] == c);
-  _connections[fd] = NULL;
-
   // delete connection
   delete c;
   c = NULL;
-
-  if (_verbose)
-    click_chatter("%s: closed connection %d", declaration().c_str(), fd);
 }
 
 void
@@ -181,6 +215,19 @@ PPTPServer::cleanup(CleanupStage)
       cleanup_connection(_connections[i]);
     assert(!_connections[i]);
   }
+  if (_gre_fd >= 0) {
+    close(_gre_fd);
+    _gre_fd = -1;
+  }
+  for (int i = 0; i < BATCH; i++)
+    if (_rbuf[i]) {
+      _rbuf[i]->kill();
+      _rbuf[i] = NULL;
+    }
+  for (int i = _sendq_head; i < _sendq.size(); i++)
+    _sendq[i].p->kill();
+  _sendq.clear();
+  _sendq_head = 0;
 }
 
 PPTPServer::Connection *
@@ -221,10 +268,30 @@ PPTPServer::initialize_pptp(int listen_fd)
   return c;
 }
 
+int
+PPTPServer::open_gre_socket()
+{
+  if (_gre_fd >= 0)
+    return 0;
+
+  // one GRE raw socket serves every call; handle_gre demultiplexes by call ID
+  _gre_fd = socket(PF_INET, SOCK_RAW, PPTP_PROTO);
+  if (_gre_fd < 0) {
+    click_chatter("%s: socket: %s", declaration().c_str(), strerror(errno));
+    return -1;
+  }
+
+  // nonblocking I/O and close-on-exec for the socket
+  fcntl(_gre_fd, F_SETFL, O_NONBLOCK);
+  fcntl(_gre_fd, F_SETFD, FD_CLOEXEC);
+
+  add_select(_gre_fd, SELECT_READ);
+  return 0;
+}
+
 PPTPServer::Connection *
-PPTPServer::initialize_gre(int pptp_fd)
+PPTPServer::initialize_gre(int pptp_fd, uint16_t peer_call_id)
 {
-  int gre_fd;
   struct sockaddr_in sin;
   socklen_t sin_len;
   Connection *c = NULL;
@@ -239,23 +306,13 @@ PPTPServer::initialize_gre(int pptp_fd)
     return NULL;
   }
 
-  // open GRE raw socket
-  gre_fd = socket(PF_INET, SOCK_RAW, PPTP_PROTO);
-  if (gre_fd < 0) {
-    click_chatter("%s: socket: %s", declaration().c_str(), strerror(errno));
+  if (open_gre_socket() < 0)
     return NULL;
-  }
 
   // create connection
-  c = new Connection(gre_fd);
+  c = new Connection(-1);
   assert(c);
 
-  // hash by socket descriptor
-  while (gre_fd >= _connections.size())
-    _connections.push_back(NULL);
-  assert(!_connections[gre_fd]);
-  _connections[gre_fd] = c;
-
   // hash by input number
   assert(!_inputs[input]);
   _inputs[input] = c;
@@ -264,49 +321,28 @@ PPTPServer::initialize_gre(int pptp_fd)
   // associated PPTP connection
   c->pptp = _connections[pptp_fd];
   assert(c->pptp);
+  c->peer_call_id = peer_call_id;
 
-  // initialize acknowledgement timer
-  c->ack_timer = new Timer(send_ack, (void *)c);
-  assert(c->ack_timer);
-  c->ack_timer->initialize(this);
-
-  // bind to local address
+  // GRE packets go between the addresses of the PPTP connection
   sin_len = sizeof(sin);
   if (getsockname(pptp_fd, (struct sockaddr *)&sin, &sin_len) < 0) {
     click_chatter("%s: getsockname: %s", declaration().c_str(), strerror(errno));
     goto err;
   }
   assert(sin.sin_family == PF_INET);
-  sin.sin_port = htons((short)pptp_fd);
-  sin_len = sizeof(sin);
-  if (bind(gre_fd, (struct sockaddr *)&sin, sin_len) < 0) {
-    click_chatter("%s: bind: %s", declaration().c_str(), strerror(errno));
-    goto err;
-  }
+  c->local = IPAddress(sin.sin_addr);
 
-  // connect to remote peer
   sin_len = sizeof(sin);
   if (getpeername(pptp_fd, (struct sockaddr *)&sin, &sin_len) < 0) {
-    click_chatter("%s: getsockname: %s", declaration().c_str(), strerror(errno));
+    click_chatter("%s: getpeername: %s", declaration().c_str(), strerror(errno));
     goto err;
   }
   assert(sin.sin_family == PF_INET);
-  sin.sin_port = htons((short)pptp_fd);
-  sin_len = sizeof(sin);
-  if (connect(gre_fd, (struct sockaddr *)&sin, sin_len) < 0) {
-    click_chatter("%s: connect: %s", declaration().c_str(), strerror(errno));
-    goto err;
-  }
+  c->peer = IPAddress(sin.sin_addr);
 
   if (_verbose)
-    click_chatter("%s: opened connection %d to %s", declaration().c_str(),
-		  gre_fd, IPAddress(sin.sin_addr).unparse().c_str());
-
-  // nonblocking I/O and close-on-exec for the socket
-  fcntl(gre_fd, F_SETFL, O_NONBLOCK);
-  fcntl(gre_fd, F_SETFD, FD_CLOEXEC);
-
-  add_select(gre_fd, SELECT_READ);
+    click_chatter("%s: opened call %d to %s", declaration().c_str(),
+		  pptp_fd, c->peer.unparse().c_str());
 
   return c;
 
@@ -316,9 +352,9 @@ PPTPServer::initialize_gre(int pptp_fd)
 }
 
 int
-PPTPServer::send_gre(Connection *c, WritablePacket *p)
+PPTPServer::send_gre(Connection *c, Packet *p)
 {
-  int fd = c->fd;
+  WritablePacket *q;
   struct pptp_gre_header *gre;
   unsigned header_len = offsetof(struct pptp_gre_header, seq);
 
@@ -331,19 +367,22 @@ PPTPServer::send_gre(Connection *c, WritablePacket *p)
     header_len += sizeof(gre->ack);
 
   // push GRE header
-  p->push(header_len);
-  gre = (struct pptp_gre_header *)p->data();
+  if (!(q = p->push(header_len))) {
+    _ndropped++;
+    return -1;
+  }
+  gre = (struct pptp_gre_header *)q->data();
   memset(gre, 0, header_len);
 
   // set common flags
   gre->flags = PPTP_GRE_FLAG_K;
   gre->ver = PPTP_GRE_VER;
   gre->protocol = htons(PPTP_GRE_PROTO);
-  gre->payload_len = htons(p->length() - header_len);
-  gre->call_id = htons((short)c->pptp->fd);
+  gre->payload_len = htons(q->length() - header_len);
+  gre->call_id = htons(c->peer_call_id);
 
   // add sequence number
-  if (p->length() > header_len) {
+  if (q->length() > header_len) {
     gre->flags |= PPTP_GRE_FLAG_S;
     gre->seq = htonl(c->seq_sent++);
   }
@@ -351,82 +390,219 @@ PPTPServer::send_gre(Connection *c, WritablePacket *p)
   // add acknowledgement number
   if (c->ack_sent != c->seq_recv) {
     gre->ver |= PPTP_GRE_FLAG_A;
-    if (p->length() > header_len)
+    if (q->length() > header_len)
       gre->ack = htonl(c->seq_recv);
     else
       gre->seq = htonl(c->seq_recv);
     c->ack_sent = c->seq_recv;
   }
 
-  // send GRE packet
-  while (p->length()) {
-    int w = write(fd, p->data(), p->length());
-    if (w < 0 && errno != EINTR) {
-      click_chatter("%s: %s:", declaration().c_str(), strerror(errno));
-      p->kill();
-      return w;
-    }
-    p->pull(w);
+  // queue GRE packet
+  if (_sendq.size() - _sendq_head >= SENDQ_MAX) {
+    q->kill();
+    _ndropped++;
+    return -1;
   }
+  Outgoing o;
+  o.p = q;
+  o.src = c->local;
+  o.dst = c->peer;
+  _sendq.push_back(o);
 
+  if (_write_selected)
+    ;				// selected() flushes once the socket drains
+  else if (_sendq.size() - _sendq_head >= BATCH)
+    flush_gre();
+  else
+    _send_task.reschedule();
   return 0;
 }
 
 void
-PPTPServer::send_ack(Timer *, void *thunk)
+PPTPServer::flush_gre()
 {
-  Connection *c = (Connection *)thunk;
-  PPTPServer *ps = (PPTPServer *)c->ps;
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  struct sockaddr_in sin[BATCH];
+#ifdef IP_PKTINFO
+  union {
+    struct cmsghdr cm;
+    char buf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+  } ctl[BATCH];
+#endif
 
-  if (c->ack_sent != c->seq_recv) {
-    WritablePacket *p = Packet::make(sizeof(struct pptp_gre_header));
-    assert(p);
-    p->pull(p->length());
-    ps->send_gre(c, p);
+  while (_sendq_head < _sendq.size()) {
+    int n = _sendq.size() - _sendq_head;
+    if (n > BATCH)
+      n = BATCH;
+
+    for (int i = 0; i < n; i++) {
+      Outgoing &o = _sendq[_sendq_head + i];
+      iov[i].iov_base = o.p->data();
+      iov[i].iov_len = o.p->length();
+      memset(&sin[i], 0, sizeof(sin[i]));
+      sin[i].sin_family = PF_INET;
+      sin[i].sin_addr = o.dst.in_addr();
+      memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+      msgs[i].msg_hdr.msg_name = &sin[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(sin[i]);
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+#ifdef IP_PKTINFO
+      // send from the address the PPTP connection came in on
+      memset(&ctl[i], 0, sizeof(ctl[i]));
+      msgs[i].msg_hdr.msg_control = &ctl[i];
+      msgs[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+      struct cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+      cm->cmsg_level = IPPROTO_IP;
+      cm->cmsg_type = IP_PKTINFO;
+      cm->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+      ((struct in_pktinfo *)CMSG_DATA(cm))->ipi_spec_dst = o.src.in_addr();
+#endif
+    }
+
+    int w = sendmmsg(_gre_fd, msgs, n, MSG_DONTWAIT);
+    _nsend_calls++;
+    if (w < 0) {
+      if (errno == EINTR)
+	continue;
+      else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	// wait for the socket to drain
+	if (!_write_selected) {
+	  add_select(_gre_fd, SELECT_WRITE);
+	  _write_selected = true;
+	}
+	return;
+      }
+      // drop the packet that failed and go on with the rest
+      click_chatter("%s: sendmmsg: %s", declaration().c_str(), strerror(errno));
+      _sendq[_sendq_head++].p->kill();
+      _ndropped++;
+      continue;
+    }
+
+    for (int i = 0; i < w; i++)
+      _sendq[_sendq_head + i].p->kill();
+    _sendq_head += w;
+    _nsent += w;
+  }
+
+  _sendq.clear();
+  _sendq_head = 0;
+  if (_write_selected) {
+    remove_select(_gre_fd, SELECT_WRITE);
+    _write_selected = false;
   }
 }
 
-void *
-PPTPServer::handle_gre(Connection *c)
+bool
+PPTPServer::run_task(Task *)
 {
-  int fd = c->fd;
-  WritablePacket *p = NULL;
-  struct pptp_gre_header *gre;
-  unsigned header_len, length;
+  if (_write_selected || _sendq_head == _sendq.size())
+    return false;
+  flush_gre();
+  return true;
+}
+
+void
+PPTPServer::queue_ack(Connection *c)
+{
+  if (!c->ack_queued) {
+    c->ack_queued = true;
+    _ack_queue.push_back(c);
+    if (!_ack_timer.scheduled())
+      _ack_timer.schedule_after_msec(ACK_DELAY);
+  }
+}
 
-  assert(IS_GRE(c));
+void
+PPTPServer::send_acks(Timer *, void *thunk)
+{
+  PPTPServer *ps = (PPTPServer *)thunk;
 
-  // allocate packet
-  if (!c->next) {
-    c->next = Packet::make(PACKET_MAX);
-    assert(c->next);
-    c->next->take(PACKET_MAX);
+  // acknowledge what data packets sent since have not
+  for (int i = 0; i < ps->_ack_queue.size(); i++) {
+    Connection *c = ps->_ack_queue[i];
+    if (!c)
+      continue;
+    c->ack_queued = false;
+    if (c->ack_sent != c->seq_recv) {
+      WritablePacket *p = Packet::make(sizeof(struct pptp_gre_header));
+      if (!p)
+	continue;
+      p->pull(p->length());
+      ps->send_gre(c, p);
+    }
   }
+  ps->_ack_queue.clear();
+}
+
+bool
+PPTPServer::handle_gre()
+{
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  int n, r;
+
+  // set up receive buffers, reusing those not passed on last time
+  for (n = 0; n < BATCH; n++) {
+    if (!_rbuf[n] && !(_rbuf[n] = make_rbuf()))
+      break;
+    iov[n].iov_base = _rbuf[n]->data();
+    iov[n].iov_len = _rbuf[n]->length();
+    memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+    msgs[n].msg_hdr.msg_iov = &iov[n];
+    msgs[n].msg_hdr.msg_iovlen = 1;
+  }
+  if (!n)
+    return false;
 
-  // read data from socket
-  p = c->next;
-  c->next = NULL;
-  assert(p);
-  int r;
   do {
-    while ((r = read(fd, p->end_data(), p->tailroom())) > 0)
-      p->put(r);
+    r = recvmmsg(_gre_fd, msgs, n, MSG_DONTWAIT, NULL);
   } while (r < 0 && errno == EINTR);
+  _nrecv_calls++;
 
-  // unrecoverable error
-  if (r < 0 && errno != EAGAIN) {
-    click_chatter("%s: read: %s", declaration().c_str(), strerror(errno));
-    goto err;
+  if (r < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      click_chatter("%s: recvmmsg: %s", declaration().c_str(), strerror(errno));
+    return false;
   }
 
-  header_len = sizeof(click_ip) + offsetof(struct pptp_gre_header, seq);
-  if (p->length() < header_len) {
-    // hold out for more data
-    c->next = p;
-    return NULL;
+  for (int i = 0; i < r; i++) {
+    WritablePacket *p = _rbuf[i];
+    _nrecv++;
+    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      _ndropped++;
+      continue;
+    }
+    p->take(p->length() - msgs[i].msg_len);
+    if (handle_gre_packet(p))
+      _rbuf[i] = NULL;
+    else
+      _rbuf[i] = reset_rbuf(p);
   }
 
-  gre = (struct pptp_gre_header*)(p->data() + sizeof(click_ip));
+  // more may be waiting if every buffer filled
+  return r == n;
+}
+
+// Returns true if p was passed on, false if its buffer can be reused.
+bool
+PPTPServer::handle_gre_packet(WritablePacket *p)
+{
+  const click_ip *ip = (const click_ip *)p->data();
+  struct pptp_gre_header *gre;
+  unsigned ip_len, header_len, length, call_id;
+  Connection *c = NULL;
+
+  if (p->length() < sizeof(click_ip))
+    goto drop;
+  ip_len = ip->ip_hl << 2;
+  header_len = ip_len + offsetof(struct pptp_gre_header, seq);
+  if (ip_len < sizeof(click_ip) || p->length() < header_len)
+    goto drop;
+
+  gre = (struct pptp_gre_header *)(p->data() + ip_len);
   length = 0;
 
   if (PPTP_GRE_IS_S(gre->flags)) {
@@ -439,27 +615,13 @@ PPTPServer::handle_gre(Connection *c)
   length += header_len;
 
   // check length
-  if (length > PACKET_MAX) {
-    click_chatter("%s: bad payload length %d", declaration().c_str(), ntohs(gre->payload_len));
-    goto err;
-  }
-  else if (p->length() > length) {
-    // trim this packet
-    unsigned extra = p->length() - length;
-    p->take(extra);
-    // allocate next packet
-    assert(!c->next);
-    c->next = Packet::make(PACKET_MAX);
-    assert(c->next);
-    // fill next packet
-    memcpy(c->next->data(), p->end_data(), extra);
-    c->next->take(PACKET_MAX - extra);
-  }
-  else if (p->length() < length) {
-    // hold out for more data
-    c->next = p;
-    return NULL;
+  if (p->length() < length) {
+    if (_verbose)
+      click_chatter("%s: bad payload length %d", declaration().c_str(), ntohs(gre->payload_len));
+    goto drop;
   }
+  else if (p->length() > length)
+    p->take(p->length() - length);
 
   // protocol errors
   if (((gre->ver) & 0x7f) != PPTP_GRE_VER ||
@@ -468,12 +630,20 @@ PPTPServer::handle_gre(Connection *c)
       PPTP_GRE_IS_R(gre->flags) ||
       !PPTP_GRE_IS_K(gre->flags) ||
       (gre->flags & 0xf)) {
-    click_chatter("%s: bad GRE header", declaration().c_str());
-    goto err;
+    if (_verbose)
+      click_chatter("%s: bad GRE header", declaration().c_str());
+    goto drop;
   }
-  if (ntohs(gre->call_id) != (short)c->pptp->fd) {
-    click_chatter("%s: bad call ID %d", declaration().c_str(), ntohs(gre->call_id));
-    goto err;
+
+  // our call ID is the descriptor of the PPTP connection
+  call_id = ntohs(gre->call_id);
+  if (call_id < (unsigned)_connections.size() && _connections[call_id])
+    c = _connections[call_id]->gre;
+  if (!c || IPAddress(ip->ip_src) != c->peer) {
+    if (_verbose)
+      click_chatter("%s: bad call ID %d from %s", declaration().c_str(),
+		    call_id, IPAddress(ip->ip_src).unparse().c_str());
+    goto drop;
   }
 
   // XXX check sequence and acknowledgement numbers for validity
@@ -486,29 +656,24 @@ PPTPServer::handle_gre(Connection *c)
       c->ack_recv = ntohl(gre->seq);
   }
 
+  // probably GRE acknowledgement
+  if (p->length() < header_len + sizeof(struct ppp_header))
+    return false;
+
   // pull IP and GRE headers
   p->pull(header_len);
 
   // set timestamp
   p->timestamp_anno() = Timestamp::now();
 
-  // probably GRE acknowledgement
-  if (p->length() < sizeof(struct ppp_header))
-    p->kill();
-  else {
-    output(c->input).push(p);
-    // schedule acknowledgement
-    c->ack_timer->schedule_after_msec(50);
-  }
-
-  return c->next;
+  // schedule acknowledgement
+  queue_ack(c);
+  output(c->input).push(p);
+  return true;
 
- err:
-  assert(p && p != c->next);
-  p->kill();
-  // XXX send stop control connection request instead
-  cleanup_connection(c->pptp);
-  return NULL;
+ drop:
+  _ndropped++;
+  return false;
 }
 
 void *
@@ -627,10 +792,10 @@ PPTPServer::handle_pptp(Connection *c)
     uint32_t max_bps = rqst->max_bps;
     uint16_t pckt_recv_size = rqst->pckt_recv_size;
     struct pptp_out_call_rply *rply = (struct pptp_out_call_rply*)hdr;
-    // (re)initialize GRE raw socket
+    // (re)initialize GRE call
     if (c->gre)
       cleanup_connection(c->gre);
-    if (!(c->gre = initialize_gre(fd)))
+    if (!(c->gre = initialize_gre(fd, ntohs(call_id_peer))))
       goto err;
     p->put(sizeof(*rply));
     hdr->ctrl_type = htons(OUT_CALL_RPLY);
@@ -661,7 +826,7 @@ PPTPServer::handle_pptp(Connection *c)
 
   case CALL_CLR_RQST: {
     struct pptp_call_disconn_ntfy *ntfy = (struct pptp_call_disconn_ntfy *)hdr;
-    // close GRE raw socket
+    // close GRE call
     if (c->gre) {
       cleanup_connection(c->gre);
       c->gre = NULL;
@@ -724,6 +889,15 @@ PPTPServer::selected(int fd)
 {
   Connection *c;
 
+  if (fd == _gre_fd) {
+    if (_write_selected)
+      flush_gre();
+    // a bounded number of batches, so other sockets get their turn
+    for (int i = 0; i < 8 && handle_gre(); i++)
+      /* nada */;
+    return;
+  }
+
   if (fd == _fd) {
     c = initialize_pptp(fd);
     if (!c)
@@ -732,12 +906,9 @@ PPTPServer::selected(int fd)
   else
     c = _connections[fd];
 
-  assert(c);
+  assert(c && IS_PPTP(c));
 
-  if (IS_PPTP(c))
-    while (handle_pptp(c));
-  else
-    while (handle_gre(c));
+  while (handle_pptp(c));
 }
 
 void
@@ -746,10 +917,34 @@ PPTPServer::push(int input, Packet *p)
   Connection *c = _inputs[input];
   if (c) {
     assert(IS_GRE(c));
-    // XXX check for error
-    send_gre(c, (WritablePacket *)p);
+    send_gre(c, p);
   }
-  p->kill();
+  else
+    p->kill();
+}
+
+String
+PPTPServer::read_handler(Element *e, void *)
+{
+  PPTPServer *ps = (PPTPServer *)e;
+  int calls = 0;
+  for (int i = 0; i < ps->_inputs.size(); i++)
+    if (ps->_inputs[i])
+      calls++;
+  StringAccum sa;
+  sa << "calls " << calls << "\n";
+  sa << "received " << ps->_nrecv << "\n";
+  sa << "recv_calls " << ps->_nrecv_calls << "\n";
+  sa << "sent " << ps->_nsent << "\n";
+  sa << "send_calls " << ps->_nsend_calls << "\n";
+  sa << "dropped " << ps->_ndropped << "\n";
+  return sa.take_string();
+}
+
+void
+PPTPServer::add_handlers()
+{
+  add_read_handler("stats", read_handler, 0);
 }
 
 CLICK_ENDDECLS
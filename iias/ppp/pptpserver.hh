@@ -30,6 +30,8 @@
 #ifndef CLICK_PPTPSERVER_HH
 #define CLICK_PPTPSERVER_HH
 #include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/task.hh>
 #include <click/timer.hh>
 #include "ppp_defs.h"
 CLICK_DECLS
@@ -67,6 +69,20 @@ new connection or drops an old one. Default is false.
 
 =back
 
+All tunnels share one raw GRE socket. Received GRE packets are matched to
+their tunnel by call ID and source address; those that match no tunnel, or
+are malformed, are dropped. Packets are read and written in batches with
+recvmmsg and sendmmsg where the system has them: packets pushed to the
+inputs are queued and sent together when PPTPServer next runs its task.
+Receive buffers are reused when the packet read into them is not passed
+on. Acknowledgements that cannot ride on a data packet are sent, for all
+tunnels at once, within 50 ms of the data they acknowledge.
+
+=h stats read-only
+
+Open tunnels, GRE packets received and sent, the system calls that took,
+and GRE packets dropped.
+
 =e
 
 The following snippet enables a single PPTP tunnel with local address
@@ -112,7 +128,7 @@ rt[1]
 	-> PPPEncap(0x0021)
 	-> [0]pptpd
 
-=a PPPControlProtocol, IPCP, LCP, PPPEncap, Strip */
+=a PPPControlProtocol, IPCP, LCP, PPPEncap, Strip, PPTPLoadClient */
 
 class PPTPServer : public Element { public:
 
@@ -127,57 +143,101 @@ class PPTPServer : public Element { public:
   int configure(Vector<String> &conf, ErrorHandler *);
   int initialize(ErrorHandler *);
   void cleanup(CleanupStage);
+  void add_handlers();
 
   void selected(int);
+  bool run_task(Task *);
 
  private:
 
+  enum { BATCH = 32,		// packets per recvmmsg/sendmmsg
+	 SENDQ_MAX = 1024,	// packets queued while the socket is full
+	 ACK_DELAY = 50 };	// msec
+
   // PPTP or GRE connection
   struct Connection {
     void *ps;			// back pointer
-    int fd;			// socket descriptor
+    int fd;			// socket descriptor (PPTP only)
     int input;			// input number
     WritablePacket *next;	// pending packet
     // PPTP connection state
     struct Connection *gre;	// associated GRE connection (PPTP only)
     // GRE connection state
     struct Connection *pptp;	// associated PPTP connection (GRE only)
+    IPAddress local;		// our address
+    IPAddress peer;		// peer's address
+    uint16_t peer_call_id;	// call ID the peer chose
     uint32_t seq_sent;		// last sequence number sent
     uint32_t seq_recv;		// last sequence number received
     uint32_t ack_sent;		// last acknowledgement number sent
     uint32_t ack_recv;		// last acknowledgement number received
-    Timer *ack_timer;		// delayed acknowledgement timer
+    bool ack_queued;		// in _ack_queue
     Connection(int fd) : 
       ps(this), fd(fd),
-      next(NULL), gre(NULL), pptp(NULL),
-      seq_sent(0), seq_recv(0), ack_sent(0), ack_recv(0) { }
+      next(NULL), gre(NULL), pptp(NULL), peer_call_id(0),
+      seq_sent(0), seq_recv(0), ack_sent(0), ack_recv(0),
+      ack_queued(false) { }
     ~Connection() { }
   };
 
+  // GRE packet waiting to be sent
+  struct Outgoing {
+    WritablePacket *p;
+    IPAddress src;
+    IPAddress dst;
+  };
+
   bool _verbose;		// be verbose
   int _fd;			// listen socket descriptor
+  int _gre_fd;			// GRE raw socket shared by all tunnels
 
-  // hashed by socket descriptor
+  // hashed by socket descriptor, which is also our call ID
   Vector<Connection *> _connections;
   // hashed by input number
   Vector<Connection *> _inputs;
 
+  // receive buffers, kept from one read to the next unless passed on
+  WritablePacket *_rbuf[BATCH];
+
+  // GRE output queue
+  Vector<Outgoing> _sendq;
+  int _sendq_head;
+  bool _write_selected;
+  Task _send_task;
+
+  // connections owing their peer an acknowledgement
+  Vector<Connection *> _ack_queue;
+  Timer _ack_timer;
+
+  // statistics
+  uint32_t _nrecv;
+  uint32_t _nrecv_calls;
+  uint32_t _nsent;
+  uint32_t _nsend_calls;
+  uint32_t _ndropped;
+
   // connection management
   int initialize_socket_error(ErrorHandler *, const char *);
   void cleanup_connection(struct Connection *c);
   Connection * initialize_pptp(int listen_fd);
-  Connection * initialize_gre(int pptp_fd);
+  Connection * initialize_gre(int pptp_fd, uint16_t peer_call_id);
+  int open_gre_socket();
 
   // GRE output
   void push(int input, Packet *p);
-  int send_gre(Connection *c, WritablePacket *p);
-  static void send_ack(Timer *t, void *thunk);
+  int send_gre(Connection *c, Packet *p);
+  void flush_gre();
+  void queue_ack(Connection *c);
+  static void send_acks(Timer *t, void *thunk);
 
   // GRE/PPP input
-  void * handle_gre(Connection *c);
+  bool handle_gre();
+  bool handle_gre_packet(WritablePacket *p);
 
   // PPTP input
   void * handle_pptp(Connection *c);
+
+  static String read_handler(Element *, void *);
 };
 
 #define IS_GRE(c) ((c)->pptp != NULL)
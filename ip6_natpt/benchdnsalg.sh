@@ -0,0 +1,125 @@
+#! /bin/sh
+
+# benchdnsalg.sh -- fuzz DNSAlg and measure its throughput on captured DNS
+#
+# Replays tcpdump captures of DNS traffic (Ethernet link type) through
+# DNSAlg: IPv4 UDP packets into input 0, IPv6 UDP packets into input 1.  The
+# first run of each capture is clean and reports packets per second and CPU
+# cycles per packet from DNSAlg's stats handler.  Each fuzz round then flips
+# random bits in the UDP payloads with RandomBitErrors before DNSAlg; a
+# round fails if click does not exit cleanly.
+#
+# Needs a click built with the ip6_natpt package installed.
+
+usage () {
+    echo "Usage: benchdnsalg.sh [--rounds N] [--bits P] [--map 'IP6 IP4'] [--workdir DIR] CAPTURE..." 1>&2
+    exit 1
+}
+
+workdir="${TMPDIR:-/tmp}/benchdnsalg.$$"
+keepwork=0
+rounds=10
+bits=0.001
+map='fec0::1 ::1.0.0.1'
+
+while test $# -gt 0; do
+    case "$1" in
+      --rounds)
+	test $# -ge 2 || usage
+	rounds="$2"; shift 2;;
+      --bits)
+	test $# -ge 2 || usage
+	bits="$2"; shift 2;;
+      --map)
+	test $# -ge 2 || usage
+	map="$2"; shift 2;;
+      --workdir)
+	test $# -ge 2 || usage
+	workdir="$2"; keepwork=1; shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+test $# -ge 1 || usage
+
+mkdir -p "$workdir" || exit 1
+test $keepwork = 1 || trap 'rm -rf "$workdir"' 0
+
+# makeconfig CAPTURE BITS
+# With BITS 0 the payloads are left alone.
+makeconfig () {
+    if test "$2" = 0; then
+	fuzz4=""; fuzz6=""
+    else
+	fuzz4="-> Strip(28) -> RandomBitErrors($2) -> Unstrip(28)"
+	fuzz6="-> Strip(48) -> RandomBitErrors($2) -> Unstrip(48)"
+    fi
+    echo "
+require(ip6_natpt)
+at :: AddressTranslator(1, 0, $map, 0, 0, 0);
+dns :: DNSAlg(at, 0.0.1.in-addr.arpa, ns4.example.org, 1.0.0.0.0.c.e.f.ip6.int, ns6.example.org);
+FromDump(\"$1\", STOP true)
+    -> c :: Classifier(12/0800 23/11, 12/86dd 20/11, -);
+c[0] -> Strip(14) -> CheckIPHeader $fuzz4 -> [0]dns;
+c[1] -> Strip(14) -> CheckIP6Header $fuzz6 -> [1]dns;
+c[2] -> Discard;
+dns[0] -> Discard;
+dns[1] -> Discard;
+DriverManager(wait, print dns.stats)"
+}
+
+# field FILE KEY -- value of the "KEY value" line in FILE
+field () {
+    awk -v k="$2" '$1 == k { print $2; exit }' "$1"
+}
+
+if test -x /usr/bin/time && /usr/bin/time -f '%e' true >/dev/null 2>&1; then
+    timecmd='/usr/bin/time -f %e -o'
+else
+    timecmd=''
+fi
+
+status=0
+printf '%-24s %9s %9s %9s %7s %7s %9s %10s %8s %8s %7s\n' \
+    capture packets xlated passed failed dropped malformed pkts/sec cyc/pkt max_cyc fuzzok
+
+for cap in "$@"; do
+    name=`basename "$cap"`
+    out="$workdir/$name.out"
+    if test -n "$timecmd"; then
+	$timecmd "$workdir/$name.time" click -e "`makeconfig "$cap" 0`" > "$out"
+    else
+	click -e "`makeconfig "$cap" 0`" > "$out"
+    fi
+    if test $? != 0; then
+	echo "benchdnsalg.sh: $cap: click failed" 1>&2
+	status=1
+	continue
+    fi
+
+    ok=0
+    r=0
+    while test $r -lt $rounds; do
+	if click -e "`makeconfig "$cap" $bits`" > "$workdir/$name.fuzz$r.out" 2>&1; then
+	    ok=`expr $ok + 1`
+	else
+	    echo "benchdnsalg.sh: $cap: fuzz round $r failed, output in $workdir/$name.fuzz$r.out" 1>&2
+	    keepwork=1; trap - 0
+	    status=1
+	fi
+	r=`expr $r + 1`
+    done
+
+    sec=-
+    test -n "$timecmd" && sec=`cat "$workdir/$name.time"`
+    echo "`field $out packets` `field $out translated` `field $out passed` `field $out failed` `field $out dropped` `field $out malformed` $sec `field $out cycles` `field $out max_cycles`" \
+	| awk -v n="$name" -v ok="$ok/$rounds" '{
+	    rate = ($7 == "-" || $7 == 0 ? "-" : sprintf("%.0f", $1 / $7));
+	    printf "%-24s %9d %9d %9d %7d %7d %9d %10s %8d %8d %7s\n", n, $1, $2, $3, $4, $5, $6, rate, $8, $9, ok
+	}'
+done
+
+exit $status
@@ -50,5 +50,128 @@ class DNSMessage {
     int rfc1035_errno;
 
 };
+
+/*
+ * DNSView
+ *
+ * A DNS message parsed in place.  parse() checks the header and every
+ * question and resource record and remembers where each one starts; names
+ * and rdata are never copied.  The names in NS, CNAME, PTR, MX and SOA rdata
+ * are checked too.  A name is accepted if its labels stay inside the
+ * message, it is at most 255 octets long and it takes at most 127
+ * compression pointers, so walking a checked name always ends.
+ */
+#define DNSVIEW_MAX_RECORDS	128
+#define DNSVIEW_MAX_NAME	255
+
+struct DNSRecord {
+  unsigned short name;		// offset of the owner name
+  unsigned short fields;	// offset of TYPE
+  unsigned short rdata;		// offset of RDATA, 0 in questions
+  unsigned short rdlength;
+  unsigned short type;
+  unsigned char section;
+};
+
+class DNSView {
+  public:
+
+    enum { QUESTION = 0, ANSWER, AUTHORITY, ADDITIONAL };
+
+    DNSView() : _buf(0), _len(0), _n(0) { }
+
+    // Returns 0, or -1 if the message is malformed or holds more than
+    // DNSVIEW_MAX_RECORDS questions and records
+    int parse(const unsigned char *buf, unsigned len);
+
+    const unsigned char *data() const	{ return _buf; }
+    unsigned length() const		{ return _len; }
+    unsigned short id() const		{ return u16(0); }
+    bool response() const		{ return (_buf[2] & 0x80) != 0; }
+    unsigned char opcode() const	{ return (_buf[2] >> 3) & 0x0F; }
+    unsigned short count(int section) const { return u16(4 + 2 * section); }
+    int size() const			{ return _n; }
+    const DNSRecord &record(int i) const { return _rr[i]; }
+    unsigned short u16(unsigned off) const { return (_buf[off] << 8) | _buf[off + 1]; }
+
+    // Octets of the name at off as it is stored, up to and including the
+    // first compression pointer, or -1 if the name is not valid
+    int name_length(unsigned off) const;
+
+    // Follows compression pointers from off to the next label, returning
+    // its offset; off must be inside a checked name
+    unsigned label(unsigned off) const;
+
+    // Reads the address out of an N.N.N.N.in-addr.arpa name, or out of
+    // a 32 nibble ip6.int or ip6.arpa name.  Return false if the name at
+    // off is not of that form.
+    bool ptr_ipv4(unsigned off, unsigned char *addr) const;
+    bool ptr_ipv6(unsigned off, unsigned char *addr) const;
+
+  private:
+
+    const unsigned char *_buf;
+    unsigned _len;
+    DNSRecord _rr[DNSVIEW_MAX_RECORDS];
+    int _n;
+
+    int check_name(unsigned off, unsigned end) const;
+    bool label_is(unsigned off, const char *s) const;
+
+};
+
+/*
+ * DNSWriter
+ *
+ * Builds a DNS message in a buffer the caller owns.  Names copied from a
+ * DNSView keep their compression: the writer remembers where each label
+ * it copies went, points a compression pointer at the new place of its
+ * target, and writes the name out in full when the target was not copied
+ * or was replaced.  A replaced name can be made a pointer target again
+ * with map().  Writing past the end of the buffer sets overflow().
+ */
+#define DNSWRITER_MAX_LABELS	512
+
+class DNSWriter {
+  public:
+
+    DNSWriter(unsigned char *buf, unsigned size)
+      : _buf(buf), _size(size), _len(0), _overflow(false), _nmap(0) { }
+
+    unsigned char *data() const		{ return _buf; }
+    unsigned length() const		{ return _len; }
+    bool overflow() const		{ return _overflow; }
+
+    // Starts the message over
+    void clear()			{ _len = 0; _overflow = false; _nmap = 0; }
+
+    void bytes(const void *p, unsigned n);
+    void u16(unsigned short v);
+    void set_u16(unsigned off, unsigned short v);
+
+    void name(const DNSView &v, unsigned off);
+    void pointer(unsigned out_off);
+    void text_name(const char *s, unsigned n);
+    void ptr_ipv4(const unsigned char *addr);
+    void ptr_ipv6(const unsigned char *addr);
+
+    // Records that the name at in_off in the view was written at out_off
+    void map(unsigned in_off, unsigned out_off);
+
+  private:
+
+    unsigned char *_buf;
+    unsigned _size;
+    unsigned _len;
+    bool _overflow;
+    unsigned short _map_in[DNSWRITER_MAX_LABELS];
+    unsigned short _map_out[DNSWRITER_MAX_LABELS];
+    int _nmap;
+
+    int find(unsigned in_off) const;
+    void label(const char *s, unsigned n);
+
+};
+
 CLICK_ENDDECLS
 #endif
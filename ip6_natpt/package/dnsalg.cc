@@ -16,6 +16,7 @@
  */
 
 #include "dnsalg.hh"
+#include <click/straccum.hh>
 
 CLICK_DECLS
 
@@ -26,6 +27,7 @@ DNSAlg::DNSAlg()
     /* in 1: IPv6 arriving packets */
     /* out 0: IPv4 outgoing translated packets*/
     /* out 1: IPv6 outgoing translated packets*/
+  reset_stats();
 }
 
 DNSAlg::~DNSAlg()
@@ -35,26 +37,20 @@ DNSAlg::~DNSAlg()
 int
 DNSAlg::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-  String rest;
-  if (conf.size() != 5)
-    return errh->error("Wrong number of arguments; expected `DnsAlg(AddressTranlator, PTR zone IPv4 network, IPv4 DNS server name, PTR zone IPv6 network, IPv6 DNS server name)'");
+  Element *e;
+  if (cp_va_kparse(conf, this, errh,
+		   "ADDRESS_TRANSLATOR", cpkP+cpkM, cpElement, &e,
+		   "IPV4_PTR_ZONE", cpkP, cpString, &ipv4_dns_server_ptr_domain,
+		   "IPV4_DNS_SERVER", cpkP, cpString, &ipv4_dns_server_name,
+		   "IPV6_PTR_ZONE", cpkP, cpString, &ipv6_dns_server_ptr_domain,
+		   "IPV6_DNS_SERVER", cpkP, cpString, &ipv6_dns_server_name,
+		   cpEnd) < 0)
+    return -1;
 
   // get control packet rewriter
-  Element *e = cp_element(conf[0], this, errh);
-  if (!e)
-    return -1;
   _at = (AddressTranslator *)e->cast("AddressTranslator");
   if (!_at)
     return errh->error("First argument must be a AddressTranslator element");
-  if (!cp_string(conf[1],&ipv4_dns_server_ptr_domain,&rest))
-    return errh->error("Second parameter must be the PTR domain zone of the IPv4 Network");
-  if (!cp_string(conf[2],&ipv4_dns_server_name,&rest))
-    return errh->error("Third parameter must be the name of the DNS server of the IPv4 Network");  
-  if (!cp_string(conf[3],&ipv6_dns_server_ptr_domain,&rest))
-    return errh->error("Four parameter must be the PTR domain zone of the IPv6 Network");
-  if (!cp_string(conf[4],&ipv6_dns_server_name,&rest))
-    return errh->error("Fifth parameter must be the name of the DNS server of the IPv6 Network");
-   
   return 0;
 }
 
@@ -73,846 +69,473 @@ DNSAlg::uninitialize()
 void
 DNSAlg::push(int port, Packet *p)
 {
+  click_cycles_t start = click_get_cycles();
+  _packets++;
   if (port == 0)
-    translate_ipv6_ipv4(p);
+    p = translate_ipv6_ipv4(p);
   else
-    translate_ipv4_ipv6(p);
+    p = translate_ipv4_ipv6(p);
+  uint64_t c = click_get_cycles() - start;
+  _cycles += c;
+  if (c > _max_cycles)
+    _max_cycles = c;
+  if (p)
+    output(port).push(p);
 }
 
-void
+Packet *
 DNSAlg::translate_ipv4_ipv6(Packet *p)
 {
-  //Get pointers to IPv4 header, TCP header and data, offsets and lengths
+  //Get pointers to IPv6 header, UDP header and data
   const click_ip6 *ip6h = p->ip6_header();
-  const click_udp *udph = (click_udp *)(ip6h + 1);
-  const unsigned char *data = (unsigned char *)(udph + 1);
-
-  unsigned len = 0;
-  //size of the packets data, no tcp/udp/IPv6 headers included
-  len = ntohs(ip6h->ip6_plen) - sizeof(click_udp);
-  unsigned old_len = len;
-  unsigned data_offset = (data - p->data());
-  unsigned short qtype;
-  unsigned short qclass;
-  unsigned short sport,dport,mport;
-  unsigned usport = ntohs(udph->uh_sport);
-  unsigned udport = ntohs(udph->uh_dport);
-  unsigned newlen = 0;
-  size_t new_len = 1024;
-  int i=0;
-  off_t off = 0;
-  rfc1035_header hdr;
-  const char *buffer;
-  const char *domainName = new char[1024];
-  char *newbuffer = new char[1024];
-  IP6Address ipv6_internal_address;
-  IP6Address ipv6_mapped_address;
+  const click_udp *udph = (const click_udp *)(ip6h + 1);
+  unsigned data_offset = (const unsigned char *)(udph + 1) - p->data();
   IP6Address ipv6_external_address = IP6Address(ip6h->ip6_src);
 
-  buffer = (const char*)data;
-  DNSMessage *dnsmsg = new DNSMessage();
-  memset(&hdr, '\0', sizeof(hdr));
-
-  //Unpack DNS header and see if it is a query or response
-  if ((dnsmsg->rfc1035HeaderUnpack(buffer,len,&off,&hdr) == 1) || (usport != 53 && udport != 53))
+  if (ip6h->ip6_nxt != IP_PROTO_UDP)
   {
-    //If it is not a DNS query, send the packet with no modification.
-    output(1).push(p);
-    return;
+    _passed++;
+    return p;
   }
-  else if (len == off)
-  {
-    output(1).push(p);
-    return;
-
-  }  
-  else
+  int what = parse_payload(p, udph);
+  if (what == PASS)
+    return p;
+  else if (what == DROP)
   {
-    memset(newbuffer, '\0', len);
-    //it's a question
-    if (hdr.qr == 0)
-    {
-      //Now we have to extract the QTYPE and QCLASS of the question
-      //For this we have to calculate the offset of where those values begins.
-      //So we first unpack the name of the question so we can now know where QTYPE starts
-      if (dnsmsg->rfc1035NameUnpack(buffer, len, &off,(char *)domainName, RFC1035_MAXHOSTNAMESZ))
-      {
-        click_chatter("ERROR obtaining domaine name (4->6)");
-        return;
-      }
-      else
-      {
-        memcpy(&qtype, buffer + off, sizeof(qtype));
-        off += sizeof(qtype);
-        qtype = ntohs(qtype);
-        memcpy(&qclass, buffer + off, sizeof(qclass));
-        off += sizeof(qclass);
-        qclass = ntohs(qclass);
-        if (qtype == RFC1035_TYPE_A)
-        {
-          dnsmsg->rfc1035BuildAAAAQuery(domainName, newbuffer, &new_len, hdr.id);
-          //After building the query, len has the size of the new AAAA Query.
-        }
-        else if (qtype == RFC1035_TYPE_AAAA)
-        {
-          click_chatter("Found AAAA query generated from IPv4...");
-          return;
-        }
-        else if (qtype == RFC1035_TYPE_PTR)
-        {
-          //get the IPv4 address contained in the inverse query
-          char *ipv4_address = new char[RFC1035_MAXHOSTNAMESZ];
-	 memset(ipv4_address,'\0',RFC1035_MAXHOSTNAMESZ); 
-          if (get_query_ipv4_address(domainName, ipv4_address) == 0)
-          {
-            click_chatter("Error: get_query_ipv4_address (4->6)");
-            return;
-          }
-          char *ipv6_address = new char[RFC1035_MAXHOSTNAMESZ];
-	      memset(ipv6_address,'\0',RFC1035_MAXHOSTNAMESZ);
-          sprintf(ipv6_address,"::%s",ipv4_address);
-	      ipv6_mapped_address = IP6Address(ipv6_address);
-
-          //Lookup its original IPv6 address in the Address Translator
-          if (_at->lookup(ipv6_internal_address, sport, ipv6_mapped_address, mport, ipv6_external_address, dport, 1))
-          {
-            //If found, create new PTR query with the mapped IPv4 address
-            char *new_ipv6_internal_address = dnsmsg->my_strdup(ipv6_internal_address.unparse().c_str());
-            dnsmsg->rfc1035BuildPTR6Query(new_ipv6_internal_address,newbuffer, &new_len, hdr.id);
-            delete (ipv4_address);
-            delete (ipv6_address);
-            delete (new_ipv6_internal_address);            
-          }
-          else
-          {
-            //We can't find a IPv6 address for the mapped IPv4 address the client is querying, so we answer to him
-            //with a SERVER FAILED response.
-            click_chatter("LOOKUP FAILED: No IPv6 address asociated with that IP address and cannot associate one to it!");
-            dnsmsg->rfc1035BuildFailedQueryResponse(domainName,qtype,newbuffer, &new_len, hdr.id);
-            failed_query = true;
-          }
-        }
-      }
-      newlen = new_len;
-      delete (domainName);
-    }
-    else if (hdr.qr == 1)//it's an answer
-    {
-      unsigned short rid;
-      int n;
-      off_t off2 = 0;
-      char *ipv6_ptr_domain = new char[RFC1035_MAXHOSTNAMESZ];
-      memset(ipv6_ptr_domain,'\0',RFC1035_MAXHOSTNAMESZ);
-      struct in_addr ipv4_addr_from_AAAA_answer;
-
-      //First pack the header section because it doesn't need any type of
-      //translation.
-      off2 += dnsmsg->rfc1035HeaderPack(newbuffer, new_len, &hdr);
-      new_len -= off2;
-      //Unpack again the question, because in the answers, the question in the message also
-      //needs to be translated.
-      if (dnsmsg->rfc1035NameUnpack(buffer, len, &off, (char *)domainName, RFC1035_MAXHOSTNAMESZ))
-      {
-        click_chatter("Failed domain Name unpacking...(4->6)");
-        return;
-      }
-      else
-      {
-        memcpy(&qtype, buffer + off, sizeof(qtype));
-        off += sizeof(qtype);
-        qtype = ntohs(qtype);
-        memcpy(&qclass, buffer + off, sizeof(qclass));
-        off += sizeof(qclass);
-        qclass = ntohs(qclass);
-
-        //First, we update the question section
-        if (qtype == RFC1035_TYPE_A)
-        {
-          off2 += dnsmsg->rfc1035QuestionPack(newbuffer + off2, new_len - off2, domainName, RFC1035_TYPE_AAAA, qclass);
-          new_len -= off2;
-        }
-        else if (qtype == RFC1035_TYPE_PTR)
-        {
-          char *ipv4_address = new char[16];
-          memset(ipv4_address,'\0',16);
-	      int nn = get_query_ipv4_address(domainName, ipv4_address);
-          if (nn == 0)
-          {
-            return;
-          }
-          else
-          {
-            char *ipv6_address = new char[RFC1035_MAXHOSTNAMESZ];
-            memset(ipv6_address,'\0',RFC1035_MAXHOSTNAMESZ);
-            sprintf(ipv6_address,"::%s",ipv4_address);
-	        ipv6_ptr_domain = dnsmsg->rfc1035BuildPTR6Domain(ipv6_address);
-            off2 += dnsmsg->rfc1035QuestionPack(newbuffer + off2, new_len - off2, ipv6_ptr_domain, RFC1035_TYPE_PTR, qclass);
-            new_len -= off2;
-            delete(ipv4_address);
-          }
-        }
-        off_t offset_after_answers = 0;
-        rfc1035_rr *answers = NULL;
-        rfc1035_rr *authorities = NULL;
-        rfc1035_rr *additionals = NULL;
-        n = dnsmsg->rfc1035AnswersUnpack(buffer,len,&answers, &authorities, &additionals, &rid,&offset_after_answers);        
-        if (n == -2) //Server Failure: The name server was unable to process this query (didn't found an answer :-( ).
-          n = 0;
-  	    if (n < 0)
-        {
-          click_chatter("Bad response from DNS server! (4->6)");
-          //It's a corrupt answer
-          return;
-  	    }
-        for (i = 0; i < n; i++)
-        {
-	    	  if (answers[i].type == RFC1035_TYPE_A)
-          {
-            //First, we update the question section
-            //Then we translate the answer
-            answers[i].type = RFC1035_TYPE_AAAA;
-            struct in_addr a;
-         		memcpy(&a, answers[i].rdata, 4);
-            char *ipv6_address = new char[RFC1035_MAXHOSTNAMESZ];
-            //Create a IPAddress instance, and then create a IP6Address instance to create
-            //the IPv4-mapped IPv6 address
-            IPAddress tempaddr = IPAddress(a);
-            IP6Address temp6 = IP6Address(tempaddr);
-            click_in6_addr ipv6_addr;            
-            ipv6_addr = temp6.in6_addr();
-            delete (answers[i].rdata);            
-            answers[i].rdlength = sizeof(struct in6_addr);
-            answers[i].rdata = new char[answers[i].rdlength];
-            memset(answers[i].rdata,'\0',answers[i].rdlength);
-            memcpy(answers[i].rdata,&ipv6_addr,answers[i].rdlength);
-            dnsmsg->rfc1035RRPack(&answers[i],&off2,newbuffer,new_len);
-            new_len -= off2;
-            delete (ipv6_address);
-          }
-          else if (answers[i].type == RFC1035_TYPE_PTR)
-          {
-            memset(answers[i].name,'\0',RFC1035_MAXHOSTNAMESZ);
-            memcpy(answers[i].name,ipv6_ptr_domain,strlen(ipv6_ptr_domain));
-            dnsmsg->rfc1035RRPack(&answers[i],&off2,newbuffer,new_len);
-            new_len -= off2;
-          } 
-        }
-       //Now we need to translate the Autorities and Aditionals sections (if needed)
-        for (i = 0; i < hdr.nscount; i++)
-        {
-          if (qtype == RFC1035_TYPE_PTR)
-          {
-            memset(authorities[i].name,'\0',RFC1035_MAXHOSTNAMESZ);            
-            memcpy(authorities[i].name,ipv6_dns_server_ptr_domain.c_str(),strlen(ipv6_dns_server_ptr_domain.c_str()));
-          }
-          memset(authorities[i].rdata,'\0',RFC1035_MAXHOSTNAMESZ);
-          memcpy(authorities[i].rdata,ipv4_dns_server_name.c_str(),strlen(ipv4_dns_server_name.c_str()));
-          authorities[i].rdlength = strlen(ipv4_dns_server_name.c_str()) + 2;          
-          dnsmsg->rfc1035RRPack(&authorities[i],&off2,newbuffer,new_len);
-          new_len -= off2;
-        }
-        for (i = 0; i < hdr.arcount; i++)
-        {
-          //In case that the query was PTR type and there is a AAAA RR in the additionas
-          //it has to be translated too.
-          if (additionals[i].type == RFC1035_TYPE_A)
-          {
-            additionals[i].type = RFC1035_TYPE_AAAA;
-            struct in_addr a;
-         		memcpy(&a, additionals[i].rdata, sizeof(struct in_addr));
-            IPAddress tmpaddr = IPAddress(a);
-            IP6Address tmpaddr6 = IP6Address(tmpaddr);
-            click_in6_addr ipv6_addr;
-            ipv6_addr = tmpaddr6.in6_addr();
-            delete (additionals[i].rdata);
-            additionals[i].rdlength = sizeof(struct in6_addr);            
-            additionals[i].rdata = new char[additionals[i].rdlength];
-            memset(additionals[i].rdata,'\0',additionals[i].rdlength);
-            memcpy(additionals[i].rdata,&ipv6_addr,additionals[i].rdlength);
-          }
-          
-          dnsmsg->rfc1035RRPack(&additionals[i],&off2,newbuffer,new_len);
-          new_len -= off2;
-        }
-      }
+    p->kill();
+    return 0;
+  }
 
-      newlen = off2;
-      delete (ipv6_ptr_domain);
-      delete (domainName);
-    }
-    WritablePacket *wp;
-    if (old_len < newlen)
-    {
-      wp = p->put(newlen - old_len);
-    }
-    else
-    {
-      wp = p->uniqueify();
-      wp->take(old_len - newlen);
-    }
-    memcpy(wp->data() + data_offset,newbuffer,newlen);
-    //Delete the temporal newbuffer
-    delete(newbuffer);
+  WritablePacket *wp = rewrite_packet(p, data_offset, true, ipv6_external_address, what);
+  if (!wp)
+    return 0;
+  unsigned len = wp->length() - data_offset;
 
-    click_ip6 *wp_ip6h = (click_ip6 *)wp->data();
-    click_udp *wp_udph = (click_udp *)(wp_ip6h + 1);
-    if (failed_query)
-    {
-        IP6Address temp_src = IP6Address(wp_ip6h->ip6_src);
-        IP6Address temp_dst = IP6Address(wp_ip6h->ip6_dst);
-        unsigned temp_src_port = wp_udph->uh_sport;
-        unsigned temp_dst_port = wp_udph->uh_dport;
-        
-        //We invert addresses so we can send the failed query response to the client
-        wp_ip6h->ip6_src = temp_dst.in6_addr();
-        wp_ip6h->ip6_dst = temp_src.in6_addr();
-        wp_udph->uh_sport = temp_dst_port;
-        wp_udph->uh_dport = temp_src_port;        
-        failed_query = false;        
-    }
-    else    
-    //update payload length of IPv6 header
-    wp_ip6h->ip6_plen = htons(wp->length() - wp->ip6_header_length());
-    //update UDP checksum
-    wp_udph->uh_ulen = htons(newlen + sizeof(click_udp));
-    wp_udph->uh_sum = htons(in6_fast_cksum(&wp_ip6h->ip6_src, &wp_ip6h->ip6_dst,
-                                            wp_ip6h->ip6_plen, wp_ip6h->ip6_nxt,
-                                            wp_udph->uh_sum, (unsigned char *)wp_udph,
-                                            wp_ip6h->ip6_plen));
-    
-    output(1).push(wp);
+  click_ip6 *wp_ip6h = (click_ip6 *)wp->ip6_header();
+  click_udp *wp_udph = (click_udp *)(wp_ip6h + 1);
+  if (what == SERVFAIL)
+  {
+    click_in6_addr temp_addr = wp_ip6h->ip6_src;
+    unsigned short temp_port = wp_udph->uh_sport;
+
+    //We invert addresses so we can send the failed query response to the client
+    wp_ip6h->ip6_src = wp_ip6h->ip6_dst;
+    wp_ip6h->ip6_dst = temp_addr;
+    wp_udph->uh_sport = wp_udph->uh_dport;
+    wp_udph->uh_dport = temp_port;
+    _failed++;
   }
+  else
+    _translated++;
+
+  //update payload length of IPv6 header
+  wp_ip6h->ip6_plen = htons(len + sizeof(click_udp));
+  //update UDP checksum
+  wp_udph->uh_ulen = htons(len + sizeof(click_udp));
+  wp_udph->uh_sum = 0;
+  wp_udph->uh_sum = htons(in6_fast_cksum(&wp_ip6h->ip6_src, &wp_ip6h->ip6_dst,
+                                          wp_ip6h->ip6_plen, wp_ip6h->ip6_nxt,
+                                          wp_udph->uh_sum, (unsigned char *)wp_udph,
+                                          wp_ip6h->ip6_plen));
+  return wp;
 }
-void
+
+Packet *
 DNSAlg::translate_ipv6_ipv4(Packet *p)
 {
   const click_ip *iph = p->ip_header();
   const click_udp *udph = p->udp_header();
-  const unsigned char *data = (unsigned char *)(udph + 1);
-  unsigned data_offset = (data - p->data());
-  unsigned len = ntohs(iph->ip_len) - sizeof(click_ip) - sizeof(click_udp);
-  unsigned old_len = len;
-  unsigned short sport,dport,mport;
-  unsigned short usport = ntohs(udph->uh_sport);
-  unsigned short udport = ntohs(udph->uh_dport);
-  unsigned short qtype;
-  unsigned short qclass;  
-  int i = 0;
-  off_t off = 0;  
-  IP6Address ipv6_internal_address;
-  IP6Address ipv6_mapped_address;
-  IP6Address ipv6_external_address = IP6Address(iph->ip_dst);
-  rfc1035_header hdr;
-  const char *buffer;
-  const char * domainName = new char[1024];
-  //new buffer of the same size of the actual buffer
-  char *newbuffer = new char[1024];
-  unsigned newlen = 0;
-  size_t new_len = 1024;
-
-  buffer = (const char*)data;
-  DNSMessage *dnsmsg = new DNSMessage();
-  memset(&hdr, '\0', sizeof(hdr));
-  //Unpack DNS header and see if it is a query or response
-  if ((dnsmsg->rfc1035HeaderUnpack(buffer,len,&off,&hdr) == 1) || (usport != 53 && udport != 53))
+  unsigned data_offset = (const unsigned char *)(udph + 1) - p->data();
+  IP6Address ipv6_external_address = IP6Address(IPAddress(iph->ip_dst));
+
+  if (iph->ip_p != IP_PROTO_UDP || IP_ISFRAG(iph))
   {
-    //If it is a bogus query, send the packet with no modification.
-    output(0).push(p);
+    _passed++;
+    return p;
   }
-  else if (len == off)
+  int what = parse_payload(p, udph);
+  if (what == PASS)
+    return p;
+  else if (what == DROP)
   {
-    output(0).push(p);
-    return;
+    p->kill();
+    return 0;
+  }
 
-  } 
-  else
+  WritablePacket *wp = rewrite_packet(p, data_offset, false, ipv6_external_address, what);
+  if (!wp)
+    return 0;
+  _translated++;
+
+  // set IP length field, incrementally update IP checksum according to RFC1624
+  // new_sum = ~(~old_sum + ~old_halfword + new_halfword)
+  click_ip *wp_iph = wp->ip_header();
+  unsigned short old_ip_hw = ((unsigned short *)wp_iph)[1];
+  wp_iph->ip_len = htons(wp->length() - wp->ip_header_offset());
+  unsigned short new_ip_hw = ((unsigned short *)wp_iph)[1];
+  unsigned ip_sum =
+    (~wp_iph->ip_sum & 0xFFFF) + (~old_ip_hw & 0xFFFF) + new_ip_hw;
+  while (ip_sum >> 16)		// XXX necessary?
+    ip_sum = (ip_sum & 0xFFFF) + (ip_sum >> 16);
+  wp_iph->ip_sum = ~ip_sum;
+
+  // set UDP checksum
+  click_udp *wp_udph = wp->udp_header();
+  unsigned wp_udp_len = wp->length() - wp->transport_header_offset();
+  wp_udph->uh_ulen = htons(wp_udp_len);
+  wp_udph->uh_sum = 0;
+  unsigned csum = ~click_in_cksum((unsigned char *)wp_udph, wp_udp_len) & 0xFFFF;
+#ifdef CLICK_LINUXMODULE
+  csum = csum_tcpudp_magic(wp_iph->ip_src.s_addr, wp_iph->ip_dst.s_addr,
+			   wp_udp_len, IP_PROTO_UDP, csum);
+#else
   {
-    //it's a question
-    if (hdr.qr == 0)
+    unsigned short *words = (unsigned short *)&wp_iph->ip_src;
+    csum += words[0];
+    csum += words[1];
+    csum += words[2];
+    csum += words[3];
+    csum += htons(IP_PROTO_UDP);
+    csum += htons(wp_udp_len);
+    while (csum >> 16)
+      csum = (csum & 0xFFFF) + (csum >> 16);
+    csum = ~csum & 0xFFFF;
+  }
+#endif
+  wp_udph->uh_sum = csum;
+  return wp;
+}
+
+/*
+ * parse_payload()
+ *
+ * Parses the DNS message carried by the UDP datagram at udph into _view.
+ * Datagrams that are not to or from port 53, are too short for a DNS
+ * header, or carry something other than a standard query or its response
+ * are passed untouched.  Returns PASS, TRANSLATE (_view holds the message)
+ * or DROP.
+ */
+int
+DNSAlg::parse_payload(Packet *p, const click_udp *udph)
+{
+  const unsigned char *data = (const unsigned char *)(udph + 1);
+  if (data > p->end_data()
+      || (ntohs(udph->uh_sport) != 53 && ntohs(udph->uh_dport) != 53))
+  {
+    _passed++;
+    return PASS;
+  }
+  unsigned len = p->end_data() - data;
+  unsigned ulen = ntohs(udph->uh_ulen);
+  if (ulen >= sizeof(click_udp) && ulen - sizeof(click_udp) < len)
+    len = ulen - sizeof(click_udp);
+  if (len < 12)
+  {
+    _passed++;
+    return PASS;
+  }
+
+  if (_view.parse(data, len) < 0)
+  {
+    _malformed++;
+    return DROP;
+  }
+  if (_view.opcode() != 0 || _view.count(DNSView::QUESTION) == 0)
+  {
+    _passed++;
+    return PASS;
+  }
+
+  return TRANSLATE;
+}
+
+/*
+ * rewrite_packet()
+ *
+ * Makes a packet with p's headers and writes the translated message in
+ * _view straight after them, then kills p.  The message is first given
+ * room for its records to grow; if that is not enough it is written again
+ * with room for the largest UDP datagram.  Leaves TRANSLATE or SERVFAIL in
+ * what.  Returns 0, having counted the drop, if the message cannot be
+ * translated.
+ */
+WritablePacket *
+DNSAlg::rewrite_packet(Packet *p, unsigned data_offset, bool to_ipv6,
+                       const IP6Address &external, int &what)
+{
+  unsigned max_room = 0xFFFF - sizeof(click_udp);
+  unsigned room = 2 * _view.length() + 12 * _view.size() + 128;
+  if (room > max_room)
+    room = max_room;
+
+  while (1)
+  {
+    WritablePacket *wp = Packet::make(p->headroom(), 0, data_offset + room, 0);
+    if (!wp)
+      break;
+    memcpy(wp->data(), p->data(), data_offset);
+    DNSWriter w(wp->data() + data_offset, room);
+    what = rewrite(w, to_ipv6, external);
+    if (what != DROP && !w.overflow())
     {
-      //Now we have to extract the QTYPE and QCLASS of the question
-      //For this we have to calculate the offset of where those values begins.
-      //So we first unpack the name of the question so we can now know where QTYPE starts
-      if (dnsmsg->rfc1035NameUnpack(buffer,len,&off,(char *)domainName,RFC1035_MAXHOSTNAMESZ))
-      {
-        click_chatter("Error obtaining Domain Name...(6->4)");
-        return;
-      }
-      else
-      {
-        memcpy(&qtype, buffer + off, sizeof(qtype));
-        off += sizeof(qtype);
-        qtype = ntohs(qtype);
-        memcpy(&qclass, buffer + off, sizeof(qclass));
-        off += sizeof(qclass);
-        qclass = ntohs(qclass);
-        memset(newbuffer, '\0', len);
-        if (qtype == RFC1035_TYPE_AAAA)
-        {
-          dnsmsg->rfc1035BuildAQuery(domainName,newbuffer,&new_len, hdr.id);
+      wp->take(room - w.length());
+      wp->copy_annotations(p);
+      wp->set_network_header(wp->data() + p->network_header_offset(),
+                             p->network_header_length());
+      p->kill();
+      return wp;
+    }
+    wp->kill();
+    if (what == DROP || room == max_room)
+      break;
+    room = max_room;
+  }
+  _dropped++;
+  p->kill();
+  return 0;
+}
 
-          //After building the query, len has the size of the new A Query.
-        }
-        else if (qtype == RFC1035_TYPE_A)
-        {
-          return;
-        } 
+/*
+ * rewrite()
+ *
+ * Copies the message in _view to w, translating A records to AAAA (or
+ * AAAA to A) and PTR names between in-addr.arpa and ip6.int.  The IPv4
+ * address in an in-addr.arpa query going to IPv6 is looked up in the
+ * AddressTranslator; if it has no mapping the sender gets a SERVFAIL
+ * answer.  AAAA records, and ip6.int names in responses, going to IPv4
+ * are looked up too, and the message is dropped if one has no mapping.
+ */
+int
+DNSAlg::rewrite(DNSWriter &w, bool to_ipv6, const IP6Address &external)
+{
+  const unsigned char *in = _view.data();
+  unsigned short from = (to_ipv6 ? RFC1035_TYPE_A : RFC1035_TYPE_AAAA);
+  unsigned short to = (to_ipv6 ? RFC1035_TYPE_AAAA : RFC1035_TYPE_A);
+  const String &zone = (to_ipv6 ? ipv6_dns_server_ptr_domain : ipv4_dns_server_ptr_domain);
+  const String &server = (to_ipv6 ? ipv4_dns_server_name : ipv6_dns_server_name);
+  unsigned char addr4[4];
+  unsigned char addr6[16];
+  int qname = -1;		// where the translated PTR question went
+
+  //Queries for AAAA from IPv4 or for A from IPv6 are not translated
+  if (!_view.response() && _view.record(0).type == to)
+    return DROP;
+
+  w.bytes(in, 12);
+  for (int i = 0; i < _view.size(); i++)
+  {
+    const DNSRecord &r = _view.record(i);
 
-        else if (qtype == RFC1035_TYPE_PTR)
+    if (r.section == DNSView::QUESTION)
+    {
+      unsigned at = w.length();
+      if (r.type == RFC1035_TYPE_PTR && to_ipv6 && _view.ptr_ipv4(r.name, addr4))
+      {
+        if (!_view.response())
         {
-          //get the IPv6 address contained in the inverse query
-          char *ipv6_address = new char[RFC1035_MAXHOSTNAMESZ];
-					memset(ipv6_address,'\0',RFC1035_MAXHOSTNAMESZ);
-          if (get_query_ipv6_address(domainName, ipv6_address) == 0)
+          if (!lookup_ipv6(addr4, external, addr6))
           {
-            return;
+            servfail(w, r);
+            return SERVFAIL;
           }
-          else
-          {
-            int ipv4_addr[4];
-            hex_ipv4_to_dec_ipv4(ipv6_address,ipv4_addr);
-
-            char *addr_tmp = new char[RFC1035_MAXHOSTNAMESZ];
-            //snprintf(addr_tmp,16,"%d.%d.%d.%d",ipv4_addr[0], ipv4_addr[1], ipv4_addr[2], ipv4_addr[3]);
-      	    sprintf(addr_tmp,"%d.%d.%d.%d",ipv4_addr[0], ipv4_addr[1], ipv4_addr[2], ipv4_addr[3]);	
-            struct in_addr ipv4_a;
-            IPAddress tempaddr = IPAddress(addr_tmp);
-            ipv4_a = tempaddr.in_addr();
-            dnsmsg->rfc1035BuildPTRQuery(ipv4_a,newbuffer, &new_len, hdr.id);
-            delete (ipv6_address);
-            delete (addr_tmp);
-          }  
         }
+        else
+          memcpy(addr6, IP6Address(IPAddress(addr4)).data(), 16);
+        w.ptr_ipv6(addr6);
+        w.map(r.name, at);
+        qname = at;
+      }
+      else if (r.type == RFC1035_TYPE_PTR && !to_ipv6 && _view.ptr_ipv6(r.name, addr6))
+      {
+        if (!_view.response())
+          memcpy(addr4, addr6 + 12, 4);
+        else if (!lookup_ipv4(addr6, external, addr4))
+          return DROP;
+        w.ptr_ipv4(addr4);
+        w.map(r.name, at);
+        qname = at;
       }
-      newlen = new_len;
-      delete (domainName);
+      else
+        w.name(_view, r.name);
+      if (r.type == from)
+        w.u16(to);
+      else
+        w.bytes(in + r.fields, 2);
+      w.bytes(in + r.fields + 2, 2);
+      continue;
     }
-    else if (hdr.qr == 1)//it's an answer
+
+    //Owner name
+    if (qname >= 0 && r.type == RFC1035_TYPE_PTR && r.section == DNSView::ANSWER)
+      w.pointer(qname);
+    else if (qname >= 0 && r.type == RFC1035_TYPE_NS && r.section == DNSView::AUTHORITY
+             && zone.length())
+      w.text_name(zone.data(), zone.length());
+    else
+      w.name(_view, r.name);
+
+    //Address records change type and rdata
+    if (r.type == from && r.rdlength == (to_ipv6 ? 4 : 16))
     {
-      unsigned short rid;
-      int n;
-      off_t off2 = 0;
-      char *ipv4_ptr_domain = new char[RFC1035_MAXHOSTNAMESZ];
-      memset(ipv4_ptr_domain,'\0',RFC1035_MAXHOSTNAMESZ);
-      struct in_addr ipv4_addr_from_AAAA_answer;
-
-      //First pack the header section because it doesn't need any type of
-      //translation.
-      off2 += dnsmsg->rfc1035HeaderPack(newbuffer, new_len, &hdr);
-      new_len -= off2;
-      //Unpack again the question, because in the answers, the question in the message also
-      //needs to be translated.
-      if (dnsmsg->rfc1035NameUnpack(buffer, len, &off, (char *)domainName, RFC1035_MAXHOSTNAMESZ))
+      w.u16(to);
+      w.bytes(in + r.fields + 2, 6);
+      if (to_ipv6)
       {
-        click_chatter("Failed domain Name unpacking... (6->4)");
-        output(0).push(p);        
-        return;
+        w.u16(16);
+        w.bytes(IP6Address(IPAddress(in + r.rdata)).data(), 16);
       }
       else
       {
-        memcpy(&qtype, buffer + off, sizeof(qtype));
-        off += sizeof(qtype);
-        qtype = ntohs(qtype);
-        memcpy(&qclass, buffer + off, sizeof(qclass));
-        off += sizeof(qclass);
-        qclass = ntohs(qclass);
-
-        //First, we update the question section        
-        if (qtype == RFC1035_TYPE_AAAA)
-        {
-          off2 += dnsmsg->rfc1035QuestionPack(newbuffer + off2, new_len - off2, domainName, RFC1035_TYPE_A, qclass);                      
-          new_len -= off2;
-        }
-        else if (qtype == RFC1035_TYPE_PTR)
-        {
-          char *ipv6_address = new char[RFC1035_MAXHOSTNAMESZ];
-          memset(ipv6_address,'\0',RFC1035_MAXHOSTNAMESZ);
-          if (get_query_ipv6_address(domainName, ipv6_address) == 0)
-          {
-            output(0).push(p);
-            return;
-          }
-          else
-            ipv6_internal_address = IP6Address(ipv6_address);
-          //Lookup its original IPv6 address in the Address Translator
-          if (_at->lookup(ipv6_internal_address,sport,ipv6_mapped_address,mport,ipv6_external_address,dport, 0))
-          {
-            char *new_ipv6_mapped_address = dnsmsg->my_strdup(ipv6_mapped_address.unparse().c_str());
-            char *new_ipv4_address = new char[RFC1035_MAXHOSTNAMESZ];
-            memset(new_ipv4_address, '\0', RFC1035_MAXHOSTNAMESZ);
-            if (extract_ipv4_address_from_ipv6_address(new_ipv6_mapped_address,new_ipv4_address) == 0)
-            {
-              click_chatter("There was a problem getting the IPv4 address from the IPv4-compatible IPv6 address returned by AddressTranslator!");
-              return;
-            }            
-            struct in_addr ipv4_addr;
-            IPAddress tempaddr = IPAddress(new_ipv4_address);
-            ipv4_addr = tempaddr.in_addr();
-            make_ipv4_ptr_domain(ipv4_addr, ipv4_ptr_domain);
-            delete (ipv6_address);
-            delete (new_ipv6_mapped_address);
-            delete (new_ipv4_address);
-          }
-          else
-          {
-            click_chatter("Lookup failed (6->4)");
-            return;
-          }
-          off2 += dnsmsg->rfc1035QuestionPack(newbuffer + off2, new_len - off2, ipv4_ptr_domain, RFC1035_TYPE_PTR, qclass);
-          new_len -= off2;
-        }
-
-        off_t offset_after_answers = 0;
-        rfc1035_rr *answers = NULL;
-        rfc1035_rr *authorities = NULL;
-        rfc1035_rr *additionals = NULL;        
-        n = dnsmsg->rfc1035AnswersUnpack(buffer,new_len,&answers, &authorities, &additionals, &rid,&offset_after_answers);
-        if (n == -2) //Server Failure: The name server was unable to process this query (didn't found an answer :-( ).
-          n = 0;        
-  	    if (n < 0)
-        {
-          click_chatter("Bad response from DNS server! (6->4)");
-          //It's a corrupt answer
-          return;
-  	    }
-        
-        for (i = 0; i < n; i++)
-        {
-	    	  if (answers[i].type == RFC1035_TYPE_AAAA)
-          {
-            //Then we translate the answer
-            click_in6_addr ipv6_addr;
-       	  	memcpy(&ipv6_addr, answers[i].rdata, answers[i].rdlength);
-            ipv6_internal_address = IP6Address(ipv6_addr);
-
-            //Lookup in the Address Translator the mapped IPv4 address for the IPv6 address of the response
-            if (_at->lookup(ipv6_internal_address,sport,ipv6_mapped_address,mport,ipv6_external_address,dport, 0))
-            {
-              char *new_ipv6_mapped_address = dnsmsg->my_strdup(ipv6_mapped_address.unparse().c_str());
-              char *new_ipv4_address = new char[RFC1035_MAXHOSTNAMESZ];
-              memset(new_ipv4_address, '\0', RFC1035_MAXHOSTNAMESZ);
-              if (extract_ipv4_address_from_ipv6_address(new_ipv6_mapped_address,new_ipv4_address) == 0)
-              {
-                click_chatter("There was a problem getting the IPv4 address from the IPv4-compatible IPv6 address returned by AddressTranslator!");
-                return;
-              }
-              IPAddress tempaddr = IPAddress(new_ipv4_address);
-              ipv4_addr_from_AAAA_answer = tempaddr.in_addr();
-              answers[i].type = RFC1035_TYPE_A;
-              delete(answers[i].rdata);              
-              answers[i].rdlength = sizeof(struct in_addr);
-              answers[i].rdata = new char[answers[i].rdlength];
-              memset(answers[i].rdata,'\0',answers[i].rdlength);
-              memcpy(answers[i].rdata,&ipv4_addr_from_AAAA_answer,answers[i].rdlength);
-              dnsmsg->rfc1035RRPack(&answers[i],&off2,newbuffer,new_len);
-              new_len -= off2;
-              delete (new_ipv6_mapped_address);
-              delete (new_ipv4_address);
-            }
-            else
-            {
-              click_chatter("LOOKUP FAILED! (6->4)");
-              return;
-            }
-          }
-          else if (answers[i].type == RFC1035_TYPE_PTR)
-          {
-            memset(answers[i].name,'\0',RFC1035_MAXHOSTNAMESZ);
-            memcpy(answers[i].name,ipv4_ptr_domain,strlen(ipv4_ptr_domain));
-            dnsmsg->rfc1035RRPack(&answers[i],&off2,newbuffer,new_len);
-            new_len -= off2;            
-          }
-
-        }
-
-       //Now we need to copy the Autorities and Aditionals sections                         
-        for (i = 0; i < hdr.nscount; i++)
-        {
-          if (qtype == RFC1035_TYPE_PTR)
-          {
-            memset(authorities[i].name,'\0',RFC1035_MAXHOSTNAMESZ);
-            memcpy(authorities[i].name,ipv4_dns_server_ptr_domain.c_str(),strlen(ipv4_dns_server_ptr_domain.c_str()));
-          }
-          authorities[i].rdlength = strlen(ipv6_dns_server_name.c_str()) + 2;
-          memset(authorities[i].rdata,'\0',RFC1035_MAXHOSTNAMESZ);
-          memcpy(authorities[i].rdata,ipv6_dns_server_name.c_str(),strlen(ipv6_dns_server_name.c_str()));          
-          dnsmsg->rfc1035RRPack(&authorities[i],&off2,newbuffer,new_len);
-          new_len -= off2;
-        }
-
-        for (i = 0; i < hdr.arcount; i++)
-        {
-          //In case that the query was PTR type and there is a AAAA RR in the additionas
-          //it has to be translated too.          
-          if (additionals[i].type == RFC1035_TYPE_AAAA)
-          {
-            if (_at->lookup(ipv6_internal_address,sport,ipv6_mapped_address,mport,ipv6_external_address,dport, 0))
-            {
-              char *new_ipv6_mapped_address = dnsmsg->my_strdup(ipv6_mapped_address.unparse().c_str());
-              char *new_ipv4_address = new char[RFC1035_MAXHOSTNAMESZ];
-              memset(new_ipv4_address, '\0', RFC1035_MAXHOSTNAMESZ);
-              if (extract_ipv4_address_from_ipv6_address(new_ipv6_mapped_address,new_ipv4_address) == 0)
-              {
-                click_chatter("There was a problem getting the IPv4 address from the IPv4-compatible IPv6 address returned by AddressTranslator!");
-                return;
-              }
-              IPAddress tempaddr = IPAddress(new_ipv4_address);
-              ipv4_addr_from_AAAA_answer = tempaddr.in_addr();
-              additionals[i].type = RFC1035_TYPE_A;
-              delete(additionals[i].rdata);
-              additionals[i].rdlength = sizeof(struct in_addr);
-              additionals[i].rdata = new char[additionals[i].rdlength];
-              memset(additionals[i].rdata,'\0',additionals[i].rdlength);
-              memcpy(additionals[i].rdata,&ipv4_addr_from_AAAA_answer,additionals[i].rdlength);
-            }
-            else
-            {
-              click_chatter("LOOKUP FAILED! (6->4)");
-              return;
-            }
-          }
-          dnsmsg->rfc1035RRPack(&additionals[i],&off2,newbuffer,new_len);          
-          new_len -= off2;
-        }
-      }      
-      newlen = off2;
-      delete (ipv4_ptr_domain);
-      delete (domainName);
-    }
-    WritablePacket *wp;
-    if (old_len < newlen){
-      wp = p->put(newlen - old_len);
+        if (!lookup_ipv4(in + r.rdata, external, addr4))
+          return DROP;
+        w.u16(4);
+        w.bytes(addr4, 4);
+      }
+      continue;
     }
-    else
+
+    //Everything else is copied, names in rdata keeping their compression
+    w.bytes(in + r.fields, 8);
+    unsigned rdlength_at = w.length();
+    w.u16(r.rdlength);
+    unsigned start = w.length();
+    if (r.type == RFC1035_TYPE_NS && r.section == DNSView::AUTHORITY && server.length())
+      w.text_name(server.data(), server.length());
+    else if (r.type == RFC1035_TYPE_NS || r.type == RFC1035_TYPE_CNAME
+             || r.type == RFC1035_TYPE_PTR)
+      w.name(_view, r.rdata);
+    else if (r.type == RFC1035_TYPE_MX)
     {
-      wp = p->uniqueify();
-      wp->take(old_len - newlen);
+      w.bytes(in + r.rdata, 2);
+      w.name(_view, r.rdata + 2);
     }
-    memcpy(wp->data() + data_offset,newbuffer,newlen);
-
-    //Delete the temporal newbuffer
-    delete(newbuffer);
-
-  // set IP length field, incrementally update IP checksum according to RFC1624
-    // new_sum = ~(~old_sum + ~old_halfword + new_halfword)
-    click_ip *wp_iph = wp->ip_header();
-    unsigned short old_ip_hw = ((unsigned short *)wp_iph)[1];
-    wp_iph->ip_len = htons(wp->length() - wp->ip_header_offset());
-    unsigned short new_ip_hw = ((unsigned short *)wp_iph)[1];
-    unsigned ip_sum =
-      (~wp_iph->ip_sum & 0xFFFF) + (~old_ip_hw & 0xFFFF) + new_ip_hw;
-    while (ip_sum >> 16)		// XXX necessary?
-      ip_sum = (ip_sum & 0xFFFF) + (ip_sum >> 16);
-    wp_iph->ip_sum = ~ip_sum;
-
-    // set UDP checksum
-    click_udp *wp_udph = (click_udp *)(wp_iph + 1);
-           
-    unsigned len2 = wp->length() - wp->transport_header_offset();
-    wp_udph->uh_ulen = 0;
-    wp_udph->uh_ulen = htons(len2);
-    
-    wp_udph->uh_sum = 0;
-    unsigned wp_tcp_len = wp->length() - wp->transport_header_offset();
-    unsigned csum = ~click_in_cksum((unsigned char *)wp_udph, wp_tcp_len) & 0xFFFF;
-    #ifdef CLICK_LINUXMODULE
-    csum = csum_tcpudp_magic(wp_iph->ip_src.s_addr, wp_iph->ip_dst.s_addr,
-		  	   wp_tcp_len, IP_PROTO_UDP, csum);
-    #else
+    else if (r.type == RFC1035_TYPE_SOA)
     {
-      unsigned short *words = (unsigned short *)&wp_iph->ip_src;
-      csum += words[0];
-      csum += words[1];
-      csum += words[2];
-      csum += words[3];
-      csum += htons(IP_PROTO_UDP);
-      csum += htons(wp_tcp_len);
-      while (csum >> 16)
-        csum = (csum & 0xFFFF) + (csum >> 16);
-      csum = ~csum & 0xFFFF;
+      w.name(_view, r.rdata);
+      w.name(_view, r.rdata + _view.name_length(r.rdata));
+      w.bytes(in + r.rdata + r.rdlength - 20, 20);
     }
-    #endif
-    wp_udph->uh_sum = csum;
-    
-     output(0).push(wp);
+    else
+      w.bytes(in + r.rdata, r.rdlength);
+    w.set_u16(rdlength_at, w.length() - start);
   }
 
+  return TRANSLATE;
 }
 
-/**
-* Auxiliary functions
-**/
-
 /*
-* get_query_ipv6_address(const char *ptr_domain, const char *normal_ipv6_address)
-*
-* Extract the IPv6 address contained in the PTR ip6.int domain
-* in ptr_domain and copy it in normal_ipv6_address. Returns the length of the
-* IPv6 address in case of success, 0 in failure.
-*/
-
-int
-DNSAlg::get_query_ipv6_address(const char *ptr_domain, char *normal_ipv6_address)
+ * servfail()
+ *
+ * Writes over w a Server Failure answer to the query in _view, repeating
+ * its question.
+ */
+void
+DNSAlg::servfail(DNSWriter &w, const DNSRecord &question)
 {
-	int i,j,n,cero_flag;
-  n = cero_flag = 0;
-  if (strstr(ptr_domain,".ip6.int") != NULL)
-  {
-  	int ipv6_address_length = strlen(ptr_domain) - 8;
-//	int ipv6_address_length = RFC1035_MAXHOSTNAMESZ;
-    for (i = ipv6_address_length - 1,j = 0; i >= 0; i--, j++)
-    {
-      if (ptr_domain[i] != '.')
-      {
-        normal_ipv6_address[j] = ptr_domain[i];
-        n++;
-      }
-      else
-        j--;
-
-      if (n == 4 && i > 0)
-      {
-        j++;
-        normal_ipv6_address[j] = ':';
-        n = 0;
-        cero_flag = 0;
-      }
-    }   
-    return strlen(normal_ipv6_address);
-  }
-  else
-    return 0;
+  w.clear();
+  w.bytes(_view.data(), 2);
+  w.u16(0x8182);		// QR, RD, RA, rcode 2
+  w.u16(1);
+  w.u16(0);
+  w.u16(0);
+  w.u16(0);
+  w.name(_view, question.name);
+  w.bytes(_view.data() + question.fields, 4);
 }
 
 /*
-* get_query_ipv4_address(const char *ptr_domain, const char *normal_ipv4_address)
-*
-* Extract the IPv4 address contained in the PTR in-addr.arpa domain
-* in ptr_domain and copy it in normal_ipv4_address. Returns the length of the
-* IPv4 address in case of success, 0 in failure.
-*/
-
-int
-DNSAlg::get_query_ipv4_address(const char *ptr_domain, char *normal_ipv4_address)
+ * lookup_ipv6()
+ *
+ * Finds the IPv6 address mapped to the IPv4 address addr4.
+ */
+bool
+DNSAlg::lookup_ipv6(const unsigned char *addr4, const IP6Address &external, unsigned char *addr6)
 {
-  int ptr_domain_length = strlen(ptr_domain) - 13;
-  //int ptr_domain_length = RFC1035_MAXHOSTNAMESZ;
-  //char *inverse_ipv4_address = new char[ptr_domain_length];
-  char *inverse_ipv4_address = new char[16];
-  int i,n;
-  int numbers[4];
-  n = 0;
-
-  if (strstr(ptr_domain,".in-addr.arpa") != NULL)
-  {
-    strncpy(inverse_ipv4_address, ptr_domain,ptr_domain_length);
-    char * number = strtok(inverse_ipv4_address,".");
-    i = 0;
-    while(number != NULL)
-    {
-      numbers[i] = my_atoi(number);
-      i++;
-      number = strtok(NULL,".");
-    }
-    //snprintf(normal_ipv4_address,18,"%d.%d.%d.%d",numbers[3],numbers[2],numbers[1],numbers[0]);
- int temp = sprintf(normal_ipv4_address,"%d.%d.%d.%d",numbers[3],numbers[2],numbers[1],numbers[0]); 
-delete (inverse_ipv4_address); 
-return  temp;
-    
-  }
-  else
-    return 0;
-
+  unsigned short sport = 0, mport = 0, dport = 0;
+  IP6Address ipv6_internal_address;
+  IP6Address ipv6_mapped_address = IP6Address(IPAddress(addr4));
+  IP6Address ipv6_external_address = external;
+  if (!_at->lookup(ipv6_internal_address, sport, ipv6_mapped_address, mport, ipv6_external_address, dport, 1))
+    return false;
+  memcpy(addr6, ipv6_internal_address.data(), 16);
+  return true;
 }
 
-int
-DNSAlg::extract_ipv4_address_from_ipv6_address(const char * new_ipv6_address, char *ipv4_address)
+/*
+ * lookup_ipv4()
+ *
+ * Finds the IPv4-compatible address mapped to the IPv6 address addr6 and
+ * returns its IPv4 part.
+ */
+bool
+DNSAlg::lookup_ipv4(const unsigned char *addr6, const IP6Address &external, unsigned char *addr4)
 {
-//	 char *ipv4_address = new char[strlen(new_ipv6_address) - 1];
-//   memset(ipv4_address, '\0', strlen(ipv4_address));
-   //Copy a IPv4-compatible IPv6 address like ::1.0.0.1 into 1.0.0.1
-   memcpy(ipv4_address,new_ipv6_address + 2,strlen(new_ipv6_address)-2);
-   return strlen(ipv4_address);
+  unsigned short sport = 0, mport = 0, dport = 0;
+  click_in6_addr a;
+  memcpy(&a, addr6, 16);
+  IP6Address ipv6_internal_address = IP6Address(a);
+  IP6Address ipv6_mapped_address;
+  IP6Address ipv6_external_address = external;
+  if (!_at->lookup(ipv6_internal_address, sport, ipv6_mapped_address, mport, ipv6_external_address, dport, 0))
+    return false;
+  memcpy(addr4, ipv6_mapped_address.data() + 12, 4);
+  return true;
 }
 
 void
-DNSAlg::make_ipv4_ptr_domain(struct in_addr addr, char * ptr_domain)
+DNSAlg::reset_stats()
 {
-  unsigned int i;
-  
-  i = (unsigned int) ntohl(addr.s_addr);
-  /*snprintf(ptr_domain, 32, "%u.%u.%u.%u.in-addr.arpa.",
-	        i & 255,
-        	(i >> 8) & 255,
-        	(i >> 16) & 255,
-        	(i >> 24) & 255);
-*/
-sprintf(ptr_domain, "%u.%u.%u.%u.in-addr.arpa.",
-                i & 255,
-                (i >> 8) & 255,
-                (i >> 16) & 255,
-                (i >> 24) & 255);
+  _packets = _translated = _passed = _failed = _dropped = _malformed = 0;
+  _cycles = _max_cycles = 0;
 }
-void
-DNSAlg::make_ipv4_ptr_domain(int *addr, char * ptr_domain)
+
+String
+DNSAlg::print_stats() const
 {
+  StringAccum sa;
+  sa << "packets " << _packets << "\n";
+  sa << "translated " << _translated << "\n";
+  sa << "passed " << _passed << "\n";
+  sa << "failed " << _failed << "\n";
+  sa << "dropped " << _dropped << "\n";
+  sa << "malformed " << _malformed << "\n";
+  sa << "cycles " << (_packets ? _cycles / _packets : 0) << "\n";
+  sa << "max_cycles " << _max_cycles << "\n";
+  return sa.take_string();
+}
+
+enum { H_STATS, H_RESET };
 
-  /*snprintf(ptr_domain, 32, "%u.%u.%u.%u.in-addr.arpa.",
-	        addr[0],
-        	addr[1],
-        	addr[2],
-        	addr[3]);
-*/
-sprintf(ptr_domain, "%u.%u.%u.%u.in-addr.arpa.",
-                addr[0],
-                addr[1],
-                addr[2],
-                addr[3]);
+static String
+dnsalg_read_handler(Element *e, void *thunk)
+{
+  DNSAlg *alg = (DNSAlg *)e;
+  switch ((intptr_t)thunk) {
+  case H_STATS:
+    return alg->print_stats();
+  default:
+    return String();
+  }
 }
-void
-DNSAlg::hex_ipv4_to_dec_ipv4(char *hex,int *dec)
+
+static int
+dnsalg_write_handler(const String &, Element *e, void *thunk, ErrorHandler *)
 {
-  int conth,contd;
-  int mult;
-  char *tmp = new char[10];
-
-  memcpy(tmp, hex + strlen(hex) - 10,10);
-  mult = 1;
-  contd = -1;
-  for (conth = 0; tmp[conth]; conth++)
-	{
-    if (tmp[conth]!= ':')    
-		{
-      if (mult == 16)
-			  mult = 1;
-      else
-			{
-        mult = 16;
-        contd++;
-        dec[contd] = 0;
-      }
-	    if (tmp[conth] > '9')
-        dec[contd] = dec[contd] + (int(tmp[conth]) - 87)*mult;        
-      else
-		    dec[contd] = dec[contd] + (int(tmp[conth]) - int('0'))*mult;        
-   }
- }
+  DNSAlg *alg = (DNSAlg *)e;
+  switch ((intptr_t)thunk) {
+  case H_RESET:
+    alg->reset_stats();
+    return 0;
+  default:
+    return -1;
+  }
 }
 
-int
-DNSAlg::my_atoi(const char *string)
+void
+DNSAlg::add_handlers()
 {
-    int val = 0;
-
-    for (;; string++) {
-	switch (*string) {
-	    case '0'...'9':
-		val = 10*val+(*string -'0');
-		break;
-	    default:
-		return val;
-	}
-    }
+  add_read_handler("stats", dnsalg_read_handler, (void *)H_STATS);
+  add_write_handler("reset", dnsalg_write_handler, (void *)H_RESET);
 }
 
 CLICK_ENDDECLS
@@ -24,6 +24,25 @@ CLICK_DECLS
  * DNS Application Level Gateway
  *
  * RFC 1035, DOMAIN NAMES - IMPLEMENTATION AND SPECIFICATION (DNS)|http://www.ietf.org/rfc/rfc1035.txt>
+ *
+ * DNSAlg(AddressTranslator, [IPv4 PTR zone, IPv4 DNS server name,
+ *        IPv6 PTR zone, IPv6 DNS server name])
+ *
+ * Input 0 takes IPv4 packets bound for the IPv4 network, input 1 IPv6
+ * packets bound for the IPv6 network; translated packets leave on the
+ * output with the same number.  A and AAAA questions and records, and
+ * in-addr.arpa and ip6.int PTR names, are translated; everything else in
+ * the message is copied.  With the zones and server names given, NS
+ * records in the authority section are rewritten to them.
+ *
+ * Messages are parsed in place with DNSView and rewritten with DNSWriter,
+ * keeping name compression, straight into the outgoing packet.  Only that
+ * packet is allocated; a message that outgrows the room first given to it
+ * is written again into a packet big enough for any UDP datagram.
+ *
+ * Handlers: stats (read): packets seen, translated, passed untouched,
+ * answered with SERVFAIL, dropped and malformed, and mean and largest CPU
+ * cycles per packet; reset (write): zeroes the stats.
  */
 
 class DNSAlg : public Element {
@@ -42,23 +61,41 @@ class DNSAlg : public Element {
 
   const char *class_name() const	{ return "DNSAlg"; }
   const char *port_count() const	{ return "2/2"; }
+  const char *processing() const	{ return PUSH; }
 
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void add_handlers();
   void push(int port, Packet *p);
-  void translate_ipv4_ipv6(Packet *p);
-  void translate_ipv6_ipv4(Packet *p);
+  Packet *translate_ipv4_ipv6(Packet *p);
+  Packet *translate_ipv6_ipv4(Packet *p);
+
+  String print_stats() const;
+  void reset_stats();
+
   private:
-  int get_query_ipv6_address(const char *ptr_domain, char *normal_ipv6_address);
-  int get_query_ipv4_address(const char *ptr_domain, char *normal_ipv4_address);
-  int extract_ipv4_address_from_ipv6_address(const char * new_ipv6_address, char *ipv4_address);
-  void hex_ipv4_to_dec_ipv4(char *hex,int *dec);
-  void make_ipv4_ptr_domain(struct in_addr addr, char * ptr_domain);
-  void make_ipv4_ptr_domain(int *addr, char * ptr_domain);
-  int my_atoi(const char *name);
-
-  bool failed_query;
+
+  enum { PASS, TRANSLATE, SERVFAIL, DROP };
+
+  int parse_payload(Packet *p, const click_udp *udph);
+  WritablePacket *rewrite_packet(Packet *p, unsigned data_offset, bool to_ipv6,
+                                 const IP6Address &external, int &what);
+  int rewrite(DNSWriter &w, bool to_ipv6, const IP6Address &external);
+  void servfail(DNSWriter &w, const DNSRecord &question);
+  bool lookup_ipv4(const unsigned char *addr6, const IP6Address &external, unsigned char *addr4);
+  bool lookup_ipv6(const unsigned char *addr4, const IP6Address &external, unsigned char *addr6);
+
+  DNSView _view;
+
+  uint32_t _packets;
+  uint32_t _translated;
+  uint32_t _passed;
+  uint32_t _failed;
+  uint32_t _dropped;
+  uint32_t _malformed;
+  uint64_t _cycles;
+  uint64_t _max_cycles;
 
 };
 CLICK_ENDDECLS
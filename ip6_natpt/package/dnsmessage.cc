@@ -96,14 +96,26 @@ off_t
 DNSMessage::rfc1035NamePack(char *buf, size_t sz, const char *name)
 {
     off_t off = 0;
-    char *copy = DNSMessage::my_strdup(name);
-    char *t;
+    char label[RFC1035_MAXLABELSZ + 1];
+    const char *t, *dot;
+    size_t len;
     /*
-     * NOTE: use of strtok here makes names like foo....com valid.
+     * Each label is copied out of 'name' in turn.  Empty labels are
+     * skipped, so names like foo....com are valid.
      */
-    for (t = strtok(copy, "."); t; t = strtok(NULL, "."))
-	off += rfc1035LabelPack(buf + off, sz - off, t);
-    delete(copy);
+    for (t = name; *t; t = (*dot ? dot + 1 : dot)) {
+	dot = strchr(t, '.');
+	if (!dot)
+	    dot = t + strlen(t);
+	len = dot - t;
+	if (len == 0)
+	    continue;
+	if (len > RFC1035_MAXLABELSZ)
+	    len = RFC1035_MAXLABELSZ;
+	memcpy(label, t, len);
+	label[len] = '\0';
+	off += rfc1035LabelPack(buf + off, sz - off, label);
+    }
     off += rfc1035LabelPack(buf + off, sz - off, NULL);
     assert((unsigned)off <= sz);
     return off;
@@ -993,6 +1005,402 @@ DNSMessage:: my_strdup(const char *str)
   #endif
 }
 
+/*
+ * DNSView::parse()
+ *
+ * Checks the header, then walks the question, answer, authority and
+ * additional sections in order, filling in one DNSRecord per entry.
+ * Octets after the last record are ignored.
+ *
+ * Returns 0 (success) or -1 (error)
+ */
+int
+DNSView::parse(const unsigned char *buf, unsigned len)
+{
+  _buf = buf;
+  _len = len;
+  _n = 0;
+  if (len < 12 || len > 0xFFFF)
+    return -1;
+
+  unsigned off = 12;
+  for (int s = QUESTION; s <= ADDITIONAL; s++)
+    for (int i = count(s); i > 0; i--) {
+      if (_n == DNSVIEW_MAX_RECORDS)
+        return -1;
+      DNSRecord &r = _rr[_n];
+      int l = name_length(off);
+      if (l < 0)
+        return -1;
+      r.name = off;
+      r.section = s;
+      off += l;
+      r.fields = off;
+      if (s == QUESTION)
+      {
+        if (off + 4 > len)
+          return -1;
+        r.type = u16(off);
+        r.rdata = r.rdlength = 0;
+        off += 4;
+        _n++;
+        continue;
+      }
+
+      if (off + 10 > len)
+        return -1;
+      r.type = u16(off);
+      r.rdlength = u16(off + 8);
+      off += 10;
+      r.rdata = off;
+      unsigned end = off + r.rdlength;
+      if (end > len)
+        return -1;
+      /* names in rdata must fill it exactly */
+      switch (r.type)
+      {
+        case RFC1035_TYPE_NS:
+        case RFC1035_TYPE_CNAME:
+        case RFC1035_TYPE_PTR:
+          if (check_name(off, end) != (int) r.rdlength)
+            return -1;
+          break;
+        case RFC1035_TYPE_MX:
+          if (r.rdlength < 2 || check_name(off + 2, end) != (int) r.rdlength - 2)
+            return -1;
+          break;
+        case RFC1035_TYPE_SOA: {
+          int l1 = check_name(off, end);
+          int l2 = (l1 < 0 ? -1 : check_name(off + l1, end));
+          if (l2 < 0 || l1 + l2 + 20 != (int) r.rdlength)
+            return -1;
+          break;
+        }
+        default:
+          break;
+      }
+      off = end;
+      _n++;
+    }
+  return 0;
+}
+
+int
+DNSView::name_length(unsigned off) const
+{
+  return check_name(off, _len);
+}
+
+/*
+ * check_name()
+ *
+ * Walks the name at 'off', whose stored octets must end by 'end'; the
+ * labels compression pointers lead to may be anywhere in the message.
+ * Returns the number of stored octets, or -1 if the name is not valid.
+ */
+int
+DNSView::check_name(unsigned off, unsigned end) const
+{
+  unsigned pos = off;
+  unsigned limit = end;
+  unsigned total = 0;
+  int stored = -1;
+  int hops = 0;
+  while (1)
+  {
+    if (pos >= limit)
+      return -1;
+    unsigned c = _buf[pos];
+    if ((c & 0xC0) == 0xC0)
+    {
+      if (pos + 2 > limit || ++hops > 127)
+        return -1;
+      if (stored < 0)
+      {
+        stored = pos + 2 - off;
+        limit = _len;
+      }
+      pos = ((c & 0x3F) << 8) | _buf[pos + 1];
+    }
+    else if (c > RFC1035_MAXLABELSZ)
+    {
+      /* "(The 10 and 01 combinations are reserved for future use.)" */
+      return -1;
+    }
+    else
+    {
+      total += c + 1;
+      if (total > DNSVIEW_MAX_NAME || pos + c + 1 > limit)
+        return -1;
+      if (c == 0)
+        return (stored < 0 ? (int) (pos + 1 - off) : stored);
+      pos += c + 1;
+    }
+  }
+}
+
+unsigned
+DNSView::label(unsigned off) const
+{
+  while ((_buf[off] & 0xC0) == 0xC0)
+    off = ((_buf[off] & 0x3F) << 8) | _buf[off + 1];
+  return off;
+}
+
+bool
+DNSView::label_is(unsigned off, const char *s) const
+{
+  unsigned n = _buf[off];
+  if (n != strlen(s))
+    return false;
+  for (unsigned i = 0; i < n; i++)
+  {
+    unsigned char c = _buf[off + 1 + i];
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    if (c != (unsigned char) s[i])
+      return false;
+  }
+  return true;
+}
+
+/*
+ * DNSView::ptr_ipv4()
+ *
+ * Reads d.c.b.a.in-addr.arpa at 'off' into addr[] = {a, b, c, d}.
+ */
+bool
+DNSView::ptr_ipv4(unsigned off, unsigned char *addr) const
+{
+  unsigned pos = off;
+  for (int i = 3; i >= 0; i--)
+  {
+    pos = label(pos);
+    unsigned n = _buf[pos];
+    unsigned v = 0;
+    if (n < 1 || n > 3)
+      return false;
+    for (unsigned j = 1; j <= n; j++)
+    {
+      unsigned char c = _buf[pos + j];
+      if (c < '0' || c > '9')
+        return false;
+      v = v * 10 + (c - '0');
+    }
+    if (v > 255)
+      return false;
+    addr[i] = v;
+    pos += n + 1;
+  }
+  pos = label(pos);
+  if (!label_is(pos, "in-addr"))
+    return false;
+  pos = label(pos + 8);
+  if (!label_is(pos, "arpa"))
+    return false;
+  pos = label(pos + 5);
+  return _buf[pos] == 0;
+}
+
+/*
+ * DNSView::ptr_ipv6()
+ *
+ * Reads the 32 nibble labels of an ip6.int (or ip6.arpa) name at 'off',
+ * lowest nibble first, into the 16 octets of addr[].
+ */
+bool
+DNSView::ptr_ipv6(unsigned off, unsigned char *addr) const
+{
+  unsigned pos = off;
+  for (int i = 0; i < 32; i++)
+  {
+    pos = label(pos);
+    if (_buf[pos] != 1)
+      return false;
+    unsigned char c = _buf[pos + 1];
+    int v;
+    if (c >= '0' && c <= '9')
+      v = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      v = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      v = c - 'A' + 10;
+    else
+      return false;
+    if (i & 1)
+      addr[15 - i / 2] |= v << 4;
+    else
+      addr[15 - i / 2] = v;
+    pos += 2;
+  }
+  pos = label(pos);
+  if (!label_is(pos, "ip6"))
+    return false;
+  pos = label(pos + 4);
+  if (!label_is(pos, "int") && !label_is(pos, "arpa"))
+    return false;
+  pos = label(pos + _buf[pos] + 1);
+  return _buf[pos] == 0;
+}
+
+void
+DNSWriter::bytes(const void *p, unsigned n)
+{
+  if (_len + n > _size)
+  {
+    _overflow = true;
+    return;
+  }
+  memcpy(_buf + _len, p, n);
+  _len += n;
+}
+
+void
+DNSWriter::u16(unsigned short v)
+{
+  unsigned char b[2];
+  b[0] = v >> 8;
+  b[1] = v;
+  bytes(b, 2);
+}
+
+void
+DNSWriter::set_u16(unsigned off, unsigned short v)
+{
+  if (off + 2 <= _len)
+  {
+    _buf[off] = v >> 8;
+    _buf[off + 1] = v;
+  }
+}
+
+int
+DNSWriter::find(unsigned in_off) const
+{
+  for (int i = _nmap - 1; i >= 0; i--)
+    if (_map_in[i] == in_off)
+      return _map_out[i];
+  return -1;
+}
+
+void
+DNSWriter::map(unsigned in_off, unsigned out_off)
+{
+  if (_nmap < DNSWRITER_MAX_LABELS && out_off < 0x4000 && find(in_off) < 0)
+  {
+    _map_in[_nmap] = in_off;
+    _map_out[_nmap] = out_off;
+    _nmap++;
+  }
+}
+
+void
+DNSWriter::pointer(unsigned out_off)
+{
+  u16(0xC000 | out_off);
+}
+
+/*
+ * DNSWriter::name()
+ *
+ * Copies the name at 'off' in the view, which parse() has checked.  As
+ * soon as the rest of the name was copied before, a pointer to it ends
+ * the name; a pointer whose target was not copied is followed and the
+ * labels there are written out.
+ */
+void
+DNSWriter::name(const DNSView &v, unsigned off)
+{
+  const unsigned char *b = v.data();
+  unsigned pos = off;
+  while (1)
+  {
+    unsigned c = b[pos];
+    if ((c & 0xC0) == 0xC0)
+    {
+      pos = ((c & 0x3F) << 8) | b[pos + 1];
+      continue;
+    }
+    if (c == 0)
+    {
+      bytes(b + pos, 1);
+      return;
+    }
+    int o = find(pos);
+    if (o >= 0)
+    {
+      pointer(o);
+      return;
+    }
+    map(pos, _len);
+    bytes(b + pos, c + 1);
+    pos += c + 1;
+  }
+}
+
+void
+DNSWriter::label(const char *s, unsigned n)
+{
+  unsigned char c;
+  if (n > RFC1035_MAXLABELSZ)
+    n = RFC1035_MAXLABELSZ;
+  c = n;
+  bytes(&c, 1);
+  bytes(s, n);
+}
+
+/*
+ * DNSWriter::text_name()
+ *
+ * Writes the dotted name in s[0..n-1]; empty labels are skipped.
+ */
+void
+DNSWriter::text_name(const char *s, unsigned n)
+{
+  unsigned start = 0;
+  for (unsigned i = 0; i <= n; i++)
+    if (i == n || s[i] == '.')
+    {
+      if (i > start)
+        label(s + start, i - start);
+      start = i + 1;
+    }
+  label(s, 0);
+}
+
+void
+DNSWriter::ptr_ipv4(const unsigned char *addr)
+{
+  char d[3];
+  for (int i = 3; i >= 0; i--)
+  {
+    unsigned v = addr[i], n = 0;
+    if (v >= 100)
+      d[n++] = '0' + v / 100;
+    if (v >= 10)
+      d[n++] = '0' + (v / 10) % 10;
+    d[n++] = '0' + v % 10;
+    label(d, n);
+  }
+  label("in-addr", 7);
+  label("arpa", 4);
+  label(d, 0);
+}
+
+void
+DNSWriter::ptr_ipv6(const unsigned char *addr)
+{
+  static const char hex[] = "0123456789abcdef";
+  for (int i = 15; i >= 0; i--)
+  {
+    label(&hex[addr[i] & 0x0F], 1);
+    label(&hex[addr[i] >> 4], 1);
+  }
+  label("ip6", 3);
+  label("int", 3);
+  label(hex, 0);
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(userlevel)
 ELEMENT_PROVIDES(DNSMessage)
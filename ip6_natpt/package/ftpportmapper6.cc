@@ -77,450 +77,457 @@ FTPPortMapper6::push(int port, Packet *p)
     translate_ipv4_ipv6(p);
 }
 
+/*
+ * Helpers for parsing FTP control lines and formatting their replacements.
+ * Replacements are built into a fixed buffer of FTPPORTMAPPER6_MAX_LINE
+ * octets, which the longest of them (an EPRT command) fits with room to spare.
+ */
+#define FTPPORTMAPPER6_MAX_LINE 80
+
+static inline unsigned char
+lower(unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+// True if the payload starts with word, ignoring case
+static bool
+starts_with(const unsigned char *data, unsigned len, const char *word)
+{
+  for (unsigned i = 0; word[i]; i++)
+    if (i >= len || lower(data[i]) != lower(word[i]))
+      return false;
+  return true;
+}
+
+// True if word appears in the first len octets, ignoring case
+static bool
+contains(const unsigned char *data, unsigned len, const char *word)
+{
+  for (unsigned i = 0; i < len; i++)
+    if (starts_with(data + i, len - i, word))
+      return true;
+  return false;
+}
+
+// Length of the first line of the payload, its CRLF included; the whole
+// payload if it has no line end
+static unsigned
+line_length(const unsigned char *data, unsigned len)
+{
+  const unsigned char *nl = (const unsigned char *)memchr(data, '\n', len);
+  return (nl ? nl - data + 1 : len);
+}
+
+static inline bool
+is_digit(unsigned char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// Parses n decimal numbers separated by sep from data[pos]; returns the
+// position after the last one, or 0 if they are not there
+static unsigned
+parse_numbers(const unsigned char *data, unsigned pos, unsigned len,
+	      unsigned char sep, unsigned *nums, int n)
+{
+  for (int i = 0; i < n; i++) {
+    if (i > 0) {
+      if (pos >= len || data[pos] != sep)
+	return 0;
+      pos++;
+    }
+    if (pos >= len || !is_digit(data[pos]))
+      return 0;
+    unsigned v = 0;
+    while (pos < len && is_digit(data[pos]) && v < 100000)
+      v = v * 10 + data[pos++] - '0';
+    nums[i] = v;
+  }
+  return pos;
+}
+
+static inline bool
+at_line_end(const unsigned char *data, unsigned pos, unsigned len)
+{
+  return pos < len && (data[pos] == '\r' || data[pos] == '\n');
+}
+
+static char *
+append(char *s, const char *str)
+{
+  while (*str)
+    *s++ = *str++;
+  return s;
+}
+
+static char *
+append_decimal(char *s, unsigned v)
+{
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v);
+  while (n)
+    *s++ = digits[--n];
+  return s;
+}
+
+static char *
+append_hex(char *s, unsigned v)
+{
+  static const char hex[] = "0123456789abcdef";
+  int shift = 12;
+  while (shift > 0 && !(v >> shift))
+    shift -= 4;
+  for (; shift >= 0; shift -= 4)
+    *s++ = hex[(v >> shift) & 0xF];
+  return s;
+}
+
+// Appends "h1,h2,h3,h4,p1,p2", the host-port argument of PORT and of the
+// 227 reply, for addr (network order) and port (host order)
+static char *
+append_host_port(char *s, struct in_addr addr, unsigned port)
+{
+  const unsigned char *a = (const unsigned char *)&addr;
+  for (int i = 0; i < 4; i++) {
+    s = append_decimal(s, a[i]);
+    *s++ = ',';
+  }
+  s = append_decimal(s, (port >> 8) & 255);
+  *s++ = ',';
+  return append_decimal(s, port & 255);
+}
+
+// Appends the RFC 2373 text form of an IPv6 address, the longest run of
+// two or more zero groups written as "::"
+static char *
+append_ip6(char *s, const unsigned char *a)
+{
+  unsigned g[8];
+  for (int i = 0; i < 8; i++)
+    g[i] = (a[2*i] << 8) | a[2*i + 1];
+
+  int zstart = -1, zlen = 1;
+  for (int i = 0; i < 8; ) {
+    int j = i;
+    while (j < 8 && g[j] == 0)
+      j++;
+    if (j - i > zlen) {
+      zstart = i;
+      zlen = j - i;
+    }
+    i = (j > i ? j : i + 1);
+  }
+
+  for (int i = 0; i < 8; i++) {
+    if (i == zstart) {
+      s = append(s, "::");
+      i += zlen - 1;
+      continue;
+    }
+    if (i > 0 && i != zstart + zlen)
+      *s++ = ':';
+    s = append_hex(s, g[i]);
+  }
+  return s;
+}
+
+static inline uint32_t
+fold(uint32_t sum)
+{
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return (sum & 0xFFFF) + (sum >> 16);
+}
+
+static inline uint32_t
+swap_bytes(uint32_t sum)
+{
+  return ((sum & 0xFF) << 8) | ((sum >> 8) & 0xFF);
+}
+
+/*
+ * replace_line: replaces the first line_len octets of the len octet TCP
+ * payload at data_offset with the buflen octets at buf, keeping whatever
+ * follows them, and trims anything past the payload.  The TCP checksum is
+ * updated incrementally (RFC 1624) from the sums of the old and new lines
+ * and of the TCP length in the pseudo-header; the rest of the payload is
+ * only summed when the length changes by an odd number of octets, since it
+ * then moves to the other byte lane.  Returns the rewritten packet, or 0 if
+ * it could not be made, in which case p is gone.
+ */
+static WritablePacket *
+replace_line(Packet *p, unsigned tcp_offset, unsigned data_offset, unsigned len,
+	     unsigned line_len, const char *buf, unsigned buflen)
+{
+  const unsigned char *data = p->data() + data_offset;
+  unsigned rest = len - line_len;
+  unsigned tcp_len = data_offset - tcp_offset + len;
+  unsigned new_tcp_len = tcp_len - line_len + buflen;
+
+  uint32_t old_sum = (~click_in_cksum(data, line_len) & 0xFFFF) + htons(tcp_len);
+  uint32_t new_sum = (~click_in_cksum((const unsigned char *)buf, buflen) & 0xFFFF)
+    + htons(new_tcp_len);
+  if (((line_len ^ buflen) & 1) && rest) {
+    uint32_t r = ~click_in_cksum(data + line_len, rest) & 0xFFFF;
+    if (line_len & 1)
+      r = swap_bytes(r);
+    old_sum += r;
+    new_sum += swap_bytes(r);
+  }
+
+  unsigned new_length = data_offset + buflen + rest;
+  WritablePacket *wp;
+  if (new_length > p->length())
+    wp = p->put(new_length - p->length());
+  else
+    wp = p->uniqueify();
+  if (!wp)
+    return 0;
+
+  unsigned char *wdata = wp->data() + data_offset;
+  memmove(wdata + buflen, wdata + line_len, rest);
+  memcpy(wdata, buf, buflen);
+  if (wp->length() > new_length)
+    wp->take(wp->length() - new_length);
+
+  click_tcp *tcph = (click_tcp *)(wp->data() + tcp_offset);
+  uint32_t sum = (~tcph->th_sum & 0xFFFF) + (~fold(old_sum) & 0xFFFF) + fold(new_sum);
+  tcph->th_sum = ~fold(sum) & 0xFFFF;
+  return wp;
+}
+
+/*
+ * translate_ipv6_ipv4: IPv4 packets, from IPv6 hosts to IPv4 ones.
+ * EPRT becomes PORT, EPSV becomes PASV, and the replies to the PASV and
+ * PORT commands made by translate_ipv4_ipv6 are turned back into 227 and
+ * 200 PORT replies.
+ */
 void
 FTPPortMapper6::translate_ipv6_ipv4(Packet *p)
 {
-  //Get pointers to IPv4 header, TCP header and data, offsets and lengths
   const click_ip *iph = p->ip_header();
-  const click_tcp *tcph = (click_tcp *)(iph + 1);
-  const unsigned char *data = (unsigned char *)tcph + (tcph->th_off<<2);
-  unsigned data_offset = (data - p->data());
-  unsigned len = (p->data() + p->length()) - data;
-
-  char buf[50];
-  unsigned buflen=0;
-  int af_number = 0;
-  unsigned new_sport = 0;
-  int pipe_count = 0;
-  int i=0;
-  bool command_found = false;
-
-  //Verify that the packet has the right contents
-  if (len < 4
-      || (data[0] != 'E' && data[0] != 'e')
-      || (data[1] != 'P' && data[1] != 'p')
-      || (data[2] != 'R' && data[2] != 'r')
-      || (data[3] != 'T' && data[3] != 't')
-      || data[4] != ' ')
+  if (iph->ip_p != IP_PROTO_TCP)
   {
-    if (len < 4
-      || (data[0] != 'E' && data[0] != 'e')
-      || (data[1] != 'P' && data[1] != 'p')
-      || (data[2] != 'S' && data[2] != 's')
-      || (data[3] != 'V' && data[3] != 'v'))
-    {
-		  if (len < 3
-        || data[0] != '2'
-  		  || data[1] != '2'
-        || data[2] != '9'
-        || data[3] != ' '
-        || epsv_found == true)
-      {
-  		  if (len < 3
-          || data[0] != '2'
-  	  	  || data[1] != '0'
-          || data[2] != '0'
-          || data[3] != ' ')
-        {
-          output(0).push(p);
-          return;
-        }
-        else
-        {
-          command_found = true;
-        }
-        
-      }
-      else
-      {
-        command_found = true;
-      }
-    }
-    else
-    {
-      command_found = true;
-    }
+    output(0).push(p);
+    return;
   }
-  else
+  const click_tcp *tcph = p->tcp_header();
+  const unsigned char *data = (const unsigned char *)tcph + (tcph->th_off << 2);
+  unsigned tcp_offset = p->transport_header_offset();
+  unsigned data_offset = data - p->data();
+  unsigned end = p->ip_header_offset() + ntohs(iph->ip_len);
+  if (end > p->length())
+    end = p->length();
+  if (data_offset >= end)
   {
-    command_found = true;
+    output(0).push(p);
+    return;
   }
-  if (command_found == true)
+  unsigned len = end - data_offset;
+  unsigned line_len = line_length(data, len);
+
+  char buf[FTPPORTMAPPER6_MAX_LINE];
+  char *s = buf;
+  unsigned nums[2];
+  unsigned pos;
+
+  if (starts_with(data, len, "EPRT "))
   {
-     // parse the EPRT/EPSV commands
-    //unsigned pos = 5;
-    unsigned pos = 4;
-    while (pos < len && data[pos] == ' ')
+    // EPRT <d>2<d><IPv6 address><d><port><d>: the address in the command
+    // doesn't matter, the one we need is the packet's source address
+    pos = 5;
+    while (pos < line_len && data[pos] == ' ')
       pos++;
-    unsigned port_arg_offset = pos;
-
-    if ((data[0] == 'E' || data[0] == 'e')
-      && (data[1] == 'P' || data[1] == 'p')
-      && (data[2] == 'S' || data[2] == 's')
-      && (data[3] == 'V' || data[3] == 'v'))
+    unsigned char d = (pos < line_len ? data[pos] : 0);
+    pos = parse_numbers(data, pos + 1, line_len, d, nums, 1);
+    if (pos && pos < line_len && data[pos] == d)
     {
-      buflen = sprintf(buf, "PASV\r\n");
-
+      pos++;
+      while (pos < line_len && data[pos] != d)
+	pos++;
+      pos = parse_numbers(data, pos + 1, line_len, d, nums + 1, 1);
     }
-    else if ((data[0] == 'E' || data[0] == 'e')
-      && (data[1] == 'P' || data[1] == 'p')
-      && (data[2] == 'R' || data[2] == 'r')
-      && (data[3] == 'T' || data[3] == 't')
-      && data[4] == ' ')
+    else
+      pos = 0;
+    if (!pos || nums[0] != 2 || nums[1] < 1024 || nums[1] > 65535
+	|| pos >= line_len || data[pos] != d || !at_line_end(data, pos + 1, line_len))
     {
-      //Parse the EPRT command, get AF number and port, the IPv6 address in the command doesn't matter,
-      //the one we need is the packet's source address.
-      while (pos < len && pipe_count < 4)
-      {
-        if (i == 1)
-          af_number = data[pos] - '0';
-        else if (pipe_count == 3 && data[pos] != '|')
-          new_sport = (new_sport * 10) + data[pos] - '0';
-        else if (data[pos] == '|')
-            pipe_count++;
-        pos++;
-        i++;
-      }
-
-        //Verify port and AF number are OK
-      if ((af_number != 2) || (new_sport < 1024 || new_sport > 65536)
-        || pos >= len || (data[pos] != '\r' && data[pos] != '\n')){
-          click_chatter("Invalid packet!')");
-          output(0).push(p);  
-        }
-       else
-       {
-          //get IPv4 source address from header and build new PORT command
-          unsigned new_saddr = ntohl(iph->ip_src.s_addr);
-          buflen = sprintf(buf, "PORT %d,%d,%d,%d,%d,%d\r\n",(new_saddr>>24)&255, (new_saddr>>16)&255,
-	            (new_saddr>>8)&255, new_saddr&255, (new_sport>>8)&255, new_sport&255);
-        }
+      click_chatter("FTPPortMapper6: invalid EPRT command");
+      output(0).push(p);
+      return;
     }
-    //Translate EPSV response into a valid PASV one:
-    else if((data[0] == '2'
-      && data[1] == '2'
-      && data[2] == '9'
-      && data[3] == ' ') && epsv_found == false)
+    s = append(s, "PORT ");
+    s = append_host_port(s, iph->ip_src, nums[1]);
+    s = append(s, "\r\n");
+  }
+  else if (starts_with(data, len, "EPSV"))
+    s = append(s, "PASV\r\n");
+  //Translate EPSV response into a valid PASV one:
+  else if (starts_with(data, len, "229 ") && !epsv_found)
+  {
+    // 229 Entering Extended Passive Mode (<d><d><d><port><d>)
+    const unsigned char *paren = (const unsigned char *)memchr(data, '(', line_len);
+    pos = (paren ? paren - data + 1 : line_len);
+    if (pos + 3 < line_len && data[pos + 1] == data[pos] && data[pos + 2] == data[pos]
+	&& parse_numbers(data, pos + 3, line_len, 0, nums, 1)
+	&& nums[0] > 0 && nums[0] <= 65535)
     {
-      while (pos < len && data[pos] != '(')
-        pos++;
-      port_arg_offset = pos;
-      while (pos < len && pipe_count < 4)
-      {
-        if (pipe_count == 3 && data[pos] != '|')
-          new_sport = (new_sport * 10) + data[pos] - '0';
-        else if (data[pos] == '|')
-          pipe_count++;
-        pos++;
-      }
-      unsigned new_saddr = ntohl(iph->ip_src.s_addr);
-
-      buflen = sprintf(buf, "227 Entering Passive Mode. %d,%d,%d,%d,%d,%d\r\n", (new_saddr>>24)&255,
-            (new_saddr>>16)&255,(new_saddr>>8)&255, new_saddr&255, (new_sport>>8)&255, new_sport&255);
+      s = append(s, "227 Entering Passive Mode (");
+      s = append_host_port(s, iph->ip_src, nums[0]);
+      s = append(s, ").\r\n");
     }
-    //Translate EPRT response into a valid PORT one:
-    else if(data[0] == '2'
-      && data[1] == '0'
-      && data[2] == '0')
+    else
     {
-
-      buflen = sprintf(buf, "200 PORT command successful.\r\n");
+      click_chatter("FTPPortMapper6: invalid 229 reply");
+      output(0).push(p);
+      return;
     }
+  }
+  //Translate EPRT response into a valid PORT one:
+  else if (starts_with(data, len, "200 ") && contains(data, line_len, "EPRT"))
+    s = append(s, "200 PORT command successful.\r\n");
+  else
+  {
+    output(0).push(p);
+    return;
+  }
 
-    WritablePacket *wp = NULL;
-    unsigned newlen = strlen(buf);
-
-    if (len <= newlen)
-      wp = p->put(newlen - len);
-    else
-    {
-      wp = p->uniqueify();
-      wp->take(len - newlen);
-   }
+  // One lookup finds or makes the session's mapping, before p changes
+  IPAddress ip_src(iph->ip_src);
+  IPAddress ip_dst(iph->ip_dst);
+  unsigned short sport = tcph->th_sport;
+  unsigned short dport = tcph->th_dport;
+  tcp_seq_t trigger = ntohl(tcph->th_seq) + len;
+  TCPAddressTranslator::Mapping6 *m = _tcp_a->apply_create(ip_src, sport, ip_dst, dport);
 
-   memmove(wp->data() + data_offset + newlen,
-            wp->data() + data_offset + len,
-            len - pos);
-   memcpy(wp->data() + data_offset,
-	         buf,
-           newlen);
+  WritablePacket *wp = replace_line(p, tcp_offset, data_offset, len, line_len, buf, s - buf);
+  if (!wp)
+    return;
 
   // set IP length field, incrementally update IP checksum according to RFC1624
-    // new_sum = ~(~old_sum + ~old_halfword + new_halfword)
+  // new_sum = ~(~old_sum + ~old_halfword + new_halfword)
   click_ip *wp_iph = wp->ip_header();
   unsigned short old_ip_hw = ((unsigned short *)wp_iph)[1];
   wp_iph->ip_len = htons(wp->length() - wp->ip_header_offset());
-   unsigned short new_ip_hw = ((unsigned short *)wp_iph)[1];
-   unsigned ip_sum =
-      (~wp_iph->ip_sum & 0xFFFF) + (~old_ip_hw & 0xFFFF) + new_ip_hw;
-  while (ip_sum >> 16)		// XXX necessary?
-    ip_sum = (ip_sum & 0xFFFF) + (ip_sum >> 16);
-  wp_iph->ip_sum = ~ip_sum;
-
-    // set TCP checksum
-    // XXX should check old TCP checksum first!!!
-    click_tcp *wp_tcph = wp->tcp_header();
-
-    IPAddress ip_src = IPAddress(wp_iph->ip_src);
-    IPAddress ip_dst = IPAddress(wp_iph->ip_dst);
-
-    unsigned  short ssport = tcph->th_sport;
-    unsigned  short ddport = tcph->th_dport;
-
-    //IP6FlowID p_flow(p);
-    if (TCPAddressTranslator::Mapping6 *p_mapping = _tcp_a->get_mapping6(IP_PROTO_TCP, ip_src, ssport, ip_dst, ddport)) {
-      tcp_seq_t interesting_seqno = ntohl(wp_tcph->th_seq) + +len;
-      p_mapping->update_seqno_delta(interesting_seqno, newlen - len);
-    }
-    else
-    {
-			if (TCPAddressTranslator::Mapping6 *p_mapping = _tcp_a->apply_create(ip_src, ssport, ip_dst, ddport))
-			{
-				tcp_seq_t interesting_seqno = ntohl(wp_tcph->th_seq) + +len;
-				p_mapping->update_seqno_delta(interesting_seqno, newlen - len);
-			}    	
-  	}
-    // always update sequence number in this packet so TCPAddressTranslator will fix it
-    // (works even with retransmits)
-    wp_tcph->th_sum = 0;
-    unsigned wp_tcp_len = wp->length() - wp->transport_header_offset();
-    unsigned csum = ~click_in_cksum((unsigned char *)wp_tcph, wp_tcp_len) & 0xFFFF;
-    #ifdef CLICK_LINUXMODULE
-    csum = csum_tcpudp_magic(wp_iph->ip_src.s_addr, wp_iph->ip_dst.s_addr,
-		  	   wp_tcp_len, IP_PROTO_TCP, csum);
-    #else
-    {
-      unsigned short *words = (unsigned short *)&wp_iph->ip_src;
-      csum += words[0];
-      csum += words[1];
-      csum += words[2];
-      csum += words[3];
-      csum += htons(IP_PROTO_TCP);
-      csum += htons(wp_tcp_len);
-      while (csum >> 16)
-        csum = (csum & 0xFFFF) + (csum >> 16);
-      csum = ~csum & 0xFFFF;
-    }
-    #endif
-    wp_tcph->th_sum = csum;
-    output(0).push(wp);
-  }
+  unsigned short new_ip_hw = ((unsigned short *)wp_iph)[1];
+  unsigned ip_sum =
+    (~wp_iph->ip_sum & 0xFFFF) + (~old_ip_hw & 0xFFFF) + new_ip_hw;
+  wp_iph->ip_sum = ~fold(ip_sum);
+
+  // TCPAddressTranslator shifts the sequence numbers after this segment; a
+  // retransmission ends at the same trigger and leaves the delta alone
+  if (m)
+    m->update_seqno_delta(trigger, (int)(s - buf) - (int)line_len);
+  output(0).push(wp);
 }
 
+/*
+ * translate_ipv4_ipv6: IPv6 packets, from IPv4 hosts to IPv6 ones.
+ * PORT becomes EPRT, PASV becomes EPSV, and 227 and 200 PORT replies
+ * become 229 and 200 EPRT replies.
+ */
 void
 FTPPortMapper6::translate_ipv4_ipv6(Packet *p)
 {
+  const click_ip6 *ip6 = (const click_ip6 *)p->data();
+  if (ip6->ip6_nxt != IP_PROTO_TCP)
+  {
+    output(1).push(p);
+    return;
+  }
+  const click_tcp *tcph = (const click_tcp *)(ip6 + 1);
+  const unsigned char *data = (const unsigned char *)tcph + (tcph->th_off << 2);
+  unsigned tcp_offset = sizeof(click_ip6);
+  unsigned data_offset = data - p->data();
+  unsigned end = sizeof(click_ip6) + ntohs(ip6->ip6_plen);
+  if (end > p->length())
+    end = p->length();
+  if (data_offset >= end)
+  {
+    output(1).push(p);
+    return;
+  }
+  unsigned len = end - data_offset;
+  unsigned line_len = line_length(data, len);
+
+  char buf[FTPPORTMAPPER6_MAX_LINE];
+  char *s = buf;
+  unsigned nums[6];
+  unsigned pos;
 
-  click_ip6 *ip6 = (click_ip6 *)p->data();
-  IP6Address ip6_src = IP6Address(ip6->ip6_src);
-  const click_tcp *tcph = (click_tcp *)(ip6 + 1);
-  const unsigned char *data = (unsigned char *)tcph + (tcph->th_off<<2);
-  unsigned len = (p->data() + p->length()) - data;
-  unsigned data_offset = (data - p->data());
-
-
-  char buf[100];
-  unsigned buflen=0;
-  int comma_count = 0;
-  int new_sport = 0;
-  int i = 0;
-  bool command_found = false;
-
-  if (len < 4
-    || (data[0] != 'P' && data[0] != 'p')
-    || (data[1] != 'O' && data[1] != 'o')
-    || (data[2] != 'R' && data[2] != 'r')
-    || (data[3] != 'T' && data[3] != 't')
-    || data[4] != ' ')
+  if (starts_with(data, len, "PASV"))
+  {
+    s = append(s, "EPSV\r\n");
+    epsv_found = false;
+  }
+  else if (starts_with(data, len, "PORT "))
   {
-    if (len < 4
-      || (data[0] != 'P' && data[0] != 'p')
-      || (data[1] != 'A' && data[1] != 'a')
-      || (data[2] != 'S' && data[2] != 's')
-      || (data[3] != 'V' && data[3] != 'v'))
+    // followed by 6 decimal numbers separated by commas
+    pos = 5;
+    while (pos < line_len && data[pos] == ' ')
+      pos++;
+    pos = parse_numbers(data, pos, line_len, ',', nums, 6);
+    bool ok = pos && at_line_end(data, pos, line_len);
+    for (int i = 0; ok && i < 6; i++)
+      ok = (nums[i] < 256);
+    if (!ok)
     {
-  		if (len < 3
-        || data[0] != '2'
-		    || data[1] != '2'
-        || data[2] != '7'
-        || data[3] != ' ')
-      {
-    		if (len < 3
-            || data[0] != '2'
-		        || data[1] != '0'
-            || data[2] != '0'
-            || data[3] != ' ')
-        {
-          output(1).push(p);
-        }
-        else
-        {
-          command_found = true;
-        }        
-      }
-      else
-      {
-        command_found = true;
-      }
+      click_chatter("FTPPortMapper6: invalid PORT command");
+      output(1).push(p);
+      return;
     }
-    else
+    s = append(s, "EPRT |2|");
+    s = append_ip6(s, (const unsigned char *)&ip6->ip6_src);
+    *s++ = '|';
+    s = append_decimal(s, (nums[4] << 8) | nums[5]);
+    s = append(s, "|\r\n");
+  }
+  else if (starts_with(data, len, "227 "))
+  {
+    // the six numbers come after the text, which varies between servers
+    pos = 4;
+    while (pos < line_len && !(is_digit(data[pos]) && parse_numbers(data, pos, line_len, ',', nums, 6)))
+      pos++;
+    if (pos >= line_len || nums[4] > 255 || nums[5] > 255)
     {
-      command_found = true;
+      click_chatter("FTPPortMapper6: invalid 227 reply");
+      output(1).push(p);
+      return;
     }
+    s = append(s, "229 Entering Extended Passive Mode (|||");
+    s = append_decimal(s, (nums[4] << 8) | nums[5]);
+    s = append(s, "|)\r\n");
   }
+  //Translate PORT response into a valid EPRT one:
+  else if (starts_with(data, len, "200 ") && contains(data, line_len, "PORT"))
+    s = append(s, "200 EPRT command successful.\r\n");
   else
   {
-    command_found = true;
+    output(1).push(p);
+    return;
   }
 
-  if (command_found == true)
-  {
-
-     // parse the PORT/PASV commands
-    //unsigned pos = 5;
-    unsigned pos = 4;
-    while (pos < len && data[pos] == ' ')
-      pos++;
-    unsigned port_arg_offset = pos;
+  // One lookup finds or makes the session's mapping, before p changes
+  IP6FlowID flow(IP6Address(ip6->ip6_src), tcph->th_sport,
+		 IP6Address(ip6->ip6_dst), tcph->th_dport);
+  tcp_seq_t trigger = ntohl(tcph->th_seq) + len;
+  TCPAddressTranslator::Mapping6 *m = _tcp_a->apply_create(IP_PROTO_TCP, flow);
 
-    if ((data[0] == 'P' || data[0] == 'p')
-      && (data[1] == 'A' || data[1] == 'a')
-      && (data[2] == 'S' || data[2] == 's')
-      && (data[3] == 'V' || data[3] == 'v'))
-    {
-      buflen = sprintf(buf, "EPSV\r\n");
-      epsv_found = false;
+  WritablePacket *wp = replace_line(p, tcp_offset, data_offset, len, line_len, buf, s - buf);
+  if (!wp)
+    return;
 
-    }
+  //update payload length of IPv6 header
+  click_ip6 *wp_ip6h = (click_ip6 *)wp->data();
+  wp_ip6h->ip6_plen = htons(wp->length() - sizeof(click_ip6));
 
-    else if ((data[0] == 'P' || data[0] == 'p')
-      && (data[1] == 'O' || data[1] == 'o')
-      && (data[2] == 'R' || data[2] == 'r')
-      && (data[3] == 'T' || data[3] == 't')
-      && data[4] == ' ')
-    {
-      // followed by 6 decimal numbers separated by commas
-      unsigned nums[6];
-      nums[0] = nums[1] = nums[2] = nums[3] = nums[4] = nums[5] = 0;
-      int which_num = 0;
-
-      while (pos < len && which_num < 6)
-      {
-          if (data[pos] >= '0' && data[pos] <= '9')
-              nums[which_num] = (nums[which_num] * 10) + data[pos] - '0';
-          else if (data[pos] == ',')
-              which_num++;
-          else
-              break;
-              pos++;
-      }
-
-      // check that the command was complete and the numbers are ok
-      if (which_num != 5 || pos >= len || (data[pos] != '\r' && data[pos] != '\n')){
-          click_chatter("invalid packet!");
-          output(1).push(p);
-          }
-      for (i = 0; i < 6; i++)
-          if (nums[i] >= 256)
-              output(1).push(p);
-
-     //Get the string representation of the IPv6 address
-      String new_saddr=ip6_src.unparse().c_str();
-      char *s= buf;
-
-     //Build the ERPT command
-      buflen= sprintf(s,"EPRT |2|");
-      s +=buflen;
-
-      buflen = sprintf (s,"%s|",new_saddr.c_str());
-      s += buflen;
-      new_sport= (nums[4]<<8)|nums[5];
-
-      buflen = sprintf (s,"%d|\n",new_sport);
-    }
-    else if(data[0] == '2'
-	  	&& data[1] == '2'
-      && data[2] == '7'
-      && data[3] == ' ')
-    {
-      unsigned p1 = 0;
-      unsigned p2 = 0;
-      while (pos < len && data[pos] == ' ')
-        pos++;
-      port_arg_offset = pos;
-      while (pos < len && comma_count <= 5)
-      {
-        if (comma_count == 4 && data[pos] != ',')
-          p1 = (p1 * 10) + data[pos] - '0';
-        else if (comma_count == 5 && data[pos] != ')' && data[pos] != '\r' && data[pos] != '\n'){
-          p2 = (p2 * 10) + data[pos] - '0';
-        }
-        else if (data[pos] == ',')
-          comma_count++;
-        else if (data[pos] == ')')
-          break;
-        pos++;
-      }
-      new_sport = (p1<<8)|p2;
-
-      buflen = sprintf(buf, "229 Entering Extended Passive mode (|||%d|)\r\n",new_sport);
-
-    }
-    //Translate EPRT response into a valid PORT one:
-    else if(data[0] == '2'
-      && data[1] == '0'
-      && data[2] == '0'
-      && data[3] == ' ')
-    {
-      buflen = sprintf(buf, "200 EPRT command successful.\r\n");
-    }
-
-      WritablePacket *wp;
-      unsigned newlen = strlen(buf);
-
-      if (len <= newlen){
-        wp = p->put(newlen - len);
-        }
-      else
-      {
-        wp = p->uniqueify();
-        wp->take(len - newlen);
-      }
-      memmove(wp->data() + data_offset + newlen,
-              wp->data() + data_offset + len,
-	            len - pos);
-      memcpy(wp->data() + data_offset,
-	           buf,
-             newlen);
-      click_ip6 *wp_ip6h = (click_ip6 *)wp->data();
-      //update payload length of IPv6 header
-      wp_ip6h->ip6_plen = htons(wp->length() - wp->ip6_header_length());
-    // set TCP checksum
-      click_tcp *wp_tcph = (click_tcp *)(wp_ip6h + 1);
-	  //but first update deltas for seq and ack numbers so TCPAddressTranslator can update the seq and ack numbers.
-      IP6FlowID p_flow(p);
-
-      if (TCPAddressTranslator::Mapping6 *p_mapping = _tcp_a->get_mapping6(IP_PROTO_TCP, p_flow)) {
-        tcp_seq_t interesting_seqno = ntohl(wp_tcph->th_seq) + +len;
-        p_mapping->update_seqno_delta(interesting_seqno, newlen -len);
-      }
-      else if (TCPAddressTranslator::Mapping6 *p_mapping = _tcp_a->apply_create(0,p_flow))
-			{
-        tcp_seq_t interesting_seqno = ntohl(wp_tcph->th_seq) + +len;
-	  		p_mapping->update_seqno_delta(interesting_seqno, newlen - len);				
-		  }
-    	
-      unsigned char *start_of_p = (unsigned char *)(wp_ip6h+1);
-      wp_tcph->th_sum = htons(in6_fast_cksum(&wp_ip6h->ip6_src,
-                                            &wp_ip6h->ip6_dst,
-                                            wp_ip6h->ip6_plen,
-                                            wp_ip6h->ip6_nxt,
-                                            wp_tcph->th_sum,
-                                            start_of_p,
-                                            wp_ip6h->ip6_plen));
-
-      output(1).push(wp);
-    }
+  if (m)
+    m->update_seqno_delta(trigger, (int)(s - buf) - (int)line_len);
+  output(1).push(wp);
 }
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(TCPAddressTranslator)
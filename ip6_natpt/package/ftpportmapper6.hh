@@ -36,6 +36,14 @@ CLICK_DECLS
  *
  * This makes FTP possible through a NAT-PT setup.
  *
+ * Only the first line of the segment is rewritten, in place; anything after it
+ * is kept. The TCP checksum is updated incrementally from the old and new
+ * lines, and the session's mapping in the TCPAddressTranslator is looked up
+ * once per rewritten segment and told the length change, so it can shift the
+ * sequence numbers that follow. A retransmitted command is rewritten the same
+ * way without changing the shift again. 200 replies are only rewritten when
+ * they name the command.
+ *
  * L<RFC 959, File Transfer Protocol (FTP)|http://www.ietf.org/rfc/rfc0959.txt>
  * L<RFC 2428, FTP extensions for IPv6|http://www.ietf.org/rfc/rfc2428.txt>
  * L<RFC 2765, Stateless IP/ICMP Translation Algorithim (SIIT)|http://www.ietf.org/rfc/rfc2765.txt>
@@ -34,9 +34,12 @@ extern "C" {
 
 TCPAddressTranslator::Mapping6::Mapping6()
   :  _trigger(0), _delta(0), _old_delta(0),
-    _prev(0), _next(0), _free_next(0), _is_reverse(false),
+    _ip_csum_delta(0), _udp_csum_delta(0),
+    _delta_csum(0), _old_delta_csum(0), _neg_delta_csum(0), _neg_old_delta_csum(0),
+    _prev(0), _next(0), _reverse(0), _is_reverse(false),
 _marked(false),
-    _flow_over(false), _free_tracked(false),_ip_p(0)
+    _flow_over(false), _free_tracked(false), _dst_anno(false), _output(0), _ip_p(0),
+    _used(0), _last_used(0)
 {
 }
 
@@ -52,10 +55,42 @@ int32_t d)
     _trigger = trigger;
     _delta += d;
     _used = 0;
+    _old_delta_csum = _delta_csum;
+    _neg_old_delta_csum = _neg_delta_csum;
+    _delta_csum = seqno_csum_delta(_delta);
+    _neg_delta_csum = seqno_csum_delta(-_delta);
     return 0;
   }
 }
 
+// Ones' complement checksum change for adding delta to a 32-bit field,
+// ignoring the carry out of the field (see shift_seqno), in the byte order
+// the checksum is stored in
+uint16_t
+TCPAddressTranslator::Mapping6::seqno_csum_delta(int32_t delta)
+{
+  uint32_t u = delta;
+  uint32_t sum = (u >> 16) + (u & 0xFFFF);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return htons(sum);
+}
+
+// Adds delta to the sequence number 'field' and csum, its precomputed
+// checksum change, to csum_delta.  2^32 is 1 modulo 0xFFFF, so a carry out
+// of the field takes 1 off the sum.
+static inline void
+shift_seqno(uint32_t &field, int32_t delta, uint16_t csum, uint32_t &csum_delta)
+{
+  if (!delta)
+    return;
+  uint32_t oldval = ntohl(field);
+  uint32_t newval = oldval + delta;
+  csum_delta += csum;
+  if (newval < oldval)
+    csum_delta += htons(0xFFFE);
+  field = htonl(newval);
+}
+
 
 void
 TCPAddressTranslator::Mapping6::change_udp_csum_delta(unsigned
@@ -82,7 +117,8 @@ old_word, unsigned new_word)
 void
 TCPAddressTranslator::uninitialize()
 {
-    
+  _tcp_gc_timer.unschedule();
+  _tcp_done_gc_timer.unschedule();
 }
 
 int
@@ -97,9 +133,11 @@ TCPAddressTranslator::initialize(ErrorHandler *)
 }
 
 TCPAddressTranslator::TCPAddressTranslator()
-  : _tcp_map(0), _tcp_done(0),
-_tcp_done_tail(0),_tcp_gc_timer(tcp_gc_hook, this),
-    _tcp_done_gc_timer(tcp_done_gc_hook, this)
+  : _tcp_map(0), _tcp_live(0), _tcp_live_tail(0), _tcp_done(0),
+_tcp_done_tail(0), _nlive(0), _ndone(0), _free_pairs(0),
+    _tcp_gc_timer(tcp_gc_hook, this),
+    _tcp_done_gc_timer(tcp_done_gc_hook, this),
+    _gc_runs(0), _gc_freed(0)
 {
     /* in 0: IPv4 arriving packets */
     /* in 1: IPv6 arriving packets */
@@ -117,20 +155,8 @@ int
 TCPAddressTranslator::configure(Vector<String> &conf,
 ErrorHandler *errh)
 {
-  if (conf.size() != 1)
-    return errh->error("wrong number of arguments; expected `TCPAddressTranslator(AddressTranslator element)'");
-
   int before = errh->nerrors();
 
-  // get AddressTranslator
-  Element *e = cp_element(conf[0], this, errh);
-  if (!e)
-    return -1;
-  _at = (AddressTranslator *)e->cast("AddressTranslator");
-  if (! _at)
-    return errh->error("second argument must be an AddressTranslator element");
-
-  
   // numbers in seconds
   _tcp_timeout_jiffies = 86400;		// 24 hours
   _tcp_done_timeout_jiffies = 240;	// 4 minutes
@@ -138,16 +164,21 @@ ErrorHandler *errh)
   _tcp_done_gc_interval = 10;		// 10 seconds
   _dst_anno = true;
 
-/*  if (cp_va_parse_remove_keywords
-      (conf, 0, this, errh,
-       "REAP_TCP", cpSeconds, "reap interval for active TCP connections", &_tcp_gc_interval,
-       "REAP_TCP_DONE", cpSeconds, "reap interval for completed TCP connections", &_tcp_done_gc_interval,
-       "TCP_TIMEOUT", cpSeconds, "TCP timeout interval", &_tcp_timeout_jiffies,
-       "TCP_DONE_TIMEOUT", cpSeconds, "completed TCP timeout interval", &_tcp_done_timeout_jiffies,
-       "DST_ANNO", cpBool, "set destination IP addr annotation?", &_dst_anno,
-       cpEnd) < 0)
+  Element *e;
+  if (cp_va_kparse(conf, this, errh,
+		   "ADDRESS_TRANSLATOR", cpkP+cpkM, cpElement, &e,
+		   "REAP_TCP", 0, cpSeconds, &_tcp_gc_interval,
+		   "REAP_TCP_DONE", 0, cpSeconds, &_tcp_done_gc_interval,
+		   "TCP_TIMEOUT", 0, cpSeconds, &_tcp_timeout_jiffies,
+		   "TCP_DONE_TIMEOUT", 0, cpSeconds, &_tcp_done_timeout_jiffies,
+		   "DST_ANNO", 0, cpBool, &_dst_anno,
+		   cpEnd) < 0)
     return -1;
-  */
+
+  // get AddressTranslator
+  _at = (AddressTranslator *)e->cast("AddressTranslator");
+  if (! _at)
+    return errh->error("first argument must be an AddressTranslator element");
 
   // change timeouts into jiffies
   _tcp_timeout_jiffies *= CLICK_HZ;
@@ -204,19 +235,15 @@ TCPAddressTranslator::translate_ipv6to4(Packet *p)
   {			// create new mapping
     m = TCPAddressTranslator::apply_create(0, flow6);
   }
-
-  else if(!m)
+  if(!m)
     {
       p->kill();
       return;
     }
   m->apply(0,p);
+  // move to the tail of the live or, once the session is over, done list
+  touch(m);
   output(0).push(p);
-
-  // add to list for dropping TCP connections faster
-  if (!m->free_tracked() && (tcph->th_flags & (TH_FIN | TH_RST))
-      && m->session_over())
-    m->add_to_free_tracked_tail(_tcp_done, _tcp_done_tail);
 }
 
 
@@ -243,12 +270,8 @@ TCPAddressTranslator::translate_ipv4to6(Packet *p)
     return;
   }
   m->apply(1,p);
+  touch(m);
   output(1).push(p);
-
-  // add to list for dropping TCP connections faster
-  if (!m->free_tracked() && (tcph->th_flags & (TH_FIN | TH_RST))
-      && m->session_over())
-    m->add_to_free_tracked_tail(_tcp_done, _tcp_done_tail);
 }
 
 
@@ -258,89 +281,43 @@ TCPAddressTranslator::Mapping6::apply(int protocol,Packet *p_in)
 {
   WritablePacket *p = p_in->uniqueify();
   // TCP header
-
+  click_tcp *tcph;
   if(protocol==0) //Handling of IPv4 packets
-  {
-    click_ip *iph = (click_ip *)p->data();
-    click_tcp *tcph = (click_tcp *)(iph + 1);
-    uint32_t csum_delta = _udp_csum_delta;
-    uint32_t oldval = ntohl(tcph->th_seq);
-    uint32_t newval = htonl(oldval + delta_for(oldval));
-
-    if (tcph->th_seq != newval)
-    {
-      csum_delta += (~tcph->th_seq >> 16) + (~tcph->th_seq & 0xFFFF)
-        + (newval >> 16) + (newval & 0xFFFF);
-      tcph->th_seq = newval;
-    }
-
-    oldval = ntohl(tcph->th_ack);
-    newval = htonl(oldval - reverse()->delta_for(oldval));
-    if (tcph->th_ack != newval)
-    {
-      csum_delta += (~tcph->th_ack >> 16) + (~tcph->th_ack & 0xFFFF)
-        + (newval >> 16) + (newval & 0xFFFF);
-      tcph->th_ack = newval;
-    }
+    tcph = (click_tcp *)((click_ip *)p->data() + 1);
+  else     //Handling of IPv6 packets
+    tcph = (click_tcp *)((click_ip6 *)p->data() + 1);
+
+  // the checksum changes for the deltas were computed when they were set
+  uint32_t csum_delta = _udp_csum_delta;
+  tcp_seq_t seqno = ntohl(tcph->th_seq);
+  if (SEQ_GEQ(seqno, _trigger))
+    shift_seqno(tcph->th_seq, _delta, _delta_csum, csum_delta);
+  else
+    shift_seqno(tcph->th_seq, _old_delta, _old_delta_csum, csum_delta);
 
-    // update checksum
-    uint32_t sum2 = (~tcph->th_sum & 0xFFFF) + csum_delta;
-    sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-    tcph->th_sum = ~(sum2 + (sum2 >> 16));
-
-    // check for session ending flags
-    if (tcph->th_flags & TH_RST)
-      set_session_over();
-    else if (tcph->th_flags & TH_FIN)
-      set_session_flow_over();
-    else if (tcph->th_flags & TH_SYN)
-      clear_session_flow_over();
-  }
-  else     //Handling of IPv4 packets
+  tcp_seq_t ackno = ntohl(tcph->th_ack);
+  if (protocol==1 && _reverse->_used == 0)
   {
-    click_ip6 *iph = (click_ip6 *)p->data();
-    click_tcp *tcph = (click_tcp *)(iph + 1);
-    uint32_t csum_delta = _udp_csum_delta;
-    uint32_t oldval = ntohl(tcph->th_seq);
-    uint32_t newval = htonl(oldval + delta_for(oldval));
-
-    if (tcph->th_seq != newval)
-    {
-      csum_delta += (~tcph->th_seq >> 16) + (~tcph->th_seq & 0xFFFF)
-        + (newval >> 16) + (newval & 0xFFFF);
-      tcph->th_seq = newval;
-    }
-
-    oldval = ntohl(tcph->th_ack);
-    if (_reverse->_used == 0)
-    {
-			newval = htonl(oldval - reverse()->delta_for2(oldval));
-			_used++;		
-		}
-		else
-		{
-			newval = htonl(oldval - reverse()->delta_for(oldval));
-		}
-    if (tcph->th_ack != newval)
-    {
-      csum_delta += (~tcph->th_ack >> 16) + (~tcph->th_ack & 0xFFFF)
-        + (newval >> 16) + (newval & 0xFFFF);
-      tcph->th_ack = newval;
-    }
-    // update checksum
-    uint32_t sum2 = (~tcph->th_sum & 0xFFFF) + csum_delta;
-    sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
-    tcph->th_sum = ~(sum2 + (sum2 >> 16));
-
-    // check for session ending flags
-    if (tcph->th_flags & TH_RST)
-      set_session_over();
-    else if (tcph->th_flags & TH_FIN)
-      set_session_flow_over();
-    else if (tcph->th_flags & TH_SYN)
-      clear_session_flow_over();
-    
+    shift_seqno(tcph->th_ack, -_reverse->_delta, _reverse->_neg_delta_csum, csum_delta);
+    _used++;
   }
+  else if (SEQ_GEQ(ackno, _reverse->_trigger))
+    shift_seqno(tcph->th_ack, -_reverse->_delta, _reverse->_neg_delta_csum, csum_delta);
+  else
+    shift_seqno(tcph->th_ack, -_reverse->_old_delta, _reverse->_neg_old_delta_csum, csum_delta);
+
+  // update checksum
+  uint32_t sum2 = (~tcph->th_sum & 0xFFFF) + csum_delta;
+  sum2 = (sum2 & 0xFFFF) + (sum2 >> 16);
+  tcph->th_sum = ~(sum2 + (sum2 >> 16));
+
+  // check for session ending flags
+  if (tcph->th_flags & TH_RST)
+    set_session_over();
+  else if (tcph->th_flags & TH_FIN)
+    set_session_flow_over();
+  else if (tcph->th_flags & TH_SYN)
+    clear_session_flow_over();
 }
 
 
@@ -409,202 +386,237 @@ TCPAddressTranslator::apply_create(IPAddress &ip_src, unsigned short
     click_chatter("LOOKUP FAILED: Cannot update seq. numbers!");
   }
 
+  return apply_create(IP_PROTO_TCP, flow);
+}
 
-    Mapping6 *forward = new TCPAddressTranslator::Mapping6();
-    Mapping6 *reverse = new TCPAddressTranslator::Mapping6();
 
-    if (forward && reverse) {
-      Mapping6::make_pair(0,flow, flow,forward, reverse);
+TCPAddressTranslator::Mapping6 *
+TCPAddressTranslator::apply_create(int ip_p, const IP6FlowID &flow)
+{
+    if (Mapping6 *m = _tcp_map.get(flow))
+      return m;
 
-      IP6FlowID reverse_flow = forward->flow_id().reverse();
-      _tcp_map.set(flow, forward);
-      _tcp_map.set(reverse_flow, reverse);
-     return forward;
-    }
-    else
-    {
+    Mapping6 *forward = alloc_pair();
+    if (!forward) {
       _nmapping_failures++;
-      delete forward;
-      delete reverse;
       return 0;
-
     }
+    Mapping6 *reverse = forward->reverse();
+    Mapping6::make_pair(0,flow, flow,forward, reverse);
 
-}
+    IP6FlowID reverse_flow = forward->flow_id().reverse();
+    _tcp_map.set(flow, forward);
+    _tcp_map.set(reverse_flow, reverse);
 
+    forward->_last_used = click_jiffies();
+    list_append(forward, _tcp_live, _tcp_live_tail);
+    _nlive++;
+    return forward;
+}
 
+/*
+ * Mapping pairs come from slabs of PAIRS_PER_SLAB, kept until cleanup;
+ * freed pairs go on _free_pairs and are reset when handed out again.
+ */
 TCPAddressTranslator::Mapping6 *
-TCPAddressTranslator::apply_create(int ip_p, const IP6FlowID &flow)
+TCPAddressTranslator::alloc_pair()
 {
-    Mapping6 *forward = new TCPAddressTranslator::Mapping6();
-    Mapping6 *reverse = new TCPAddressTranslator::Mapping6();
-
-    if (forward && reverse) {
-      Mapping6::make_pair(0,flow, flow,forward, reverse);
-
-      IP6FlowID reverse_flow = forward->flow_id().reverse();
-      _tcp_map.set(flow, forward);
-      _tcp_map.set(reverse_flow, reverse);
-     return forward;
-    }
-    else
-    {
-      _nmapping_failures++;
-      delete forward;
-      delete reverse;
+  if (!_free_pairs) {
+    MappingPair *slab = new MappingPair[PAIRS_PER_SLAB];
+    if (!slab)
       return 0;
-
+    _slabs.push_back(slab);
+    for (int i = PAIRS_PER_SLAB - 1; i >= 0; i--) {
+      slab[i].next_free = _free_pairs;
+      _free_pairs = &slab[i];
     }
-
+  }
+  MappingPair *pair = _free_pairs;
+  _free_pairs = pair->next_free;
+  pair->forward = Mapping6();
+  pair->reverse = Mapping6();
+  pair->forward._reverse = &pair->reverse;
+  pair->reverse._reverse = &pair->forward;
+  return &pair->forward;
 }
 
+// Removes the pair of primary mapping m from the map and releases it;
+// m must be off the live and done lists
 void
-TCPAddressTranslator::tcp_gc_hook(Timer *timer, void *thunk)
+TCPAddressTranslator::free_pair(Mapping6 *m)
 {
-  TCPAddressTranslator *rw = (TCPAddressTranslator *)thunk;
-  rw->clean_map6(rw->_tcp_map, click_jiffies() -
-rw->_tcp_timeout_jiffies);
-  timer->reschedule_after_sec(rw->_tcp_gc_interval);
+  _tcp_map.erase(m->flow_id());
+  _tcp_map.erase(m->reverse()->flow_id());
+  MappingPair *pair = reinterpret_cast<MappingPair *>(m);
+  pair->next_free = _free_pairs;
+  _free_pairs = pair;
 }
 
 void
-TCPAddressTranslator::tcp_done_gc_hook(Timer *timer, void *thunk)
+TCPAddressTranslator::list_remove(Mapping6 *m, Mapping6 *&head, Mapping6 *&tail)
 {
-  TCPAddressTranslator *rw = (TCPAddressTranslator *)thunk;
-  rw->clean_map6_free_tracked(rw->_tcp_map, rw->_tcp_done,
-rw->_tcp_done_tail,click_jiffies() -
-rw->_tcp_done_timeout_jiffies);
-  timer->reschedule_after_sec(rw->_tcp_done_gc_interval);
+  if (m->_prev)
+    m->_prev->_next = m->_next;
+  else
+    head = m->_next;
+  if (m->_next)
+    m->_next->_prev = m->_prev;
+  else
+    tail = m->_prev;
+  m->_prev = m->_next = 0;
 }
 
 void
-TCPAddressTranslator::clean_map6(Map6 &table, uint32_t last_jif)
+TCPAddressTranslator::list_append(Mapping6 *m, Mapping6 *&head, Mapping6 *&tail)
 {
-    Mapping6 *to_free = 0;
+  m->_prev = tail;
+  m->_next = 0;
+  if (tail)
+    tail->_next = m;
+  else
+    head = m;
+  tail = m;
+}
 
-    for (Map6::iterator iter = table.begin(); iter.live(); iter++)
-	if (Mapping6 *m = iter.value()) {
-	    if (m->is_primary() && !m->used_since(last_jif) &&
-!m->free_tracked()) {
-		m->set_free_next(to_free);
-		to_free = m;
-	    }
-	}
+// Marks m's session used now: it goes to the tail of the done list if the
+// session is over and of the live list otherwise, so both lists stay
+// ordered by last use
+void
+TCPAddressTranslator::touch(Mapping6 *m)
+{
+  m = m->primary();
+  m->_last_used = click_jiffies();
+  bool over = m->session_over();
+  if (over != m->free_tracked()) {
+    if (over) {
+      list_remove(m, _tcp_live, _tcp_live_tail);
+      _nlive--;
+      list_append(m, _tcp_done, _tcp_done_tail);
+      _ndone++;
+    } else {
+      // reuse of a port; back to the live list
+      list_remove(m, _tcp_done, _tcp_done_tail);
+      _ndone--;
+      list_append(m, _tcp_live, _tcp_live_tail);
+      _nlive++;
+    }
+    m->_free_tracked = m->_reverse->_free_tracked = over;
+  } else if (over && m != _tcp_done_tail) {
+    list_remove(m, _tcp_done, _tcp_done_tail);
+    list_append(m, _tcp_done, _tcp_done_tail);
+  } else if (!over && m != _tcp_live_tail) {
+    list_remove(m, _tcp_live, _tcp_live_tail);
+    list_append(m, _tcp_live, _tcp_live_tail);
+  }
+}
 
-    while (to_free)
-	to_free = to_free->free_from_list(table, true);
+// Frees the mappings at the head of a list that were not used since
+// last_jif, at most GC_BATCH; returns how many were freed
+int
+TCPAddressTranslator::expire(Mapping6 *&head, Mapping6 *&tail, int &count, uint32_t last_jif)
+{
+  Timestamp start = Timestamp::now();
+  int n = 0;
+  while (head && n < GC_BATCH && !head->used_since(last_jif)) {
+    Mapping6 *m = head;
+    list_remove(m, head, tail);
+    count--;
+    free_pair(m);
+    n++;
+  }
+  _gc_last = Timestamp::now() - start;
+  if (_gc_last > _gc_max)
+    _gc_max = _gc_last;
+  _gc_runs++;
+  _gc_freed += n;
+  return n;
 }
 
-inline TCPAddressTranslator::Mapping6 *
-TCPAddressTranslator::Mapping6::free_from_list(Map6 &map, bool notify)
+void
+TCPAddressTranslator::tcp_gc_hook(Timer *timer, void *thunk)
 {
-    // see also clear_map below
-    Mapping6 *next = _free_next;
-    //map.remove(reverse()->flow_id().reverse());
-    //map.remove(flow_id().reverse());
-    delete reverse();
-    delete this;
-    return next;
-} 
+  TCPAddressTranslator *rw = (TCPAddressTranslator *)thunk;
+  // a full batch means more may be due; come back soon
+  if (rw->expire(rw->_tcp_live, rw->_tcp_live_tail, rw->_nlive,
+		 click_jiffies() - rw->_tcp_timeout_jiffies) == GC_BATCH)
+    timer->reschedule_after_msec(1);
+  else
+    timer->reschedule_after_sec(rw->_tcp_gc_interval);
+}
 
 void
-TCPAddressTranslator::incr_clean_map6_free_tracked(Map6
-&table,Mapping6 *&free_head, Mapping6 *&free_tail,uint32_t last_jif)
-{
-    Mapping6 *m = free_head;
-    if (!m->session_over()) {
-	// has been recycled; remove from free-tracked list
-	free_head = m->free_next();
-	if (!free_head)
-	    free_tail = 0;
-	m->clear_free_tracked();
-    } else if (m->used_since(last_jif)) {
-	// recently used; cycle to end of list
-	if (m->free_next()) {
-	    free_head = m->free_next();
-	    m->set_free_next(0);
-	    m->append_to_free(free_head, free_tail);
-	}
-    } else {
-	// actually free; delete it
-	free_head = m->free_from_list(table, true);
-	if (!free_head)
-	    free_tail = 0;
-    }
-}  
+TCPAddressTranslator::tcp_done_gc_hook(Timer *timer, void *thunk)
+{
+  TCPAddressTranslator *rw = (TCPAddressTranslator *)thunk;
+  if (rw->expire(rw->_tcp_done, rw->_tcp_done_tail, rw->_ndone,
+		 click_jiffies() - rw->_tcp_done_timeout_jiffies) == GC_BATCH)
+    timer->reschedule_after_msec(1);
+  else
+    timer->reschedule_after_sec(rw->_tcp_done_gc_interval);
+}
 
 void
 TCPAddressTranslator::clear_map6(Map6 &table)
 {
-    Mapping6 *to_free = 0;
-
-    for (Map6::iterator iter = table.begin(); iter.live(); iter++) {
-	Mapping6 *m = iter.value();
-	if (m->is_primary()) {
-	    m->set_free_next(to_free);
-	    to_free = m;
-	}
-    }
-
-    while (to_free) {
-	// don't call free_from_list, because there is no need to update
-	// 'table' incrementally
-	Mapping6 *next = to_free->free_next();
-	delete to_free->reverse();
-	delete to_free;
-	to_free = next;
-    }
-
+    // every mapping lives in a slab
+    for (int i = 0; i < _slabs.size(); i++)
+      delete[] _slabs[i];
+    _slabs.clear();
+    _free_pairs = 0;
+    _tcp_live = _tcp_live_tail = _tcp_done = _tcp_done_tail = 0;
+    _nlive = _ndone = 0;
     table.clear();
 } 
 
 void
-TCPAddressTranslator::clean_map6_free_tracked(Map6 &table, Mapping6
-*&free_head, Mapping6 *&free_tail,uint32_t last_jif)
+TCPAddressTranslator::cleanup(CleanupStage)
 {
-  Mapping6 *free_list = free_head;
-  Mapping6 **prev_ptr = &free_list;
+  clear_map6(_tcp_map);
+}
 
-  Mapping6 *m = free_list;
-  while (m)
-  {
-	  Mapping6 *next = m->free_next();
-  	if (!m->session_over())
-    {
-	    // reuse of a port; take it off the free-tracked list
-	    *prev_ptr = next;
-	    m->clear_free_tracked();
-	  }
-    else if (m->used_since(last_jif))
-	    break;
-	  else
-	    prev_ptr = &m->_free_next;
-  	m = next;
-  }
+String
+TCPAddressTranslator::print_mappings() const
+{
+  StringAccum sa;
+  sa << "live " << _nlive << "\n";
+  sa << "done " << _ndone << "\n";
+  sa << "allocated " << (_slabs.size() * PAIRS_PER_SLAB) << "\n";
+  sa << "failures " << _nmapping_failures << "\n";
+  return sa.take_string();
+}
+
+String
+TCPAddressTranslator::print_gc_stats() const
+{
+  StringAccum sa;
+  sa << "runs " << _gc_runs << "\n";
+  sa << "freed " << _gc_freed << "\n";
+  sa << "last_pause " << _gc_last.usecval() << "\n";
+  sa << "max_pause " << _gc_max.usecval() << "\n";
+  return sa.take_string();
+}
 
-  // cut off free_list before 'm'
-  *prev_ptr = 0;
+enum { H_MAPPINGS, H_GC_STATS };
 
-  // move free_head forward, to 'm' or beyond
-  if (m && m->free_next())
-  {
-	  // if 'm' exists, then shift it to the end of the list
-  	free_head = m->free_next();
-	  m->set_free_next(0);
-  	m->append_to_free(free_head, free_tail);
+static String
+tcpaddresstranslator_read_handler(Element *e, void *thunk)
+{
+  TCPAddressTranslator *tat = (TCPAddressTranslator *)e;
+  switch ((intptr_t)thunk) {
+  case H_MAPPINGS:
+    return tat->print_mappings();
+  case H_GC_STATS:
+    return tat->print_gc_stats();
+  default:
+    return String();
   }
-  else
-	  free_head = free_tail = m;
-
-  // free contents of free_list
-  while (free_list)
-  	free_list = free_list->free_from_list(table, true);
 }
 
 void
-TCPAddressTranslator::cleanup(CleanupStage)
+TCPAddressTranslator::add_handlers()
 {
-  clear_map6(_tcp_map);
+  add_read_handler("mappings", tcpaddresstranslator_read_handler, (void *)H_MAPPINGS);
+  add_read_handler("gc_stats", tcpaddresstranslator_read_handler, (void *)H_GC_STATS);
 }
 
 String
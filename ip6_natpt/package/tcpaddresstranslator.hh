@@ -10,12 +10,27 @@
 #include <click/ip6address.hh>
 #include <click/ipaddress.hh>
 #include <click/vector.hh>
+#include <click/timestamp.hh>
 #include <clicknet/tcp.h>
 /*
-* TCPAddressTranslator (AddressTranslator)
+* TCPAddressTranslator (AddressTranslator, [KEYWORDS])
 *
 * Updates seq and ack numbers in TCP header when the size
 * of a packet have changed.
+*
+* Mappings are kept on two lists ordered by last use: one for open
+* sessions, expired after TCP_TIMEOUT, and one for sessions that saw a
+* FIN or RST, expired after TCP_DONE_TIMEOUT.  A packet moves its mapping
+* to the tail of its list, so the gc timers only look at the mappings that
+* are due, at most GC_BATCH per run.  Mapping pairs come from slabs of
+* PAIRS_PER_SLAB.
+*
+* Keywords: REAP_TCP, REAP_TCP_DONE (gc intervals), TCP_TIMEOUT,
+* TCP_DONE_TIMEOUT (seconds), DST_ANNO (bool).
+*
+* Handlers: mappings (read): live, done and allocated mapping pairs;
+* gc_stats (read): gc runs, pairs freed, last and longest gc pause in
+* microseconds.
 */
 CLICK_DECLS
 
@@ -49,13 +64,27 @@ IPAddress &, unsigned short &) const;
   Mapping6 *apply_create(IPAddress &, unsigned short &, IPAddress &,
 unsigned short &);
   void cleanup(CleanupStage);
+  void add_handlers();
+
+  String print_mappings() const;
+  String print_gc_stats() const;
 
  
  private:
 
+  struct MappingPair;
+  enum { PAIRS_PER_SLAB = 256, GC_BATCH = 1024 };
+
   Map6 _tcp_map;    //IPv6 to IPv4
-  Mapping6 *_tcp_done;
+  Mapping6 *_tcp_live;	// open sessions, least recently used first
+  Mapping6 *_tcp_live_tail;
+  Mapping6 *_tcp_done;	// sessions over, least recently used first
   Mapping6 *_tcp_done_tail;
+  int _nlive;
+  int _ndone;
+
+  Vector<MappingPair *> _slabs;
+  MappingPair *_free_pairs;
          
   bool _dst_anno;
   
@@ -67,16 +96,24 @@ unsigned short &);
   int _tcp_done_timeout_jiffies;
 
   int _nmapping_failures;
+
+  uint32_t _gc_runs;
+  uint32_t _gc_freed;
+  Timestamp _gc_last;
+  Timestamp _gc_max;
   
   static void tcp_gc_hook(Timer *, void *);
   static void tcp_done_gc_hook(Timer *, void *);
 
   protected:
 
+    Mapping6 *alloc_pair();
+    void free_pair(Mapping6 *);
+    void touch(Mapping6 *);
+    static void list_remove(Mapping6 *, Mapping6 *&head, Mapping6 *&tail);
+    static void list_append(Mapping6 *, Mapping6 *&head, Mapping6 *&tail);
+    int expire(Mapping6 *&head, Mapping6 *&tail, int &count, uint32_t last_jif);
     void clear_map6(Map6 &);
-    void clean_map6(Map6 &, uint32_t last_jif);
-    void clean_map6_free_tracked(Map6 &, Mapping6 *&free_head, Mapping6 *&free_tail, uint32_t last_jif);
-    void incr_clean_map6_free_tracked(Map6 &, Mapping6 *&head, Mapping6 *&tail, uint32_t last_jif);
 
 
 };
@@ -101,8 +138,6 @@ bool, Mapping6 *);
   Mapping6 * get_prev()                { return _prev; }
   void set_next(Mapping6 * next)       { _next = next; }
   void set_prev(Mapping6 * prev)       { _prev = prev; }
-  Mapping6 *free_next() const		{ return _free_next; }
-  void set_free_next(Mapping6 *m)      {_free_next = m;}
   int output() const 			{ return _output; }
 
     bool is_primary() const		{ return !_is_reverse; }
@@ -120,9 +155,8 @@ bool, Mapping6 *);
     void set_session_flow_over()	{ _flow_over = true; }
     void clear_session_flow_over()	{ _flow_over = false; }
 
+    // true if the mapping is on the done list
     bool free_tracked() const		{ return _free_tracked; }
-    void add_to_free_tracked_tail(Mapping6 *&head, Mapping6 *&tail);
-    void clear_free_tracked();
 
     void apply(int port, Packet *p);
     String s() const;
@@ -137,16 +171,23 @@ bool, Mapping6 *);
   tcp_seq_t _old_delta;
 
   void change_udp_csum_delta(unsigned old_word, unsigned new_word);
+  static uint16_t seqno_csum_delta(int32_t delta);
 
   uint16_t _ip_csum_delta;
   uint16_t _udp_csum_delta;
 
+  // checksum changes, as stored in the packet, for adding _delta and
+  // _old_delta to a sequence number and for subtracting them from an ack
+  uint16_t _delta_csum;
+  uint16_t _old_delta_csum;
+  uint16_t _neg_delta_csum;
+  uint16_t _neg_old_delta_csum;
+
  
   //long unsigned int _t;
   IP6FlowID _mapto;
-  Mapping6 *_prev;
+  Mapping6 *_prev;		// on the live or done list, primaries only
   Mapping6 *_next;
-  Mapping6 *_free_next;
 
 
     Mapping6 *_reverse;
@@ -159,43 +200,18 @@ bool, Mapping6 *);
     uint8_t _output;
     uint8_t _ip_p;
     unsigned _used;
-
-    void append_to_free(Mapping6 *&head, Mapping6 *&tail);
-    inline Mapping6 *free_from_list(Map6 &, bool notify);
+    uint32_t _last_used;	// jiffies, kept on the primary
 
   friend class TCPAddressTranslator;
 };
 
-
- 
-inline void
-TCPAddressTranslator::Mapping6::append_to_free(Mapping6 *&head,
-Mapping6 *&tail)
-{
-  assert((!head && !tail) || (head && tail && head->_free_tracked && tail->_free_tracked));
-  assert(!_free_next && !_reverse->_free_next);
-  if (tail)
-	  tail = tail->_free_next = this;
-  else
-	  head = tail = this;
-}
-
-inline void
-TCPAddressTranslator::Mapping6::add_to_free_tracked_tail(Mapping6
-*&head, Mapping6 *&tail)
-{
-  assert(!_free_tracked && !_reverse->_free_tracked);
-  _free_tracked = _reverse->_free_tracked = true;
-  primary()->append_to_free(head, tail);
-}
-
-inline void
-TCPAddressTranslator::Mapping6::clear_free_tracked()
-{
-  _free_tracked = _reverse->_free_tracked = false;
-  _free_next = 0;
-  assert(_reverse->_free_next == 0);
-}
+// Both mappings of a session, allocated together from a slab.  forward is
+// the first member, so a primary mapping's address is its pair's.
+struct TCPAddressTranslator::MappingPair {
+  Mapping6 forward;
+  Mapping6 reverse;
+  MappingPair *next_free;
+};
 
 inline TCPAddressTranslator::Mapping6 *
 TCPAddressTranslator::get_mapping6(int ip_p, const IP6FlowID &in)
@@ -249,7 +265,7 @@ TCPAddressTranslator::Mapping6::delta_for2(tcp_seq_t seqno) const
 inline bool
 TCPAddressTranslator::Mapping6::used_since(uint32_t t) const
 {
-  return ((int32_t)(_used - t)) >= 0 || ((int32_t)(_reverse->_used - t)) >= 0;
+  return ((int32_t)(primary()->_last_used - t)) >= 0;
 }
 
 CLICK_ENDDECLS
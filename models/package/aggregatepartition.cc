@@ -0,0 +1,108 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * aggregatepartition.{cc,hh} -- select one partition of aggregates
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "aggregatepartition.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packet_anno.hh>
+#include "elements/analysis/aggregateipflows.hh"
+#include <errno.h>
+#include <string.h>
+CLICK_DECLS
+
+AggregatePartition::AggregatePartition()
+    : _npackets(0), _ndeleted(0), _order_file(0)
+{
+}
+
+AggregatePartition::~AggregatePartition()
+{
+}
+
+int
+AggregatePartition::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    AggregateIPFlows *af = 0;
+    if (Args(conf, this, errh)
+	.read_mp("COUNT", _count)
+	.read_mp("INDEX", _index)
+	.read("NOTIFIER", ElementCastArg("AggregateIPFlows"), af)
+	.read("ORDER", FilenameArg(), _order_filename)
+	.complete() < 0)
+	return -1;
+    if (_count == 0)
+	return errh->error("COUNT must be positive");
+    if (_index >= _count)
+	return errh->error("INDEX must be less than COUNT");
+    if (_order_filename && !af)
+	return errh->error("ORDER requires NOTIFIER");
+    if (af)
+	af->add_listener(this);
+    return 0;
+}
+
+int
+AggregatePartition::initialize(ErrorHandler *errh)
+{
+    if (!_order_filename)
+	/* nada */;
+    else if (_order_filename == "-")
+	_order_file = stdout;
+    else if (!(_order_file = fopen(_order_filename.c_str(), "w")))
+	return errh->error("%s: %s", _order_filename.c_str(), strerror(errno));
+    return 0;
+}
+
+void
+AggregatePartition::cleanup(CleanupStage)
+{
+    if (_order_file && _order_file != stdout)
+	fclose(_order_file);
+    _order_file = 0;
+}
+
+Packet *
+AggregatePartition::simple_action(Packet *p)
+{
+    uint32_t aggregate = AGGREGATE_ANNO(p);
+    if (aggregate != 0 && aggregate % _count == _index) {
+	_npackets++;
+	return p;
+    } else {
+	checked_output_push(1, p);
+	return 0;
+    }
+}
+
+void
+AggregatePartition::aggregate_notify(uint32_t aggregate, AggregateEvent event, const Packet *)
+{
+    if (event == DELETE_AGG) {
+	_ndeleted++;
+	if (_order_file && aggregate != 0 && aggregate % _count == _index)
+	    fprintf(_order_file, "%u %llu\n", aggregate, (unsigned long long) _ndeleted);
+    }
+}
+
+void
+AggregatePartition::add_handlers()
+{
+    add_data_handlers("count", Handler::OP_READ, &_npackets);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(AggregatePartition)
@@ -0,0 +1,98 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_AGGREGATEPARTITION_HH
+#define CLICK_AGGREGATEPARTITION_HH
+#include <click/element.hh>
+#include "elements/analysis/aggregatenotifier.hh"
+CLICK_DECLS
+
+/*
+=c
+
+AggregatePartition(COUNT, INDEX [, I<keywords> NOTIFIER, ORDER])
+
+=s ipmeasure
+
+selects one partition of aggregates
+
+=d
+
+Expects packets with aggregate annotations set as if by AggregateIPFlows.
+Emits packets whose aggregate annotation modulo COUNT equals INDEX on output
+0, and all other packets, including those with aggregate 0, on output 1 (or
+drops them, if output 1 is not connected).
+
+Since AggregateIPFlows numbers flows sequentially, COUNT copies of a
+configuration, each with a different INDEX, split a trace into roughly equal
+sets of complete flows.  Every copy sees the same aggregate numbers, so their
+per-flow results can be merged without renumbering.  The C<--jobs> option of
+F<scripts/lossxml.sh> works this way.
+
+Keyword arguments are:
+
+=over 8
+
+=item NOTIFIER
+
+The name of an AggregateIPFlows element.  AggregatePartition numbers every
+aggregate that element deletes, in every partition, in the order it deletes
+them.  Since every copy runs the same AggregateIPFlows over the same trace,
+the numbers agree across copies.
+
+=item ORDER
+
+Filename.  If given with NOTIFIER, AggregatePartition writes a line
+`AGGREGATE NUMBER' to this file for each deleted aggregate in its
+partition.  Elements such as CalculateTCPLossEvents write a flow out when
+its aggregate is deleted, so sorting the copies' flows by NUMBER restores the
+order a single copy over the whole trace would have written them in.
+
+=back
+
+=e
+
+   FromDump(trace.dump, FORCE_IP true, STOP true)
+      -> AggregateIPFlows
+      -> AggregatePartition(4, 0)
+      -> TCPCollector(trace.0.xml)
+      -> Discard;
+
+=h count read-only
+
+Returns the number of packets emitted on output 0.
+
+=a
+
+AggregateIPFlows, TCPCollector */
+
+class AggregatePartition : public Element, public AggregateListener { public:
+
+    AggregatePartition();
+    ~AggregatePartition();
+
+    const char *class_name() const	{ return "AggregatePartition"; }
+    const char *port_count() const	{ return "1/1-2"; }
+    const char *processing() const	{ return "a/ah"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    Packet *simple_action(Packet *);
+
+    void aggregate_notify(uint32_t, AggregateEvent, const Packet *);
+
+  private:
+
+    uint32_t _count;
+    uint32_t _index;
+    uint64_t _npackets;
+    uint64_t _ndeleted;		// aggregates deleted so far, all partitions
+
+    String _order_filename;
+    FILE *_order_file;
+
+};
+
+CLICK_ENDDECLS
+#endif
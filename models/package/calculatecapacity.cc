@@ -19,8 +19,10 @@ CalculateCapacity::StreamInfo::StreamInfo()
       init_seq(0),
       pkt_head(0), pkt_tail(0),
       pkt_cnt(0), mss(0), rmss(0),
+      datarate(0), ackrate(0), dbytes(0), abytes(0),
       intervals(0), hist(0),
-      cutoff(0), valid(0)
+      cutoff(0), valid(0),
+      window_ackbytes(0), window_databytes(0)
 {
 }
 
@@ -445,6 +447,216 @@ CalculateCapacity::StreamInfo::fill_shortrate()
 }
 
 
+// ONLINE MODE
+
+CalculateCapacity::StreamInfo::Bin &
+CalculateCapacity::StreamInfo::online_bin(int index)
+{
+    int l = 0, h = bins.size();
+    while (l < h) {
+	int m = (l + h) / 2;
+	if (bins[m].index < index)
+	    l = m + 1;
+	else
+	    h = m;
+    }
+    if (l == bins.size() || bins[l].index != index) {
+	Bin b;
+	memset(&b, 0, sizeof(b));
+	b.index = index;
+	bins.insert(bins.begin() + l, b);
+    }
+    return bins[l];
+}
+
+void
+CalculateCapacity::StreamInfo::online_close_window()
+{
+    // The window starting at window.front() is complete; this matches one
+    // iteration of fill_shortrate()'s outer loop.
+    const IntervalStream &first = window.front(), &last = window.back();
+    double timetmp = window.size() - 1 > 20 ?
+	(last.time - first.time).doubleval() : 3.0;
+    double tmp = window_ackbytes / timetmp;
+    if (tmp > ackrate) {
+	ackrate = tmp;
+	ackstart = last.time;
+	abytes = window_ackbytes;
+    }
+    tmp = window_databytes / timetmp;
+    if (tmp > datarate) {
+	datarate = tmp;
+	datastart = last.time;
+	dbytes = window_databytes;
+    }
+    window_ackbytes -= first.newack;
+    window_databytes -= first.size;
+    window.pop_front();
+}
+
+void
+CalculateCapacity::StreamInfo::online_packet(const Pkt &k, const Pkt *prev, const CalculateCapacity *cf)
+{
+    // compute the interval record as fill_intervals() would
+    IntervalStream is;
+    is.size = k.last_seq - k.seq + k.hsize;
+    if ((k.flags & TH_ACK) && prev && (prev->flags & TH_ACK) && k.ack > prev->ack)
+	is.newack = k.ack - prev->ack;
+    else
+	is.newack = 0;
+    if (is.newack >= 5 * 1500)
+	is.newack = 0;
+    is.time = k.timestamp;
+    is.interval = (prev ? k.timestamp - prev->timestamp : Timestamp());
+
+    // short-term rates
+    while (window.size() && (is.time - window.front().time).doubleval() >= 3.0)
+	online_close_window();
+    window.push_back(is);
+    window_ackbytes += is.newack;
+    window_databytes += is.size;
+
+    // interarrival histogram
+    int index = cf->interval_bin(is.interval);
+    Bin &b = online_bin(index);
+    b.count++;
+    if (is.interval && !(is.size < 500 && is.newack < 500))
+	b.npeak++;
+    if (is.size > rmss / 2 || is.newack < 0.5 * rmss)
+	b.ack[0]++;
+    else if (is.newack < 1.5 * rmss)
+	b.ack[1]++;
+    else if (is.newack < 2.5 * rmss)
+	b.ack[2]++;
+    else
+	b.ack[3]++;
+}
+
+static inline double
+bin_log_center(const CalculateCapacity *cf, int index)
+{
+    if (index >= CalculateCapacity::NBINS)
+	return log(cf->bin_cutoff(CalculateCapacity::NBINS - 1));
+    else if (index == 0)
+	return log(cf->bin_cutoff(0) / 2);
+    else
+	return (log(cf->bin_cutoff(index - 1)) + log(cf->bin_cutoff(index))) / 2;
+}
+
+void
+CalculateCapacity::StreamInfo::online_findpeaks(const CalculateCapacity *cf)
+{
+    // Apply findpeaks()'s slope test to the histogram.  Every packet in a
+    // bin is treated as lying at the bin's center, so the sorted log
+    // interval at rank r is the center of the bin containing r.
+    Vector<int> pbin;		// bins with npeak > 0
+    Vector<uint32_t> cum;	// ranks before each such bin
+    uint32_t n = 0;
+    for (int i = 0; i < bins.size(); i++)
+	if (bins[i].npeak) {
+	    pbin.push_back(i);
+	    cum.push_back(n);
+	    n += bins[i].npeak;
+	}
+    if (!n)
+	return;
+
+    Vector<double> slopes(pbin.size(), 0);
+    uint32_t slopelen = (uint32_t) (0.01 * n);
+    if (slopelen < 1)
+	slopelen = 1;
+    for (int i = 0; i < pbin.size(); i++) {
+	uint32_t rc = cum[i] + bins[pbin[i]].npeak / 2;
+	uint32_t imin = rc < slopelen ? 0 : rc - slopelen;
+	uint32_t imax = rc + slopelen >= n - 1 ? n - 1 : rc + slopelen;
+	if (imax == imin)
+	    continue;
+	// bins holding ranks imin and imax
+	int bmin = i, bmax = i;
+	while (bmin > 0 && cum[bmin] > imin)
+	    bmin--;
+	while (bmax < pbin.size() - 1 && cum[bmax + 1] <= imax)
+	    bmax++;
+	slopes[i] = (bin_log_center(cf, bins[pbin[bmax]].index)
+		     - bin_log_center(cf, bins[pbin[bmin]].index)) / (imax - imin);
+    }
+
+    double expectedslope = (bin_log_center(cf, bins[pbin.back()].index)
+			    - bin_log_center(cf, bins[pbin[0]].index)) / n;
+    double peakstart = 0.2 * expectedslope;
+    double peakend = 0.5 * expectedslope;
+
+    int lefti = -1;
+    uint32_t area = 0;
+    for (int i = 0; i <= pbin.size(); i++) {
+	if (lefti >= 0 && (i == pbin.size() || slopes[i] >= peakend)) {
+	    // end of peak at i - 1
+	    if (area > 2) {
+		Peak *p = new Peak;
+		const Bin &lb = bins[pbin[lefti]], &rb = bins[pbin[i - 1]];
+		p->left = (lb.index == 0 ? 0 : cf->bin_cutoff(lb.index - 1));
+		p->right = cf->bin_cutoff(rb.index < NBINS ? rb.index : NBINS - 1);
+		uint32_t crank = (cum[lefti] + cum[i - 1] + rb.npeak - 1) / 2;
+		int c = lefti;
+		while (c < i - 1 && cum[c + 1] <= crank)
+		    c++;
+		p->center = exp(bin_log_center(cf, bins[pbin[c]].index));
+		p->area = area;
+
+		// ack classes of all packets in the peak's bins
+		uint32_t ack[4] = { 0, 0, 0, 0 };
+		for (int j = pbin[lefti]; j <= pbin[i - 1]; j++)
+		    for (int a = 0; a < 4; a++)
+			ack[a] += bins[j].ack[a];
+		double cnt = ack[0] + ack[1] + ack[2] + ack[3];
+		p->acknone = ack[0] / cnt;
+		p->ackone = ack[1] / cnt;
+		p->acktwo = ack[2] / cnt;
+		p->ackmore = ack[3] / cnt;
+		peaks.push_back(p);
+	    }
+	    lefti = -1;
+	} else if (lefti < 0 && i < pbin.size() && slopes[i] < peakstart) {
+	    // new peak here
+	    int k = i;
+	    while (k > 0 && slopes[k - 1] < peakend)
+		k--;
+	    lefti = k;
+	    area = 0;
+	    for (int j = k; j < i; j++)
+		area += bins[pbin[j]].npeak;
+	}
+	if (lefti >= 0 && i < pbin.size())
+	    area += bins[pbin[i]].npeak;
+    }
+}
+
+void
+CalculateCapacity::StreamInfo::online_write_xml(FILE *f, const CalculateCapacity *cf) const
+{
+    fprintf(f, "  <stream dir='%d' beginseq='%u' mss='%u' mssr='%u'>\n",
+	    direction, init_seq, mss, rmss);
+    for (Vector<struct Peak *>::const_iterator iter = peaks.begin();
+	 iter != peaks.end(); iter++) {
+	const Peak *p = *iter;
+	fprintf(f, "   <peak center='%lf' area='%d' left='%lf' right='%lf' ",
+		p->center, p->area, p->left, p->right);
+	fprintf(f, "acknone='%lf' ackone='%lf' acktwo='%lf' ackmore='%lf'",
+		p->acknone, p->ackone, p->acktwo, p->ackmore);
+	fprintf(f, " />\n");
+    }
+
+    fprintf(f, "    <interarrivalhist>\n");
+    for (int i = 0; i < bins.size(); i++)
+	if (bins[i].index < NBINS)
+	    fprintf(f, "%lf %u\n", cf->bin_cutoff(bins[i].index), bins[i].count);
+	else
+	    fprintf(f, "inf %u\n", bins[i].count);
+    fprintf(f, "    </interarrivalhist>\n");
+    fprintf(f, " </stream>\n");
+}
+
+
 void
 CalculateCapacity::ConnInfo::kill(CalculateCapacity *cf)
 {
@@ -462,15 +674,17 @@ CalculateCapacity::ConnInfo::kill(CalculateCapacity *cf)
 	    fprintf(f, " filepos='%s'", String(_filepos).c_str());
 	fprintf(f, ">\n");
 
-	_stream[0].fill_intervals();
-	_stream[0].fill_shortrate();
-	_stream[0].histogram();
-	_stream[0].findpeaks();
-
-	_stream[1].fill_intervals();
-	_stream[1].fill_shortrate();
-	_stream[1].histogram();
-	_stream[1].findpeaks();
+	for (int d = 0; d < 2; d++)
+	    if (cf->online()) {
+		_stream[d].online_findpeaks(cf);
+		_stream[d].datarate *= 8;
+		_stream[d].ackrate *= 8;
+	    } else {
+		_stream[d].fill_intervals();
+		_stream[d].fill_shortrate();
+		_stream[d].histogram();
+		_stream[d].findpeaks();
+	    }
 
 	uint32_t bigger = 0;
 	double drate = 0;
@@ -504,8 +718,13 @@ CalculateCapacity::ConnInfo::kill(CalculateCapacity *cf)
 		atime.sec(), atime.subsec(), dbytes, abytes);
 
 
-	_stream[0].write_xml(f);
-	_stream[1].write_xml(f);
+	if (cf->online()) {
+	    _stream[0].online_write_xml(f, cf);
+	    _stream[1].online_write_xml(f, cf);
+	} else {
+	    _stream[0].write_xml(f);
+	    _stream[1].write_xml(f);
+	}
 	fprintf(f, "</flow>\n");
     }
     cf->free_pkt_list(_stream[0].pkt_head, _stream[0].pkt_tail);
@@ -534,36 +753,42 @@ CalculateCapacity::ConnInfo::create_pkt(const Packet *p, CalculateCapacity *pare
 	ack_stream.have_init_seq = true;
     }
 
-    // introduce a Pkt
-    if (Pkt *np = parent->new_pkt()) {
-	const click_ip *iph = p->ip_header();
-	uint32_t size;
-
-	// set fields appropriately
-	np->seq = ntohl(tcph->th_seq) - stream.init_seq;
-	np->last_seq = np->seq + calculate_seqlen(iph, tcph);
-	np->ack = ntohl(tcph->th_ack) - ack_stream.init_seq;
-	np->timestamp = p->timestamp_anno() - _init_time;
-	np->flags = tcph->th_flags;
-	np->hsize = 4*(tcph->th_off + iph->ip_hl);
-
+    const click_ip *iph = p->ip_header();
+    Pkt k;
+    k.next = k.prev = 0;
+    k.seq = ntohl(tcph->th_seq) - stream.init_seq;
+    k.last_seq = k.seq + calculate_seqlen(iph, tcph);
+    k.ack = ntohl(tcph->th_ack) - ack_stream.init_seq;
+    k.timestamp = p->timestamp_anno() - _init_time;
+    k.flags = tcph->th_flags;
+    k.hsize = 4*(tcph->th_off + iph->ip_hl);
+
+    //can't use p->length() due to truncated traces
+    uint32_t size = k.hsize + k.last_seq - k.seq;
+    stream.mss = stream.mss > size ? stream.mss : size;
+    ack_stream.rmss = stream.mss;
+
+    Pkt *np;
+    if (parent->online()) {
+	// keep only the latest packet, for intervals and end times
+	stream.online_packet(k, stream.pkt_tail, parent);
+	if (!stream.pkt_tail && !(stream.pkt_tail = parent->new_pkt()))
+	    return 0;
+	np = stream.pkt_head = stream.pkt_tail;
+	*np = k;
+    } else if ((np = parent->new_pkt())) {
+	*np = k;
 	// hook up to packet list
-	np->next = 0;
 	np->prev = stream.pkt_tail;
 	if (stream.pkt_tail)
 	    stream.pkt_tail = stream.pkt_tail->next = np;
 	else
 	    stream.pkt_head = stream.pkt_tail = np;
-
-	stream.pkt_cnt++;
-	//can't use p->length() due to truncated traces
-	size = np->hsize + np->last_seq - np->seq;
-	stream.mss = stream.mss > size ? stream.mss : size;
-	ack_stream.rmss = stream.mss;
-
-	return np;
     } else
 	return 0;
+
+    stream.pkt_cnt++;
+    return np;
 }
 
 void
@@ -586,7 +811,7 @@ CalculateCapacity::ConnInfo::handle_packet(const Packet *p, CalculateCapacity *p
 
 CalculateCapacity::CalculateCapacity()
     : _traceinfo_file(0), _filepos_h(0),
-      _free_pkt(0), _packet_source(0)
+      _free_pkt(0), _packet_source(0), _online(false)
 {
 }
 
@@ -605,12 +830,22 @@ CalculateCapacity::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read_p("TRACEINFO", FilenameArg(), _traceinfo_filename)
 	.read("SOURCE", _packet_source)
 	.read("NOTIFIER", ElementCastArg("AggregateIPFlows"), af)
+	.read("ONLINE", _online)
 	.complete() < 0)
         return -1;
 
     if (af)
 	af->add_listener(this);
 
+    // same bins as StreamInfo::histogram()
+    _cutoffs.resize(NBINS);
+    double curr = 1.0e-6, stepsize = 1.0e-6;
+    for (int i = 0; i < NBINS; i++) {
+	stepsize *= 1.009;
+	curr += stepsize;
+	_cutoffs[i] = curr;
+    }
+
     return 0;
 }
 
@@ -4,6 +4,7 @@
 #include <click/element.hh>
 #include <click/hashtable.hh>
 #include <click/handlercall.hh>
+#include <click/deque.hh>
 #include "elements/analysis/aggregatenotifier.hh"
 #include "elements/analysis/toipflowdumps.hh"
 CLICK_DECLS
@@ -57,6 +58,19 @@ the router quits.
 Boolean. If true, then use IP ID to distinguish network duplicates from
 retransmissions. Default is true.
 
+=item ONLINE
+
+Boolean. If true, then analyze each stream incrementally as packets arrive,
+rather than keeping a record of every packet until the connection ends.
+Interarrival times go into a log-binned histogram, peaks are found from the
+histogram, and short-term rates come from a sliding three-second window, so
+no sorting is needed and per-stream memory is bounded by the number of
+histogram bins and the packets in that window. Peak boundaries are rounded to
+histogram bins, and packets are classified against the MSS seen so far
+instead of the final MSS. The per-packet C<interarrival> section is replaced
+by an C<interarrivalhist> section listing each nonempty bin's upper bound and
+packet count. Default is false, which computes exact results.
+
 =back
 
 =e
@@ -98,6 +112,11 @@ class CalculateCapacity : public Element, public AggregateListener { public:
     FILE *traceinfo_file() const	{ return _traceinfo_file; }
     HandlerCall *filepos_h() const	{ return _filepos_h; }
 
+    enum { NBINS = 1000 };
+    bool online() const			{ return _online; }
+    inline int interval_bin(const Timestamp &) const;
+    double bin_cutoff(int b) const	{ return _cutoffs[b]; }
+
     typedef HashTable<unsigned, ConnInfo *> ConnMap;
 
   private:
@@ -113,6 +132,9 @@ class CalculateCapacity : public Element, public AggregateListener { public:
     String _traceinfo_filename;
     Element *_packet_source;
 
+    bool _online;
+    Vector<double> _cutoffs;	// upper bounds of histogram bins
+
     Pkt *new_pkt();
     inline void free_pkt(Pkt *);
     inline void free_pkt_list(Pkt *, Pkt *);
@@ -170,6 +192,13 @@ struct CalculateCapacity::StreamInfo {
     uint8_t *valid;
     Vector<struct Peak *> peaks;
 
+    // ONLINE mode state
+    struct Bin;
+    Vector<Bin> bins;		// nonempty histogram bins, sorted by index
+    Deque<IntervalStream> window; // packets in the current rate window
+    uint32_t window_ackbytes;
+    uint32_t window_databytes;
+
     //void categorize(Pkt *insertion, ConnInfo *, CalculateCapacity *);
     //void register_loss_event(Pkt *startk, Pkt *endk, ConnInfo *, CalculateCapacity *);
     //void update_counters(const Pkt *np, const click_tcp *, const ConnInfo *);
@@ -179,6 +208,12 @@ struct CalculateCapacity::StreamInfo {
     void histogram();
     void write_xml(FILE *) const;
 
+    Bin &online_bin(int);
+    void online_packet(const Pkt &, const Pkt *, const CalculateCapacity *);
+    void online_close_window();
+    void online_findpeaks(const CalculateCapacity *);
+    void online_write_xml(FILE *, const CalculateCapacity *) const;
+
 };
 
 struct CalculateCapacity::StreamInfo::IntervalStream {
@@ -188,6 +223,13 @@ struct CalculateCapacity::StreamInfo::IntervalStream {
     Timestamp time; //flow-relative
 };
 
+struct CalculateCapacity::StreamInfo::Bin {
+    int index;		// histogram bin; NBINS holds longer intervals
+    uint32_t count;	// all packets
+    uint32_t npeak;	// packets considered by findpeaks
+    uint32_t ack[4];	// none, one, two, more, as in findpeaks
+};
+
 struct CalculateCapacity::StreamInfo::Peak {
     double center;  //interval in middle
     double left;  //interval at left edge
@@ -229,6 +271,22 @@ CalculateCapacity::calculate_seqlen(const click_ip *iph, const click_tcp *tcph)
     return (ntohs(iph->ip_len) - (iph->ip_hl << 2) - (tcph->th_off << 2)) + (tcph->th_flags & TH_SYN ? 1 : 0) + (tcph->th_flags & TH_FIN ? 1 : 0);
 }
 
+inline int
+CalculateCapacity::interval_bin(const Timestamp &t) const
+{
+    // first bin whose cutoff exceeds t, as in StreamInfo::histogram()
+    double d = t.doubleval();
+    int l = 0, h = NBINS;
+    while (l < h) {
+	int m = (l + h) / 2;
+	if (d < _cutoffs[m])
+	    h = m;
+	else
+	    l = m + 1;
+    }
+    return l;
+}
+
 inline void
 CalculateCapacity::free_pkt(Pkt *p)
 {
@@ -24,9 +24,13 @@
 #include <click/error.hh>
 #include <click/router.hh>
 #include <click/integers.hh>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
 CLICK_DECLS
 
 InferIPAddrColors::InferIPAddrColors()
+    : _checkpoint_timer(this)
 {
 }
 
@@ -39,14 +43,19 @@ InferIPAddrColors::configure(const Vector<String> &conf, ErrorHandler *errh)
 {
     bool active = true;
     String seed_filename;
+    _checkpoint_interval = Timestamp(600);
 
     if (Args(conf, this, errh)
 	.read("ACTIVE", active)
 	.read("SEED", FilenameArg(), seed_filename)
+	.read("CHECKPOINT", FilenameArg(), _checkpoint_filename)
+	.read("CHECKPOINT_INTERVAL", _checkpoint_interval)
 	.complete() < 0)
 	return -1;
 
     _active = active;
+    if (_checkpoint_filename && !_checkpoint_interval)
+	return errh->error("CHECKPOINT_INTERVAL must be positive");
     if (seed_filename && read_file(seed_filename, errh) < 0)
 	return -1;
     return 0;
@@ -57,12 +66,18 @@ InferIPAddrColors::initialize(ErrorHandler *errh)
 {
     if (clear(errh) < 0)
 	return -1;
+    if (_checkpoint_filename) {
+	_checkpoint_timer.initialize(this);
+	_checkpoint_timer.schedule_after(_checkpoint_interval);
+    }
     return 0;
 }
 
 void
-InferIPAddrColors::cleanup(CleanupStage)
+InferIPAddrColors::cleanup(CleanupStage stage)
 {
+    if (stage >= CLEANUP_ROUTER_INITIALIZED && _checkpoint_filename)
+	(void) checkpoint(ErrorHandler::default_handler());
     IPAddrColors::cleanup();
 }
 
@@ -88,11 +103,9 @@ InferIPAddrColors::update(Packet *p)
 
     // resolve colors
     if (snode->color <= MAXCOLOR)
-	while (snode->color != _color_mapping[snode->color])
-	    snode->color = _color_mapping[snode->color];
+	snode->color = find_color(snode->color);
     if (dnode->color <= MAXCOLOR)
-	while (dnode->color != _color_mapping[dnode->color])
-	    dnode->color = _color_mapping[dnode->color];
+	dnode->color = find_color(dnode->color);
 
     if (snode->color == BADCOLOR || dnode->color == BADCOLOR)
 	/* skip this packet */;
@@ -102,21 +115,16 @@ InferIPAddrColors::update(Packet *p)
 	dnode->color = _next_color + 1;
 	_color_mapping.push_back(_next_color);
 	_color_mapping.push_back(_next_color + 1);
+	_color_rank.push_back(0);
 	_next_color += 2;
     } else if (snode->color == NULLCOLOR)
 	snode->color = (dnode->color ^ 1);
     else if (dnode->color == NULLCOLOR)
 	dnode->color = (snode->color ^ 1);
-    else if ((snode->color & ~1) < (dnode->color & ~1)) {
-	_color_mapping[dnode->color] = (snode->color ^ 1);
-	_color_mapping[dnode->color ^ 1] = snode->color;
+    else if ((snode->color >> 1) != (dnode->color >> 1)) {
+	merge_colors(snode->color, dnode->color);
+	snode->color = find_color(snode->color);
 	dnode->color = (snode->color ^ 1);
-	_compacted = false;
-    } else if ((dnode->color & ~1) < (snode->color & ~1)) {
-	_color_mapping[snode->color] = (dnode->color ^ 1);
-	_color_mapping[snode->color ^ 1] = dnode->color;
-	snode->color = (dnode->color ^ 1);
-	_compacted = false;
     } else if (snode->color == dnode->color) {
 	click_chatter("color conflict: src %s same color as dst %s", IPAddress(iph->ip_src).unparse().c_str(), IPAddress(iph->ip_dst).unparse().c_str());
 	// maybe the source was spoofed?
@@ -142,6 +150,26 @@ InferIPAddrColors::pull(int)
     return p;
 }
 
+int
+InferIPAddrColors::checkpoint(ErrorHandler *errh)
+{
+    // Write to a temporary and rename, so a crash mid-write leaves the
+    // previous checkpoint intact.
+    String tmp = _checkpoint_filename + ".tmp";
+    if (write_file(tmp, true, errh) < 0)
+	return -1;
+    if (rename(tmp.c_str(), _checkpoint_filename.c_str()) < 0)
+	return errh->error("%s: %s", _checkpoint_filename.c_str(), strerror(errno));
+    return 0;
+}
+
+void
+InferIPAddrColors::run_timer(Timer *)
+{
+    (void) checkpoint(ErrorHandler::default_handler());
+    _checkpoint_timer.reschedule_after(_checkpoint_interval);
+}
+
 
 // HANDLERS
 
@@ -157,7 +185,7 @@ InferIPAddrColors::write_file_handler(const String &data, Element *e, void *thun
 }
 
 enum {
-    AC_ACTIVE, AC_BANNER, AC_STOP, AC_CLEAR, AC_NCOLORS
+    AC_ACTIVE, AC_BANNER, AC_STOP, AC_CLEAR, AC_NCOLORS, AC_CHECKPOINT
 };
 
 String
@@ -194,6 +222,10 @@ InferIPAddrColors::write_handler(const String &data, Element *e, void *thunk, Er
 	return 0;
       case AC_CLEAR:
 	return ac->clear(errh);
+      case AC_CHECKPOINT:
+	if (!ac->_checkpoint_filename)
+	    return errh->error("no CHECKPOINT file configured");
+	return ac->checkpoint(errh);
       default:
 	return errh->error("internal error");
     }
@@ -210,6 +242,7 @@ InferIPAddrColors::add_handlers()
     add_write_handler("stop", write_handler, (void *)AC_STOP);
     add_read_handler("ncolors", read_handler, (void *)AC_NCOLORS);
     add_write_handler("clear", write_handler, (void *)AC_CLEAR);
+    add_write_handler("checkpoint", write_handler, (void *)AC_CHECKPOINT);
 }
 
 CLICK_ENDDECLS
@@ -2,6 +2,7 @@
 #ifndef CLICK_INFERIPADDRCOLORS_HH
 #define CLICK_INFERIPADDRCOLORS_HH
 #include <click/element.hh>
+#include <click/timer.hh>
 #include "ipaddrcolors.hh"
 CLICK_DECLS
 
@@ -40,6 +41,16 @@ Default is true.
 
 Filename. Read this color file for seed colors.
 
+=item CHECKPOINT
+
+Filename. If given, periodically write the current color assignment to this
+file in binary. The file is written under a temporary name and then renamed,
+so it always holds a complete coloring that can be passed back as SEED.
+
+=item CHECKPOINT_INTERVAL
+
+Time value. How often to write CHECKPOINT. Default is 10 minutes.
+
 =back
 
 =h write_text_file write-only
@@ -56,6 +67,10 @@ color assignment in binary to the specified file.
 
 Returns or sets the ACTIVE parameter.
 
+=h checkpoint write-only
+
+Writes the CHECKPOINT file immediately.
+
 =h clear write-only
 
 Erases all accumulated color state when written.
@@ -73,7 +88,9 @@ aggregation.)
 =head1 ALGORITHM
 
 InferIPAddrColors works incrementally, but its algorithm is equivalent to this
-offline algorithm. Initialize a working set W with all IP addresses seen.
+offline algorithm. (Colors are merged with a union-find structure, using
+union by rank and path halving, so each packet costs near-constant time.)
+Initialize a working set W with all IP addresses seen.
 Repeat these steps until W is empty:
 
 =over 3
@@ -175,10 +192,18 @@ class InferIPAddrColors : public Element, public IPAddrColors { public:
     void push(int, Packet *);
     Packet *pull(int);
 
+    void run_timer(Timer *);
+
   private:
 
     bool _active : 1;
 
+    String _checkpoint_filename;
+    Timestamp _checkpoint_interval;
+    Timer _checkpoint_timer;
+
+    int checkpoint(ErrorHandler *);
+
     static String read_handler(Element *, void *);
     static int write_handler(const String &, Element *, void *, ErrorHandler*);
     static void write_nodes(Node*, FILE*, bool, uint32_t*, int&, int, ErrorHandler*);
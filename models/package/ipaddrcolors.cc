@@ -68,6 +68,7 @@ IPAddrColors::cleanup()
     _blocks.clear();
     _root = _free = 0;
     _color_mapping.clear();
+    _color_rank.clear();
     _next_color = 0;
 }
 
@@ -248,11 +249,35 @@ IPAddrColors::hard_ensure_color(color_t c)
 	    return -1;
 	for (color_t x = _next_color; x <= (c | 1); x++)
 	    _color_mapping[x] = x;
+	_color_rank.resize((c >> 1) + 1, 0);
 	_next_color = (c | 1) + 1;
     }
     return 0;
 }
 
+void
+IPAddrColors::merge_colors(color_t a, color_t b)
+{
+    // Record that 'a' and 'b', representatives of different color pairs, lie
+    // on opposite sides of the link.  Union by rank; ties go to the lower
+    // pair so seeded colors stay representatives.
+    assert(a <= MAXCOLOR && b <= MAXCOLOR && (a >> 1) != (b >> 1));
+    uint8_t &arank = _color_rank[a >> 1];
+    uint8_t &brank = _color_rank[b >> 1];
+    if (arank < brank || (arank == brank && a > b)) {
+	_color_mapping[a] = b ^ 1;
+	_color_mapping[a ^ 1] = b;
+	if (arank == brank)
+	    brank++;
+    } else {
+	_color_mapping[b] = a ^ 1;
+	_color_mapping[b ^ 1] = a;
+	if (arank == brank)
+	    arank++;
+    }
+    _compacted = false;
+}
+
 int
 IPAddrColors::set_color(uint32_t a, color_t color)
 {
@@ -348,6 +373,7 @@ IPAddrColors::clear(ErrorHandler *errh)
 
     _next_color = 0;
     _color_mapping.resize(0);
+    _color_rank.resize(0);
     _compacted = true;
     _n_fixed_colors = 0;
     return 0;
@@ -372,29 +398,31 @@ IPAddrColors::compact_colors()
     if (_compacted)
 	return;
 
-    // resolve color pointer chains
-    for (color_t c = 0; c < _next_color; c++) {
-	color_t cc = c;
-	while (_color_mapping[cc] != cc)
-	    _color_mapping[c] = cc = _color_mapping[cc];
-    }
-
-    // allocate new colors
+    // number classes in order of their lowest color pair, independent of
+    // which pair union-by-rank chose as representative
+    Vector<color_t> renumber(_next_color, NULLCOLOR);
     color_t next_color = 0;
+    for (color_t c = 0; c < _next_color; c += 2) {
+	color_t r = find_color(c);
+	if (renumber[r] == NULLCOLOR) {
+	    renumber[r] = next_color;
+	    renumber[r ^ 1] = next_color + 1;
+	    next_color += 2;
+	}
+    }
     for (color_t c = 0; c < _next_color; c++)
-	if (_color_mapping[c] == c)
-	    _color_mapping[c] = next_color++;
-	else
-	    _color_mapping[c] = _color_mapping[ _color_mapping[c] ];
+	renumber[c] = renumber[find_color(c)];
 
     // change nodes according to mapping
+    _color_mapping.swap(renumber);
     node_compact_colors(_root);
 
     // rewrite mapping array
+    _color_mapping.resize(next_color);
     for (color_t c = 0; c < next_color; c++)
 	_color_mapping[c] = c;
+    _color_rank.assign(next_color >> 1, 0);
     _next_color = next_color;
-    _color_mapping.resize(next_color);
     _compacted = true;
 }
 
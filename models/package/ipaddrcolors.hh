@@ -53,6 +53,7 @@ class IPAddrColors { public:
 
     color_t _next_color;
     Vector<color_t> _color_mapping;
+    Vector<uint8_t> _color_rank;	// union-by-rank; indexed by color >> 1
 
     bool _compacted : 1;
     bool _allocated : 1;
@@ -64,6 +65,8 @@ class IPAddrColors { public:
 
     inline int ensure_color(color_t);
     int hard_ensure_color(color_t);
+    inline color_t find_color(color_t);
+    void merge_colors(color_t, color_t);
 
     uint32_t node_ok(Node *, int, uint32_t *, color_t, ErrorHandler *) const;
     static void node_print(const Node *, int, const Node *highlight = 0);
@@ -102,7 +105,7 @@ inline IPAddrColors::color_t
 IPAddrColors::color(uint32_t a)
 {
     if (Node *n = find_node(a))
-	return (n->color <= MAXCOLOR ? _color_mapping[n->color] : n->color);
+	return (n->color <= MAXCOLOR ? find_color(n->color) : n->color);
     else
 	return BADCOLOR;
 }
@@ -113,5 +116,22 @@ IPAddrColors::ensure_color(color_t c)
     return (c < _next_color ? 0 : hard_ensure_color(c));
 }
 
+/* _color_mapping is a union-find forest over colors.  The two colors of a
+   pair (c and c ^ 1) always point at complementary colors, so the
+   representative of c ^ 1 is the complement of c's representative; this is
+   how the forest tracks bipartite parity.  find_color uses path halving. */
+inline IPAddrColors::color_t
+IPAddrColors::find_color(color_t c)
+{
+    color_t p;
+    while ((p = _color_mapping[c]) != c) {
+	color_t gp = _color_mapping[p];
+	_color_mapping[c] = gp;
+	_color_mapping[c ^ 1] = gp ^ 1;
+	c = gp;
+    }
+    return c;
+}
+
 CLICK_ENDDECLS
 #endif
@@ -1,46 +1,119 @@
 // -*- mode: c++; c-basic-offset: 4 -*-
 #include <click/config.h>
 #include "tcpscoreboard.hh"
+#include <string.h>
 CLICK_DECLS
 
+TCPScoreboard::TCPScoreboard(const TCPScoreboard &x)
+    : _cumack(x._cumack), _r(_inline), _head(0), _n(0), _cap(NINLINE)
+{
+    *this = x;
+}
+
+TCPScoreboard &
+TCPScoreboard::operator=(const TCPScoreboard &x)
+{
+    if (&x != this) {
+	clear(x._cumack);
+	if (x._n > _cap) {
+	    Range *r = new Range[x._n];
+	    if (!r)		// out of memory: keep only the cumulative ack
+		return *this;
+	    if (_r != _inline)
+		delete[] _r;
+	    _r = r;
+	    _cap = x._n;
+	}
+	memcpy(_r, x._r + x._head, x._n * sizeof(Range));
+	_n = x._n;
+    }
+    return *this;
+}
+
+// Returns the index of the first range whose end_seq is at or after 'seq'
+// (or nranges() if there is none).  'seq' must be above cumack().
+int
+TCPScoreboard::find_end(tcp_seq_t seq) const
+{
+    const Range *r = _r + _head;
+    uint32_t off = offset(seq);
+    int l = 0, h = _n;
+    while (l < h) {
+	int m = (l + h) / 2;
+	if (offset(r[m].end_seq) < off)
+	    l = m + 1;
+	else
+	    h = m;
+    }
+    return l;
+}
+
+bool
+TCPScoreboard::insert(int i, tcp_seq_t seq, tcp_seq_t end_seq)
+{
+    if (_head + _n == _cap) {
+	if (_n == _cap) {
+	    Range *r = new Range[_cap * 2];
+	    if (!r)
+		return false;
+	    memcpy(r, _r + _head, _n * sizeof(Range));
+	    if (_r != _inline)
+		delete[] _r;
+	    _r = r;
+	    _cap *= 2;
+	} else
+	    memmove(_r, _r + _head, _n * sizeof(Range));
+	_head = 0;
+    }
+    Range *r = _r + _head;
+    memmove(r + i + 1, r + i, (_n - i) * sizeof(Range));
+    r[i].seq = seq;
+    r[i].end_seq = end_seq;
+    _n++;
+    return true;
+}
+
 void
 TCPScoreboard::add(tcp_seq_t seq, tcp_seq_t end_seq)
 {
     // common cases
     if (SEQ_GEQ(seq, end_seq) || SEQ_LEQ(end_seq, _cumack))
 	/* nothing to do */;
-    else if (SEQ_LEQ(seq, _cumack) && !_sack.size())
-	_cumack = end_seq;
     else if (SEQ_LEQ(seq, _cumack)) {
+	// advance the cumulative ack, absorbing any ranges it reaches
 	_cumack = end_seq;
-	while (_sack.size() && SEQ_GEQ(_cumack, _sack[0])) {
-	    if (SEQ_LT(_cumack, _sack[1]))
-		_cumack = _sack[1];
-	    _sack.pop_front();
-	    _sack.pop_front();
+	while (_n && SEQ_GEQ(_cumack, _r[_head].seq)) {
+	    if (SEQ_LT(_cumack, _r[_head].end_seq))
+		_cumack = _r[_head].end_seq;
+	    _head++;
+	    _n--;
 	}
-    } else if (!_sack.size() || SEQ_GT(seq, _sack.back())) {
-	_sack.push_back(seq);
-	_sack.push_back(end_seq);
+	if (!_n)
+	    _head = 0;
     } else {
-	int block;
-	for (block = 0; block < _sack.size(); block += 2)
-	    if (SEQ_LEQ(seq, _sack[block + 1])) {
-		if (SEQ_LT(end_seq, _sack[block])) { // add new block
-		    _sack.push_back(0);
-		    _sack.push_back(0);
-		    for (int i = _sack.size() - 1; i >= block + 2; i--)
-			_sack[i] = _sack[i - 2];
-		    _sack[block] = seq;
-		    _sack[block+1] = end_seq;
-		} else {
-		    if (SEQ_LEQ(seq, _sack[block]))
-			_sack[block] = seq;
-		    if (SEQ_GEQ(end_seq, _sack[block+1]))
-			_sack[block+1] = end_seq;
+	int i = find_end(seq);
+	Range *r = _r + _head;
+	if (i == _n || SEQ_LT(end_seq, r[i].seq))
+	    (void) insert(i, seq, end_seq);
+	else {
+	    // overlaps or abuts range i; extend it and swallow any later
+	    // ranges the extension reaches
+	    if (SEQ_LT(seq, r[i].seq))
+		r[i].seq = seq;
+	    if (SEQ_GT(end_seq, r[i].end_seq)) {
+		r[i].end_seq = end_seq;
+		int j = i + 1;
+		while (j < _n && SEQ_LEQ(r[j].seq, r[i].end_seq)) {
+		    if (SEQ_GT(r[j].end_seq, r[i].end_seq))
+			r[i].end_seq = r[j].end_seq;
+		    j++;
+		}
+		if (j > i + 1) {
+		    memmove(r + i + 1, r + j, (_n - j) * sizeof(Range));
+		    _n -= j - i - 1;
 		}
-		break;
 	    }
+	}
     }
 }
 
@@ -52,17 +125,15 @@ TCPScoreboard::contains(tcp_seq_t seq, tcp_seq_t end_seq) const
 	return false;
     else if (SEQ_LEQ(end_seq, _cumack))
 	return true;
-    else {
-	if (SEQ_LT(seq, _cumack))
-	    seq = _cumack;
-	for (int block = 0; block < _sack.size(); block += 2)
-	    if (SEQ_LT(seq, _sack[block]))
-		return false;
-	    else if (SEQ_LEQ(end_seq, _sack[block+1]))
-		return true;
-	    else if (SEQ_LEQ(seq, _sack[block+1]))
-		seq = _sack[block+1];
+    else if (SEQ_LEQ(seq, _cumack) || !_n)
+	// ranges never start at or below cumack, so [cumack, cumack+1) is
+	// always missing
 	return false;
+    else {
+	// ranges are disjoint and non-adjacent, so at most one can hold the
+	// whole interval
+	int i = find_end(end_seq);
+	return i < _n && SEQ_LEQ(_r[_head + i].seq, seq);
     }
 }
 
@@ -2,31 +2,74 @@
 #ifndef CLICK_TCPSCOREBOARD_HH
 #define CLICK_TCPSCOREBOARD_HH
 #include <clicknet/tcp.h>
-#include <click/deque.hh>
 CLICK_DECLS
 
+/*
+ * TCPScoreboard records which sequence numbers have been received: everything
+ * before cumack(), plus a set of disjoint, non-adjacent ranges above it.
+ * Ranges are kept sorted in a flat array.  The first few live inline, so the
+ * common case of a handful of SACK blocks never allocates; larger holesets
+ * spill to the heap and are searched by bisection.  All ranges lie above
+ * cumack(), so they are ordered by their offset from cumack(), which is safe
+ * across sequence number wraparound.
+ */
 class TCPScoreboard { public:
 
-    TCPScoreboard(tcp_seq_t cumack = 0)	: _cumack(cumack) { }
+    TCPScoreboard(tcp_seq_t cumack = 0);
+    TCPScoreboard(const TCPScoreboard &);
+    ~TCPScoreboard();
+    TCPScoreboard &operator=(const TCPScoreboard &);
 
     inline tcp_seq_t cumack() const	{ return _cumack; }
     bool contains(tcp_seq_t seq, tcp_seq_t end_seq) const;
 
+    inline int nranges() const		{ return _n; }
+    inline tcp_seq_t range_seq(int i) const	{ return _r[_head + i].seq; }
+    inline tcp_seq_t range_end_seq(int i) const	{ return _r[_head + i].end_seq; }
+
     inline void clear(tcp_seq_t cumack = 0);
     void add(tcp_seq_t seq, tcp_seq_t end_seq);
     inline void add_cumack(tcp_seq_t cumack);
 
-  public:
+  private:
+
+    enum { NINLINE = 4 };
+
+    struct Range {
+	tcp_seq_t seq;
+	tcp_seq_t end_seq;
+    };
 
     tcp_seq_t _cumack;
-    Deque<tcp_seq_t> _sack;
+    Range *_r;			// live ranges are _r[_head, _head + _n)
+    int _head;
+    int _n;
+    int _cap;
+    Range _inline[NINLINE];
+
+    inline uint32_t offset(tcp_seq_t seq) const { return seq - _cumack; }
+    int find_end(tcp_seq_t seq) const;
+    bool insert(int i, tcp_seq_t seq, tcp_seq_t end_seq);
 
 };
 
+inline
+TCPScoreboard::TCPScoreboard(tcp_seq_t cumack)
+    : _cumack(cumack), _r(_inline), _head(0), _n(0), _cap(NINLINE)
+{
+}
+
+inline
+TCPScoreboard::~TCPScoreboard()
+{
+    if (_r != _inline)
+	delete[] _r;
+}
+
 inline void TCPScoreboard::clear(tcp_seq_t cumack)
 {
     _cumack = cumack;
-    _sack.clear();
+    _head = _n = 0;
 }
 
 inline void TCPScoreboard::add_cumack(tcp_seq_t cumack)
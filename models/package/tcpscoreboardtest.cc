@@ -0,0 +1,149 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * tcpscoreboardtest.{cc,hh} -- regression test and benchmark for
+ * TCPScoreboard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "tcpscoreboardtest.hh"
+#include "tcpscoreboard.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+
+TCPScoreboardTest::TCPScoreboardTest()
+{
+}
+
+TCPScoreboardTest::~TCPScoreboardTest()
+{
+}
+
+int
+TCPScoreboardTest::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _benchmark = false;
+    _iterations = 1000000;
+    return Args(conf, this, errh)
+	.read("BENCHMARK", _benchmark)
+	.read("ITERATIONS", _iterations)
+	.complete();
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test %<%s%> failed", __FILE__, __LINE__, #x);
+
+int
+TCPScoreboardTest::check(ErrorHandler *errh)
+{
+    // simple cases
+    TCPScoreboard sb(100);
+    CHECK(sb.contains(50, 100));
+    CHECK(!sb.contains(50, 101));
+    CHECK(!sb.contains(100, 100));
+    sb.add(200, 300);
+    sb.add(400, 500);
+    CHECK(sb.nranges() == 2 && sb.cumack() == 100);
+    CHECK(sb.contains(200, 300) && sb.contains(250, 260));
+    CHECK(!sb.contains(150, 250) && !sb.contains(250, 450));
+    sb.add(300, 400);
+    CHECK(sb.nranges() == 1 && sb.contains(250, 450));
+    sb.add_cumack(200);
+    CHECK(sb.nranges() == 0 && sb.cumack() == 500);
+
+    // many holes, forcing heap storage, and copies
+    sb.clear(0);
+    for (int i = 0; i < 64; i++)
+	sb.add(i * 20 + 10, i * 20 + 20);
+    CHECK(sb.nranges() == 64);
+    TCPScoreboard sb2(sb);
+    for (int i = 0; i < 64; i++)
+	CHECK(sb2.contains(i * 20 + 10, i * 20 + 20) && !sb2.contains(i * 20 + 9, i * 20 + 20));
+    sb.add(5, 1270);
+    CHECK(sb.nranges() == 1 && sb.cumack() == 0);
+    sb.add_cumack(10);
+    CHECK(sb.nranges() == 0 && sb.cumack() == 1280);
+    CHECK(sb2.nranges() == 64);
+
+    // random operations against a bitmap, near and away from wraparound
+    enum { W = 512 };
+    Vector<bool> got;
+    for (int trial = 0; trial < 200; trial++) {
+	tcp_seq_t base = (trial & 1 ? 0xFFFFFF00U : click_random());
+	TCPScoreboard rsb(base);
+	got.assign(W + 32, false);
+	for (int op = 0; op < 100; op++) {
+	    int a = click_random(0, W - 1), len = click_random(0, 31);
+	    rsb.add(base + a, base + a + len);
+	    for (int k = a; k < a + len; k++)
+		got[k] = true;
+	    int cumack = 0;
+	    while (got[cumack])
+		cumack++;
+	    CHECK(rsb.cumack() == base + cumack);
+	    for (int q = 0; q < 16; q++) {
+		int s = click_random(0, W - 1), l = click_random(0, 15);
+		bool expect = (l > 0);
+		for (int k = s; k < s + l; k++)
+		    expect = expect && got[k];
+		CHECK(rsb.contains(base + s, base + s + l) == expect);
+	    }
+	}
+    }
+
+    return 0;
+}
+
+void
+TCPScoreboardTest::benchmark(const char *name, int nholes, ErrorHandler *errh)
+{
+    // Each round opens 'nholes' holes above the cumulative ack with SACKed
+    // segments, probes them, and then fills them in as retransmissions would.
+    const uint32_t mss = 1460;
+    TCPScoreboard sb(1);
+    uint32_t nops = 0, ncontained = 0;
+    tcp_seq_t base = 1;
+    Timestamp before = Timestamp::now();
+    while (nops < _iterations) {
+	for (int i = 1; i <= nholes; i++, nops++)
+	    sb.add(base + (2 * i) * mss, base + (2 * i + 1) * mss);
+	for (int i = 0; i < 2 * nholes; i++, nops++)
+	    ncontained += sb.contains(base + i * mss, base + (i + 1) * mss);
+	for (int i = 0; i < nholes; i++, nops++)
+	    sb.add(base + (2 * i + 1) * mss, base + (2 * i + 2) * mss);
+	sb.add(base, base + mss);
+	nops++;
+	base = sb.cumack();
+    }
+    Timestamp elapsed = Timestamp::now() - before;
+    double rate = nops / (elapsed.doubleval() > 0 ? elapsed.doubleval() : 1e-9);
+    errh->message("%s: %u operations in %s s, %.0f/s (%u contained)", name, nops, elapsed.unparse().c_str(), rate, ncontained);
+}
+
+int
+TCPScoreboardTest::initialize(ErrorHandler *errh)
+{
+    if (check(errh) < 0)
+	return -1;
+    errh->message("All tests pass!");
+    if (_benchmark) {
+	benchmark("sack", 3, errh);
+	benchmark("holes", 200, errh);
+    }
+    return 0;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel TCPScoreboard)
+EXPORT_ELEMENT(TCPScoreboardTest)
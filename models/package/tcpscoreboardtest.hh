@@ -0,0 +1,69 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_TCPSCOREBOARDTEST_HH
+#define CLICK_TCPSCOREBOARDTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+TCPScoreboardTest([I<keywords> BENCHMARK, ITERATIONS])
+
+=s test
+
+runs regression tests and a micro-benchmark for TCPScoreboard
+
+=d
+
+TCPScoreboardTest runs TCPScoreboard regression tests at initialization time.
+The tests compare the scoreboard against a simple bitmap model, including
+near sequence number wraparound.  It does not route packets.
+
+Keywords are:
+
+=over 8
+
+=item BENCHMARK
+
+Boolean.  If true, also time TCPScoreboard on a SACK-heavy workload (few
+ranges, the inline case) and a many-hole workload (the heap case), and
+report operations per second.  Default is false.
+
+=item ITERATIONS
+
+Unsigned.  Number of scoreboard operations per benchmark workload.  Default
+is 1000000.
+
+=back
+
+=e
+
+   require(models);
+   TCPScoreboardTest(BENCHMARK true);
+
+=a
+
+TCPCollector, TCPMystery, CalculateTCPLossEvents */
+
+class TCPScoreboardTest : public Element { public:
+
+    TCPScoreboardTest();
+    ~TCPScoreboardTest();
+
+    const char *class_name() const	{ return "TCPScoreboardTest"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+
+  private:
+
+    bool _benchmark;
+    uint32_t _iterations;
+
+    int check(ErrorHandler *);
+    void benchmark(const char *, int, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,189 @@
+#! /bin/sh
+
+# benchtcp.sh -- benchmark and regression-check the TCP analysis elements
+#
+# Generates synthetic traces with scripts/gentcptrace.py, runs each analysis
+# element over them, and reports packets per second, peak process memory,
+# TCPCollector's max_memusage, and per-stage time (total time minus the time
+# to parse and aggregate the trace).  Each element's XML output is compared
+# against a stored baseline in test/bench; without --record, the script
+# refuses to run until every baseline it needs exists.
+
+usage () {
+    echo "Usage: benchtcp.sh [--record] [--flows N] [--workdir DIR] [ELEMENT...]" 1>&2
+    echo "Elements: collector mystery lossevents capacity multiq (default all)" 1>&2
+    exit 1
+}
+
+scriptdir=`dirname "$0"`
+scriptdir=`cd "$scriptdir" && pwd`
+basedir="$scriptdir/../test/bench"
+workdir="${TMPDIR:-/tmp}/benchtcp.$$"
+keepwork=0
+record=0
+flows=5000
+
+while test $# -gt 0; do
+    case "$1" in
+      --record)
+	record=1; shift 1;;
+      --flows)
+	test $# -ge 2 || usage
+	flows="$2"; shift 2;;
+      --workdir)
+	test $# -ge 2 || usage
+	workdir="$2"; keepwork=1; shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+elements="$*"
+test -z "$elements" && elements="collector mystery lossevents capacity multiq"
+
+cases="clean lossy sack heavytail"
+
+# caseopts CASE -- gentcptrace.py options for CASE
+caseopts () {
+    case "$1" in
+      clean)	echo "--loss=0";;
+      lossy)	echo "--loss=0.02 --reorder=0.01";;
+      sack)	echo "--loss=0.02 --reorder=0.01 --sack=1";;
+      heavytail) echo "--loss=0.01 --sack=0.5 --length=pareto:40";;
+    esac
+}
+
+mkdir -p "$workdir" || exit 1
+test $keepwork = 1 || trap 'rm -rf "$workdir"' 0
+
+if test -x /usr/bin/time && /usr/bin/time -f '%e' true >/dev/null 2>&1; then
+    timecmd='/usr/bin/time -f %e:%M -o'
+else
+    timecmd=''
+fi
+
+# runclick NAME CONFIG
+# Runs CONFIG, leaving "packets memusage" in $workdir/NAME.out and
+# "seconds maxrss" in $workdir/NAME.time.
+runclick () {
+    if test -n "$timecmd"; then
+	$timecmd "$workdir/$1.time.raw" click -e "$2" > "$workdir/$1.out" || return 1
+	sed 's/:/ /' "$workdir/$1.time.raw" > "$workdir/$1.time"
+    else
+	start=`date +%s.%N`
+	click -e "$2" > "$workdir/$1.out" || return 1
+	end=`date +%s.%N`
+	echo "$start $end" | awk '{ printf "%.2f -\n", $2 - $1 }' > "$workdir/$1.time"
+    fi
+}
+
+# elementconfig ELEMENT OUTPUT
+# The analysis element is always named 'tc'.
+elementconfig () {
+    case "$1" in
+      none)
+	echo "-> Discard;";;
+      collector)
+	echo "-> tc :: TCPCollector($2, SOURCE fd, NOTIFIER aipf) -> Discard;";;
+      mystery)
+	echo "-> tc :: TCPCollector($2, SOURCE fd, NOTIFIER aipf) -> Discard;
+TCPMystery(tc);";;
+      lossevents)
+	echo "-> tc :: CalculateTCPLossEvents($2, SOURCE fd, NOTIFIER aipf, ACKCAUSALITY true, UNDELIVERED true) -> Discard;";;
+      capacity)
+	echo "-> tc :: CalculateCapacity($2, SOURCE fd, NOTIFIER aipf) -> Discard;";;
+      multiq)
+	echo "-> tc :: TCPCollector($2, SOURCE fd, NOTIFIER aipf) -> Discard;
+MultiQ(TCPCOLLECTOR tc);";;
+      *)
+	return 1;;
+    esac
+}
+
+# makeconfig TRACE ELEMENT OUTPUT
+makeconfig () {
+    body=`elementconfig $2 $3` || return 1
+    case "$2" in
+      none)
+	driver="print c.count";;
+      collector|mystery|multiq)
+	driver="write tc.clear, print c.count, print tc.max_memusage";;
+      *)
+	driver="write tc.clear, print c.count";;
+    esac
+    echo "
+require(models)
+fd :: FromIPSummaryDump($1, STOP true)
+    -> aipf :: AggregateIPFlows
+    -> c :: Counter
+    $body
+DriverManager(wait, $driver, stop)"
+}
+
+for e in $elements; do
+    elementconfig $e x >/dev/null || { echo "benchtcp.sh: unknown element '$e'" 1>&2; usage; }
+done
+
+# without --record, every output needs a baseline to be compared with
+if test $record = 0; then
+    missing=
+    for case in $cases; do
+	for e in $elements; do
+	    test -f "$basedir/$case.$e.xml" || missing="$missing $case.$e"
+	done
+    done
+    if test -n "$missing"; then
+	echo "benchtcp.sh: no baseline in $basedir for:$missing" 1>&2
+	echo "benchtcp.sh: run 'benchtcp.sh --record' on a reference build first" 1>&2
+	exit 1
+    fi
+fi
+
+status=0
+printf '%-10s %-11s %9s %8s %8s %10s %10s %12s  %s\n' \
+    case element packets seconds stage pkts/sec maxrss_kB max_memusage output
+
+for case in $cases; do
+    trace="$workdir/$case.ipsd"
+    ${PYTHON:-python} "$scriptdir/gentcptrace.py" --flows=$flows `caseopts $case` > "$trace" || exit 1
+
+    # parse-and-aggregate baseline, subtracted to get per-stage time
+    runclick $case.none "`makeconfig $trace none /dev/null`" || exit 1
+    basesec=`awk '{ print $1 }' "$workdir/$case.none.time"`
+
+    for e in $elements; do
+	xml="$workdir/$case.$e.xml"
+	if ! runclick $case.$e "`makeconfig $trace $e $xml`"; then
+	    echo "benchtcp.sh: $case $e: click failed" 1>&2
+	    status=1
+	    continue
+	fi
+	packets=`sed -n 1p "$workdir/$case.$e.out"`
+	memusage=`sed -n 2p "$workdir/$case.$e.out"`
+	set x `cat "$workdir/$case.$e.time"`
+	seconds=$2; maxrss=$3
+
+	# the trace file name differs from run to run; drop it before comparing
+	sed "s/^<trace file='[^']*'/<trace/" "$xml" > "$xml.cmp"
+	baseline="$basedir/$case.$e.xml"
+	if test $record = 1; then
+	    mkdir -p "$basedir" && cp "$xml.cmp" "$baseline"
+	    result=recorded
+	elif cmp -s "$xml.cmp" "$baseline"; then
+	    result=same
+	else
+	    result=DIFFERENT
+	    status=1
+	fi
+
+	echo "$packets $seconds $basesec $maxrss" | awk -v c=$case -v e=$e -v m="${memusage:--}" -v r=$result '{
+	    stage = $2 - $3; if (stage < 0) stage = 0;
+	    rate = ($2 > 0 ? $1 / $2 : 0);
+	    printf "%-10s %-11s %9d %8.2f %8.2f %10.0f %10s %12s  %s\n", c, e, $1, $2, stage, rate, $4, m, r
+	}'
+    done
+done
+
+exit $status
@@ -0,0 +1,185 @@
+#!/usr/bin/env python
+#
+# gentcptrace.py -- generate a synthetic TCP trace for benchmarking
+#
+# Writes an IPSummaryDump file, readable by FromIPSummaryDump, containing
+# many overlapping TCP connections as seen by a passive monitor between the
+# sender and the receiver.  Loss, reordering, SACK use and connection length
+# are controlled by options, and the output depends only on the options and
+# the random seed.
+
+from __future__ import print_function
+import sys, random, getopt
+
+MSS = 1460
+
+def usage():
+    print("""Usage: gentcptrace.py [OPTIONS] > TRACE
+  -n, --flows N          generate N connections (default 1000)
+  -l, --loss P           drop probability per data segment (default 0)
+  -r, --reorder P        probability a segment swaps with its successor (default 0)
+  -s, --sack P           fraction of connections that negotiate SACK (default 0)
+  -d, --length DIST      connection length in segments: fixed:N, exp:MEAN,
+                         or pareto:MEAN (default exp:40)
+  -a, --arrival RATE     connection arrivals per second (default 100)
+  -w, --window N         sender window in segments (default 16)
+  -R, --rtt SECONDS      round-trip time (default 0.1)
+  -S, --seed N           random seed (default 1)""", file=sys.stderr)
+    sys.exit(1)
+
+def conn_length(rng, dist):
+    kind, _, arg = dist.partition(':')
+    mean = float(arg or 40)
+    if kind == 'fixed':
+        return max(1, int(mean))
+    elif kind == 'exp':
+        return max(1, int(rng.expovariate(1.0 / mean)))
+    elif kind == 'pareto':
+        # shape 1.2 has a finite mean but a heavy tail
+        shape = 1.2
+        return max(1, int(rng.paretovariate(shape) * mean * (shape - 1) / shape))
+    else:
+        raise ValueError("bad length distribution '%s'" % dist)
+
+class Conn:
+    def __init__(self, rng, n, start, opts):
+        self.rng = rng
+        self.src = '10.%d.%d.%d' % ((n >> 16) & 255, (n >> 8) & 255, (n & 255) or 1)
+        self.dst = '192.168.%d.%d' % ((n >> 8) & 255, (n & 255) or 1)
+        self.sport = 1024 + n % 60000
+        self.dport = 80
+        self.sack = rng.random() < opts['sack']
+        self.iss = rng.randrange(1 << 32)
+        self.irs = rng.randrange(1 << 32)
+        self.start = start
+        self.nseg = conn_length(rng, opts['length'])
+        self.opts = opts
+        self.records = []
+
+    def data(self, t, seq, ack, flags='A', length=0, opt=None):
+        self.records.append((t, self.src, self.sport, self.dst, self.dport,
+                             (self.iss + seq) & 0xFFFFFFFF,
+                             (self.irs + ack) & 0xFFFFFFFF, flags, length, opt))
+
+    def ack(self, t, seq, ack, flags='A', opt=None):
+        self.records.append((t, self.dst, self.dport, self.src, self.sport,
+                             (self.irs + seq) & 0xFFFFFFFF,
+                             (self.iss + ack) & 0xFFFFFFFF, flags, 0, opt))
+
+    def generate(self):
+        rng, opts = self.rng, self.opts
+        rtt = opts['rtt']
+        half = rtt / 2
+        t = self.start
+        synopt = 'mss%d' % MSS + (';sackok' if self.sack else '')
+        self.data(t, 0, 0, 'S', 0, synopt)
+        self.ack(t + half, 0, 1, 'SA', synopt)
+        t += rtt
+        self.data(t, 1, 1)
+
+        # Segments are numbered from 0; segment i covers bytes
+        # [1 + i*MSS, 1 + (i+1)*MSS).  Lost segments are seen once by the
+        # monitor, then retransmitted after the receiver's dup acks return.
+        nseg = self.nseg
+        window = opts['window']
+        gap = rtt / window
+        received = set()
+        next_seg = 0
+        rcv_next = 0
+        while rcv_next < nseg:
+            burst = list(range(next_seg, min(next_seg + window, nseg)))
+            i = 0
+            while i < len(burst) - 1:
+                if rng.random() < opts['reorder']:
+                    burst[i], burst[i + 1] = burst[i + 1], burst[i]
+                    i += 1
+                i += 1
+            lost = []
+            for k, seg in enumerate(burst):
+                ts = t + k * gap
+                if seg in received:
+                    continue
+                self.data(ts, 1 + seg * MSS, 1, 'A', MSS)
+                if rng.random() < opts['loss']:
+                    lost.append(seg)
+                else:
+                    received.add(seg)
+                    while rcv_next in received:
+                        rcv_next += 1
+                    self.ack(ts + half, 1, 1 + rcv_next * MSS, 'A', self.sack_opt(received, rcv_next))
+            next_seg = max(next_seg, max(burst) + 1) if burst else next_seg
+            t += max(rtt, len(burst) * gap)
+            for seg in lost:
+                # fast retransmit, one RTT after the loss was signalled
+                self.data(t, 1 + seg * MSS, 1, 'A', MSS)
+                received.add(seg)
+                while rcv_next in received:
+                    rcv_next += 1
+                self.ack(t + half, 1, 1 + rcv_next * MSS, 'A', self.sack_opt(received, rcv_next))
+                t += gap
+            if not burst and not lost:
+                break
+
+        fin = 1 + nseg * MSS
+        self.data(t, fin, 1, 'FA')
+        self.ack(t + half, 1, fin + 1, 'FA')
+        self.data(t + rtt, fin + 1, 2)
+        return self.records
+
+    def sack_opt(self, received, rcv_next):
+        if not self.sack:
+            return None
+        blocks = []
+        for seg in sorted(s for s in received if s > rcv_next):
+            l, r = 1 + seg * MSS, 1 + (seg + 1) * MSS
+            if blocks and blocks[-1][1] == l:
+                blocks[-1][1] = r
+            else:
+                blocks.append([l, r])
+        if not blocks:
+            return None
+        return ';'.join('sack%u-%u' % ((self.iss + l) & 0xFFFFFFFF, (self.iss + r) & 0xFFFFFFFF)
+                        for l, r in blocks[-3:])
+
+def main():
+    opts = {'flows': 1000, 'loss': 0.0, 'reorder': 0.0, 'sack': 0.0,
+            'length': 'exp:40', 'arrival': 100.0, 'window': 16,
+            'rtt': 0.1, 'seed': 1}
+    try:
+        optlist, args = getopt.getopt(sys.argv[1:], 'n:l:r:s:d:a:w:R:S:h',
+            ['flows=', 'loss=', 'reorder=', 'sack=', 'length=', 'arrival=',
+             'window=', 'rtt=', 'seed=', 'help'])
+    except getopt.GetoptError:
+        usage()
+    for o, a in optlist:
+        if o in ('-n', '--flows'): opts['flows'] = int(a)
+        elif o in ('-l', '--loss'): opts['loss'] = float(a)
+        elif o in ('-r', '--reorder'): opts['reorder'] = float(a)
+        elif o in ('-s', '--sack'): opts['sack'] = float(a)
+        elif o in ('-d', '--length'): opts['length'] = a
+        elif o in ('-a', '--arrival'): opts['arrival'] = float(a)
+        elif o in ('-w', '--window'): opts['window'] = max(1, int(a))
+        elif o in ('-R', '--rtt'): opts['rtt'] = float(a)
+        elif o in ('-S', '--seed'): opts['seed'] = int(a)
+        else: usage()
+    if args:
+        usage()
+
+    rng = random.Random(opts['seed'])
+    records = []
+    t = 1000000000.0
+    for n in range(opts['flows']):
+        t += rng.expovariate(opts['arrival'])
+        records.extend(Conn(rng, n + 1, t, opts).generate())
+    records.sort(key=lambda r: r[0])
+
+    out = sys.stdout
+    out.write('!IPSummaryDump 1.3\n')
+    out.write('!creator "gentcptrace.py %s"\n' % ' '.join(sys.argv[1:]))
+    out.write('!data timestamp ip_src sport ip_dst dport ip_proto tcp_seq tcp_ack tcp_flags payload_len tcp_opt\n')
+    for (ts, src, sport, dst, dport, seq, ack, flags, length, opt) in records:
+        out.write('%.6f %s %d %s %d T %u %u %s %d %s\n'
+                  % (ts, src, sport, dst, dport, seq, ack, flags, length, opt or '.'))
+
+if __name__ == '__main__':
+    main()
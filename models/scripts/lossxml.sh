@@ -1,15 +1,32 @@
 #! /bin/sh
 
 usage () {
-    echo "Usage: lossxml.sh FILE" 1>&2
+    echo "Usage: lossxml.sh [--config] [--jobs N] FILE" 1>&2
     exit 1
 }
 
 
 doconfig=0
-if test "$1" = '--config'; then 
-    shift 1; doconfig=1
-fi
+jobs=1
+while true; do
+    case "$1" in
+      --config)
+	shift 1; doconfig=1;;
+      --jobs)
+	test $# -ge 2 || usage
+	jobs="$2"; shift 2;;
+      --jobs=*)
+	jobs=`echo "$1" | sed 's/^--jobs=//'`; shift 1;;
+      *)
+	break;;
+    esac
+done
+
+case "$jobs" in
+  ''|*[!0-9]*|0)
+    echo "lossxml.sh: --jobs must be a positive integer" 1>&2
+    usage;;
+esac
 
 if test $# = 0; then
     usage
@@ -28,7 +45,7 @@ s/\.dump//'`
 from=''
 case $file in
   *.dump|*.dump.gz|*.bin)
-    from='FromDump("'"$file"'", FORCE_IP true, STOP true)';;
+    from='FromDump("'"$file"'", FORCE_IP true, STOP true, MMAP true)';;
   *.gz)
     text=`zcat "$wholefile" | head -c 2000`;;
   *)
@@ -42,7 +59,7 @@ if test -z "$from"; then
       [0-9]*)
         from='FromTcpdump("'"$file"'", STOP true)';;
       $hex_a1b2c3d4*|$hex_d4c3b2a1*)
-        from='FromDump("'"$file"'", FORCE_IP true, STOP true)';;
+        from='FromDump("'"$file"'", FORCE_IP true, STOP true, MMAP true)';;
       !*)
         from='FromIPSummaryDump("'"$file"'", STOP true)';;
       *)
@@ -53,22 +70,96 @@ fi
 
 shift 1
 
-config="
+# makeconfig OUTPUT [PARTITION ORDER]
+# With PARTITION, only flows whose aggregate number is PARTITION modulo
+# $jobs are analyzed, and the order in which AggregateIPFlows deleted them is
+# written to ORDER.  Every partition runs AggregateIPFlows over the whole
+# trace, so aggregate numbers and deletion order agree across partitions.
+makeconfig () {
+    if test -n "$2"; then
+	partition="
+    -> AggregatePartition($jobs, $2, NOTIFIER aipf, ORDER $3)"
+    else
+	partition=''
+    fi
+    if test -z "$2" -o "$2" = 0; then
+	progress="
+ProgressBar(fd.filepos, fd.filesize, BANNER '$dir$base')"
+    else
+	progress=''
+    fi
+    echo "
 require(models)
 fd :: $from
-    -> aipf :: AggregateIPFlows
+    -> aipf :: AggregateIPFlows$partition
     -> IPFilter(0 tcp || icmp)
-    -> loss :: CalculateTCPLossEvents(TRACEINFO $base.xml, /*FLOWDUMPS tifd,*/ SOURCE fd, IP_ID false, NOTIFIER aipf, ACKCAUSALITY true, UNDELIVERED true)
+    -> loss :: CalculateTCPLossEvents(TRACEINFO $1, /*FLOWDUMPS tifd,*/ SOURCE fd, IP_ID false, NOTIFIER aipf, ACKCAUSALITY true, UNDELIVERED true)
     // -> tifd :: ToIPFlowDumps($base.dir, NOTIFIER aipf, TCP_OPT true, TCP_WINDOW true)
     -> Discard;
-
-ProgressBar(fd.filepos, fd.filesize, BANNER '$dir$base')
+$progress
 DriverManager(wait, write loss.clear, /*write tifd.clear,*/ stop)
 "
+}
+
+# mergexml OUTPUT ORDERFILES -- PARTFILES...
+# Concatenates the partitions' <flow> elements under the first partition's
+# <trace> header.  CalculateTCPLossEvents writes a flow when AggregateIPFlows
+# deletes its aggregate, so flows are merged in deletion order, as a single
+# process would have written them.  Flows still open at the end of the trace
+# have no deletion number and come last, by aggregate number; a single
+# process writes those in hash table order.
+mergexml () {
+    out="$1"; shift 1
+    orders=''
+    while test "$1" != --; do
+	orders="$orders $1"; shift 1
+    done
+    shift 1
+    {
+	sed -n '/^<flow /q; /^<\/trace>/d; p' "$1"
+	{ cat $orders; echo '--'; cat "$@"; } \
+	    | awk 'BEGIN		{ inorder = 1 }
+		   inorder && $1 == "--" { inorder = 0; next }
+		   inorder		{ seq[$1] = $2; next }
+		   /^<flow /		{ agg = $2; gsub(/[^0-9]/, "", agg); inflow = 1
+					  if (agg in seq) key = "0\t" seq[agg]
+					  else key = "1\t" agg }
+		   inflow		{ printf "%s\t%d\t%s\n", key, NR, $0 }
+		   /^<\/flow>/		{ inflow = 0 }' \
+	    | sort -t '	' -k1,1n -k2,2n -k3,3n | cut -f4-
+	echo '</trace>'
+    } > "$out"
+}
 
-if test $doconfig = 1; then 
-    echo "$config"
+if test $jobs = 1; then
+    if test $doconfig = 1; then
+	makeconfig $base.xml
+    else
+	cd $dir || { echo "$!\n" 1>&2; exit 1; }
+	click -e "`makeconfig $base.xml`"
+    fi
+elif test $doconfig = 1; then
+    i=0
+    while test $i -lt $jobs; do
+	echo "// partition $i of $jobs"
+	makeconfig $base.$i.xml $i $base.$i.order
+	i=`expr $i + 1`
+    done
 else
     cd $dir || { echo "$!\n" 1>&2; exit 1; }
-    click -e "$config"
+    i=0; parts=''; orders=''; pids=''
+    while test $i -lt $jobs; do
+	click -e "`makeconfig $base.$i.xml $i $base.$i.order`" &
+	pids="$pids $!"; parts="$parts $base.$i.xml"; orders="$orders $base.$i.order"
+	i=`expr $i + 1`
+    done
+    status=0
+    for pid in $pids; do
+	wait $pid || status=1
+    done
+    if test $status != 0; then
+	echo "lossxml.sh: a partition failed; leaving$parts$orders" 1>&2
+	exit 1
+    fi
+    mergexml $base.xml $orders -- $parts && rm -f $parts $orders
 fi
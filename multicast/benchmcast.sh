@@ -0,0 +1,156 @@
+#! /bin/sh
+
+# benchmcast.sh -- benchmark multicast forwarding at scale
+#
+# Fills IPMulticastTable and PIMForwardingTable, or their IPv6 counterparts,
+# with synthetic groups, receivers and SSM sources through their populate
+# handlers, then pushes packets from MulticastBenchSource or
+# IP6MulticastBenchSource through them.  Reports packets per second, wall
+# time and CPU cycles per packet, copies made, peak process memory, and the
+# memory the tables took over an otherwise identical run with empty tables.
+#
+# Needs a click built with the multicast and multicast6 packages installed.
+
+usage () {
+    echo "Usage: benchmcast.sh [--packets N] [--family ip4|ip6|both] [--workdir DIR] [SCALE...]" 1>&2
+    echo "Scales: small medium large ssm (default all)" 1>&2
+    exit 1
+}
+
+workdir="${TMPDIR:-/tmp}/benchmcast.$$"
+keepwork=0
+packets=1000000
+families="ip4 ip6"
+
+while test $# -gt 0; do
+    case "$1" in
+      --packets)
+	test $# -ge 2 || usage
+	packets="$2"; shift 2;;
+      --family)
+	test $# -ge 2 || usage
+	case "$2" in
+	  ip4|ip6) families="$2";;
+	  both) families="ip4 ip6";;
+	  *) usage;;
+	esac
+	shift 2;;
+      --workdir)
+	test $# -ge 2 || usage
+	workdir="$2"; keepwork=1; shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+scales="$*"
+test -z "$scales" && scales="small medium large ssm"
+
+# scaleopts SCALE -- "groups receivers sources neighbors" for SCALE
+scaleopts () {
+    case "$1" in
+      small)	echo "100 10 1 2";;
+      medium)	echo "10000 10 4 2";;
+      large)	echo "100000 10 4 2";;
+      ssm)	echo "10000 50 16 4";;
+      *)	return 1;;
+    esac
+}
+
+for s in $scales; do
+    scaleopts $s >/dev/null || { echo "benchmcast.sh: unknown scale '$s'" 1>&2; usage; }
+done
+
+mkdir -p "$workdir" || exit 1
+test $keepwork = 1 || trap 'rm -rf "$workdir"' 0
+
+if test -x /usr/bin/time && /usr/bin/time -f '%e' true >/dev/null 2>&1; then
+    timecmd='/usr/bin/time -f %e:%M -o'
+else
+    timecmd=''
+fi
+
+# runclick NAME CONFIG
+# Runs CONFIG, leaving its output in $workdir/NAME.out and "seconds maxrss"
+# in $workdir/NAME.time.
+runclick () {
+    if test -n "$timecmd"; then
+	$timecmd "$workdir/$1.time.raw" click -e "$2" > "$workdir/$1.out" || return 1
+	sed 's/:/ /' "$workdir/$1.time.raw" > "$workdir/$1.time"
+    else
+	click -e "$2" > "$workdir/$1.out" || return 1
+	echo "- -" > "$workdir/$1.time"
+    fi
+}
+
+# makeconfig FAMILY GROUPS RECEIVERS SOURCES NEIGHBORS POPULATE
+# With POPULATE 0 the tables are left empty.
+makeconfig () {
+    if test $6 = 1; then
+	populate="write mct.populate $2 $3 $4, write pft.populate $2 $4 $5,"
+    else
+	populate=""
+    fi
+    case "$1" in
+      ip4)
+	echo "
+require(multicast)
+src :: MulticastBenchSource($2, $4, LIMIT $packets, STOP true, ACTIVE false)
+    -> mct :: IPMulticastTable(1);
+mct[0] -> c0 :: Counter -> Discard;
+mct[1] -> pft :: PIMForwardingTable(10.0.0.1) -> c1 :: Counter -> Discard;";;
+      ip6)
+	echo "
+require(multicast6)
+src :: IP6MulticastBenchSource($2, $4, LIMIT $packets, STOP true, ACTIVE false)
+    -> mct :: IP6MulticastTable;
+mct[0] -> c0 :: Counter -> Discard;
+mct[1] -> pft :: IP6PIMForwardingTable(fe80::1) -> c1 :: Counter -> Discard;";;
+    esac
+    echo "DriverManager($populate write src.active true, wait,
+    print c0.count, print c1.count, print src.rate, print src.latency, stop)"
+}
+
+# field FILE KEY -- value of the "KEY value" line in FILE
+field () {
+    awk -v k="$2" '$1 == k { print $2; exit }' "$1"
+}
+
+status=0
+printf '%-4s %-7s %7s %5s %4s %9s %10s %10s %7s %7s %7s %10s %10s %10s\n' \
+    fam scale groups recv src packets copies pkts/sec ns/pkt cyc/pkt p99 maxrss_kB table_kB kB/group
+
+for f in $families; do
+    for s in $scales; do
+	set x `scaleopts $s`
+	g=$2; r=$3; src=$4; n=$5
+
+	if ! runclick $f.$s.empty "`makeconfig $f $g $r $src $n 0`" \
+	    || ! runclick $f.$s "`makeconfig $f $g $r $src $n 1`"; then
+	    echo "benchmcast.sh: $f $s: click failed" 1>&2
+	    status=1
+	    continue
+	fi
+
+	out="$workdir/$f.$s.out"
+	copies=`sed -n 1,2p "$out" | awk '{ n += $1 } END { print n }'`
+	sent=`field "$out" packets`
+	rate=`field "$out" rate`
+	sec=`field "$out" seconds`
+	mean=`field "$out" mean`
+	p99=`field "$out" p99`
+	maxrss=`awk '{ print $2 }' "$workdir/$f.$s.time"`
+	emptyrss=`awk '{ print $2 }' "$workdir/$f.$s.empty.time"`
+
+	echo "$sent $copies $rate $sec $mean $p99 $maxrss $emptyrss" | awk -v f=$f -v s=$s -v g=$g -v r=$r -v src=$src '{
+	    nspkt = ($1 > 0 ? $4 * 1e9 / $1 : 0);
+	    if ($7 == "-" || $8 == "-") { table = "-"; pergroup = "-" }
+	    else { table = $7 - $8; if (table < 0) table = 0; pergroup = sprintf("%.2f", table / g) }
+	    printf "%-4s %-7s %7d %5d %4d %9d %10d %10.0f %7.0f %7d %7d %10s %10s %10s\n", f, s, g, r, src, $1, $2, $3, nspkt, $5, $6, $7, table, pergroup
+	}'
+    done
+done
+
+exit $status
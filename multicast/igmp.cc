@@ -24,10 +24,14 @@
 #include "ipmulticasttable.hh"
 #include <click/error.hh>
 #include <click/packet_anno.hh>
+#include <click/straccum.hh>
 #include <clicknet/ip.h>
 #include "debug.hh"
 
-IGMP::IGMP(): _igmptimer(this)
+IGMP::IGMP()
+  : _timers(), _general_countdown(0), _pending_head(0),
+	_group_expired(0), _source_expired(0), _queries_sent(0), _queries_merged(0),
+	_igmptimer(this)
 {
 }
 
@@ -43,18 +47,33 @@ IGMP::~IGMP()
 int
 IGMP::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-  if (conf.size() != 1)
-    return errh->error("wrong number of arguments; expected 'IGMP(MulticastTable element)'");
+  Element *e;
+  _query_interval = 125000;
+  _query_response_interval = 10000;
+  _last_member_query_interval = 1000;
+  _robustness = 2;
+  _tick = 100;
+  _max_queries = 8;
+  if (cp_va_kparse(conf, this, errh,
+		   "MCASTTABLE", cpkP+cpkM, cpElement, &e,
+		   "QUERY_INTERVAL", 0, cpUnsigned, &_query_interval,
+		   "QUERY_RESPONSE_INTERVAL", 0, cpUnsigned, &_query_response_interval,
+		   "LAST_MEMBER_QUERY_INTERVAL", 0, cpUnsigned, &_last_member_query_interval,
+		   "ROBUSTNESS", 0, cpUnsigned, &_robustness,
+		   "TICK", 0, cpUnsigned, &_tick,
+		   "MAX_QUERIES", 0, cpUnsigned, &_max_queries,
+		   cpEnd) < 0)
+    return -1;
 
   // get MulticastTable element
-  Element *e = cp_element(conf[0], this, errh);
-  if (!e) {
-    return -1;
-  }
-  else {
-	MCastTable = (IPMulticastTable *)e->cast("IPMulticastTable");
-	return 0;
-  }
+  MCastTable = (IPMulticastTable *)e->cast("IPMulticastTable");
+  if (!MCastTable)
+	return errh->error("%s is not an IPMulticastTable", e->name().c_str());
+  if (_tick == 0)
+	return errh->error("TICK must be positive");
+  if (_robustness == 0)
+	return errh->error("ROBUSTNESS must be positive");
+  return 0;
 }
 
 /*******************************************************************************************
@@ -65,51 +84,10 @@ IGMP::configure(Vector<String> &conf, ErrorHandler *errh)
 int IGMP::initialize(ErrorHandler *errh)
 {
   _igmptimer.initialize(this);
-  _igmptimer.schedule_after_msec(INTERVAL);
-
-  /*****************************************************************************************
-  // ** for performance tests, add a number of groups and receivers ***
-  IPAddress group;
-  //IP6Address recv=(IP6Address(0));
-  IPAddress src;
-  //  recv=IPAddress("192.168.30.2");
-
-    for(unsigned int i=1; i < 50001; i++)
-	{
-	  MCastTable->addgroup(IPAddress(i));
-	  //	  MCastTable->joingroup(IPAddress(i), IPAddress(~i));  
-	}
-
-  group=IPAddress("232.2.2.2");
-  MCastTable->addgroup(group);
-
-
-  for(unsigned int i; i < 10; i++)
-	{
-	  	  MCastTable->joingroup(IPAddress(i), group, 1);  
-
-	}
-
-
-  group=IPAddress("232.2.2.3");
-  MCastTable->addgroup(group);
-
-
-  for(unsigned int i=1; i < 10; i++)
-	{
-	  	  MCastTable->joingroup(IPAddress(i), group, 1);  
-	}
-
-  group=IPAddress("232.2.2.1");
-  MCastTable->addgroup(group);
-
-
-  for(unsigned int i; i < 10; i++)
-	{
-	  	  MCastTable->joingroup(IPAddress(i), group,1);  
+  _igmptimer.schedule_after_msec(_tick);
 
-	} 
-	****************************************** end of performance test *********************/
+  // for performance tests, fill the table with IPMulticastTable's populate
+  // handler, see benchmcast.sh
   return 0;
 }
 
@@ -146,6 +124,7 @@ IGMP::simple_action(Packet *p)
 	  }
 	  MCastTable->addgroup(ip->ip_dst);
 	  MCastTable->joingroup(IPAddress(ip->ip_src), IPAddress(ip->ip_dst), PAINT_ANNO(p));
+	  refresh(IPAddress(ip->ip_src), IPAddress(ip->ip_dst));
 	  break;
 	  
 	case 0x16:
@@ -154,6 +133,7 @@ IGMP::simple_action(Packet *p)
 	  }
 	  MCastTable->addgroup(ip->ip_dst);
 	  MCastTable->joingroup(IPAddress(ip->ip_src), IPAddress(ip->ip_dst), PAINT_ANNO(p));
+	  refresh(IPAddress(ip->ip_src), IPAddress(ip->ip_dst));
 	  break;
 	  
 	case 0x17:
@@ -162,6 +142,7 @@ IGMP::simple_action(Packet *p)
 	  }
 	  v1andv2message = (igmpv1andv2message *) igmpmessage;
 	  MCastTable->leavegroup(IPAddress(ip->ip_src), IPAddress(v1andv2message->group) );
+	  _timers.cancel(MembershipKey<IPAddress>(IPAddress(ip->ip_src), IPAddress(v1andv2message->group)));
 	  break;
 	
 	case 0x22:
@@ -180,6 +161,10 @@ IGMP::simple_action(Packet *p)
 			// host answered to a query, keepalive timer can be restarted, to be implemented in host
 			debug_msg("MODE_IS_INCLUDE"); //recv group mode
 			MCastTable->set_receiver_mode(IPAddress(ip->ip_src), IPAddress(v3report->grouprecords[grouprecord_counter].multicast_address), INCLUDEMODE);
+			for(unsigned int source_counter=0; source_counter!=ntohs(v3report->grouprecords[grouprecord_counter].no_of_sources); source_counter++)
+			  refresh_source(IPAddress(ip->ip_src),
+							 IPAddress(v3report->grouprecords[grouprecord_counter].multicast_address),
+							 IPAddress(v3report->grouprecords[grouprecord_counter].sources[source_counter]));
 			break; 
 
 		  case 0x02:
@@ -228,6 +213,9 @@ IGMP::simple_action(Packet *p)
 			break;
 			debug_msg("Unknown type in IGMP grouprecord or bad group record pointer");
 		  }
+		  // every record but BLOCK_OLD_SOURCES shows the receiver is still there
+		  if(v3report->grouprecords[grouprecord_counter].type <= 0x05)
+			refresh(IPAddress(ip->ip_src), IPAddress(v3report->grouprecords[grouprecord_counter].multicast_address));
 		}
 	  break;
 	  
@@ -292,6 +280,7 @@ IGMP::change_to_include_mode(IPAddress recv,
 		  MCastTable->addsource(recv,
 								group,
 								IPAddress(ntohl(v3report->grouprecords[groupcounter].sources[source_counter])));
+		  refresh_source(recv, group, IPAddress(v3report->grouprecords[groupcounter].sources[source_counter]));
 		  query(group,
 				IPAddress(ntohl(v3report->grouprecords[groupcounter].sources[source_counter])));
 		}
@@ -322,6 +311,7 @@ IGMP::allow_new_sources(IPAddress recv, IPAddress group, unsigned short no_of_so
   for(unsigned int source_counter=0; source_counter!=no_of_sources; source_counter++)
 	{
 	  MCastTable->addsource(recv, group, IPAddress(ntohl(v3report->grouprecords[groupcounter].sources[source_counter])));
+	  refresh_source(recv, group, IPAddress(v3report->grouprecords[groupcounter].sources[source_counter]));
 	  query(group, IPAddress(ntohl(v3report->grouprecords[groupcounter].sources[source_counter])));
 	}
   if(no_of_sources==0)  query(group, IPAddress("0.0.0.0"));
@@ -343,8 +333,9 @@ IGMP::block_old_sources(IPAddress recv, IPAddress group, unsigned short no_of_so
 	  MCastTable->delsource(recv,
 							group,
 							IPAddress(v3report->grouprecords[groupcounter].sources[source_counter]));
+	  _timers.cancel(MembershipKey<IPAddress>(recv, group, IPAddress(v3report->grouprecords[groupcounter].sources[source_counter])));
 	  query(group,
-			IPAddress(v3report->grouprecords[groupcounter].sources[source_counter]));
+			IPAddress(ntohl(v3report->grouprecords[groupcounter].sources[source_counter])));
 	}
    if(no_of_sources==0) query(group, IPAddress("0.0.0.0"));
    return true;
@@ -357,10 +348,86 @@ IGMP::block_old_sources(IPAddress recv, IPAddress group, unsigned short no_of_so
  * query is called to generate query messages. all arriving changes of state of an         *
  * interface are followed by a group/source specific query                                 *
  *                                                                                         *
+ * queries are queued: requests for a group that is already queued are merged into it,    *
+ * and run_timer sends at most MAX_QUERIES per tick                                        *
  *                                                                                         *
  *******************************************************************************************/
 void
 IGMP::query(IPAddress group, IPAddress source)
+{
+  pendingquery *pq = _pending.findp(group);
+  if(pq) _queries_merged++;
+  else {
+	_pending.insert(group, pendingquery());
+	_pending_order.push_back(group);
+	pq = _pending.findp(group);
+  }
+  IPAddress a=IPAddress("0.0.0.0");
+  if(source==a.addr()) pq->group=true;
+  else {
+	for(int i=0; i<pq->sources.size(); ++i)
+	  if(pq->sources[i]==source) return;
+	pq->sources.push_back(source);
+  }
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * flush_queries sends queued queries, oldest first, until MAX_QUERIES are out;            *
+ * a group with more sources than fit in one query is sent in several                      *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+IGMP::flush_queries()
+{
+  uint32_t sent=0;
+  while(_pending_head < _pending_order.size() && sent < _max_queries) {
+	IPAddress group=_pending_order[_pending_head];
+	pendingquery *pq = _pending.findp(group);
+	if(pq->group) {
+	  send_query(group, pq->sources, 0, 0);
+	  pq->group=false;
+	  sent++;
+	}
+	while(pq->sources.size() && sent < _max_queries) {
+	  int n = pq->sources.size() < MAX_QUERY_SOURCES ? pq->sources.size() : MAX_QUERY_SOURCES;
+	  send_query(group, pq->sources, pq->sources.size()-n, n);
+	  pq->sources.resize(pq->sources.size()-n);
+	  sent++;
+	}
+	if(pq->group || pq->sources.size()) break;
+	_pending.remove(group);
+	_pending_head++;
+  }
+  if(_pending_head == _pending_order.size()) {
+	_pending_order.clear();
+	_pending_head=0;
+  }
+}
+
+// RFC 3376 4.1.1: codes from 128 on are a floating point value
+static unsigned char
+igmp_code(uint32_t value)
+{
+  if(value < 128) return value;
+  uint32_t mant=value >> 3;
+  int exp=0;
+  while(mant > 0x1F && exp < 7) {
+	mant >>= 1;
+	exp++;
+  }
+  if(mant > 0x1F) return 0xFF;
+  return 0x80 | (exp << 4) | (mant & 0x0F);
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * send_query builds a query for the group with n of the sources, starting at first        *
+ * a zero group makes a general query                                                      *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+IGMP::send_query(IPAddress group, const Vector<IPAddress> &sources, int first, int n)
 {
   debug_msg("igmp query");
   WritablePacket *q = 0;
@@ -368,8 +435,10 @@ IGMP::query(IPAddress group, IPAddress source)
   void *igmpbegin;
   igmpv3querie *igp;
   static int id = 1;
+  int igmplen = sizeof(*igp) - sizeof(igp->sources) + n*sizeof(igp->sources[0]);
 
-  q = Packet::make(sizeof(*nip)+sizeof(*igp));
+  q = Packet::make(sizeof(*nip)+igmplen);
+  if(!q) return;
 
   // set IP header values...
   nip = reinterpret_cast<click_ip *>(q->data());
@@ -384,12 +453,10 @@ IGMP::query(IPAddress group, IPAddress source)
   // this is now being done by the FixIPSource element
   //  nip->ip_src = IPAddress("192.168.30.6");
  
-  // destination IPAddress for general queries is 224.0.0.22
-  // 224.0.0.1 should work as well but messages are also recieved by hosts,
-  // not only routers - useful for debugging
+  // general queries go to all systems (224.0.0.1), group specific queries to the group itself
   IPAddress a=IPAddress("0.0.0.0");
-  if(source==a.addr())	  nip->ip_dst = IPAddress("224.0.0.22");
-  else   nip->ip_dst = IPAddress("224.0.0.1");
+  if(group==a.addr())	  nip->ip_dst = IPAddress("224.0.0.1");
+  else   nip->ip_dst = group;
 
   nip->ip_hl = sizeof(click_ip) >> 2;
   q->set_ip_header(nip, nip->ip_hl << 2);
@@ -399,26 +466,23 @@ IGMP::query(IPAddress group, IPAddress source)
   igmpbegin = (unsigned char *)q->data()+sizeof(click_ip);
   igp=(igmpv3querie *) igmpbegin;
   igp->type=0x11;
-  // the responsecode may vary, the value 1 is ok
-  igp->responsecode=1;
+  // the response time in tenths of a second
+  if(group==a.addr()) igp->responsecode=igmp_code(_query_response_interval/100);
+  else igp->responsecode=igmp_code(_last_member_query_interval/100);
   // in a general query the group address is set to 0
   igp->group=group;
-  // to create group specific queries just set a group address
-  // IGMP capable hosts should respond to this - useful for debugging
-  // igp->group=(IPAddress("232.2.2.2").addr());
   
   // querier robustness value (qrv) instructs the host to send all messages 
   // qrv times
-  igp->s_and_qrv=0x03; 
-  igp->qqic=0x00;
+  igp->s_and_qrv=(_robustness > 7 ? 0 : _robustness); 
+  igp->qqic=igmp_code(_query_interval/1000);
 
-  if(source==a.addr())	igp->no_of_sources=0x00;
-  else {
-	igp->no_of_sources=htons(0x0001);
-	igp->sources[0]=htonl(source.addr());
-  }
+  igp->no_of_sources=htons(n);
+  for(int i=0; i<n; ++i)
+	igp->sources[i]=htonl(sources[first+i].addr());
 
   igp->checksum=0x0000;
+  igp->checksum=click_in_cksum((unsigned char *)igp, igmplen);
  
   // finish off IP header
   nip->ip_len = htons(q->length());
@@ -427,33 +491,66 @@ IGMP::query(IPAddress group, IPAddress source)
   q->timestamp_anno().assign_now();
   SET_FIX_IP_SRC_ANNO(q, true);
 
-  // calculate checksum like described in RFC 1071
-  
-  unsigned int sum;
-  sum=0;
-  int count;
-  count=sizeof(*igp);
-  unsigned short *datapoint=(unsigned short *)q->data()+10;
-
-  while(count > 1) {
-	sum += *datapoint++;
-	count -= 2;
-  }
- 
-  if(count > 0) sum += *(unsigned char *)datapoint;
-  while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+  _queries_sent++;
+  output(1).push(q);  
+}
 
-  igp->checksum=~sum;  
+/*******************************************************************************************
+ *                                                                                         *
+ * refresh restarts the group timer of a receiver that reported on a group                 *
+ * refresh_source restarts the timer of one of its sources, in INCLUDE mode only           *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+IGMP::refresh(IPAddress recv, IPAddress group)
+{
+  if(!MCastTable->multicastgroups.find_receiver(recv, group)) return;
+  uint32_t gmi = _robustness*_query_interval + _query_response_interval;
+  _timers.schedule(MembershipKey<IPAddress>(recv, group), ticks(gmi));
+}
 
-  output(1).push(q);  
+void
+IGMP::refresh_source(IPAddress recv, IPAddress group, IPAddress source)
+{
+  IPMulticastTable::receiver *r = MCastTable->multicastgroups.find_receiver(recv, group);
+  if(!r || r->mode!=INCLUDEMODE || r->find_source(source) < 0) return;
+  uint32_t gmi = _robustness*_query_interval + _query_response_interval;
+  _timers.schedule(MembershipKey<IPAddress>(recv, group, source), ticks(gmi));
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * expire is called for each timer that ran out                                            *
+ *                                                                                         *
+ * an expired source is deleted; an expired group timer drops the receiver from the group, *
+ * unless it is in INCLUDE mode with running source timers (RFC 3376 6.5)                  *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+IGMP::expire(const MembershipKey<IPAddress> &k)
+{
+  IPMulticastTable::receiver *r = MCastTable->multicastgroups.find_receiver(k.recv, k.group);
+  if(!r) return;
+  if(!k.group_timer()) {
+	// source timers only run in INCLUDE mode
+	if(r->mode!=INCLUDEMODE) return;
+	_source_expired++;
+	MCastTable->delsource(k.recv, k.group, k.source);
+	return;
+  }
+  if(r->mode==INCLUDEMODE)
+	for(int i=0; i<r->sources.size(); ++i)
+	  if(_timers.running(MembershipKey<IPAddress>(k.recv, k.group, r->sources[i]))) return;
+  _group_expired++;
+  MCastTable->leavegroup(k.recv, k.group);
 }
 
 /*******************************************************************************************
  *                                                                                         *
- * run_timer is called continually, it reschedules itself                                  *
+ * run_timer is called every tick, it reschedules itself                                   *
  *                                                                                         *
- * for now it calls the function that generates general queries                            *
- * other queries might be added in future releases                                         *
+ * it expires memberships, queues a general query every QUERY_INTERVAL                     *
+ * and sends the queued queries                                                            *
  *                                                                                         *
  *******************************************************************************************/
 void
@@ -461,8 +558,75 @@ IGMP::run_timer(Timer *)
 {
   //  debug_msg("IGMP run timer .X.X.");  
   //  MCastTable->printgroups(true);
-  //  query(IPAddress("0.0.0.0"), IPAddress("0.0.0.0"));
-  _igmptimer.reschedule_after_msec(INTERVAL);
+  Vector<MembershipKey<IPAddress> > expired;
+  _timers.tick(expired);
+  for(int i=0; i<expired.size(); ++i)
+	expire(expired[i]);
+
+  if(_query_interval) {
+	if(_general_countdown == 0) {
+	  query(IPAddress("0.0.0.0"), IPAddress("0.0.0.0"));
+	  _general_countdown=ticks(_query_interval);
+	}
+	_general_countdown--;
+  }
+  flush_queries();
+  _igmptimer.reschedule_after_msec(_tick);
+}
+
+String
+IGMP::print_memberships()
+{
+  StringAccum sa;
+  int receivers=0, sources=0;
+  for(int i=0; i<MCastTable->multicastgroups.size(); ++i) {
+	const IPMulticastTable::MulticastGroup *g = MCastTable->multicastgroups.group(i);
+	receivers += g->receivers.size();
+	for(int r=0; r<g->receivers.size(); ++r)
+	  sources += g->receivers[r].sources.size();
+  }
+  sa << "groups " << MCastTable->multicastgroups.size() << "\n";
+  sa << "receivers " << receivers << "\n";
+  sa << "sources " << sources << "\n";
+  return sa.take_string();
+}
+
+String
+IGMP::print_timers()
+{
+  StringAccum sa;
+  sa << "timers " << _timers.size() << "\n";
+  for(int l=0; l<MCASTTIMER_LEVELS; ++l)
+	sa << "wheel" << l << " " << _timers.level_size(l) << "\n";
+  sa << "queued_queries " << (_pending_order.size()-_pending_head) << "\n";
+  sa << "group_expired " << _group_expired << "\n";
+  sa << "source_expired " << _source_expired << "\n";
+  sa << "queries_sent " << _queries_sent << "\n";
+  sa << "queries_merged " << _queries_merged << "\n";
+  return sa.take_string();
+}
+
+enum { H_MEMBERSHIPS, H_TIMERS };
+
+static String
+igmp_read_handler(Element *e, void *thunk)
+{
+  IGMP *igmp = (IGMP *)e;
+  switch ((intptr_t)thunk) {
+  case H_MEMBERSHIPS:
+	return igmp->print_memberships();
+  case H_TIMERS:
+	return igmp->print_timers();
+  default:
+	return String();
+  }
+}
+
+void
+IGMP::add_handlers()
+{
+  add_read_handler("memberships", igmp_read_handler, (void *)H_MEMBERSHIPS);
+  add_read_handler("timers", igmp_read_handler, (void *)H_TIMERS);
 }
 
 EXPORT_ELEMENT(IGMP)
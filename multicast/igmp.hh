@@ -2,12 +2,14 @@
 #define IGMP_HH
 #include "protocoldefinitions.hh"
 #include "ipmulticasttable.hh"
+#include "mcasttimer.hh"
 #include <click/timer.hh>
 #include <click/element.hh>
+#include <click/hashmap.hh>
 
 /*
 =c
-IGMP(IPMulticastTable)
+IGMP(IPMulticastTable, [I<KEYWORDS>])
 
 =s IPv4 Multicast
 
@@ -18,6 +20,60 @@ This element checks whether an arriving IGMP message is valid (checksum) and tak
 
 It manages the databank of listeners kept in the IPMulticastTable element.
 
+Every report starts or restarts the receiver's group timer and the timers of
+the sources it allows, to the group membership interval (ROBUSTNESS times
+QUERY_INTERVAL plus QUERY_RESPONSE_INTERVAL).  When a group timer expires the
+receiver leaves the group, unless it is in INCLUDE mode and still has sources;
+when a source timer expires the source is deleted.  The timers are kept on a
+hierarchical timing wheel advanced every TICK, so expiring a membership costs
+the same however many are held.
+
+General queries are sent every QUERY_INTERVAL.  Group and group-and-source
+specific queries are queued rather than sent at once: requests for the same
+group are merged into one query listing all their sources, and at most
+MAX_QUERIES queries leave per TICK.
+
+Keyword arguments are:
+
+=over 8
+
+=item QUERY_INTERVAL
+
+Milliseconds between general queries.  0 disables general queries.  Defaults
+to 125000.
+
+=item QUERY_RESPONSE_INTERVAL
+
+Milliseconds hosts may take to answer a general query.  Defaults to 10000.
+
+=item LAST_MEMBER_QUERY_INTERVAL
+
+Milliseconds hosts may take to answer a group specific query.  Defaults to
+1000.
+
+=item ROBUSTNESS
+
+Unsigned integer, the querier robustness variable.  Defaults to 2.
+
+=item TICK
+
+Milliseconds per timer tick.  Defaults to 100.
+
+=item MAX_QUERIES
+
+Unsigned integer.  Maximum number of queries sent per TICK.  Defaults to 8.
+
+=back
+
+=h memberships read-only
+
+Number of groups, receivers and receiver sources in the IPMulticastTable.
+
+=h timers read-only
+
+Running group and source timers, with the number on each wheel, queued
+queries, and counters of expired timers and of sent and merged queries.
+
 =e
 mct::MulticastTable("pimctl");
 
@@ -46,12 +102,22 @@ class IGMP : public Element { public:
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
   Packet *simple_action(Packet *);
+  void add_handlers();
+
+  String print_memberships();
+  String print_timers();
 
 private:
 
   void query(IPAddress, IPAddress);
   //  void generalquery();
   void run_timer(Timer *);
+  void send_query(IPAddress, const Vector<IPAddress> &, int, int);
+  void flush_queries();
+  void refresh(IPAddress, IPAddress);
+  void refresh_source(IPAddress, IPAddress, IPAddress);
+  void expire(const MembershipKey<IPAddress> &);
+  uint32_t ticks(uint32_t msec) const	{ return (msec + _tick - 1) / _tick; }
   bool change_to_include_mode(IPAddress, IPAddress, unsigned short, unsigned short, unsigned int);
   bool change_to_exclude_mode(IPAddress, IPAddress, unsigned short, unsigned short, unsigned int);
   bool allow_new_sources(IPAddress, IPAddress, unsigned short, unsigned short, unsigned int);  
@@ -70,7 +136,34 @@ private:
   igmpv1andv2message *v1andv2message;
   igmpv3report *v3report;
 
-  static const int INTERVAL = 4000; // RFC says 125000;
+  // queued group specific queries; a zero group is a general query
+  struct pendingquery {
+	bool group;                     // query the group itself
+	Vector<IPAddress> sources;      // query these sources of the group
+	pendingquery() : group(false) { }
+  };
+
+  enum { MAX_QUERY_SOURCES = 64 };
+
+  uint32_t _query_interval;
+  uint32_t _query_response_interval;
+  uint32_t _last_member_query_interval;
+  uint32_t _robustness;
+  uint32_t _tick;
+  uint32_t _max_queries;
+
+  MembershipTimers<IPAddress> _timers;
+  uint32_t _general_countdown;    // ticks until the next general query
+
+  HashMap<IPAddress, pendingquery> _pending;
+  Vector<IPAddress> _pending_order;
+  int _pending_head;
+
+  uint32_t _group_expired;
+  uint32_t _source_expired;
+  uint32_t _queries_sent;
+  uint32_t _queries_merged;
+
   Timer _igmptimer;
 };
 
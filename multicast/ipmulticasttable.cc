@@ -22,9 +22,11 @@
 #include <click/ipaddress.hh>
 #include <click/router.hh>
 #include <click/confparse.hh>
+#include <click/straccum.hh>
 #include "debug.hh"
 
 IPMulticastTable::IPMulticastTable()
+  : pimenable(false), no_of_interfaces(0), pPim(0)
 {
 }
 
@@ -61,26 +63,9 @@ IPMulticastTable::configure(Vector<String> &conf, ErrorHandler *errh)
   }
 }
 
-int
-IPMulticastTable::initialize(ErrorHandler *errh)
-{
-  bool b=false;
-
-  for(unsigned int i=0; i<no_of_interfaces; ++i) { 
-	interfaces.push_back(b);
-  }
-  return 0;
-}
-
 bool IPMulticastTable::addgroup(IPAddress group)
 {
-  MulticastGroup newgroup;
-  newgroup.group = group;
-  Vector<MulticastGroup>::iterator i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) { 
-	if(IPAddress((*i).group)==IPAddress(group)) return false;
-  }
-  multicastgroups.push_back(newgroup);
+  if(!multicastgroups.add_group(group)) return false;
   const unsigned char *p = group.data();
   debug_msg("IPMulticasttable: Added IP group address: %d.%d.%d.%d", p[0], p[1], p[2], p[3]);
 
@@ -95,36 +80,18 @@ bool IPMulticastTable::addgroup(IPAddress group)
  *******************************************************************************************/
 bool IPMulticastTable::joingroup(IPAddress recv, IPAddress group, unsigned int interface)
 {
-  receiver new_receiver;           // create new receiver struct
-  new_receiver.receiver=recv;      // initialize this new struct with receivers IP address
-
-  Vector<MulticastGroup>::iterator i;
-
-   for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
+  const unsigned char *p = group.data();
+  const unsigned char *p2 = recv.data();
 
-	if((*i).group.addr()==group.addr()) {
+  if(!multicastgroups.find(group)) return true;
 
-	  // search for duplicate entries
-	  
-	  Vector<receiver>::iterator a;
-	  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a) {
-		if( (*a).receiver.addr()==recv.addr() ) { 
-		  const unsigned char *p = group.data();
-		  const unsigned char *p2 = recv.data();
-		  debug_msg("IPMulticasttable: Duplicate request to add %d.%d.%d.%d to group %d.%d.%d.%d - ignored", p2[0], p2[1], p2[2], p2[3], p[0], p[1], p[2], p[3]);
-		  return false;  
-		}
-	  }
-	  const unsigned char *p = group.data();
-	  const unsigned char *p2 = recv.data();
-	  	  debug_msg("IPMulticasttable: Adding %d.%d.%d.%d to group %d.%d.%d.%d", p2[0], p2[1], p2[2], p2[3], p[0], p[1], p[2], p[3]);
-		  (*i).interface_id=interface;
-		  (*i).receivers.push_back(new_receiver); 
-	}
+  // duplicate entries are ignored
+  if(!multicastgroups.join(recv, group, interface)) {
+	debug_msg("IPMulticasttable: Duplicate request to add %d.%d.%d.%d to group %d.%d.%d.%d - ignored", p2[0], p2[1], p2[2], p2[3], p[0], p[1], p[2], p[3]);
+	return false;
   }
-   // printgroups(true);
+  debug_msg("IPMulticasttable: Adding %d.%d.%d.%d to group %d.%d.%d.%d", p2[0], p2[1], p2[2], p2[3], p[0], p[1], p[2], p[3]);
   return true;
-  //  multicastgroups[0].receivers.push_back(recv);
 }
 
 /*******************************************************************************************
@@ -135,47 +102,22 @@ bool IPMulticastTable::joingroup(IPAddress recv, IPAddress group, unsigned int i
  *******************************************************************************************/
 bool IPMulticastTable::leavegroup(IPAddress recv, IPAddress group)
 {
-  Vector<MulticastGroup>::iterator i;
-
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
-
-
-	if((*i).group.addr()==group.addr()) {
-	  debug_msg("IPMulticasttable: leavegroup found group");
-
-	  // search for duplicate entries
-	  
-	  Vector<receiver>::iterator a;
-	  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a) {
-		if( (*a).receiver.addr()==recv.addr() ) {
-		  const unsigned char *p = group.data();
-		  const unsigned char *p2 = recv.data();
-		  debug_msg("IPMulticasttable: Delete %d.%d.%d.%d from group %d.%d.%d.%d", 
-					p2[0], p2[1], p2[2], p2[3], 
-					p[0], p[1], p[2], p[3]);
-		  (*i).receivers.erase(a);
-		  printgroups(true);
-
-
-		  // if no more receivers exist, the group is deleted
-		  if((*i).receivers.begin()==(*i).receivers.end()) {
-			// (XXX) send a listener query first
-			multicastgroups.erase(i);
-			debug_msg("IPMulticasttable: deleted group");
-			return true;
-		  }
-		  return true;  
-		}
-	  }
-	  const unsigned char *p = group.data();
-	  const unsigned char *p2 = recv.data();
-	  debug_msg("IPMulticasttable: %d.%d.%d.%d not found in group %d.%d.%d.%d - not deleted",
-				p2[0], p2[1], p2[2], p2[3],
-				p[0], p[1], p[2], p[3]);
-
-	}
+  const unsigned char *p = group.data();
+  const unsigned char *p2 = recv.data();
+
+  // if no more receivers exist, the group is deleted
+  // (XXX) send a listener query first
+  if(multicastgroups.leave(recv, group)) {
+	debug_msg("IPMulticasttable: Delete %d.%d.%d.%d from group %d.%d.%d.%d", 
+			  p2[0], p2[1], p2[2], p2[3], 
+			  p[0], p[1], p[2], p[3]);
+	printgroups(true);
+	return true;
   }
-
+  if(multicastgroups.find(group))
+	debug_msg("IPMulticasttable: %d.%d.%d.%d not found in group %d.%d.%d.%d - not deleted",
+			  p2[0], p2[1], p2[2], p2[3],
+			  p[0], p[1], p[2], p[3]);
   return false; 
 }
 
@@ -185,22 +127,18 @@ bool IPMulticastTable::leavegroup(IPAddress recv, IPAddress group)
  *                displays receivers in a group and their sources (if existing)            *
  *                                                                                         *
  *******************************************************************************************/
-bool IPMulticastTable::printreceiver(Vector<MulticastGroup>::iterator i)
+bool IPMulticastTable::printreceiver(const MulticastGroup *g)
 {
-  Vector<receiver>::iterator re;
-  for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re) {
-	const unsigned char *p = (*re).receiver.data();
-	Vector<IPAddress>::iterator a;
+  for(int re=0; re<g->receivers.size(); ++re) {
+	const receiver &r = g->receivers[re];
+	const unsigned char *p = r.addr.data();
 	debug_msg("IPMulticasttable: %d.%d.%d.%d", p[0], p[1], p[2], p[3]);
-	short si;
-	si=0;
-	for(a=(*re).sources.begin(); a!=(*re).sources.end(); ++a) {
-	  const unsigned char *p = (*a).data();
-	  si++;
+	for(int a=0; a<r.sources.size(); ++a) {
+	  const unsigned char *p = r.sources[a].data();
 	  debug_msg("IPMulticasttable: source %d %d.%d.%d.%d mode %x", 
-				si,
+				a+1,
 				p[0], p[1], p[2], p[3],
-				(*re).mode);
+				r.mode);
 	}
   }
   return true; 
@@ -214,13 +152,13 @@ bool IPMulticastTable::printreceiver(Vector<MulticastGroup>::iterator i)
  *******************************************************************************************/
 bool IPMulticastTable::printgroups(bool printreceivers)
 {
-  Vector<MulticastGroup>::iterator i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
-	const unsigned char *p = (*i).group.data();
+  for(int i=0; i<multicastgroups.size(); ++i) {
+	const MulticastGroup *g = multicastgroups.group(i);
+	const unsigned char *p = g->group.data();
 	debug_msg("IPMulticasttable: IP group address: %d.%d.%d.%d", p[0], p[1], p[2], p[3]);
 	if(printreceivers) {
 	  	debug_msg("IPMulticasttable: receivers in group:");
-		printreceiver(i);
+		printreceiver(g);
 	}
   }
   return true;
@@ -230,49 +168,32 @@ bool IPMulticastTable::printgroups(bool printreceivers)
  *                                                                                         *
  * push: every arriving packet is handled by the oush function                             *
  *             the forwarding of a multicast packet is done here                           *
+ *             the receivers of the packet's channel are looked up in the group index      *
  *                                                                                         *
  *******************************************************************************************/
 void IPMulticastTable::push(int port, Packet *p_in)
 {
-  bool submitted_packet=false;
   IPAddress group=IPAddress(p_in->dst_ip_anno());
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  //	  click_chatter("IPMulticasttable: scanning %x for %x",(*i).group.addr() ,group.addr());
-	  if(((*i).receivers.size() != 0) && 
-		 //		 interfaces[(*i).interface_id]==false &&
-		 group.addr()==(*i).group.addr())
-
-		
-		{
-		  //	  click_chatter("IPMulticasttable: ipv4mct push found group");
-		  interfaces[(*i).interface_id]=true;
-		  Vector<receiver>::iterator a;
-		  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a)
-			{
-			  submitted_packet=true;
-			  Packet *q_in = p_in->clone();
-			  WritablePacket *p = q_in->uniqueify();
-			  click_ip *ip = p->ip_header();
-			  ip->ip_ttl=(ip->ip_ttl)-1;
-			  IPAddress r=IPAddress((*a).receiver.addr());
-			  q_in->set_dst_ip_anno(r);
-			  int hlen = ip->ip_hl << 2;
-			  ip->ip_sum = 0;
-			  ip->ip_sum = click_in_cksum((unsigned char *)ip, hlen);
-			  // debug_msg("IPMulticasttable: pushing packet with new dst_ip_anno to ip router");
-			  output(0).push(p);
-			}
-		}
-	}
+  IPAddress source=IPAddress(p_in->ip_header()->ip_src);
+  const Vector<IPAddress> *out = multicastgroups.out(source, group);
+
+  if(out) {
+	for(int a=0; a<out->size(); ++a)
+	  {
+		Packet *q_in = p_in->clone();
+		WritablePacket *p = q_in->uniqueify();
+		click_ip *ip = p->ip_header();
+		ip->ip_ttl=(ip->ip_ttl)-1;
+		p->set_dst_ip_anno((*out)[a]);
+		int hlen = ip->ip_hl << 2;
+		ip->ip_sum = 0;
+		ip->ip_sum = click_in_cksum((unsigned char *)ip, hlen);
+		// debug_msg("IPMulticasttable: pushing packet with new dst_ip_anno to ip router");
+		output(0).push(p);
+	  }
+  }
   // after forwarding the multicast stream to all connected hosts, forward the stream to the PIM table
   // debug_msg("IPMulticasttable: IPMulticastTable pushes stream to PIM table");
-
-  for(unsigned int intr=0; intr<(no_of_interfaces-1); ++intr) { 
-	interfaces[intr]=false;
-  }
-  
   output(1).push(p_in);
 }
 
@@ -284,142 +205,170 @@ void IPMulticastTable::push(int port, Packet *p_in)
 bool IPMulticastTable::addsource(IPAddress recv, IPAddress group, IPAddress sa)
 {
   debug_msg("IPMulticasttable: addsource");
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(group.addr()==(*i).group.addr()) 
-		{
-		  Vector<receiver>::iterator re;
-		  for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re)
-			{
-			  if((*re).receiver.addr()==recv.addr()) {
-				Vector<IPAddress>::iterator a;
-				for(a=(*re).sources.begin(); a!=(*re).sources.end(); a++) {
-				  if((*a).addr()==ntohl(sa.addr())) {
-					debug_msg("IPMulticasttable: addsource: Duplicate request to add source");
-					return false;
-				  }
-
-				}
-				(*re).sources.push_back(ntohl(IPAddress(sa)));
-				if (pimenable==true) {
-				  debug_msg("IPMulticasttable: PIM join");
-				  pPim->join(group, sa);
-				}
-				const unsigned char *p = sa.data();
-				debug_msg("IPMulticasttable: IPMulticastTable IP source address: %d.%d.%d.%d", p[3], p[2], p[1], p[0]);
-				return true;				
-			  }
-			}
-		}
-	}
-  return false;
+  receiver *re = multicastgroups.find_receiver(recv, group);
+  if(!re) return false;
+  if(!multicastgroups.add_source(recv, group, IPAddress(ntohl(sa.addr())))) {
+	debug_msg("IPMulticasttable: addsource: Duplicate request to add source");
+	return false;
+  }
+  if (pimenable==true) {
+	debug_msg("IPMulticasttable: PIM join");
+	pPim->join(group, sa);
+  }
+  const unsigned char *p = sa.data();
+  debug_msg("IPMulticasttable: IPMulticastTable IP source address: %d.%d.%d.%d", p[3], p[2], p[1], p[0]);
+  return true;				
 }
 
 /*******************************************************************************************
  *                                                                                         *
- * addsource: SSM function, adds a source address to a pair of group<->interface           *
+ * delsource: SSM function, deletes a source address from a pair of group<->interface      *
  *                                                                                         *
  *******************************************************************************************/
 bool IPMulticastTable::delsource(IPAddress recv, IPAddress group, IPAddress sa)
 {
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(group.addr()==(*i).group.addr()) 
-		{
-		  Vector<receiver>::iterator re;
-		  for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re)
-			{
-			  if((*re).receiver.addr()==recv.addr()) {
-				Vector<IPAddress>::iterator a;
-				for(a=(*re).sources.begin(); a!=(*re).sources.end(); ++a) {
-				  if((*a).addr()==sa.addr()) {
-					(*re).sources.erase(a);
-					// "dead" receivers are dropped from the list
-					if((get_receiver_mode(recv, group)==INCLUDEMODE) && ((*re).sources.size()==0)) {
-					  leavegroup(recv, group);
-					  // if this group has no more receivers connected to the router PIM is informed
-					  if ((pimenable) && (pPim->noPIMreceivers(group, htonl(sa)))) pPim->prune(group, htonl(sa));
-					  return true;
-					}
-				  }
-				}
-			  }
-			}
-		}
-	}
+  if(!multicastgroups.del_source(recv, group, sa)) return false;
+  // "dead" receivers are dropped from the list
+  receiver *re = multicastgroups.find_receiver(recv, group);
+  if((re->mode==INCLUDEMODE) && (re->sources.size()==0)) {
+	leavegroup(recv, group);
+	// if this group has no more receivers connected to the router PIM is informed
+	if ((pimenable) && (pPim->noPIMreceivers(group, htonl(sa)))) pPim->prune(group, htonl(sa));
+	return true;
+  }
   return false;
 }
 
 unsigned char
 IPMulticastTable::get_receiver_mode(IPAddress recv, IPAddress group)
 {
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(group.addr()==(*i).group.addr()) 
-		{
-		  Vector<receiver>::iterator a;
-		  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a)
-			{
-			  if((*a).receiver.addr()==recv.addr())  return (*a).mode;
-			}
-		}
-	}
-  return MODE_NOT_SET;
+  receiver *re = multicastgroups.find_receiver(recv, group);
+  return re ? re->mode : MODE_NOT_SET;
 }
 
 
 bool
 IPMulticastTable::set_receiver_mode(IPAddress recv, IPAddress group, MODE mode)
 {
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(group.addr()==(*i).group.addr()) 
-		{
-		  debug_msg("IPMulticasttable: found group");
-		  Vector<receiver>::iterator a;
-		  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a)
-			{
-			  if((*a).receiver.addr()==recv.addr())  {
-				(*a).mode=mode;
-				return true;
-				debug_msg("IPMulticasttable: setmode %x", mode);
-			  }
-			}
-		}
-	}
-  return false;
+  if(!multicastgroups.set_mode(recv, group, mode)) return false;
+  debug_msg("IPMulticasttable: setmode %x", mode);
+  return true;
 }
 
 // check whether IGMP listeners are attached or not
 bool IPMulticastTable::getIGMPreceivers(IPAddress source, IPAddress group)
 {
-  debug_msg("IPMulticasttable: ********************");
-  printgroups(true);
-  debug_msg("IPMulticasttable: ********************");
+  // the (source, group) channel is in use if any receiver of the group names the source
+  return !multicastgroups.has_channel(source, group);
+}
 
-  Vector<MulticastGroup>::iterator i;
+/*******************************************************************************************
+ *                                                                                         *
+ * populate: adds synthetic groups, receivers and sources for benchmarks                   *
+ *           addresses are counted up from the given base addresses                        *
+ *                                                                                         *
+ *******************************************************************************************/
+static IPAddress
+offset_address(IPAddress base, uint32_t i)
+{
+  return IPAddress(htonl(ntohl(base.addr()) + i));
+}
 
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
-    if((*i).group.addr()==group.addr()) {
-      debug_msg("IPMulticasttable: getIGMPreceivers found group");
-      Vector<receiver>::iterator re;
-      for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re) {
-	debug_msg("IPMulticasttable: searching for recvs in group %x", (*i).group.addr() );
-	Vector<IPAddress>::iterator a;
-	debug_msg("IPMulticasttable: groessse sources %d", (*re).sources.size() );
-	for(a=(*re).sources.begin(); a!=(*re).sources.end(); ++a) {
-	  debug_msg("IPMulticasttable: search %x from group %x", source.addr(), group.addr() );
-	  debug_msg("IPMulticasttable: compare %x to %x", source.addr(), (*a).addr() );
-	  if( (*a).addr()==(source.addr()) ) return false; 
-	}
-      }
-    }
+int
+IPMulticastTable::populate(uint32_t groups, uint32_t receivers, uint32_t sources,
+						   IPAddress group, IPAddress recv, IPAddress source)
+{
+  Vector<receiver> rs;
+  for(uint32_t r=0; r<receivers; ++r) {
+	receiver re;
+	re.addr=offset_address(recv, r);
+	if(sources) re.mode=INCLUDEMODE;
+	for(uint32_t s=0; s<sources; ++s)
+	  re.sources.push_back(offset_address(source, s));
+	rs.push_back(re);
   }
-  return true; 
+  int added=0;
+  for(uint32_t g=0; g<groups; ++g) {
+	IPAddress ga=offset_address(group, g);
+	multicastgroups.add_group(ga);
+	added+=multicastgroups.join_all(ga, 0, rs);
+  }
+  return added;
+}
+
+String
+IPMulticastTable::print_stats()
+{
+  int receivers=0, sources=0, channels=0, entries=0;
+  for(int i=0; i<multicastgroups.size(); ++i) {
+	const MulticastGroup *g = multicastgroups.group(i);
+	receivers += g->receivers.size();
+	for(int r=0; r<g->receivers.size(); ++r)
+	  sources += g->receivers[r].sources.size();
+	channels += g->channels.size();
+	for(HashMap<IPAddress, MulticastMembership<IPAddress>::Channel>::const_iterator c=g->channels.begin(); c; c++)
+	  entries += c.value().out.size();
+	entries += g->any.size();
+  }
+  StringAccum sa;
+  sa << "groups " << multicastgroups.size() << "\n";
+  sa << "receivers " << receivers << "\n";
+  sa << "sources " << sources << "\n";
+  sa << "channels " << channels << "\n";
+  sa << "out_entries " << entries << "\n";
+  return sa.take_string();
+}
+
+enum { H_STATS, H_POPULATE, H_CLEAR };
+
+static String
+ipmulticasttable_read_handler(Element *e, void *thunk)
+{
+  IPMulticastTable *mct = (IPMulticastTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_STATS:
+	return mct->print_stats();
+  default:
+	return String();
+  }
+}
+
+static int
+ipmulticasttable_write_handler(const String &in_s, Element *e, void *thunk, ErrorHandler *errh)
+{
+  IPMulticastTable *mct = (IPMulticastTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_POPULATE: {
+	Vector<String> conf;
+	cp_argvec(in_s, conf);
+	uint32_t groups=0, receivers=1, sources=0;
+	IPAddress group(String("232.1.0.0")), recv(String("10.1.0.1")), source(String("10.0.0.1"));
+	if (cp_va_kparse(conf, e, errh,
+					 "GROUPS", cpkP+cpkM, cpUnsigned, &groups,
+					 "RECEIVERS", cpkP, cpUnsigned, &receivers,
+					 "SOURCES", cpkP, cpUnsigned, &sources,
+					 "GROUP", 0, cpIPAddress, &group,
+					 "RECEIVER", 0, cpIPAddress, &recv,
+					 "SOURCE", 0, cpIPAddress, &source,
+					 cpEnd) < 0)
+	  return -1;
+	mct->populate(groups, receivers, sources, group, recv, source);
+	return 0;
+  }
+  case H_CLEAR:
+	mct->multicastgroups.clear();
+	return 0;
+  default:
+	return -1;
+  }
+}
+
+void
+IPMulticastTable::add_handlers()
+{
+  add_read_handler("stats", ipmulticasttable_read_handler, (void *)H_STATS);
+  add_write_handler("populate", ipmulticasttable_write_handler, (void *)H_POPULATE);
+  add_write_handler("clear", ipmulticasttable_write_handler, (void *)H_CLEAR);
 }
 
 EXPORT_ELEMENT(IPMulticastTable)
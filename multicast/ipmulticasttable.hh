@@ -2,7 +2,9 @@
 #define IPV4MULTICASTTABLE_HH
 CLICK_DECLS
 #include <click/element.hh>
+#include <click/ipaddress.hh>
 #include "pimcontrol.hh"
+#include "mcastindex.hh"
 
 
 /*
@@ -15,7 +17,29 @@ IPMulticastTable(PIMControl)
 =d
 Includes data structures to store addresses of receivers of multicast streams (IPv4).
 Each multicast group entry can hold information about senders and receivers.
-The data structures is based upon STL containers.
+Groups are kept in a hash table.  For every group the table keeps the list
+of receivers for each source named by a receiver (SSM channel) and the list
+for all other sources, honoring the INCLUDE and EXCLUDE source filters, so
+forwarding a packet does not scan the groups or the receivers' source lists.
+
+=h stats read-only
+
+Numbers of groups, receivers, source filter entries, (source, group)
+channels and outgoing list entries.
+
+=h populate write-only
+
+Fills the table with synthetic memberships, for benchmarks.  Takes
+keyword arguments GROUPS, RECEIVERS and SOURCES (unsigned integers), and
+GROUP, RECEIVER and SOURCE (IP addresses, defaulting to 232.1.0.0,
+10.1.0.1 and 10.0.0.1).  Adds GROUPS groups starting at GROUP, each joined
+by the RECEIVERS hosts starting at RECEIVER.  With SOURCES 0 the receivers
+accept any source; otherwise each is in INCLUDE mode with the SOURCES
+sources starting at SOURCE.  PIM is not told about these memberships.
+
+=h clear write-only
+
+Removes every group.
 
 =e
 mct::IPMulticastTable("pimctl");
@@ -44,26 +68,14 @@ class IPMulticastTable : public Element {
   const char *port_count() const	{ return "1/2"; }
   const char *processing() const	{ return "h/hh"; }
 
-  struct receiver {
-	IPAddress receiver;
-	MODE mode;
-	Vector<IPAddress> sources; // for SSM = Source Specific Multicast the senders IPs are needed
-  };
-
-  struct MulticastGroup {
-	unsigned int interface_id;
-	IPAddress group; // group address
-	Vector<receiver> receivers; // a group can be joined by one or more receivers
-  };
+  // for SSM = Source Specific Multicast the senders IPs are kept per receiver
+  typedef MulticastMembership<IPAddress>::Receiver receiver;
+  typedef MulticastMembership<IPAddress>::Group MulticastGroup;
 
-  MulticastGroup *gp;
-
-  Vector<MulticastGroup> multicastgroups;
-  Vector<bool> interfaces;
+  MulticastMembership<IPAddress> multicastgroups;
 
   int configure(Vector<String> &, ErrorHandler *);
-  int initialize(ErrorHandler *);
-  bool printreceiver(Vector<MulticastGroup>::iterator);
+  bool printreceiver(const MulticastGroup *);
   bool addgroup(IPAddress);
   bool joingroup(IPAddress, IPAddress, unsigned int);
   unsigned char get_receiver_mode(IPAddress, IPAddress);
@@ -75,6 +87,10 @@ class IPMulticastTable : public Element {
   void push(int, Packet *);
   bool getIGMPreceivers(IPAddress, IPAddress);
 
+  void add_handlers();
+  String print_stats();
+  int populate(uint32_t, uint32_t, uint32_t, IPAddress, IPAddress, IPAddress);
+
 private:
   bool pimenable;
   unsigned int no_of_interfaces;
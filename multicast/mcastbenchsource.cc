@@ -0,0 +1,267 @@
+/*
+ * mcastbenchsource.{cc,hh} -- in-memory multicast traffic for benchmarks
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+
+#include <click/config.h>
+#include "mcastbenchsource.hh"
+#include <click/ipaddress.hh>
+#include <click/router.hh>
+#include <click/error.hh>
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+
+MulticastBenchSource::MulticastBenchSource()
+  : _template(0), _task(this)
+{
+  reset();
+}
+
+MulticastBenchSource::~MulticastBenchSource()
+{
+}
+
+int
+MulticastBenchSource::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _group = IPAddress(String("232.1.0.0"));
+  _source = IPAddress(String("10.0.0.1"));
+  _length = 64;
+  _limit = 1000000;
+  _burst = 32;
+  _stop = false;
+  _active = true;
+  if (cp_va_kparse(conf, this, errh,
+				   "GROUPS", cpkP+cpkM, cpUnsigned, &_groups,
+				   "SOURCES", cpkP+cpkM, cpUnsigned, &_sources,
+				   "GROUP", 0, cpIPAddress, &_group,
+				   "SOURCE", 0, cpIPAddress, &_source,
+				   "LENGTH", 0, cpUnsigned, &_length,
+				   "LIMIT", 0, cpUnsigned, &_limit,
+				   "BURST", 0, cpUnsigned, &_burst,
+				   "STOP", 0, cpBool, &_stop,
+				   "ACTIVE", 0, cpBool, &_active,
+				   cpEnd) < 0)
+	return -1;
+  if (_groups == 0 || _sources == 0)
+	return errh->error("GROUPS and SOURCES must be positive");
+  if (_length < sizeof(click_ip) + sizeof(click_udp))
+	return errh->error("LENGTH too small for IP and UDP headers");
+  if (_burst == 0)
+	return errh->error("BURST must be positive");
+  return 0;
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * initialize: builds the packet every sent packet is copied from                          *
+ *                                                                                         *
+ *******************************************************************************************/
+int
+MulticastBenchSource::initialize(ErrorHandler *errh)
+{
+  WritablePacket *q = Packet::make(_length);
+  if (!q)
+	return errh->error("out of memory");
+  memset(q->data(), 0, _length);
+
+  click_ip *ip = reinterpret_cast<click_ip *>(q->data());
+  ip->ip_v = 4;
+  ip->ip_hl = sizeof(click_ip) >> 2;
+  ip->ip_len = htons(_length);
+  ip->ip_ttl = 64;
+  ip->ip_p = IP_PROTO_UDP;
+  q->set_ip_header(ip, sizeof(click_ip));
+
+  click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+  udp->uh_sport = htons(5000);
+  udp->uh_dport = htons(5000);
+  udp->uh_ulen = htons(_length - sizeof(click_ip));
+
+  _template = q;
+  _task.initialize(this, _active);
+  return 0;
+}
+
+void
+MulticastBenchSource::cleanup(CleanupStage)
+{
+  if (_template)
+	_template->kill();
+  _template = 0;
+}
+
+static IPAddress
+offset_address(IPAddress base, uint32_t i)
+{
+  return IPAddress(htonl(ntohl(base.addr()) + i));
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * run_task: sends up to BURST packets, timing each push                                   *
+ *                                                                                         *
+ *******************************************************************************************/
+bool
+MulticastBenchSource::run_task(Task *)
+{
+  if (!_active)
+	return false;
+  if (_limit && _count >= _limit) {
+	if (_stop)
+	  router()->please_stop_driver();
+	return false;
+  }
+
+  uint32_t n = _burst;
+  if (_limit && _limit - _count < n)
+	n = _limit - _count;
+  if (_count == 0)
+	_first = Timestamp::now();
+
+  for (uint32_t i = 0; i < n; i++) {
+	WritablePacket *p = _template->clone()->uniqueify();
+	if (!p)
+	  break;
+	IPAddress group = offset_address(_group, _count % _groups);
+	click_ip *ip = p->ip_header();
+	ip->ip_src = offset_address(_source, (_count / _groups) % _sources);
+	ip->ip_dst = group;
+	ip->ip_sum = 0;
+	ip->ip_sum = click_in_cksum((unsigned char *)ip, sizeof(click_ip));
+	p->set_dst_ip_anno(group);
+
+	click_cycles_t start = click_get_cycles();
+	output(0).push(p);
+	uint64_t c = click_get_cycles() - start;
+
+	_cycles += c;
+	if (c > _max_cycles)
+	  _max_cycles = c;
+	int b = 0;
+	while (b < BUCKETS - 1 && (c >> b) != 0)
+	  b++;
+	_histogram[b]++;
+	_count++;
+  }
+
+  _last = Timestamp::now();
+  _task.fast_reschedule();
+  return true;
+}
+
+void
+MulticastBenchSource::reset()
+{
+  _count = 0;
+  _first = _last = Timestamp();
+  _cycles = 0;
+  _max_cycles = 0;
+  for (int b = 0; b < BUCKETS; b++)
+	_histogram[b] = 0;
+}
+
+void
+MulticastBenchSource::set_active(bool active)
+{
+  _active = active;
+  if (_active)
+	_task.reschedule();
+}
+
+uint64_t
+MulticastBenchSource::percentile(double f) const
+{
+  uint32_t want = (uint32_t)(f * _count);
+  uint32_t seen = 0;
+  for (int b = 0; b < BUCKETS; b++) {
+	seen += _histogram[b];
+	if (seen > want)
+	  return (uint64_t)1 << b;
+  }
+  return _max_cycles;
+}
+
+String
+MulticastBenchSource::print_rate()
+{
+  double sec = (_last - _first).doubleval();
+  StringAccum sa;
+  sa << "packets " << _count << "\n";
+  sa << "seconds " << sec << "\n";
+  sa << "rate " << (sec > 0 ? _count / sec : 0) << "\n";
+  return sa.take_string();
+}
+
+String
+MulticastBenchSource::print_latency()
+{
+  StringAccum sa;
+  sa << "mean " << (_count ? _cycles / _count : 0) << "\n";
+  sa << "p50 " << (_count ? percentile(0.5) : 0) << "\n";
+  sa << "p99 " << (_count ? percentile(0.99) : 0) << "\n";
+  sa << "max " << _max_cycles << "\n";
+  return sa.take_string();
+}
+
+enum { H_COUNT, H_RATE, H_LATENCY, H_RESET, H_ACTIVE };
+
+static String
+mcastbenchsource_read_handler(Element *e, void *thunk)
+{
+  MulticastBenchSource *src = (MulticastBenchSource *)e;
+  switch ((intptr_t)thunk) {
+  case H_COUNT:
+	return String(src->count()) + "\n";
+  case H_RATE:
+	return src->print_rate();
+  case H_LATENCY:
+	return src->print_latency();
+  default:
+	return String();
+  }
+}
+
+static int
+mcastbenchsource_write_handler(const String &in_s, Element *e, void *thunk, ErrorHandler *errh)
+{
+  MulticastBenchSource *src = (MulticastBenchSource *)e;
+  switch ((intptr_t)thunk) {
+  case H_RESET:
+	src->reset();
+	return 0;
+  case H_ACTIVE: {
+	bool active;
+	if (!cp_bool(cp_uncomment(in_s), &active))
+	  return errh->error("active parameter must be boolean");
+	src->set_active(active);
+	return 0;
+  }
+  default:
+	return -1;
+  }
+}
+
+void
+MulticastBenchSource::add_handlers()
+{
+  add_read_handler("count", mcastbenchsource_read_handler, (void *)H_COUNT);
+  add_read_handler("rate", mcastbenchsource_read_handler, (void *)H_RATE);
+  add_read_handler("latency", mcastbenchsource_read_handler, (void *)H_LATENCY);
+  add_write_handler("reset", mcastbenchsource_write_handler, (void *)H_RESET);
+  add_write_handler("active", mcastbenchsource_write_handler, (void *)H_ACTIVE);
+}
+
+EXPORT_ELEMENT(MulticastBenchSource)
@@ -0,0 +1,469 @@
+#ifndef MCASTINDEX_HH
+#define MCASTINDEX_HH
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <click/hashmap.hh>
+CLICK_DECLS
+
+/*
+ * mcastindex.hh -- hashed multicast group and channel index
+ *
+ * Shared by the IPv4 tables (IPMulticastTable, PIMForwardingTable) and the
+ * IPv6 tables (IP6MulticastTable, IP6PIMForwardingTable); A is IPAddress or
+ * IP6Address.  The multicast6 package includes this file from multicast/.
+ *
+ * MulticastMembership<A> holds the receivers of each group with their
+ * source filter.  Groups are found through a hash table.  Each group keeps
+ * its outgoing lists, so that forwarding a packet is one group lookup and
+ * one source lookup:
+ *
+ *   - for each source named by some receiver of the group, the receivers
+ *     that accept it: INCLUDE receivers that list it, and EXCLUDE or
+ *     unset receivers that do not;
+ *   - for any other source, the EXCLUDE and unset receivers.
+ *
+ * Changes update only the lists they affect.  Naming or dropping a source
+ * touches that source's list; joining, leaving or changing mode touches
+ * the receiver's own sources for an INCLUDE receiver, and every list of
+ * the group otherwise, since EXCLUDE receivers are on all of them.
+ *
+ * ChannelFanout<A> maps channels, and groups regardless of source, to the
+ * list of addresses a packet is copied to.  Channels are kept per group,
+ * so group-wide changes only visit that group's channels.
+ */
+
+#define MCASTINDEX_INCLUDE	0x00
+#define MCASTINDEX_EXCLUDE	0x01
+#define MCASTINDEX_NOT_SET	0x02
+
+// Adds 'to' to v unless it is there; returns false if it was
+template <typename A>
+inline bool
+mcastindex_add(Vector<A> &v, const A &to)
+{
+  for (int i = 0; i < v.size(); i++)
+    if (v[i] == to)
+      return false;
+  v.push_back(to);
+  return true;
+}
+
+// Removes 'to' from v, not keeping the order; returns false if it was not
+// there
+template <typename A>
+inline bool
+mcastindex_remove(Vector<A> &v, const A &to)
+{
+  for (int i = 0; i < v.size(); i++)
+    if (v[i] == to) {
+      v[i] = v.back();
+      v.pop_back();
+      return true;
+    }
+  return false;
+}
+
+template <typename A>
+class MulticastMembership { public:
+
+  struct Receiver {
+	A addr;
+	unsigned char mode;
+	Vector<A> sources;
+
+	Receiver() : mode(MCASTINDEX_NOT_SET) { }
+
+	int find_source(const A &s) const {
+	  for (int i = 0; i < sources.size(); i++)
+		if (sources[i] == s)
+		  return i;
+	  return -1;
+	}
+
+	bool accepts(const A &s) const {
+	  if (mode == MCASTINDEX_INCLUDE)
+		return find_source(s) >= 0;
+	  return find_source(s) < 0;
+	}
+  };
+
+  struct Channel {
+	int refs;				// receivers naming the source
+	Vector<A> out;				// receivers accepting it
+
+	Channel() : refs(0) { }
+  };
+
+  struct Group {
+	A group;
+	unsigned interface_id;
+	Vector<Receiver> receivers;
+	HashMap<A, int> index;			// receiver address -> receivers[]
+	HashMap<A, Channel> channels;		// named source -> receivers
+	Vector<A> any;				// receivers for other sources
+	int pos;				// in MulticastMembership::_order
+
+	Group() : interface_id(0), pos(-1) { }
+
+	const Vector<A> &out(const A &source) const {
+	  const Channel *c = channels.findp(source);
+	  return c ? c->out : any;
+	}
+  };
+
+  MulticastMembership() { }
+  ~MulticastMembership()		{ clear(); }
+
+  Group *find(const A &group) const {
+	Group * const *g = _groups.findp(group);
+	return g ? *g : 0;
+  }
+
+  Receiver *find_receiver(const A &recv, const A &group) const {
+	Group *g = find(group);
+	if (!g)
+	  return 0;
+	const int *i = g->index.findp(recv);
+	return i ? &g->receivers[*i] : 0;
+  }
+
+  // Returns false if the group exists
+  bool add_group(const A &group) {
+	if (find(group))
+	  return false;
+	Group *g = new Group;
+	g->group = group;
+	g->pos = _order.size();
+	_groups.insert(group, g);
+	_order.push_back(g);
+	return true;
+  }
+
+  // Returns false if the group does not exist or recv is already a member
+  bool join(const A &recv, const A &group, unsigned interface_id) {
+	Group *g = find(group);
+	if (!g || g->index.findp(recv))
+	  return false;
+	Receiver r;
+	r.addr = recv;
+	g->index.insert(recv, g->receivers.size());
+	g->receivers.push_back(r);
+	g->interface_id = interface_id;
+	attach(g, g->receivers.back());
+	return true;
+  }
+
+  // Adds receivers, with their modes and sources, to the group.  Receivers
+  // that are members already are skipped.  Returns the number added.
+  int join_all(const A &group, unsigned interface_id, const Vector<Receiver> &rs) {
+	Group *g = find(group);
+	if (!g)
+	  return 0;
+	int n = 0;
+	for (int i = 0; i < rs.size(); i++)
+	  if (!g->index.findp(rs[i].addr)) {
+		g->index.insert(rs[i].addr, g->receivers.size());
+		g->receivers.push_back(rs[i]);
+		attach(g, g->receivers.back());
+		n++;
+	  }
+	g->interface_id = interface_id;
+	return n;
+  }
+
+  // Removes recv from the group, and the group once it is empty.  Returns
+  // false if recv was not a member.
+  bool leave(const A &recv, const A &group) {
+	Group *g = find(group);
+	const int *ip = (g ? g->index.findp(recv) : 0);
+	if (!ip)
+	  return false;
+	int i = *ip, last = g->receivers.size() - 1;
+	detach(g, g->receivers[i]);
+	g->index.remove(recv);
+	if (i != last) {
+	  g->receivers[i] = g->receivers[last];
+	  g->index.insert(g->receivers[i].addr, i);
+	}
+	g->receivers.pop_back();
+	if (g->receivers.size() == 0)
+	  remove_group(group);
+	return true;
+  }
+
+  bool set_mode(const A &recv, const A &group, unsigned char mode) {
+	Receiver *r = find_receiver(recv, group);
+	if (!r)
+	  return false;
+	if (r->mode != mode) {
+	  Group *g = find(group);
+	  remove_from_lists(g, *r);
+	  r->mode = mode;
+	  add_to_lists(g, *r);
+	}
+	return true;
+  }
+
+  // Returns false if recv is not a member or already names the source
+  bool add_source(const A &recv, const A &group, const A &source) {
+	Receiver *r = find_receiver(recv, group);
+	if (!r || r->find_source(source) >= 0)
+	  return false;
+	Channel &c = name_source(find(group), source);
+	r->sources.push_back(source);
+	if (r->mode == MCASTINDEX_INCLUDE)
+	  mcastindex_add(c.out, r->addr);
+	else
+	  mcastindex_remove(c.out, r->addr);
+	return true;
+  }
+
+  // Returns false if recv is not a member or does not name the source
+  bool del_source(const A &recv, const A &group, const A &source) {
+	Receiver *r = find_receiver(recv, group);
+	int i = (r ? r->find_source(source) : -1);
+	if (i < 0)
+	  return false;
+	r->sources[i] = r->sources.back();
+	r->sources.pop_back();
+	Group *g = find(group);
+	if (Channel *c = unname_source(g, source)) {
+	  if (r->mode == MCASTINDEX_INCLUDE)
+		mcastindex_remove(c->out, r->addr);
+	  else
+		mcastindex_add(c->out, r->addr);
+	}
+	return true;
+  }
+
+  // True if some receiver of the group names the source, i.e. the (source,
+  // group) channel is in use
+  bool has_channel(const A &source, const A &group) const {
+	Group *g = find(group);
+	return g && g->channels.findp(source);
+  }
+
+  // Receivers a packet from source to group goes to; 0 if the group has
+  // none
+  const Vector<A> *out(const A &source, const A &group) const {
+	Group *g = find(group);
+	if (!g)
+	  return 0;
+	const Vector<A> &v = g->out(source);
+	return v.size() ? &v : 0;
+  }
+
+  // Groups are numbered 0 to size()-1; removing a group renumbers the last
+  int size() const			{ return _order.size(); }
+  Group *group(int i) const		{ return _order[i]; }
+
+  void clear() {
+	for (typename HashMap<A, Group *>::iterator it = _groups.begin(); it; it++)
+	  delete it.value();
+	_groups.clear();
+	_order.clear();
+  }
+
+ private:
+
+  HashMap<A, Group *> _groups;
+  Vector<Group *> _order;
+
+  void remove_group(const A &group) {
+	Group *g = find(group);
+	_order[g->pos] = _order.back();
+	_order[g->pos]->pos = g->pos;
+	_order.pop_back();
+	_groups.remove(group);
+	delete g;
+  }
+
+  // The channel of a source some receiver is about to name, created if no
+  // receiver named it yet.  A new channel starts as 'any': nobody excludes
+  // the source yet.
+  Channel &name_source(Group *g, const A &source) {
+	Channel *c = g->channels.findp(source);
+	if (!c) {
+	  g->channels.insert(source, Channel());
+	  c = g->channels.findp(source);
+	  c->out = g->any;
+	}
+	c->refs++;
+	return *c;
+  }
+
+  // Drops one receiver's naming of the source; returns its channel, or 0
+  // once no receiver names it and it is removed
+  Channel *unname_source(Group *g, const A &source) {
+	Channel *c = g->channels.findp(source);
+	if (--c->refs > 0)
+	  return c;
+	g->channels.remove(source);
+	return 0;
+  }
+
+  void attach(Group *g, const Receiver &r) {
+	for (int j = 0; j < r.sources.size(); j++)
+	  name_source(g, r.sources[j]);
+	add_to_lists(g, r);
+  }
+
+  void detach(Group *g, const Receiver &r) {
+	remove_from_lists(g, r);
+	for (int j = 0; j < r.sources.size(); j++)
+	  unname_source(g, r.sources[j]);
+  }
+
+  void add_to_lists(Group *g, const Receiver &r) {
+	if (r.mode == MCASTINDEX_INCLUDE) {
+	  for (int j = 0; j < r.sources.size(); j++)
+		mcastindex_add(g->channels.findp(r.sources[j])->out, r.addr);
+	  return;
+	}
+	g->any.push_back(r.addr);
+	for (typename HashMap<A, Channel>::iterator it = g->channels.begin(); it; it++)
+	  if (r.find_source(it.key()) < 0)
+		mcastindex_add(it.value().out, r.addr);
+  }
+
+  void remove_from_lists(Group *g, const Receiver &r) {
+	if (r.mode == MCASTINDEX_INCLUDE) {
+	  for (int j = 0; j < r.sources.size(); j++)
+		mcastindex_remove(g->channels.findp(r.sources[j])->out, r.addr);
+	  return;
+	}
+	mcastindex_remove(g->any, r.addr);
+	for (typename HashMap<A, Channel>::iterator it = g->channels.begin(); it; it++)
+	  mcastindex_remove(it.value().out, r.addr);
+  }
+
+  MulticastMembership(const MulticastMembership<A> &);
+  MulticastMembership<A> &operator=(const MulticastMembership<A> &);
+
+};
+
+template <typename A>
+class ChannelFanout { public:
+
+  // The channels of one group
+  struct Group {
+	HashMap<A, Vector<A> > sources;		// source -> where its packets go
+	Vector<A> all;				// every address on some source
+	HashMap<A, int> refs;			// address -> sources it is on
+  };
+
+  ChannelFanout() : _nchannels(0), _nentries(0) { }
+
+  // Adds 'to' to the channel's list; returns false if it is there already
+  bool add(const A &source, const A &group, const A &to) {
+	Group *g = _groups.findp(group);
+	if (!g) {
+	  _groups.insert(group, Group());
+	  g = _groups.findp(group);
+	}
+	Vector<A> *v = g->sources.findp(source);
+	if (!v) {
+	  g->sources.insert(source, Vector<A>());
+	  v = g->sources.findp(source);
+	  _nchannels++;
+	}
+	if (!mcastindex_add(*v, to))
+	  return false;
+	_nentries++;
+	if (int *n = g->refs.findp(to))
+	  (*n)++;
+	else {
+	  g->refs.insert(to, 1);
+	  g->all.push_back(to);
+	}
+	return true;
+  }
+
+  // Removes 'to' from the channel's list; returns false if it was not there
+  bool remove(const A &source, const A &group, const A &to) {
+	Group *g = _groups.findp(group);
+	Vector<A> *v = (g ? g->sources.findp(source) : 0);
+	if (!v || !mcastindex_remove(*v, to))
+	  return false;
+	_nentries--;
+	if (!v->size()) {
+	  g->sources.remove(source);
+	  _nchannels--;
+	}
+	int *n = g->refs.findp(to);
+	if (--*n == 0) {
+	  g->refs.remove(to);
+	  mcastindex_remove(g->all, to);
+	}
+	if (!g->sources.size())
+	  _groups.remove(group);
+	return true;
+  }
+
+  // Removes every channel of the group that 'to' is on, whatever its
+  // source; returns false if there was none
+  bool remove_group(const A &group, const A &to) {
+	const Group *g = _groups.findp(group);
+	if (!g || !g->refs.findp(to))
+	  return false;
+	Vector<A> sources;
+	for (typename HashMap<A, Vector<A> >::const_iterator it = g->sources.begin(); it; it++)
+	  for (int i = 0; i < it.value().size(); i++)
+		if (it.value()[i] == to) {
+		  sources.push_back(it.key());
+		  break;
+		}
+	for (int i = 0; i < sources.size(); i++)
+	  remove(sources[i], group, to);
+	return true;
+  }
+
+  bool has(const A &source, const A &group) const {
+	return out(source, group) != 0;
+  }
+
+  bool has(const A &source, const A &group, const A &to) const {
+	const Vector<A> *v = out(source, group);
+	if (v)
+	  for (int i = 0; i < v->size(); i++)
+		if ((*v)[i] == to)
+		  return true;
+	return false;
+  }
+
+  bool has_group(const A &group, const A &to) const {
+	const Group *g = _groups.findp(group);
+	return g && g->refs.findp(to);
+  }
+
+  // Where packets of the channel go, or 0
+  const Vector<A> *out(const A &source, const A &group) const {
+	const Group *g = _groups.findp(group);
+	return g ? g->sources.findp(source) : 0;
+  }
+
+  // Where packets to the group go whatever their source, or 0
+  const Vector<A> *out_group(const A &group) const {
+	const Group *g = _groups.findp(group);
+	return g ? &g->all : 0;
+  }
+
+  const HashMap<A, Group> &groups() const	{ return _groups; }
+  int nchannels() const			{ return _nchannels; }
+  int nentries() const			{ return _nentries; }
+
+  void clear() {
+	_groups.clear();
+	_nchannels = _nentries = 0;
+  }
+
+ private:
+
+  HashMap<A, Group> _groups;
+  int _nchannels;
+  int _nentries;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,228 @@
+#ifndef MCASTTIMER_HH
+#define MCASTTIMER_HH
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <click/hashmap.hh>
+CLICK_DECLS
+
+/*
+ * mcasttimer.hh -- membership timers on a hierarchical timing wheel
+ *
+ * Used by IGMP and MLD for the group and source timers of RFC 3376 and
+ * RFC 3810; A is IPAddress or IP6Address.  The multicast and multicast6
+ * packages each carry a copy of this file.
+ *
+ * MembershipKey<A> names a timer: the group timer of a receiver when
+ * source is the zero address, else the timer of one of its sources.
+ *
+ * MembershipTimers<A> keeps one timer per key on MCASTTIMER_LEVELS wheels
+ * of 64 slots each.  A timer less than 64 ticks away sits in the first
+ * wheel, one less than 64^2 ticks away in the second, and so on; a slot of
+ * an upper wheel is moved down when the lower wheel wraps around to it.
+ * Starting, restarting and cancelling a timer are a hash lookup and a list
+ * operation, and each tick only looks at the timers that are due or that
+ * move down a wheel, however many timers are running.  A timer runs for
+ * at most max_ticks() ticks.
+ */
+
+#define MCASTTIMER_LEVELS	4
+#define MCASTTIMER_SLOT_BITS	6
+#define MCASTTIMER_SLOTS	(1 << MCASTTIMER_SLOT_BITS)
+
+template <typename A>
+struct MembershipKey {
+  A recv;
+  A group;
+  A source;
+
+  MembershipKey() { }
+  MembershipKey(const A &r, const A &g, const A &s = A())
+	: recv(r), group(g), source(s) { }
+
+  bool group_timer() const		{ return source == A(); }
+
+  inline size_t hashcode() const {
+	return (CLICK_NAME(hashcode)(recv) * 31 + CLICK_NAME(hashcode)(group)) * 31
+	  + CLICK_NAME(hashcode)(source);
+  }
+};
+
+template <typename A>
+inline bool
+operator==(const MembershipKey<A> &a, const MembershipKey<A> &b)
+{
+  return a.recv == b.recv && a.group == b.group && a.source == b.source;
+}
+
+template <typename A>
+class MembershipTimers { public:
+
+  MembershipTimers() : _free(-1), _now(0) {
+	for (int i = 0; i < MCASTTIMER_LEVELS * MCASTTIMER_SLOTS; i++)
+	  _head[i] = -1;
+	for (int l = 0; l < MCASTTIMER_LEVELS; l++)
+	  _level_size[l] = 0;
+  }
+
+  // Starts the timer for k, or restarts it if it is running, to expire
+  // 'ticks' ticks from now (at least 1)
+  void schedule(const MembershipKey<A> &k, uint32_t ticks) {
+	int i;
+	if (int *ip = _index.findp(k)) {
+	  i = *ip;
+	  unlink(i);
+	} else {
+	  i = alloc();
+	  _e[i].key = k;
+	  _index.insert(k, i);
+	}
+	if (ticks < 1)
+	  ticks = 1;
+	if (ticks > max_ticks())
+	  ticks = max_ticks();
+	_e[i].expiry = _now + ticks;
+	link(i);
+  }
+
+  // Stops the timer for k; returns false if it was not running
+  bool cancel(const MembershipKey<A> &k) {
+	int *ip = _index.findp(k);
+	if (!ip)
+	  return false;
+	int i = *ip;
+	unlink(i);
+	release(i);
+	_index.remove(k);
+	return true;
+  }
+
+  bool running(const MembershipKey<A> &k) const {
+	return _index.findp(k) != 0;
+  }
+
+  // Ticks left before k expires, 0 if it is not running
+  uint32_t remaining(const MembershipKey<A> &k) const {
+	const int *ip = _index.findp(k);
+	return ip ? _e[*ip].expiry - _now : 0;
+  }
+
+  // Advances the wheels by one tick and appends the keys whose timers
+  // expired to 'expired'
+  void tick(Vector<MembershipKey<A> > &expired) {
+	_now++;
+	int l = 1;
+	while (l < MCASTTIMER_LEVELS
+		   && (_now & ((1U << (MCASTTIMER_SLOT_BITS * l)) - 1)) == 0)
+	  l++;
+	// move due upper slots down, top wheel first
+	for (l--; l >= 1; l--) {
+	  int *h = &_head[l * MCASTTIMER_SLOTS + ((_now >> (MCASTTIMER_SLOT_BITS * l)) & (MCASTTIMER_SLOTS - 1))];
+	  int i = *h;
+	  *h = -1;
+	  while (i >= 0) {
+		int next = _e[i].next;
+		_level_size[l]--;
+		link(i);
+		i = next;
+	  }
+	}
+	int *h = &_head[_now & (MCASTTIMER_SLOTS - 1)];
+	int i = *h;
+	*h = -1;
+	while (i >= 0) {
+	  int next = _e[i].next;
+	  _level_size[0]--;
+	  expired.push_back(_e[i].key);
+	  _index.remove(_e[i].key);
+	  release(i);
+	  i = next;
+	}
+  }
+
+  // Number of running timers, in total and on wheel l
+  int size() const			{ return _index.size(); }
+  int level_size(int l) const		{ return _level_size[l]; }
+  uint32_t now() const			{ return _now; }
+
+  static uint32_t max_ticks() {
+	return (1U << (MCASTTIMER_SLOT_BITS * MCASTTIMER_LEVELS)) - 1;
+  }
+
+  void clear() {
+	_e.clear();
+	_index.clear();
+	_free = -1;
+	for (int i = 0; i < MCASTTIMER_LEVELS * MCASTTIMER_SLOTS; i++)
+	  _head[i] = -1;
+	for (int l = 0; l < MCASTTIMER_LEVELS; l++)
+	  _level_size[l] = 0;
+  }
+
+ private:
+
+  struct Entry {
+	MembershipKey<A> key;
+	uint32_t expiry;
+	int prev;		// -1 if first in its slot
+	int next;		// -1 if last; next free entry when unused
+	int slot;		// index into _head
+  };
+
+  Vector<Entry> _e;
+  HashMap<MembershipKey<A>, int> _index;
+  int _head[MCASTTIMER_LEVELS * MCASTTIMER_SLOTS];
+  int _level_size[MCASTTIMER_LEVELS];
+  int _free;
+  uint32_t _now;
+
+  int alloc() {
+	if (_free >= 0) {
+	  int i = _free;
+	  _free = _e[i].next;
+	  return i;
+	}
+	_e.push_back(Entry());
+	return _e.size() - 1;
+  }
+
+  void release(int i) {
+	_e[i].next = _free;
+	_free = i;
+  }
+
+  void link(int i) {
+	Entry &e = _e[i];
+	int32_t d = e.expiry - _now;
+	uint32_t delta = (d > 0 ? d : 0);
+	uint32_t when = _now + delta;
+	int l = 0;
+	while (l < MCASTTIMER_LEVELS - 1
+		   && (delta >> (MCASTTIMER_SLOT_BITS * (l + 1))) != 0)
+	  l++;
+	e.slot = l * MCASTTIMER_SLOTS + ((when >> (MCASTTIMER_SLOT_BITS * l)) & (MCASTTIMER_SLOTS - 1));
+	e.prev = -1;
+	e.next = _head[e.slot];
+	if (e.next >= 0)
+	  _e[e.next].prev = i;
+	_head[e.slot] = i;
+	_level_size[l]++;
+  }
+
+  void unlink(int i) {
+	Entry &e = _e[i];
+	if (e.prev >= 0)
+	  _e[e.prev].next = e.next;
+	else
+	  _head[e.slot] = e.next;
+	if (e.next >= 0)
+	  _e[e.next].prev = e.prev;
+	_level_size[e.slot / MCASTTIMER_SLOTS]--;
+  }
+
+  MembershipTimers(const MembershipTimers<A> &);
+  MembershipTimers<A> &operator=(const MembershipTimers<A> &);
+
+};
+
+CLICK_ENDDECLS
+#endif
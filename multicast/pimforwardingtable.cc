@@ -22,6 +22,7 @@
 #include <click/router.hh>
 #include <click/error.hh>
 #include <click/confparse.hh>
+#include <click/straccum.hh>
 #include "debug.hh"
 
 PIMForwardingTable::PIMForwardingTable()
@@ -70,6 +71,19 @@ PIMForwardingTable::configure(Vector<String> &conf, ErrorHandler *errh)
 }
 
 
+/*******************************************************************************************
+ *                                                                                         *
+ * find_interface: returns the entry of an interface, or 0 if it is not a PIM interface    *
+ *                                                                                         *
+ *******************************************************************************************/
+PIMForwardingTable::piminterface *
+PIMForwardingTable::find_interface(IPAddress interface)
+{
+  for(int i=0; i<piminterfaces.size(); ++i)
+	if(piminterfaces[i].interface==interface) return &piminterfaces[i];
+  return 0;
+}
+
 /*******************************************************************************************
  *                                                                                         *
  * addgroup: adds  group, source and upstream neighbor address to an existing interface    * 
@@ -83,28 +97,12 @@ bool PIMForwardingTable::addgroup(IPAddress interface,
 
   debug_msg("PIMForwardingTable: PIM addgroup");
 
-  groupsource gs;
-  //  gs.neighbor=IPAddress(ntohl(upstreamneighbor));
-  gs.group=IPAddress((group));
-  gs.source=IPAddress(ntohl(source));
-
-  // go through all pim interfaces...
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	if( IPAddress((*i).interface) == IPAddress(interface) )
-	  {
-		// and check for double entries...
-		Vector<groupsource>::iterator g;
-		for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-		  if( (*g).group.addr()==gs.group.addr() ) return false;
-		}
-		// before finally adding the group address.
-		(*i).groupsources.push_back(gs);
-		printgroups();
-		return true;
-	  }
-  }
-  return false;
+  piminterface *i = find_interface(interface);
+  if(!i) return false;
+  // double entries are refused
+  if(!channels.add(IPAddress(ntohl(source)), group, i->neighbor)) return false;
+  printgroups();
+  return true;
 }
 
 bool PIMForwardingTable::delgroup(IPAddress interface,
@@ -115,34 +113,17 @@ bool PIMForwardingTable::delgroup(IPAddress interface,
 
   debug_msg("PIMForwardingTable: PIM delgroup");
 
-  // go through all pim interfaces...
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	if( IPAddress((*i).interface) == IPAddress(interface) )
-	  {
-		debug_msg("PIMForwardingTable: delgroup found interface");
-		// and check for group entries...
-		Vector<groupsource>::iterator g;
-		for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-			debug_msg("PIMForwardingTable: delgroup at source %x", source.addr());
-			debug_msg("PIMForwardingTable: delgroup at group %x", group.addr());
-		  if( ( (*g).group.addr()==group.addr() ) &&  ( (*g).source.addr()==htonl(source.addr())) ) {
-
-			(*i).groupsources.erase(g);
-			return true;
-		  }
-		}
-	  }
-  }
-  return false;
+  piminterface *i = find_interface(interface);
+  if(!i) return false;
+  debug_msg("PIMForwardingTable: delgroup found interface");
+  debug_msg("PIMForwardingTable: delgroup at source %x", source.addr());
+  debug_msg("PIMForwardingTable: delgroup at group %x", group.addr());
+  return channels.remove(IPAddress(htonl(source.addr())), group, i->neighbor);
 }
 
 bool PIMForwardingTable::addinterface(IPAddress interface, IPAddress neighbor)
 {
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) {
-	if(IPAddress((*i).interface)==IPAddress(interface)) return false;
-  }
+  if(find_interface(interface)) return false;
   debug_msg("PIMForwardingTable: PIM addinterface");
   piminterface newinterface;
   newinterface.interface=IPAddress(interface);
@@ -154,14 +135,13 @@ bool PIMForwardingTable::addinterface(IPAddress interface, IPAddress neighbor)
 
 bool PIMForwardingTable::printgroups()
 {
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	  {
-		Vector<groupsource>::iterator g;
-		for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-		  debug_msg("PIMForwardingTable: PIM: g-%x s-%x n-%x", (*g).group.addr(), (*g).source.addr(), (*g).neighbor.addr());
-		}
+  typedef ChannelFanout<IPAddress>::Group Fanout;
+  for(HashMap<IPAddress, Fanout>::const_iterator g=channels.groups().begin(); g; g++) {
+	for(HashMap<IPAddress, Vector<IPAddress> >::const_iterator s=g.value().sources.begin(); s; s++) {
+	  for(int n=0; n<s.value().size(); ++n) {
+		debug_msg("PIMForwardingTable: PIM: g-%x s-%x n-%x", g.key().addr(), s.key().addr(), s.value()[n].addr());
 	  }
+	}
   }
   return true;
 }
@@ -178,75 +158,135 @@ void PIMForwardingTable::push(int port, Packet *p_in)
   IPAddress group=IPAddress(p_in->dst_ip_anno());
   click_ip* ip;
   ip=(click_ip *)p_in->data();
-  IPAddress source=IPAddress(ip->ip_src);
-  if(piminterfaces.size()!=0) {
-	Vector<piminterface>::iterator  i;
-	for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i)
-	  {
-
-		if((*i).groupsources.size() != 0)
-		  {
-			Vector<groupsource>::iterator  g;
-			for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-			  //			  click_chatter("PIMForwardingTable: comparing %x to %x",(*g).group.addr(), group.addr()); 
-			  if((*g).source.addr()==ntohl(source.addr()) && (group.addr())==((*g).group.addr())) 
-				{
-				  Packet *q_in = p_in->clone();
-				  WritablePacket *p = q_in->uniqueify();
-				  click_ip *ip = p->ip_header();
-				  ip->ip_ttl=(ip->ip_ttl)-1;
-				  //				  p->set_dst_ip_anno(IPAddress(htonl((*g).neighbor.addr())));
-				  p->set_dst_ip_anno(IPAddress((*i).neighbor.addr()));
-				  int hlen = ip->ip_hl << 2;
-				  ip->ip_sum = 0;
-				  ip->ip_sum = click_in_cksum((unsigned char *)ip, hlen);
-				  output(0).push(p);
-				  // click_chatter("PIMForwardingTable: forwarding ...");
-				}
-			}
-		  }
-		else
-		  {
-			//	debug_msg("PIMForwardingTable: PIM forwarding table is empty, no other PIM routers requested this group");
-		  }
-		
-	  }
+  IPAddress source=IPAddress(ntohl(ip->ip_src.s_addr));
+  const Vector<IPAddress> *out = channels.out(source, group);
+  if(out) {
+	for(int n=0; n<out->size(); ++n) {
+	  Packet *q_in = p_in->clone();
+	  WritablePacket *p = q_in->uniqueify();
+	  click_ip *ip = p->ip_header();
+	  ip->ip_ttl=(ip->ip_ttl)-1;
+	  p->set_dst_ip_anno((*out)[n]);
+	  int hlen = ip->ip_hl << 2;
+	  ip->ip_sum = 0;
+	  ip->ip_sum = click_in_cksum((unsigned char *)ip, hlen);
+	  output(0).push(p);
+	  // click_chatter("PIMForwardingTable: forwarding ...");
+	}
   }
+  else
+	{
+	  //	debug_msg("PIMForwardingTable: PIM forwarding table is empty, no other PIM routers requested this group");
+	}
+  // only copies leave this element
+  p_in->kill();
 }
 
 uint32_t PIMForwardingTable::get_upstreamneighbor(IPAddress interface)
 {
-  if(piminterfaces.size()!=0) {
-	Vector<piminterface>::iterator  i;
-	for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i)
-	  {
-		  if((*i).interface.addr()==interface.addr()) 
-			{
-			  //	  click_chatter("interafce %x -- neighbor %x",(*i).interface,(*i).neighbor );
-			  return IPAddress((*i).neighbor);
-			} 
-		}
-  }
-  return 0;
+  piminterface *i = find_interface(interface);
+  //	  click_chatter("interafce %x -- neighbor %x",(*i).interface,(*i).neighbor );
+  return i ? i->neighbor.addr() : 0;
 }
 
 // returns false if no PIM receivers are known
 bool PIMForwardingTable::getPIMreceivers(IPAddress source, IPAddress group)
 {
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	{
-	  Vector<groupsource>::iterator g;
-	  for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-		debug_msg("PIMForwardingTable getPIMreceivers: source %x group %x", source.addr(), group.addr());
-		if((*g).source.addr()==(source.addr()) && (group.addr())==((*g).group.addr())) {
-		  debug_msg("PIMForwardingTable getPIMreceivers: found active group");
-		  return false;
-		}
-	  }
-	}
+  debug_msg("PIMForwardingTable getPIMreceivers: source %x group %x", source.addr(), group.addr());
+  if(channels.has(source, group)) {
+	debug_msg("PIMForwardingTable getPIMreceivers: found active group");
+	return false;
   }
   return true;
 }
 
+/*******************************************************************************************
+ *                                                                                         *
+ * populate: adds synthetic channels for benchmarks                                        *
+ *           addresses are counted up from the given base addresses                        *
+ *                                                                                         *
+ *******************************************************************************************/
+static IPAddress
+offset_address(IPAddress base, uint32_t i)
+{
+  return IPAddress(htonl(ntohl(base.addr()) + i));
+}
+
+int
+PIMForwardingTable::populate(uint32_t groups, uint32_t sources, uint32_t neighbors,
+							 IPAddress group, IPAddress source, IPAddress neighbor)
+{
+  int added=0;
+  for(uint32_t g=0; g<groups; ++g)
+	for(uint32_t s=0; s<sources; ++s)
+	  for(uint32_t n=0; n<neighbors; ++n)
+		// sources are kept in host byte order, see push
+		if(channels.add(IPAddress(ntohl(offset_address(source, s).addr())),
+						offset_address(group, g),
+						offset_address(neighbor, n)))
+		  added++;
+  return added;
+}
+
+String
+PIMForwardingTable::print_stats()
+{
+  StringAccum sa;
+  sa << "channels " << channels.nchannels() << "\n";
+  sa << "out_entries " << channels.nentries() << "\n";
+  return sa.take_string();
+}
+
+enum { H_STATS, H_POPULATE, H_CLEAR };
+
+static String
+pimforwardingtable_read_handler(Element *e, void *thunk)
+{
+  PIMForwardingTable *pft = (PIMForwardingTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_STATS:
+	return pft->print_stats();
+  default:
+	return String();
+  }
+}
+
+static int
+pimforwardingtable_write_handler(const String &in_s, Element *e, void *thunk, ErrorHandler *errh)
+{
+  PIMForwardingTable *pft = (PIMForwardingTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_POPULATE: {
+	Vector<String> conf;
+	cp_argvec(in_s, conf);
+	uint32_t groups=0, sources=1, neighbors=1;
+	IPAddress group(String("232.1.0.0")), source(String("10.0.0.1")), neighbor(String("10.2.0.1"));
+	if (cp_va_kparse(conf, e, errh,
+					 "GROUPS", cpkP+cpkM, cpUnsigned, &groups,
+					 "SOURCES", cpkP, cpUnsigned, &sources,
+					 "NEIGHBORS", cpkP, cpUnsigned, &neighbors,
+					 "GROUP", 0, cpIPAddress, &group,
+					 "SOURCE", 0, cpIPAddress, &source,
+					 "NEIGHBOR", 0, cpIPAddress, &neighbor,
+					 cpEnd) < 0)
+	  return -1;
+	pft->populate(groups, sources, neighbors, group, source, neighbor);
+	return 0;
+  }
+  case H_CLEAR:
+	pft->channels.clear();
+	return 0;
+  default:
+	return -1;
+  }
+}
+
+void
+PIMForwardingTable::add_handlers()
+{
+  add_read_handler("stats", pimforwardingtable_read_handler, (void *)H_STATS);
+  add_write_handler("populate", pimforwardingtable_write_handler, (void *)H_POPULATE);
+  add_write_handler("clear", pimforwardingtable_write_handler, (void *)H_CLEAR);
+}
+
 EXPORT_ELEMENT(PIMForwardingTable)
@@ -2,6 +2,8 @@
 #define PIMFORWARDINGTABLE_HH
 CLICK_DECLS
 #include <click/element.hh>
+#include <click/ipaddress.hh>
+#include "mcastindex.hh"
 
 /*
 =c
@@ -11,6 +13,24 @@ PIMForwardingTable()
 
 =d
 Takes care of arriving multicast traffic. Streams are duplicated and forwarded to neighbouring routers which are connected to Rendezvous Point or Source Path Trees.
+The neighbors of each (source, group) channel are kept in a hash table, so a packet is forwarded with a single lookup.
+
+=h stats read-only
+
+Numbers of (source, group) channels and of outgoing neighbor entries.
+
+=h populate write-only
+
+Fills the table with synthetic channels, for benchmarks.  Takes keyword
+arguments GROUPS, SOURCES and NEIGHBORS (unsigned integers), and GROUP,
+SOURCE and NEIGHBOR (IP addresses, defaulting to 232.1.0.0, 10.0.0.1 and
+10.2.0.1).  Every channel of the GROUPS groups starting at GROUP and the
+SOURCES sources starting at SOURCE is forwarded to the NEIGHBORS neighbors
+starting at NEIGHBOR.
+
+=h clear write-only
+
+Removes every channel.
 
 =a
 IPMulticastTable, IGMP, PIMControl, PIM, IPMulticastEtherEncap, FixPIMSource
@@ -35,30 +55,23 @@ class PIMForwardingTable : public Element {
   const char *processing() const	{ return "h/h"; }
 
   /*
-   * groupsource holds a group address and all allowed sources
-   *
-   * a pair of group / source Address is also known as "channel"
-   *
-   */  
-  struct groupsource {
-	IPAddress neighbor;
-	IPAddress group;
-	IPAddress source;
-  };
-
-
-  /*
-   * pimtable holds the IP address of an interface and all source/group entries
+   * pimtable holds the IP address of an interface and its PIM neighbor
    *
    */
   struct piminterface {
     IPAddress interface;                           // interface
 	IPAddress neighbor;
-	Vector<groupsource> groupsources; 
   };
 
   Vector<piminterface> piminterfaces;
 
+  /*
+   * channels maps each pair of source / group address, also known as "channel",
+   * to the neighbors that joined it
+   *
+   */
+  ChannelFanout<IPAddress> channels;
+
   bool addinterface(IPAddress, IPAddress);
   bool addgroup(IPAddress, IPAddress, IPAddress, IPAddress);
   bool delgroup(IPAddress);
@@ -67,6 +80,13 @@ class PIMForwardingTable : public Element {
   void push(int, Packet *);
   uint32_t get_upstreamneighbor(IPAddress);
   bool getPIMreceivers(IPAddress, IPAddress);
+
+  void add_handlers();
+  String print_stats();
+  int populate(uint32_t, uint32_t, uint32_t, IPAddress, IPAddress, IPAddress);
+
+ private:
+  piminterface *find_interface(IPAddress);
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,150 @@
+#ifndef IP6MCASTBENCHSOURCE_HH
+#define IP6MCASTBENCHSOURCE_HH
+#include <click/element.hh>
+#include <click/ip6address.hh>
+#include <click/task.hh>
+#include <click/timestamp.hh>
+
+/*
+=c
+IP6MulticastBenchSource(GROUPS, SOURCES, [I<KEYWORDS>])
+
+=s IPv6 Multicast
+
+=d
+Generates UDP multicast packets from memory, for benchmarking
+IP6MulticastTable and IP6PIMForwardingTable.  Packet number i is sent from source
+SOURCE + ((i / GROUPS) mod SOURCES) to group GROUP + (i mod GROUPS), so that
+every (source, group) channel made by the populate handlers of those
+elements is hit in turn.  The destination address annotation is set to the
+group.  Addresses are counted up in their last 32 bits.
+
+The time each packet spends in the push path downstream of
+IP6MulticastBenchSource, i.e. forwarding and copying it to all receivers, is
+measured in CPU cycles.
+
+Keyword arguments are:
+
+=over 8
+
+=item GROUP
+
+IPv6 address.  The first group.  Defaults to ff3e::8000:0.
+
+=item SOURCE
+
+IPv6 address.  The first source.  Defaults to fec0::1.
+
+=item LENGTH
+
+Unsigned integer.  Packet length, IPv6 header included.  Defaults to 64.
+
+=item LIMIT
+
+Unsigned integer.  Number of packets to send; 0 means no limit.  Defaults to
+1000000.
+
+=item BURST
+
+Unsigned integer.  Packets sent per task run.  Defaults to 32.
+
+=item STOP
+
+Boolean.  If true, stop the driver after LIMIT packets.  Defaults to false.
+
+=item ACTIVE
+
+Boolean.  If false, send nothing until the active handler is set to true,
+e.g. after the tables are populated.  Defaults to true.
+
+=back
+
+=h count read-only
+
+Packets sent so far.
+
+=h rate read-only
+
+Packets sent, seconds from the first to the last packet, and packets per
+second.
+
+=h latency read-only
+
+Mean, median, 99th percentile and maximum CPU cycles per packet.  Median and
+percentile are rounded up to a power of two.
+
+=h reset write-only
+
+Zeroes the counters.  Writing true to active afterwards sends LIMIT more
+packets, starting again from the first channel.
+
+=h active write-only
+
+Starts or stops sending.
+
+=e
+src :: IP6MulticastBenchSource(1000, 4, LIMIT 1000000, STOP true, ACTIVE false)
+  -> mct :: IP6MulticastTable;
+mct[0] -> Discard;
+mct[1] -> pft :: IP6PIMForwardingTable(fe80::1) -> Discard;
+DriverManager(write mct.populate 1000 10 4, write pft.populate 1000 4 2,
+	write src.active true, wait, print src.rate, print src.latency, stop)
+
+=a IP6MulticastTable, IP6PIMForwardingTable, MulticastBenchSource, InfiniteSource
+*/
+
+CLICK_DECLS
+
+class IP6MulticastBenchSource : public Element {
+
+ public:
+
+  IP6MulticastBenchSource();
+  ~IP6MulticastBenchSource();
+
+  const char *class_name() const	{ return "IP6MulticastBenchSource"; }
+  const char *port_count() const	{ return "0/1"; }
+  const char *processing() const	{ return "h"; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  bool run_task(Task *);
+  void add_handlers();
+
+  uint32_t count() const		{ return _count; }
+  String print_rate();
+  String print_latency();
+  void reset();
+  void set_active(bool);
+
+ private:
+
+  // packets by cycles taken, bucket b holding those below 2^b cycles
+  enum { BUCKETS = 40 };
+
+  uint32_t _groups;
+  uint32_t _sources;
+  IP6Address _group;
+  IP6Address _source;
+  uint32_t _length;
+  uint32_t _limit;
+  uint32_t _burst;
+  bool _stop;
+  bool _active;
+
+  Packet *_template;
+  uint32_t _count;
+  Timestamp _first;
+  Timestamp _last;
+  uint64_t _cycles;
+  uint64_t _max_cycles;
+  uint32_t _histogram[BUCKETS];
+
+  Task _task;
+
+  uint64_t percentile(double) const;
+};
+
+CLICK_ENDDECLS
+#endif
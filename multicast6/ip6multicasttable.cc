@@ -20,9 +20,11 @@
 #include <click/router.hh>
 #include <click/error.hh>
 #include <click/confparse.hh>
+#include <click/straccum.hh>
 #include "ip6multicasttable.hh"
 
 IP6MulticastTable::IP6MulticastTable()
+  : pPim(0), use_pim(false)
 {
 }
 
@@ -51,6 +53,7 @@ IP6MulticastTable::configure(Vector<String> &conf, ErrorHandler *errh)
 	  return -1;
 	}
 	pPim = (IP6PIMControl *)e->cast("IP6PIMControl");
+	use_pim = (pPim != 0);
 	/*  }
 		else {
  // return errh->error("wrong number of arguments; expected 'IP6MulticastTable(optional PIM element)'");
@@ -69,16 +72,9 @@ IP6MulticastTable::printIP6(IP6Address group)
 
 bool IP6MulticastTable::addgroup(IP6Address group)
 {
-  MulticastGroup newgroup;
-  newgroup.group = group;
-  Vector<MulticastGroup>::iterator i;
   // check if entry already exists
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) { 
-	if(IP6Address((*i).group)==IP6Address(group)) return false;
-  }
-  multicastgroups.push_back(newgroup);
+  return multicastgroups.add_group(group);
   //  pPim->join(group);
-  return true;
 }
 
 /*******************************************************************************************
@@ -88,37 +84,20 @@ bool IP6MulticastTable::addgroup(IP6Address group)
  *******************************************************************************************/
 bool IP6MulticastTable::joingroup(IP6Address recv, IP6Address group)
 {
-  receiver new_receiver;           // create new receiver struct
-  new_receiver.receiver=recv;      // initialize this new struct with receivers IP address
-
-  Vector<MulticastGroup>::iterator i;
-
-   for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
-
-	if(IP6Address((*i).group)==IP6Address(group)) {
-
-	  // search for duplicate entries
-	  
-	  Vector<receiver>::iterator a;
-	  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a) {
-		if( IP6Address((*a).receiver)==IP6Address(recv) ) { 
-		  //		  debug_msg("Duplicate request to add");
-		  //		  printIP6(recv);
-		  //		  debug_msg("to group");
-		  //		  printIP6(group);
-		  return false;  
-		}
-	  }
-	  const unsigned char *p = group.data();
-	  const unsigned char *p2 = recv.data();
-	  debug_msg("Adding");
-	  printIP6(recv);
-	  debug_msg("  to group");
-   	  printIP6(group);
-	  (*i).receivers.push_back(new_receiver); 
-	}
+  if(!multicastgroups.find(group)) return true;
+
+  // search for duplicate entries
+  if(!multicastgroups.join(recv, group, 0)) {
+	//		  debug_msg("Duplicate request to add");
+	//		  printIP6(recv);
+	//		  debug_msg("to group");
+	//		  printIP6(group);
+	return false;  
   }
-   // printgroups(true);
+  debug_msg("Adding");
+  printIP6(recv);
+  debug_msg("  to group");
+  printIP6(group);
   return true;
 }
 
@@ -130,37 +109,14 @@ bool IP6MulticastTable::joingroup(IP6Address recv, IP6Address group)
  *******************************************************************************************/
 bool IP6MulticastTable::leavegroup(IP6Address recv, IP6Address group)
 {
-
-  Vector<MulticastGroup>::iterator i;
-
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
-
-
-	if(IP6Address((*i).group)==IP6Address(group)) {
-	  // debug_msg("leavegroup found group");
-
-	  Vector<receiver>::iterator a;
-
-	  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a) {
-		if( IP6Address((*a).receiver)==IP6Address(recv) ) {
-		  debug_msg("Deleting");
-		  printIP6(recv);
-		  debug_msg("  from group");
-		  printIP6(group);
-		  (*i).receivers.erase(a);
-		  
-		  // if no more receivers exist, the group is deleted
-		  if((*i).receivers.begin()==(*i).receivers.end()) {
-			// (XXX) send a listener query first
-			multicastgroups.erase(i);
-			return true;
-		  }
-		  return true;
-		}
-	  }
-	}
-  }
-  return false; 
+  // if no more receivers exist, the group is deleted
+  // (XXX) send a listener query first
+  if(!multicastgroups.leave(recv, group)) return false; 
+  debug_msg("Deleting");
+  printIP6(recv);
+  debug_msg("  from group");
+  printIP6(group);
+  return true;
 }
 
 /*******************************************************************************************
@@ -169,17 +125,15 @@ bool IP6MulticastTable::leavegroup(IP6Address recv, IP6Address group)
  *                displays receivers in a group and their sources (if existing)            *
  *                                                                                         *
  *******************************************************************************************/
-bool IP6MulticastTable::printreceiver(Vector<MulticastGroup>::iterator i)
+bool IP6MulticastTable::printreceiver(const MulticastGroup *g)
 {
-  Vector<receiver>::iterator re;
-  for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re) {
-
-	Vector<click_in6_addr>::iterator a;
+  for(int re=0; re<g->receivers.size(); ++re) {
+	const receiver &r = g->receivers[re];
 	debug_msg("  receiver:");
-	printIP6(IP6Address((*re).receiver));
-	for(a=(*re).sources.begin(); a!=(*re).sources.end(); ++a) {
+	printIP6(r.addr);
+	for(int a=0; a<r.sources.size(); ++a) {
 	  debug_msg("    allowed source");
-	  printIP6(IP6Address((*a)));
+	  printIP6(r.sources[a]);
 	}
   }
   return true; 
@@ -194,13 +148,13 @@ bool IP6MulticastTable::printreceiver(Vector<MulticastGroup>::iterator i)
  *******************************************************************************************/
 bool IP6MulticastTable::printgroups(bool printreceivers)
 {
-  Vector<MulticastGroup>::iterator i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
+  for(int i=0; i<multicastgroups.size(); ++i) {
+	const MulticastGroup *g = multicastgroups.group(i);
 	debug_msg("Printing groups: IP group address:");
-	printIP6(IP6Address((*i).group));
+	printIP6(g->group);
 	if(printreceivers) {
 	  	debug_msg("receivers in group:");
-		printreceiver(i);
+		printreceiver(g);
 	}
   }
   return true;
@@ -211,33 +165,27 @@ bool IP6MulticastTable::printgroups(bool printreceivers)
  *                                                                                         *
  * push: every arriving packet is handled by the oush function                             *
  *             the forwarding of a multicast packet is done here                           *
+ *             the receivers of the packet's channel are looked up in the group index      *
  *                                                                                         *
  *******************************************************************************************/
 void IP6MulticastTable::push(int port, Packet *p_in)
 {
-  bool submitted_packet=false;
-  click_in6_addr group=click_in6_addr(DST_IP6_ANNO(p_in));
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(((*i).receivers.size() != 0) && IP6Address(group)==IP6Address((*i).group)) 
-
-		{
-		  Vector<receiver>::iterator a;
-		  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a)
-			{
-			  submitted_packet=true;
-			  Packet *q_in = p_in->clone();
-			  WritablePacket *p = q_in->uniqueify();
-			  click_ip6 *ip = p->ip6_header();
-			  ip->ip6_hlim++;
-			  click_in6_addr r=click_in6_addr((*a).receiver);
-			  SET_DST_IP6_ANNO(p, r);
-			  output(0).push(p);
-			}
-		}
-	}
-	output(1).push(p_in);
+  IP6Address group=IP6Address(DST_IP6_ANNO(p_in));
+  IP6Address source=IP6Address(p_in->ip6_header()->ip6_src);
+  const Vector<IP6Address> *out = multicastgroups.out(source, group);
+
+  if(out) {
+	for(int a=0; a<out->size(); ++a)
+	  {
+		Packet *q_in = p_in->clone();
+		WritablePacket *p = q_in->uniqueify();
+		click_ip6 *ip = p->ip6_header();
+		ip->ip6_hlim++;
+		SET_DST_IP6_ANNO(p, (*out)[a]);
+		output(0).push(p);
+	  }
+  }
+  output(1).push(p_in);
 }
 
 /*******************************************************************************************
@@ -248,35 +196,14 @@ void IP6MulticastTable::push(int port, Packet *p_in)
 bool IP6MulticastTable::addsource(IP6Address recv, IP6Address group, IP6Address sa)
 {
   //  debug_msg("addsource");
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(IP6Address(group)==IP6Address((*i).group)) 
-		{
-		  Vector<receiver>::iterator re;
-		  for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re)
-			{
-			  if(IP6Address((*re).receiver)==IP6Address(recv)) {
-				Vector<click_in6_addr>::iterator a;
-				for(a=(*re).sources.begin(); a!=(*re).sources.end(); a++) {
-				  //  if(IP6Address((*a))==IP6Address(sa)) {// PIM-Embedded RP test
-					//					debug_msg("addsource: Duplicate request to add source");
-				  return false; 
-				  //				  }
-
-				}
-				(*re).sources.push_back(click_in6_addr(sa));
-				//const unsigned char *p = sa.data();
-				//	debug_msg("IP source address: %d.%d.%d.%d", p[0], p[1], p[2], p[3]);
-				if ( (pPim->noPIMreceivers(group, sa)) ) {
-					  pPim->generatejoinprune(group, sa, true);
-				  	}
-				return true;				
-			  }
-			}
-		}
-	}
-  return false;
+  if(!multicastgroups.add_source(recv, group, sa)) {
+	//					debug_msg("addsource: Duplicate request to add source");
+	return false;
+  }
+  if ( use_pim && pPim->noPIMreceivers(group, sa) ) {
+	pPim->generatejoinprune(group, sa, true);
+  }
+  return true;				
 }
 
 /*******************************************************************************************
@@ -286,95 +213,156 @@ bool IP6MulticastTable::addsource(IP6Address recv, IP6Address group, IP6Address
  *******************************************************************************************/
 bool IP6MulticastTable::delsource(IP6Address recv, IP6Address group, IP6Address sa)
 {
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(IP6Address(group)==IP6Address((*i).group)) 
-		{
-		  Vector<receiver>::iterator re;
-		  for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re)
-			{
-			  if(IP6Address((*re).receiver)==IP6Address(recv)) {
-				Vector<click_in6_addr>::iterator a;
-				for(a=(*re).sources.begin(); a!=(*re).sources.end(); ++a) {
-				  if(IP6Address((*a))==IP6Address(sa)) {
-					(*re).sources.erase(a);
-					// "dead" receivers are dropped from the list
-					if((get_receiver_mode(recv, group)==INCLUDEMODE) && ((*re).sources.size()==0)) leavegroup(recv, group); 
-					if ( pPim->noPIMreceivers(group, sa) ) {
-					  pPim->generatejoinprune(group, sa, false);
-					}
-					return true;
-				  }
-				}
-			  }
-			}
-		}
-	}
-  return false;
+  if(!multicastgroups.del_source(recv, group, sa)) return false;
+  // "dead" receivers are dropped from the list
+  receiver *re = multicastgroups.find_receiver(recv, group);
+  if((re->mode==INCLUDEMODE) && (re->sources.size()==0)) leavegroup(recv, group); 
+  if ( use_pim && pPim->noPIMreceivers(group, sa) ) {
+	pPim->generatejoinprune(group, sa, false);
+  }
+  return true;
 }
 
 unsigned char
 IP6MulticastTable::get_receiver_mode(IP6Address recv, IP6Address group)
 {
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(IP6Address(group)==IP6Address((*i).group)) 
-		{
-		  Vector<receiver>::iterator a;
-		  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a)
-			{
-			  if(IP6Address((*a).receiver)==IP6Address(recv))  return (*a).mode;
-			}
-		}
-	}
-  return MODE_NOT_SET;
+  receiver *re = multicastgroups.find_receiver(recv, group);
+  return re ? re->mode : MODE_NOT_SET;
 }
 
 
 bool
 IP6MulticastTable::set_receiver_mode(IP6Address recv, IP6Address group, MODE mode)
 {
-  Vector<MulticastGroup>::iterator  i;
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i)
-	{
-	  if(IP6Address(group)==IP6Address((*i).group)) 
-		{
-		  //		  debug_msg("found group");
-		  Vector<receiver>::iterator a;
-		  for(a=(*i).receivers.begin(); a!=(*i).receivers.end(); ++a)
-			{
-			  if(IP6Address((*a).receiver)==IP6Address(recv))  {
-				(*a).mode=mode;
-				return true;
-				//				debug_msg("setmode %x", mode);
-			  }
-			}
-		}
-	}
-  return false;
+  return multicastgroups.set_mode(recv, group, mode);
+  //				debug_msg("setmode %x", mode);
 }
 
 // check whether MLD listeners are attached or not
 bool IP6MulticastTable::getMLDreceivers(IP6Address source, IP6Address group)
 {
-  Vector<MulticastGroup>::iterator i;
-
-  for(i=multicastgroups.begin(); i!=multicastgroups.end(); ++i) {
-    if(IP6Address((*i).group)==IP6Address(group)) {
-      debug_msg("IP6Multicasttable: getMLDreceivers found group");
-      Vector<receiver>::iterator re;
-      for(re=(*i).receivers.begin(); re!=(*i).receivers.end(); ++re) {
-	Vector<click_in6_addr>::iterator a;
-	for(a=(*re).sources.begin(); a!=(*re).sources.end(); ++a) {
-	  //	  if( IP6Address(*a)==IP6Address(source) ) // non SSM test
-	    return false; 
-	}
-      }
-    }
+  // the (source, group) channel is in use if any receiver of the group names the source
+  if(multicastgroups.has_channel(source, group)) {
+	debug_msg("IP6Multicasttable: getMLDreceivers found group");
+	return false;
   }
   return true; 
 }
 
+/*******************************************************************************************
+ *                                                                                         *
+ * populate: adds synthetic groups, listeners and sources for benchmarks                   *
+ *           addresses are counted up from the given base addresses                        *
+ *                                                                                         *
+ *******************************************************************************************/
+static IP6Address
+offset_address(IP6Address base, uint32_t i)
+{
+  IP6Address a(base);
+  unsigned char *d = a.data();
+  uint32_t x = ((d[12] << 24) | (d[13] << 16) | (d[14] << 8) | d[15]) + i;
+  d[12] = x >> 24;
+  d[13] = x >> 16;
+  d[14] = x >> 8;
+  d[15] = x;
+  return a;
+}
+
+int
+IP6MulticastTable::populate(uint32_t groups, uint32_t receivers, uint32_t sources,
+							IP6Address group, IP6Address recv, IP6Address source)
+{
+  Vector<receiver> rs;
+  for(uint32_t r=0; r<receivers; ++r) {
+	receiver re;
+	re.addr=offset_address(recv, r);
+	if(sources) re.mode=INCLUDEMODE;
+	for(uint32_t s=0; s<sources; ++s)
+	  re.sources.push_back(offset_address(source, s));
+	rs.push_back(re);
+  }
+  int added=0;
+  for(uint32_t g=0; g<groups; ++g) {
+	IP6Address ga=offset_address(group, g);
+	multicastgroups.add_group(ga);
+	added+=multicastgroups.join_all(ga, 0, rs);
+  }
+  return added;
+}
+
+String
+IP6MulticastTable::print_stats()
+{
+  int receivers=0, sources=0, channels=0, entries=0;
+  for(int i=0; i<multicastgroups.size(); ++i) {
+	const MulticastGroup *g = multicastgroups.group(i);
+	receivers += g->receivers.size();
+	for(int r=0; r<g->receivers.size(); ++r)
+	  sources += g->receivers[r].sources.size();
+	channels += g->channels.size();
+	for(HashMap<IP6Address, MulticastMembership<IP6Address>::Channel>::const_iterator c=g->channels.begin(); c; c++)
+	  entries += c.value().out.size();
+	entries += g->any.size();
+  }
+  StringAccum sa;
+  sa << "groups " << multicastgroups.size() << "\n";
+  sa << "listeners " << receivers << "\n";
+  sa << "sources " << sources << "\n";
+  sa << "channels " << channels << "\n";
+  sa << "out_entries " << entries << "\n";
+  return sa.take_string();
+}
+
+enum { H_STATS, H_POPULATE, H_CLEAR };
+
+static String
+ip6multicasttable_read_handler(Element *e, void *thunk)
+{
+  IP6MulticastTable *mct = (IP6MulticastTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_STATS:
+	return mct->print_stats();
+  default:
+	return String();
+  }
+}
+
+static int
+ip6multicasttable_write_handler(const String &in_s, Element *e, void *thunk, ErrorHandler *errh)
+{
+  IP6MulticastTable *mct = (IP6MulticastTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_POPULATE: {
+	Vector<String> conf;
+	cp_argvec(in_s, conf);
+	uint32_t groups=0, receivers=1, sources=0;
+	IP6Address group("ff3e::8000:0"), recv("fec0::1:0:1"), source("fec0::1");
+	if (cp_va_kparse(conf, e, errh,
+					 "GROUPS", cpkP+cpkM, cpUnsigned, &groups,
+					 "RECEIVERS", cpkP, cpUnsigned, &receivers,
+					 "SOURCES", cpkP, cpUnsigned, &sources,
+					 "GROUP", 0, cpIP6Address, &group,
+					 "RECEIVER", 0, cpIP6Address, &recv,
+					 "SOURCE", 0, cpIP6Address, &source,
+					 cpEnd) < 0)
+	  return -1;
+	mct->populate(groups, receivers, sources, group, recv, source);
+	return 0;
+  }
+  case H_CLEAR:
+	mct->multicastgroups.clear();
+	return 0;
+  default:
+	return -1;
+  }
+}
+
+void
+IP6MulticastTable::add_handlers()
+{
+  add_read_handler("stats", ip6multicasttable_read_handler, (void *)H_STATS);
+  add_write_handler("populate", ip6multicasttable_write_handler, (void *)H_POPULATE);
+  add_write_handler("clear", ip6multicasttable_write_handler, (void *)H_CLEAR);
+}
+
 EXPORT_ELEMENT(IP6MulticastTable)
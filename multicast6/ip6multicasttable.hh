@@ -5,6 +5,7 @@
 #include <click/element.hh>
 #include <clicknet/ip6.h>
 #include <click/ip6address.hh>
+#include "../multicast/mcastindex.hh"
 #include "debug.hh"
 
 
@@ -17,7 +18,30 @@ IP6MulticastTable(IP6PIMControl)
 =d
 Includes data structures to store addresses of receivers of multicast streams (IPv6).
 Each multicast group entry can hold information about senders and receivers.
-The data structures is based upon STL containers.
+Groups are kept in a hash table.  For every group the table keeps the list
+of receivers for each source named by a receiver (SSM channel) and the list
+for all other sources, honoring the INCLUDE and EXCLUDE source filters, so
+forwarding a packet does not scan the groups or the receivers' source lists.
+
+=h stats read-only
+
+Numbers of groups, listeners, source filter entries, (source, group)
+channels and outgoing list entries.
+
+=h populate write-only
+
+Fills the table with synthetic memberships, for benchmarks.  Takes
+keyword arguments GROUPS, RECEIVERS and SOURCES (unsigned integers), and
+GROUP, RECEIVER and SOURCE (IPv6 addresses, defaulting to ff3e::8000:0,
+fec0::1:0:1 and fec0::1).  Adds GROUPS groups starting at GROUP, each
+joined by the RECEIVERS listeners starting at RECEIVER; addresses are
+counted up in their last 32 bits.  With SOURCES 0 the listeners accept any
+source; otherwise each is in INCLUDE mode with the SOURCES sources starting
+at SOURCE.  PIM is not told about these memberships.
+
+=h clear write-only
+
+Removes every group.
 
 =e
 mct::IP6MulticastTable("pimctl");
@@ -59,26 +83,15 @@ class IP6MulticastTable : public Element {
 
 
 
-  struct receiver {
-	click_in6_addr receiver;
-	MODE mode;
-	Vector<click_in6_addr> sources; // for SSM = Source Specific Multicast the senders IPs are needed
-  };
-
-  //  receiver *new_receiver;
-
-  struct MulticastGroup {
-	click_in6_addr group; // group address
-	Vector<receiver> receivers; // a group can be joined by one or more receivers
-  };
+  // for SSM = Source Specific Multicast the senders IPs are kept per receiver
+  typedef MulticastMembership<IP6Address>::Receiver receiver;
+  typedef MulticastMembership<IP6Address>::Group MulticastGroup;
 
-  MulticastGroup *gp;
-
-  Vector<MulticastGroup> multicastgroups;
+  MulticastMembership<IP6Address> multicastgroups;
 
   int configure(Vector<String> &, ErrorHandler *);
   void printIP6(IP6Address);
-  bool printreceiver(Vector<MulticastGroup>::iterator);
+  bool printreceiver(const MulticastGroup *);
   bool addgroup(IP6Address);
   bool joingroup(IP6Address, IP6Address);
   unsigned char get_receiver_mode(IP6Address, IP6Address);
@@ -89,6 +102,10 @@ class IP6MulticastTable : public Element {
   bool printgroups(bool);
   void push(int, Packet *);
   bool getMLDreceivers(IP6Address, IP6Address);
+
+  void add_handlers();
+  String print_stats();
+  int populate(uint32_t, uint32_t, uint32_t, IP6Address, IP6Address, IP6Address);
 };
 
 CLICK_ENDDECLS
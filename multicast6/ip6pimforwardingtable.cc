@@ -23,6 +23,7 @@
 #include <click/error.hh>
 #include <click/ip6address.hh>
 #include <click/confparse.hh>
+#include <click/straccum.hh>
 #include "debug.hh"
 
 
@@ -72,6 +73,19 @@ IP6PIMForwardingTable::configure(Vector<String> &conf, ErrorHandler *errh)
 }
 
 
+/*******************************************************************************************
+ *                                                                                         *
+ * find_interface: returns the entry of an interface, or 0 if it is not a PIM interface    *
+ *                                                                                         *
+ *******************************************************************************************/
+IP6PIMForwardingTable::piminterface *
+IP6PIMForwardingTable::find_interface(IP6Address interface)
+{
+  for(int i=0; i<piminterfaces.size(); ++i)
+	if(piminterfaces[i].interface==interface) return &piminterfaces[i];
+  return 0;
+}
+
 /*******************************************************************************************
  *                                                                                         *
  * addgroup: adds  group, source and upstream neighbor address to an existing interface    * 
@@ -85,28 +99,14 @@ bool IP6PIMForwardingTable::addgroup(IP6Address interface,
 
   debug_msg("IP6PIMForwardingTable PIM addgroup");
 
-  groupsource gs;
-  gs.neighbor=upstreamneighbor;
-  gs.group=group;
-  gs.source=source;
-
-  // go through all pim interfaces...
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	if( IP6Address((*i).interface) == IP6Address(interface) )
-	  {
-		// and check for double entries...
-		Vector<groupsource>::iterator g;
-		for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-		  if( (*g).group==IP6Address(gs.group) ) return false;
-		}
-		// before finally adding the group address.
-		(*i).groupsources.push_back(gs);
-		printgroups();
-		return true;
-	  }
-  }
-  return false;
+  piminterface *i = find_interface(interface);
+  if(!i) return false;
+  // and check for double entries, by group only: not for mldv1 and embedded rp address
+  if(channels.has_group(group, i->neighbor)) return false;
+  // before finally adding the group address.
+  channels.add(source, group, i->neighbor);
+  printgroups();
+  return true;
 }
 
 bool IP6PIMForwardingTable::delgroup(IP6Address interface, IP6Address group, IP6Address source, IP6Address upstreamneighbor)
@@ -114,37 +114,16 @@ bool IP6PIMForwardingTable::delgroup(IP6Address interface, IP6Address group, IP6
 
   debug_msg("IP6PIMForwardingTable PIM delgroup");
 
-  // go through all pim interfaces...
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	if( IP6Address((*i).interface) == IP6Address(interface) )
-	  {
-		debug_msg("IP6PIMForwardingTable delgroup found interface");
-		// and check for group entries...
-		Vector<groupsource>::iterator g;
-		for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-		  //debug_msg("IP6PIMForwardingTable delgroup at source %x", IP6Address(source));
-		  //	debug_msg("IP6PIMForwardingTable delgroup at group %x", IP6Address(group));
-			//		  if( ( (*g).group.addr()==IP6Address(group) ) &&  ( (*g).source.addr()==htonl(source.addr())) ) { (X)
-	
-		  if( //( (*g).source==IP6Address(source)) &&  // not for mldv1 and embedded rp addres
-		     (*g).group==IP6Address(group)   ) {
-
-			(*i).groupsources.erase(g);
-			return true;
-		  }
-		}
-	  }
-  }
-  return false;
+  piminterface *i = find_interface(interface);
+  if(!i) return false;
+  debug_msg("IP6PIMForwardingTable delgroup found interface");
+  // the source is ignored: not for mldv1 and embedded rp address
+  return channels.remove_group(group, i->neighbor);
 }
 
 bool IP6PIMForwardingTable::addinterface(IP6Address interface, IP6Address neighbor)
 {
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) {
-	if(IP6Address((*i).interface)==IP6Address(interface)) return false;
-  }
+  if(find_interface(interface)) return false;
   piminterface newinterface;
   newinterface.interface=IP6Address(interface);
   newinterface.neighbor=IP6Address(neighbor);
@@ -161,14 +140,8 @@ bool IP6PIMForwardingTable::delgroup(IP6Address group)
 
 bool IP6PIMForwardingTable::printgroups()
 {
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	  {
-		Vector<groupsource>::iterator g;
-		for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-		  //		  debug_msg("IP6PIMForwardingTable PIM: g-%x s-%x n-%x", (*g).group.addr(), (*g).source.addr(), (*g).neighbor.addr());
-		}
-	  }
+  for(HashMap<IP6Address, ChannelFanout<IP6Address>::Group>::const_iterator g=channels.groups().begin(); g; g++) {
+	//		  debug_msg("IP6PIMForwardingTable PIM: g-%x s-%x n-%x", (*g).group.addr(), (*g).source.addr(), (*g).neighbor.addr());
   }
   return true;
 }
@@ -183,74 +156,135 @@ bool IP6PIMForwardingTable::printgroups()
 void IP6PIMForwardingTable::push(int port, Packet *p_in)
 {
   IP6Address group=DST_IP6_ANNO(p_in);
-  click_ip6* ip;
-  ip=(click_ip6 *)p_in->data();
-  IP6Address source=IP6Address(ip->ip6_src);
-  if(piminterfaces.size()!=0) {
-	Vector<piminterface>::iterator  i;
-	for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i)
-	  {
-
-		if((*i).groupsources.size() != 0)
-		  {
-			Vector<groupsource>::iterator  g;
-			for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-
-			  if( // (*g).source==source && not for embedded RP and MLDv1...
-			     group==(*g).group)
-				{
-				  Packet *q_in = p_in->clone();
-				  WritablePacket *p = q_in->uniqueify();
-				  SET_DST_IP6_ANNO(p, (*i).neighbor);
-				  output(0).push(p);
-				  // debug_msg("IP6PIMForwardingTable forwarding ...");
-				}
-			}
-		  }
-		else
-		  {
-			//	debug_msg("IP6PIMForwardingTable PIM forwarding table is empty, no other PIM routers requested this group");
-		  }
-		
-	  }
+  // the source is not compared: not for embedded RP and MLDv1...
+  const Vector<IP6Address> *out = channels.out_group(group);
+  if(out) {
+	for(int n=0; n<out->size(); ++n) {
+	  Packet *q_in = p_in->clone();
+	  WritablePacket *p = q_in->uniqueify();
+	  SET_DST_IP6_ANNO(p, (*out)[n]);
+	  output(0).push(p);
+	  // debug_msg("IP6PIMForwardingTable forwarding ...");
+	}
   }
+  else
+	{
+	  //	debug_msg("IP6PIMForwardingTable PIM forwarding table is empty, no other PIM routers requested this group");
+	}
+  // only copies leave this element
+  p_in->kill();
 }
 
 
 click_in6_addr IP6PIMForwardingTable::get_upstreamneighbor(IP6Address interface)
 {
-  if(piminterfaces.size()!=0) {
-	Vector<piminterface>::iterator  i;
-	for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i)
-	  {
-	    if((*i).interface==interface) 
-	      {
-		return click_in6_addr((*i).neighbor);
-	      } 
-	  }
-  }
+  piminterface *i = find_interface(interface);
+  if(i) return click_in6_addr(i->neighbor);
   return click_in6_addr(IP6Address("0::0"));
 }
 
 // returns false if no PIM receivers are known
 bool IP6PIMForwardingTable::getPIMreceivers(IP6Address source, IP6Address group)
 {
-  Vector<piminterface>::iterator i;
-  for(i=piminterfaces.begin(); i!=piminterfaces.end(); ++i) { 
-	{
-	  Vector<groupsource>::iterator g;
-	  for(g=(*i).groupsources.begin(); g!=(*i).groupsources.end(); ++g) {
-	    //		debug_msg("PIMForwardingTable getPIMreceivers: source %x group %x", source.addr(), group.addr());
-
-		if((*g).source==source && group==(*g).group) {
-		   debug_msg("PIMForwardingTable getPIMreceivers: found active group");
-		  return true;
-		}
-	  }
-	}
+  if(channels.has(source, group)) {
+	debug_msg("PIMForwardingTable getPIMreceivers: found active group");
+	return true;
   }
   return false;
 }
 
 
+/*******************************************************************************************
+ *                                                                                         *
+ * populate: adds synthetic channels for benchmarks                                        *
+ *           addresses are counted up from the given base addresses                        *
+ *                                                                                         *
+ *******************************************************************************************/
+static IP6Address
+offset_address(IP6Address base, uint32_t i)
+{
+  IP6Address a(base);
+  unsigned char *d = a.data();
+  uint32_t x = ((d[12] << 24) | (d[13] << 16) | (d[14] << 8) | d[15]) + i;
+  d[12] = x >> 24;
+  d[13] = x >> 16;
+  d[14] = x >> 8;
+  d[15] = x;
+  return a;
+}
+
+int
+IP6PIMForwardingTable::populate(uint32_t groups, uint32_t sources, uint32_t neighbors,
+								IP6Address group, IP6Address source, IP6Address neighbor)
+{
+  int added=0;
+  for(uint32_t g=0; g<groups; ++g)
+	for(uint32_t s=0; s<sources; ++s)
+	  for(uint32_t n=0; n<neighbors; ++n)
+		if(channels.add(offset_address(source, s), offset_address(group, g), offset_address(neighbor, n)))
+		  added++;
+  return added;
+}
+
+String
+IP6PIMForwardingTable::print_stats()
+{
+  StringAccum sa;
+  sa << "channels " << channels.nchannels() << "\n";
+  sa << "out_entries " << channels.nentries() << "\n";
+  return sa.take_string();
+}
+
+enum { H_STATS, H_POPULATE, H_CLEAR };
+
+static String
+ip6pimforwardingtable_read_handler(Element *e, void *thunk)
+{
+  IP6PIMForwardingTable *pft = (IP6PIMForwardingTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_STATS:
+	return pft->print_stats();
+  default:
+	return String();
+  }
+}
+
+static int
+ip6pimforwardingtable_write_handler(const String &in_s, Element *e, void *thunk, ErrorHandler *errh)
+{
+  IP6PIMForwardingTable *pft = (IP6PIMForwardingTable *)e;
+  switch ((intptr_t)thunk) {
+  case H_POPULATE: {
+	Vector<String> conf;
+	cp_argvec(in_s, conf);
+	uint32_t groups=0, sources=1, neighbors=1;
+	IP6Address group("ff3e::8000:0"), source("fec0::1"), neighbor("fe80::2:0:1");
+	if (cp_va_kparse(conf, e, errh,
+					 "GROUPS", cpkP+cpkM, cpUnsigned, &groups,
+					 "SOURCES", cpkP, cpUnsigned, &sources,
+					 "NEIGHBORS", cpkP, cpUnsigned, &neighbors,
+					 "GROUP", 0, cpIP6Address, &group,
+					 "SOURCE", 0, cpIP6Address, &source,
+					 "NEIGHBOR", 0, cpIP6Address, &neighbor,
+					 cpEnd) < 0)
+	  return -1;
+	pft->populate(groups, sources, neighbors, group, source, neighbor);
+	return 0;
+  }
+  case H_CLEAR:
+	pft->channels.clear();
+	return 0;
+  default:
+	return -1;
+  }
+}
+
+void
+IP6PIMForwardingTable::add_handlers()
+{
+  add_read_handler("stats", ip6pimforwardingtable_read_handler, (void *)H_STATS);
+  add_write_handler("populate", ip6pimforwardingtable_write_handler, (void *)H_POPULATE);
+  add_write_handler("clear", ip6pimforwardingtable_write_handler, (void *)H_CLEAR);
+}
+
 EXPORT_ELEMENT(IP6PIMForwardingTable)
@@ -3,6 +3,7 @@
 CLICK_DECLS
 #include <click/element.hh>
 #include <click/ip6address.hh>
+#include "../multicast/mcastindex.hh"
 
 /*
 =c
@@ -12,6 +13,25 @@ IP6PIMForwardingTable()
 
 =d
 Takes care of arriving multicast traffic. Streams are duplicated and forwarded to neighbouring routers which are connected to Rendezvous Point or Source Path Trees.
+The neighbors of each (source, group) channel, and of each group whatever the source, are kept in hash tables, so a packet is forwarded with a single lookup.
+
+=h stats read-only
+
+Numbers of (source, group) channels and of outgoing neighbor entries.
+
+=h populate write-only
+
+Fills the table with synthetic channels, for benchmarks.  Takes keyword
+arguments GROUPS, SOURCES and NEIGHBORS (unsigned integers), and GROUP,
+SOURCE and NEIGHBOR (IPv6 addresses, defaulting to ff3e::8000:0, fec0::1
+and fe80::2:0:1).  Every channel of the GROUPS groups starting at GROUP
+and the SOURCES sources starting at SOURCE is forwarded to the NEIGHBORS
+neighbors starting at NEIGHBOR; addresses are counted up in their last 32
+bits.
+
+=h clear write-only
+
+Removes every channel.
 
 =a
 IPv6MulticastTable, MLD, IP6PIMControl, IP6PIM, IP6MC_EtherEncap, IP6FixPIMSource
@@ -36,29 +56,22 @@ class IP6PIMForwardingTable : public Element {
   const char *processing() const	{ return "h/h"; }
 
   /*
-   * groupsource holds a group address and all allowed sources
-   *
-   * a pair of group / source Address is also known as "channel"
-   *
-   */  
-  struct groupsource {
-	IP6Address neighbor;
-	IP6Address group;
-	IP6Address source;
-  };
-
-
-  /*
-   * pimtable holds the IP address of an interface and all source/group entries
+   * pimtable holds the IP address of an interface and its PIM neighbor
    *
    */
   struct piminterface {
     IP6Address interface;                           // interface 
 	IP6Address neighbor;                           // neighbor interface
-	Vector<groupsource> groupsources; 
   };
 
   Vector<piminterface> piminterfaces;
+
+  /*
+   * channels maps each pair of source / group address, also known as "channel",
+   * to the neighbors that joined it
+   *
+   */
+  ChannelFanout<IP6Address> channels;
   click_in6_addr get_upstreamneighbor(IP6Address);
   bool addinterface(IP6Address, IP6Address);
   bool addgroup(IP6Address, IP6Address, IP6Address, IP6Address);
@@ -67,6 +80,13 @@ class IP6PIMForwardingTable : public Element {
   bool printgroups();
   void push(int, Packet *);
   bool getPIMreceivers(IP6Address, IP6Address);
+
+  void add_handlers();
+  String print_stats();
+  int populate(uint32_t, uint32_t, uint32_t, IP6Address, IP6Address, IP6Address);
+
+ private:
+  piminterface *find_interface(IP6Address);
 };
 
 CLICK_ENDDECLS
@@ -25,9 +25,13 @@
 #include <clicknet/ip6.h>
 #include <click/ip6address.hh>
 #include <click/confparse.hh>
+#include <click/straccum.hh>
 #include "debug.hh"
 
-MLD::MLD(): _timer(this)
+MLD::MLD()
+  : _timers(), _general_countdown(0), _pending_head(0),
+	_group_expired(0), _source_expired(0), _queries_sent(0), _queries_merged(0),
+	_timer(this)
 {
 }
 
@@ -43,19 +47,33 @@ MLD::~MLD()
 int
 MLD::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-  if (conf.size() != 1)
-    return errh->error("wrong number of arguments; expected 'MLD(IP6MulticastTable element)'");
-
-  // get Multicast6 element
-  Element *e = cp_element(conf[0], this, errh);
-  if (!e) {
+  Element *e;
+  _query_interval = 125000;
+  _query_response_interval = 10000;
+  _last_listener_query_interval = 1000;
+  _robustness = 2;
+  _tick = 100;
+  _max_queries = 8;
+  if (cp_va_kparse(conf, this, errh,
+		   "MCASTTABLE", cpkP+cpkM, cpElement, &e,
+		   "QUERY_INTERVAL", 0, cpUnsigned, &_query_interval,
+		   "QUERY_RESPONSE_INTERVAL", 0, cpUnsigned, &_query_response_interval,
+		   "LAST_LISTENER_QUERY_INTERVAL", 0, cpUnsigned, &_last_listener_query_interval,
+		   "ROBUSTNESS", 0, cpUnsigned, &_robustness,
+		   "TICK", 0, cpUnsigned, &_tick,
+		   "MAX_QUERIES", 0, cpUnsigned, &_max_queries,
+		   cpEnd) < 0)
     return -1;
-  }
-  else {
-	MCastTable = (IP6MulticastTable *)e->cast("IP6MulticastTable");
 
-	return 0;
-  }
+  // get Multicast6 element
+  MCastTable = (IP6MulticastTable *)e->cast("IP6MulticastTable");
+  if (!MCastTable)
+	return errh->error("%s is not an IP6MulticastTable", e->name().c_str());
+  if (_tick == 0)
+	return errh->error("TICK must be positive");
+  if (_robustness == 0)
+	return errh->error("ROBUSTNESS must be positive");
+  return 0;
 }
 
 /*******************************************************************************************
@@ -67,7 +85,7 @@ int MLD::initialize(ErrorHandler *errh)
 {
   // debug_msg("MLD: mld initil");
   _timer.initialize(this);
-  _timer.schedule_after_msec(QUERY_INTERVAL);
+  _timer.schedule_after_msec(_tick);
   // at startup the router assumes he is the only MLDv2 router in its subnet
   querierstate=true;
 
@@ -194,6 +212,7 @@ MLD::simple_action(Packet *p)
 					IP6Address(v1report->group),
 					IP6Address(extract_rp(IP6Address(v1report->group))));
 		}
+		refresh(IP6Address(ip->ip6_src), IP6Address(v1report->group));
 		break;
 	  }
 	  
@@ -219,6 +238,9 @@ MLD::simple_action(Packet *p)
 					IP6Address(extract_rp(IP6Address(v1report->group))));
 		}
 		MCastTable->leavegroup(IP6Address(ip->ip6_src), IP6Address(v1report->group)); 
+		_timers.cancel(MembershipKey<IP6Address>(IP6Address(ip->ip6_src), IP6Address(v1report->group)));
+		// ask whether other listeners are left
+		query(IP6Address(v1report->group), IP6Address("::"));
 	  } 	  
 	  break;
 	  
@@ -239,11 +261,15 @@ MLD::simple_action(Packet *p)
 			switch(report->grouprecords[grouprecord_counter].type) {
 			case 0x01: 
 			  // debug_msg("MLD: MLDv2 include");
-			  // MODE_IS_INCLUDE, generated by hosts, ignored by router
+			  // MODE_IS_INCLUDE, generated by hosts in answer to queries, refreshes the source timers
+			  for(source_counter=0; source_counter!=ntohs(report->grouprecords[grouprecord_counter].no_of_sources); source_counter++)
+				refresh_source(IP6Address(ip->ip6_src),
+							   IP6Address(report->grouprecords[grouprecord_counter].multicast_address),
+							   IP6Address(report->grouprecords[grouprecord_counter].sources[source_counter]));
 			  break; 
 			case 0x02:
 			  // debug_msg("MLD: MLDv2 exclude");
-			  // MODE_IS_EXCLUDE, generated by hosts, ignored by router
+			  // MODE_IS_EXCLUDE, generated by hosts in answer to queries, refreshes the group timer below
 			  break;
 			case 0x03:
 			  debug_msg("MLD: CHANGE_TO_INCLUDE_MODE");
@@ -279,6 +305,9 @@ MLD::simple_action(Packet *p)
 			default:
 			  debug_msg("MLD: Unknown type in MLD grouprecord");
 			}
+			// every record but BLOCK_OLD_SOURCES shows the listener is still there
+			if(report->grouprecords[grouprecord_counter].type <= 0x05)
+			  refresh(IP6Address(ip->ip6_src), IP6Address(report->grouprecords[grouprecord_counter].multicast_address));
 		  } 
 		break;
 	  }
@@ -339,8 +368,13 @@ MLD::change_to_include_mode(IP6Address recv,
 	  MCastTable->addsource(IP6Address(recv),
 				IP6Address(group),
 				IP6Address(report->grouprecords[groupcounter].sources[source_counter]));
+	  refresh_source(recv, group, IP6Address(report->grouprecords[groupcounter].sources[source_counter]));
 	}
-  if(no_of_sources == 0) MCastTable->leavegroup(recv, group);
+  if(no_of_sources == 0) {
+	MCastTable->leavegroup(recv, group);
+	_timers.cancel(MembershipKey<IP6Address>(recv, group));
+	query(group, IP6Address("::"));
+  }
   return true;
 }
 
@@ -367,7 +401,9 @@ MLD::allow_new_sources(IP6Address recv,
 	  MCastTable->addsource(IP6Address(recv),
 				IP6Address(group),
 				IP6Address(report->grouprecords[groupcounter].sources[source_counter]));
+	  refresh_source(recv, group, IP6Address(report->grouprecords[groupcounter].sources[source_counter]));
 	}
+  return true;
 }
 
 /*******************************************************************************************
@@ -388,7 +424,10 @@ MLD::block_old_sources(IP6Address recv,
 	  MCastTable->delsource(recv,
 				group,
 				IP6Address(report->grouprecords[groupcounter].sources[source_counter]));
+	  _timers.cancel(MembershipKey<IP6Address>(recv, group, IP6Address(report->grouprecords[groupcounter].sources[source_counter])));
+	  query(group, IP6Address(report->grouprecords[groupcounter].sources[source_counter]));
 	}
+   return true;
 }
 
 /*******************************************************************************************
@@ -396,20 +435,104 @@ MLD::block_old_sources(IP6Address recv,
  * query is called to generate query messages. all arriving changes of state of an         *
  * interface are followed by a group/source specific query                                 *
  *                                                                                         *
+ * queries are queued: requests for a group that is already queued are merged into it,    *
+ * and run_timer sends at most MAX_QUERIES per tick                                        *
  *                                                                                         *
  *******************************************************************************************/
 void
 MLD::generalquery()
 {
   debug_msg("MLD: generalquery");
+  query(IP6Address("::"), IP6Address("::"));
+}
+
+void
+MLD::query(IP6Address group, IP6Address source)
+{
+  pendingquery *pq = _pending.findp(group);
+  if(pq) _queries_merged++;
+  else {
+	_pending.insert(group, pendingquery());
+	_pending_order.push_back(group);
+	pq = _pending.findp(group);
+  }
+  if(source==IP6Address("::")) pq->group=true;
+  else {
+	for(int i=0; i<pq->sources.size(); ++i)
+	  if(pq->sources[i]==source) return;
+	pq->sources.push_back(source);
+  }
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * flush_queries sends queued queries, oldest first, until MAX_QUERIES are out;            *
+ * a group with more sources than fit in one query is sent in several                      *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+MLD::flush_queries()
+{
+  uint32_t sent=0;
+  while(_pending_head < _pending_order.size() && sent < _max_queries) {
+	IP6Address group=_pending_order[_pending_head];
+	pendingquery *pq = _pending.findp(group);
+	if(pq->group) {
+	  send_query(group, pq->sources, 0, 0);
+	  pq->group=false;
+	  sent++;
+	}
+	while(pq->sources.size() && sent < _max_queries) {
+	  int n = pq->sources.size() < MAX_QUERY_SOURCES ? pq->sources.size() : MAX_QUERY_SOURCES;
+	  send_query(group, pq->sources, pq->sources.size()-n, n);
+	  pq->sources.resize(pq->sources.size()-n);
+	  sent++;
+	}
+	if(pq->group || pq->sources.size()) break;
+	_pending.remove(group);
+	_pending_head++;
+  }
+  if(_pending_head == _pending_order.size()) {
+	_pending_order.clear();
+	_pending_head=0;
+  }
+}
+
+// RFC 3810 5.1.3 and 5.1.9: large codes are a floating point value
+static uint16_t
+mld_code(uint32_t value, int mantbits)
+{
+  uint32_t limit = 1 << (mantbits + 3);
+  if(value < limit) return value;
+  uint32_t mant=value >> 3;
+  int exp=0;
+  while(mant >= (2U << mantbits) && exp < 7) {
+	mant >>= 1;
+	exp++;
+  }
+  if(mant >= (2U << mantbits)) return (limit << 1) - 1;
+  return limit | (exp << mantbits) | (mant & ((1 << mantbits) - 1));
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * send_query builds a query for the group with n of the sources, starting at first        *
+ * the unspecified group makes a general query                                             *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+MLD::send_query(IP6Address group, const Vector<IP6Address> &sources, int first, int n)
+{
   WritablePacket *q = 0;
 
   click_ip6 *nip;
-  void *mldbegin;
   mldv2querie *igp;
   hopbyhopheader *hopbyhop;
+  int mldlen = sizeof(*igp) + n*sizeof(click_in6_addr);
+  bool general = (group==IP6Address("::"));
 
-  q = Packet::make(sizeof(*nip)+sizeof(*hopbyhop)+sizeof(*igp));
+  q = Packet::make(sizeof(*nip)+sizeof(*hopbyhop)+mldlen);
+  if(!q) return;
 
   nip = reinterpret_cast<click_ip6 *>(q->data());
   hopbyhop=(hopbyhopheader *) (q->data() + sizeof(*nip));
@@ -417,13 +540,15 @@ MLD::generalquery()
 
   nip->ip6_flow = 0;		// set flow to 0 (includes version)
   nip->ip6_v = 6;		// then set version to 6
-  nip->ip6_plen=htons(sizeof(*igp)+sizeof(*hopbyhop));
+  nip->ip6_plen=htons(mldlen+sizeof(*hopbyhop));
   nip->ip6_nxt=0x00; //i.e. protocal: hop-by-hop message
   nip->ip6_hlim=0x01; //kill at next router
   nip->ip6_src = IP6Address("fe80::204:23ff:fe45:9d71");
  
-  nip->ip6_dst = IP6Address("ff02::1");
-  SET_DST_IP6_ANNO(q, IP6Address("ff02::1"));
+  // general queries go to all nodes, group specific queries to the group itself
+  if(general) nip->ip6_dst = IP6Address("ff02::1");
+  else nip->ip6_dst = group;
+  SET_DST_IP6_ANNO(q, IP6Address(nip->ip6_dst));
   hopbyhop->type=0x3a;  //MLD router alert
   hopbyhop->length=0;
   hopbyhop->parameter=0x0502;
@@ -431,16 +556,71 @@ MLD::generalquery()
   igp->type=130;
   igp->code=0x00;
   igp->checksum=0x0000;
-  igp->responsecode=0x01;
+  // maximum response delay in milliseconds
+  igp->responsecode=htons(mld_code(general ? _query_response_interval : _last_listener_query_interval, 12));
   igp->reserved=0;
-  igp->group=IP6Address("::"); 
-  igp->res_and_s_and_qrv=0x03; 
-  igp->qqic=0x00;
-  igp->no_of_sources=0x00;
-
+  igp->group=group; 
+  igp->res_and_s_and_qrv=(_robustness > 7 ? 0 : _robustness); 
+  igp->qqic=mld_code(_query_interval/1000, 4);
+  igp->no_of_sources=htons(n);
+  click_in6_addr *src = (click_in6_addr *)(igp + 1);
+  for(int i=0; i<n; ++i)
+	src[i]=sources[first+i];
+
+  _queries_sent++;
   output(1).push(q);  
 }
 
+/*******************************************************************************************
+ *                                                                                         *
+ * refresh restarts the group timer of a listener that reported on a group                 *
+ * refresh_source restarts the timer of one of its sources, in INCLUDE mode only           *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+MLD::refresh(IP6Address recv, IP6Address group)
+{
+  if(!MCastTable->multicastgroups.find_receiver(recv, group)) return;
+  uint32_t mali = _robustness*_query_interval + _query_response_interval;
+  _timers.schedule(MembershipKey<IP6Address>(recv, group), ticks(mali));
+}
+
+void
+MLD::refresh_source(IP6Address recv, IP6Address group, IP6Address source)
+{
+  IP6MulticastTable::receiver *r = MCastTable->multicastgroups.find_receiver(recv, group);
+  if(!r || r->mode!=INCLUDEMODE || r->find_source(source) < 0) return;
+  uint32_t mali = _robustness*_query_interval + _query_response_interval;
+  _timers.schedule(MembershipKey<IP6Address>(recv, group, source), ticks(mali));
+}
+
+/*******************************************************************************************
+ *                                                                                         *
+ * expire is called for each timer that ran out                                            *
+ *                                                                                         *
+ * an expired source is deleted; an expired group timer drops the listener from the group, *
+ * unless it is in INCLUDE mode with running source timers (RFC 3810 7.5)                  *
+ *                                                                                         *
+ *******************************************************************************************/
+void
+MLD::expire(const MembershipKey<IP6Address> &k)
+{
+  IP6MulticastTable::receiver *r = MCastTable->multicastgroups.find_receiver(k.recv, k.group);
+  if(!r) return;
+  if(!k.group_timer()) {
+	// source timers only run in INCLUDE mode
+	if(r->mode!=INCLUDEMODE) return;
+	_source_expired++;
+	MCastTable->delsource(k.recv, k.group, k.source);
+	return;
+  }
+  if(r->mode==INCLUDEMODE)
+	for(int i=0; i<r->sources.size(); ++i)
+	  if(_timers.running(MembershipKey<IP6Address>(k.recv, k.group, r->sources[i]))) return;
+  _group_expired++;
+  MCastTable->leavegroup(k.recv, k.group);
+}
+
 /*******************************************************************************************
  *                                                                                         *
  * extract_RP extracts embedded RP address from multicast group address                    *
@@ -504,25 +684,85 @@ MLD::extract_rp(IP6Address group)
 
 /*******************************************************************************************
  *                                                                                         *
- * run_timer is called continually, it reschedules itself                                  *
+ * run_timer is called every tick, it reschedules itself                                   *
  *                                                                                         *
- * for now it calls the function that generates general queries                            *
- * other queries might be added in future releases                                         *
+ * it expires memberships, queues a general query every QUERY_INTERVAL while this router   *
+ * is the querier, and sends the queued queries                                            *
  *                                                                                         *
  *******************************************************************************************/
 void
 MLD::run_timer(Timer *)
 {
-  debug_msg("MLD: run timer");  
   //  MCastTable->printgroups(true);
-  if(querierstate) {
-    //	generalquery();
-	_timer.reschedule_after_msec(QUERY_INTERVAL);
+  Vector<MembershipKey<IP6Address> > expired;
+  _timers.tick(expired);
+  for(int i=0; i<expired.size(); ++i)
+	expire(expired[i]);
+
+  if(querierstate && _query_interval) {
+	if(_general_countdown == 0) {
+	  generalquery();
+	  _general_countdown=ticks(_query_interval);
+	}
+	_general_countdown--;
   }
-  else {
-	// see RFC 3810 for the correct time value... 
-	_timer.reschedule_after_msec( (QUERY_INTERVAL*2) + (QUERY_RESPONSE_INTERVAL/2) );
+  flush_queries();
+  _timer.reschedule_after_msec(_tick);
+}
+
+String
+MLD::print_memberships()
+{
+  StringAccum sa;
+  int receivers=0, sources=0;
+  for(int i=0; i<MCastTable->multicastgroups.size(); ++i) {
+	const IP6MulticastTable::MulticastGroup *g = MCastTable->multicastgroups.group(i);
+	receivers += g->receivers.size();
+	for(int r=0; r<g->receivers.size(); ++r)
+	  sources += g->receivers[r].sources.size();
+  }
+  sa << "groups " << MCastTable->multicastgroups.size() << "\n";
+  sa << "listeners " << receivers << "\n";
+  sa << "sources " << sources << "\n";
+  return sa.take_string();
+}
+
+String
+MLD::print_timers()
+{
+  StringAccum sa;
+  sa << "timers " << _timers.size() << "\n";
+  for(int l=0; l<MCASTTIMER_LEVELS; ++l)
+	sa << "wheel" << l << " " << _timers.level_size(l) << "\n";
+  sa << "queued_queries " << (_pending_order.size()-_pending_head) << "\n";
+  sa << "group_expired " << _group_expired << "\n";
+  sa << "source_expired " << _source_expired << "\n";
+  sa << "queries_sent " << _queries_sent << "\n";
+  sa << "queries_merged " << _queries_merged << "\n";
+  return sa.take_string();
+}
+
+enum { H_MEMBERSHIPS, H_TIMERS };
+
+static String
+mld_read_handler(Element *e, void *thunk)
+{
+  MLD *mld = (MLD *)e;
+  switch ((intptr_t)thunk) {
+  case H_MEMBERSHIPS:
+	return mld->print_memberships();
+  case H_TIMERS:
+	return mld->print_timers();
+  default:
+	return String();
   }
 }
 
+void
+MLD::add_handlers()
+{
+  add_read_handler("memberships", mld_read_handler, (void *)H_MEMBERSHIPS);
+  add_read_handler("timers", mld_read_handler, (void *)H_TIMERS);
+}
+
 EXPORT_ELEMENT(MLD)
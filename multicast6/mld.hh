@@ -2,12 +2,14 @@
 #define MLD_HH
 #include "ip6multicasttable.hh"
 #include "ip6protocoldefinitions.hh"
+#include "mcasttimer.hh"
 #include <click/timer.hh>
 #include <click/element.hh>
+#include <click/hashmap.hh>
 
 /*
 =c
-MLD(IP6MulticastTable)
+MLD(IP6MulticastTable, [I<KEYWORDS>])
 
 =s IPv6 Multicast
 
@@ -18,6 +20,61 @@ This element checks whether an arriving MLD message is valid (checksum) and take
 
 It manages the databank of listeners kept in the IP6MulticastTable element.
 
+Every report starts or restarts the listener's group timer and the timers of
+the sources it allows, to the multicast listener interval (ROBUSTNESS times
+QUERY_INTERVAL plus QUERY_RESPONSE_INTERVAL).  When a group timer expires the
+listener leaves the group, unless it is in INCLUDE mode and still has sources;
+when a source timer expires the source is deleted.  The timers are kept on a
+hierarchical timing wheel advanced every TICK, so expiring a membership costs
+the same however many are held.
+
+While this router is the querier, general queries are sent every
+QUERY_INTERVAL.  Group and group-and-source specific queries are queued:
+requests for the same group are merged into one query listing all their
+sources, and at most MAX_QUERIES queries leave per TICK.
+
+Keyword arguments are:
+
+=over 8
+
+=item QUERY_INTERVAL
+
+Milliseconds between general queries.  0 disables general queries.  Defaults
+to 125000.
+
+=item QUERY_RESPONSE_INTERVAL
+
+Milliseconds listeners may take to answer a general query.  Defaults to
+10000.
+
+=item LAST_LISTENER_QUERY_INTERVAL
+
+Milliseconds listeners may take to answer a group specific query.  Defaults
+to 1000.
+
+=item ROBUSTNESS
+
+Unsigned integer, the robustness variable.  Defaults to 2.
+
+=item TICK
+
+Milliseconds per timer tick.  Defaults to 100.
+
+=item MAX_QUERIES
+
+Unsigned integer.  Maximum number of queries sent per TICK.  Defaults to 8.
+
+=back
+
+=h memberships read-only
+
+Number of groups, listeners and listener sources in the IP6MulticastTable.
+
+=h timers read-only
+
+Running group and source timers, with the number on each wheel, queued
+queries, and counters of expired timers and of sent and merged queries.
+
 =e
 mct::IP6MulticastTable("pimctl");
 mcc :: Classifier(6/11 24/ff, // UDP Multicast traffic
@@ -45,6 +102,10 @@ class MLD : public Element { public:
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
   Packet *simple_action(Packet *);
+  void add_handlers();
+
+  String print_memberships();
+  String print_timers();
   
 
   // this does not really belong here but i do not want to extend existing click elements
@@ -58,7 +119,14 @@ class MLD : public Element { public:
 private:
 
   void generalquery();
+  void query(IP6Address, IP6Address);
+  void send_query(IP6Address, const Vector<IP6Address> &, int, int);
+  void flush_queries();
   void run_timer(Timer *);
+  void refresh(IP6Address, IP6Address);
+  void refresh_source(IP6Address, IP6Address, IP6Address);
+  void expire(const MembershipKey<IP6Address> &);
+  uint32_t ticks(uint32_t msec) const	{ return (msec + _tick - 1) / _tick; }
   bool change_to_include_mode(IP6Address, IP6Address, unsigned short, unsigned short);
   bool change_to_exclude_mode(IP6Address, IP6Address, unsigned short, unsigned short);
   bool allow_new_sources(IP6Address, IP6Address, unsigned short, unsigned short);  
@@ -76,9 +144,35 @@ private:
   mldv2report *report;
   mldv1message *v1report;
   mldv2querie *v2query;
-  static const int QUERY_INTERVAL = 125000;
-  static const int QUERY_RESPONSE_INTERVAL = 10000;
-  //  static const int QUERY_INTERVAL = 125000;
+
+  // queued group specific queries; the unspecified group is a general query
+  struct pendingquery {
+	bool group;                     // query the group itself
+	Vector<IP6Address> sources;     // query these sources of the group
+	pendingquery() : group(false) { }
+  };
+
+  enum { MAX_QUERY_SOURCES = 64 };
+
+  uint32_t _query_interval;
+  uint32_t _query_response_interval;
+  uint32_t _last_listener_query_interval;
+  uint32_t _robustness;
+  uint32_t _tick;
+  uint32_t _max_queries;
+
+  MembershipTimers<IP6Address> _timers;
+  uint32_t _general_countdown;    // ticks until the next general query
+
+  HashMap<IP6Address, pendingquery> _pending;
+  Vector<IP6Address> _pending_order;
+  int _pending_head;
+
+  uint32_t _group_expired;
+  uint32_t _source_expired;
+  uint32_t _queries_sent;
+  uint32_t _queries_merged;
+
   Timer _timer;
 };
 
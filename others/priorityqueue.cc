@@ -45,7 +45,8 @@ OmlMPDef PriorityQueue::mp_def[] = {
 };
 #endif
 
-PriorityQueue::PriorityQueue() : _timer(this) {
+PriorityQueue::PriorityQueue()
+  : _Q_table(0), _slots(0), _nonfull(0), _nonempty(0), _highwater(0), _timer(this) {
 #ifdef CLICK_OML
   mp = omlc_add_mp("PriorityQueue", mp_def);
 #endif
@@ -59,13 +60,15 @@ void* PriorityQueue::cast(const char *n) {
     return (Storage *)this;
   else if (strcmp(n, "PriorityQueue") == 0)
     return (PriorityQueue *)this;
+  else if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+    return static_cast<Notifier *>(&_empty_note);
   
   return 0;
 }
 
 int PriorityQueue::configure(Vector<String> &conf, ErrorHandler *errh) {
 
-  QUEUE_CLASS_NAME<Packet*> *q;
+  uint32_t i;
   String goals = "no_goal";
   _queues_number = 1;
   _queues_proportion = 1;
@@ -85,16 +88,32 @@ int PriorityQueue::configure(Vector<String> &conf, ErrorHandler *errh) {
     return errh->error("CAPACITY not specified");
   if (!_period) 
     return errh->error("PERIOD not specified");
-
-  _Q_table = new QUEUE_CLASS_NAME<Packet*>[_queues_number];
-  _pull_q = _Q_table;
+  if (!_queues_number) 
+    return errh->error("NUMBER must be at least 1");
 
   _capacity_short = _capacity / (_queues_number - 1 + _queues_proportion);
   _capacity_long = _capacity - (_queues_number - 1) * _capacity_short;
-  for (q = _Q_table; q < _Q_table + _queues_number - 1; q++) q->reserve(_capacity_short);
-  q->reserve(_capacity_long);
 
-  memset(_paint_goal, 0, 255);
+  // All queues share one array of _capacity slots
+  _slots = new Packet*[_capacity];
+  _Q_table = new Ring[_queues_number];
+  _bitmap_words = (_queues_number + 31) >> 5;
+  _nonfull = new uint32_t[_bitmap_words];
+  _nonempty = new uint32_t[_bitmap_words];
+  memset(_nonfull, 0, _bitmap_words << 2);
+  memset(_nonempty, 0, _bitmap_words << 2);
+  Packet **slot = _slots;
+  for (i = 0; i < _queues_number; i++) {
+    Ring &q = _Q_table[i];
+    q._slot = slot;
+    q._capacity = (i < _queues_number - 1 ? _capacity_short : _capacity_long);
+    q._head = q._size = 0;
+    slot += q._capacity;
+    set_bit(_nonfull, i, q._capacity > 0);
+  }
+  _pull_q = 0;
+
+  memset(_paint_goal, 0, NPAINTS);
   if(goals.compare("no_goal")) {
     int64_t index = 0, index_nxt;
     do {
@@ -109,9 +128,10 @@ int PriorityQueue::configure(Vector<String> &conf, ErrorHandler *errh) {
     } while(index_nxt != -1);
   }
 
-  memset(_paint_bytes, 0, 255 << 3);
-  memset(_paint_achieved, 1, 255);
-  memset(_paint_packets_bucket, 0, 255 << 2);
+  memset(_paint_bytes, 0, NPAINTS << 3);
+  memset(_paint_samples_bytes, 0, NPAINTS << 3);
+  memset(_paint_achieved, 1, NPAINTS);
+  memset(_paint_packets_bucket, 0, NPAINTS << 2);
   _iterations = 0;
 
   _samples_counter = _samples_skipped;
@@ -125,25 +145,45 @@ int PriorityQueue::configure(Vector<String> &conf, ErrorHandler *errh) {
 
 int PriorityQueue::initialize(ErrorHandler *errh) {
 
+  _sleepiness = 0;
+  _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+
   _timer.initialize(this);
   _next = Timestamp::now();
   _timer.schedule_at(_next);
   return 0;
 }
 
+void PriorityQueue::cleanup(CleanupStage) {
+
+  if (_Q_table)
+    for (uint32_t i = 0; i < _queues_number; i++)
+      while (_Q_table[i]._size)
+        dequeue(i)->kill();
+  delete[] _Q_table;
+  delete[] _slots;
+  delete[] _nonfull;
+  delete[] _nonempty;
+  delete[] _highwater;
+  _Q_table = 0;
+  _slots = 0;
+  _nonfull = _nonempty = 0;
+  _highwater = 0;
+}
+
 void PriorityQueue::run_timer(Timer *) {
 
   int i;
   uint64_t paint_bytes_sum = 0, paint_samples_bytes_sum = 0;
-  double throughput_ratio[255], samples_throughput_ratio[255];
+  double throughput_ratio[NPAINTS], samples_throughput_ratio[NPAINTS];
 
-  for (i=0; i<255; i++) {
+  for (i=0; i<NPAINTS; i++) {
     throughput_ratio[i] = samples_throughput_ratio[i] = 0;
     paint_bytes_sum += _paint_bytes[i];
     paint_samples_bytes_sum += _paint_samples_bytes[i];
   }
   if (paint_bytes_sum) {
-    for (i=0; i<255; i++) {
+    for (i=0; i<NPAINTS; i++) {
       throughput_ratio[i] = (_paint_bytes[i] * 100.0 / paint_bytes_sum);
       samples_throughput_ratio[i] = (_paint_samples_bytes[i] * 100.0 / paint_samples_bytes_sum);
       _paint_achieved[i] = ( samples_throughput_ratio[i] >= _paint_goal[i] );
@@ -151,16 +191,15 @@ void PriorityQueue::run_timer(Timer *) {
   }
 
 #ifdef CLICK_OML
-  QUEUE_CLASS_NAME<Packet*> *q;
   uint32_t shorts_len = 0, long_len = 0;
   uint32_t bucket_ratio0 = 0;
   uint32_t bucket_ratio1 = 0;
   uint32_t bucket_ratio2 = 0;
   _iterations++;
 
-  for (q = _Q_table; q < _Q_table + _queues_number - 1; q++)
-    shorts_len += q->size();
-  long_len = q->size();
+  for (uint32_t q = 0; q < _queues_number - 1; q++)
+    shorts_len += _Q_table[q]._size;
+  long_len = _Q_table[_queues_number - 1]._size;
   if (long_len) {
     bucket_ratio0 = _paint_packets_bucket[0] * 100 / long_len;
     bucket_ratio1 = _paint_packets_bucket[1] * 100 / long_len;
@@ -201,63 +240,78 @@ void PriorityQueue::push(int port, Packet *p) {
     return;
   }
 
-  bool pushed = false;
-  QUEUE_CLASS_NAME<Packet*> *q = _Q_table;
-  uint32_t size;
-  if (!_paint_achieved[PAINT_ANNO(p)]) {
-    for (; !pushed && q < _Q_table + _queues_number - 1; q++) {
-      size = q->size();
-      if (size != _capacity_short) {
-        q->push_back(p);
-        pushed = true;
-        if (size == _highwater[q - _Q_table]) 
-          _highwater[q - _Q_table]++;
-      }
-    }
-  } else { q += (_queues_number - 1); }
-  if (!pushed) {
-    size = q->size();
-    if (size != _capacity_long) {
-      q->push_back(p);
-      pushed = true;
-      if (size == _highwater[q - _Q_table]) 
-        _highwater[q - _Q_table]++;
-      _paint_packets_bucket[PAINT_ANNO(p)]++;
-    }
-  }
-  if (!pushed) {
+  // Paints below their goal take the first short queue with room, or the
+  // long queue if all are full; the rest go straight to the long queue.
+  uint32_t last = _queues_number - 1;
+  int q;
+  if (!_paint_achieved[PAINT_ANNO(p)])
+    q = find_bit(_nonfull, 0);
+  else
+    q = test_bit(_nonfull, last) ? last : -1;
+
+  if (q < 0) {
     p->kill();
     _drops++;
+    return;
   }
-  return;
+  enqueue(q, p);
+  if ((uint32_t) q == last)
+    _paint_packets_bucket[PAINT_ANNO(p)]++;
+  _empty_note.wake();
 }
 
 Packet* PriorityQueue::pull(int) {
 
-  Packet *p = NULL;
-  QUEUE_CLASS_NAME<Packet*> *q;
-  for (q = _pull_q; !p && q < _Q_table + _queues_number; q++) {
-    if (q->size()) {
-      p = q->front();
-      q->pop_front();
-    }
+  // Round-robin over the non-empty queues, starting after the last one served
+  int q = find_bit(_nonempty, _pull_q);
+  if (q < 0)
+    q = find_bit(_nonempty, 0);
+  if (q < 0) {
+    if (_sleepiness >= SLEEPINESS_TRIGGER) _empty_note.sleep();
+    else _sleepiness++;
+    return NULL;
   }
-  if (!p) {
-    for (q = _Q_table; !p && q < _pull_q; q++) {
-      if (q->size()) {
-        p = q->front();
-        q->pop_front();
-      }
-    }
-  }
-  _pull_q = q;
+  _sleepiness = 0;
 
-  if (p) {
-    if (q == (_Q_table + _queues_number)) _paint_packets_bucket[PAINT_ANNO(p)]--;
-  }
+  Packet *p = dequeue(q);
+  _pull_q = q + 1 < (int) _queues_number ? q + 1 : 0;
+  if ((uint32_t) q == _queues_number - 1) _paint_packets_bucket[PAINT_ANNO(p)]--;
+  return p;
+}
+
+void PriorityQueue::enqueue(uint32_t q, Packet *p) {
+
+  Ring &r = _Q_table[q];
+  uint32_t size = r._size;
+  r.push_back(p);
+  if (size == _highwater[q]) 
+    _highwater[q]++;
+  if (size + 1 == r._capacity) set_bit(_nonfull, q, false);
+  if (!size) set_bit(_nonempty, q, true);
+}
+
+Packet* PriorityQueue::dequeue(uint32_t q) {
+
+  Ring &r = _Q_table[q];
+  Packet *p = r.front();
+  r.pop_front();
+  set_bit(_nonfull, q, true);
+  if (!r._size) set_bit(_nonempty, q, false);
   return p;
 }
 
+int PriorityQueue::find_bit(const uint32_t *bitmap, uint32_t from) const {
+
+  uint32_t w = from >> 5;
+  if (w >= _bitmap_words) return -1;
+  uint32_t bits = bitmap[w] & (~0U << (from & 31));
+  while (!bits) {
+    if (++w == _bitmap_words) return -1;
+    bits = bitmap[w];
+  }
+  return (w << 5) + __builtin_ctz(bits);
+}
+
 
 // Setup handlers
 enum {H_LENGTH, H_CAPACITY, H_GOALS, H_DROPS, H_HIGHWATER};
@@ -268,13 +322,12 @@ String PriorityQueue::read_handler(Element *e, void *thunk) {
   int which = reinterpret_cast<intptr_t>(thunk);
   
   uint32_t total = 0, i = 0;
-  QUEUE_CLASS_NAME<Packet*> *q;
   String ret = "";
   switch (which) {
     case H_LENGTH:
-      for (q = d->_Q_table; q < d->_Q_table + d->_queues_number; q++) {
-        total += q->size();
-        ret += String(q->size()) + " "; 
+      for (i = 0; i < d->_queues_number; i++) {
+        total += d->_Q_table[i]._size;
+        ret += String(d->_Q_table[i]._size) + " "; 
       }
       ret = String(total) + " : " + ret; 
       break;
@@ -282,7 +335,7 @@ String PriorityQueue::read_handler(Element *e, void *thunk) {
       ret += String(d->_capacity) + " : (short) " + String(d->_capacity_short) + " (long) " + String(d->_capacity_long);
       break;
     case H_GOALS:
-      for (i = 0; i < 255; i++)
+      for (i = 0; i < NPAINTS; i++)
         if (d->_paint_goal[i]) 
           ret += String(i) + "->" + (d->_paint_achieved[i] ? String("y") : String("n")) + " ";
       break;
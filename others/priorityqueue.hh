@@ -1,19 +1,12 @@
 #ifndef PRIORITYQUEUE_HH
 #define PRIORITYQUEUE_HH
 
-#if CLICK_VERSION_CODE >= CLICK_MAKE_VERSION_CODE(2,0,1)
-#include <click/deque.hh>
-#define QUEUE_CLASS_NAME Deque
-#else
-#include <click/dequeue.hh>
-#define QUEUE_CLASS_NAME DEQueue
-#endif
-
 #include <click/element.hh>
 #include <click/etheraddress.hh>
 #include <click/hashmap.hh>
 #include <click/standard/storage.hh>
 #include <click/timer.hh>
+#include <click/notifier.hh>
 
 #include <click/config.h>
 #ifdef CLICK_OML
@@ -34,6 +27,7 @@ public:
   void *cast(const char *);
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
   
   void push(int port, Packet *p);
   Packet* pull(int);
@@ -45,23 +39,66 @@ protected:
 
   EtherAddress _eth; 
 
-  QUEUE_CLASS_NAME<Packet*> *_Q_table;
-  QUEUE_CLASS_NAME<Packet*> *_pull_q;
+  // A FIFO of packets over a slice of _slots, preallocated in configure()
+  struct Ring {
+    Packet **_slot;
+    uint32_t _capacity;
+    uint32_t _head;
+    uint32_t _size;
+
+    Packet *front() const { return _slot[_head]; }
+    void push_back(Packet *p) {
+      uint32_t tail = _head + _size;
+      _slot[tail < _capacity ? tail : tail - _capacity] = p;
+      _size++;
+    }
+    void pop_front() {
+      if (++_head == _capacity) _head = 0;
+      _size--;
+    }
+  };
+
+  Ring *_Q_table;
+  Packet **_slots;
+  uint32_t _pull_q; // next queue to serve
   uint32_t _queues_number;
   uint32_t _queues_proportion;
   uint32_t _capacity_short;
   uint32_t _capacity_long;
 
+  // One bit per queue, set when the queue is not full / not empty, so
+  // push and pull find their queue with a find-first-set
+  uint32_t *_nonfull;
+  uint32_t *_nonempty;
+  uint32_t _bitmap_words;
+
+  void set_bit(uint32_t *bitmap, uint32_t q, bool on) {
+    if (on) bitmap[q >> 5] |= 1U << (q & 31);
+    else bitmap[q >> 5] &= ~(1U << (q & 31));
+  }
+  bool test_bit(const uint32_t *bitmap, uint32_t q) const {
+    return bitmap[q >> 5] & (1U << (q & 31));
+  }
+  int find_bit(const uint32_t *bitmap, uint32_t from) const;
+  void enqueue(uint32_t q, Packet *p);
+  Packet *dequeue(uint32_t q);
+
+  enum { SLEEPINESS_TRIGGER = 9 };
+  int _sleepiness;
+  ActiveNotifier _empty_note;
+
   uint32_t _drops;
   uint32_t *_highwater;
 
-  uint64_t _paint_bytes[255]; //bytes transmitted
+  enum { NPAINTS = 256 }; // one entry per PAINT_ANNO value
+
+  uint64_t _paint_bytes[NPAINTS]; //bytes transmitted
   uint32_t _iterations;
-  uint8_t _paint_goal[255];  // percentage
-  bool _paint_achieved[255];
-  uint32_t _paint_packets_bucket[255]; //packets in bucket
+  uint8_t _paint_goal[NPAINTS];  // percentage
+  bool _paint_achieved[NPAINTS];
+  uint32_t _paint_packets_bucket[NPAINTS]; //packets in bucket
 
-  uint64_t _paint_samples_bytes[255]; //for the implementation of the 'sampled' policy
+  uint64_t _paint_samples_bytes[NPAINTS]; //for the implementation of the 'sampled' policy
   uint32_t _samples_skipped;
   uint32_t _samples_counter;
 
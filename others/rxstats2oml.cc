@@ -49,6 +49,26 @@ RXStats2OML::~RXStats2OML()
 {
 }
 
+int
+RXStats2OML::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _max_neighbors = 256;
+  if (Args(conf, this, errh)
+      .read("MAX_NEIGHBORS", _max_neighbors)
+      .complete() < 0)
+    return -1;
+  if (!_max_neighbors)
+    return errh->error("MAX_NEIGHBORS must be positive");
+  return 0;
+}
+
+int
+RXStats2OML::initialize(ErrorHandler *)
+{
+  _neighbors.configure(_max_neighbors);
+  return 0;
+}
+
 Packet *
 RXStats2OML::simple_action(Packet *p_in)
 {
@@ -71,12 +91,10 @@ RXStats2OML::simple_action(Packet *p_in)
   }
 #endif
 
-  DstInfo *nfo = _neighbors.findp(src);
-  if (!nfo) {
-    DstInfo foo = DstInfo(src);
-    _neighbors.insert(src, foo);
-    nfo = _neighbors.findp(src);
-  }
+  int i = _neighbors.insert(src);
+  if (i < 0)
+    return p_in;
+  DstInfo *nfo = &_neighbors.local(i);
 
   nfo->_rate = ceh->rate;
   nfo->_signal = ceh->rssi;
@@ -90,7 +108,7 @@ RXStats2OML::simple_action(Packet *p_in)
   return p_in;
 }
 
-enum {H_STATS, H_RESET};
+enum {H_STATS, H_DROPS, H_RESET};
 
 static String
 RXStats2OML_read_param(Element *e, void *thunk)
@@ -101,8 +119,10 @@ RXStats2OML_read_param(Element *e, void *thunk)
     Timestamp now = Timestamp::now();
 
     StringAccum sa;
-    for (RXStats2OML::NIter iter = td->_neighbors.begin(); iter.live(); iter++) {
-      RXStats2OML::DstInfo n = iter.value();
+    for (int i = 0; i < td->_neighbors.size(); i++) {
+      RXStats2OML::DstInfo n = td->_neighbors.sum(i);
+      if (!n._packets)
+	continue;
       Timestamp age = now - n._last_received;
       Timestamp avg_signal;
       Timestamp avg_noise;
@@ -110,7 +130,7 @@ RXStats2OML_read_param(Element *e, void *thunk)
 	      avg_signal = Timestamp::make_msec(1000*n._sum_signal / n._packets);
 	      avg_noise = Timestamp::make_msec(1000*n._sum_noise / n._packets);
       }
-      sa << n._eth.unparse();
+      sa << td->_neighbors.key(i).unparse();
       sa << " rate " << n._rate;
       sa << " signal " << n._signal;
       sa << " noise " << n._noise;
@@ -123,6 +143,8 @@ RXStats2OML_read_param(Element *e, void *thunk)
     }
     return sa.take_string();
   }
+  case H_DROPS:
+    return String(td->_neighbors.drops()) + "\n";
 
   default:
     return String();
@@ -137,7 +159,7 @@ RXStats2OML_write_param(const String &in_s, Element *e, void *vparam,
   RXStats2OML *f = (RXStats2OML *)e;
   String s = cp_uncomment(in_s);
   switch((intptr_t)vparam) {
-  case H_RESET: f->_neighbors.clear(); return 0;
+  case H_RESET: f->_neighbors.reset(); return 0;
   }
   return 0;
 }
@@ -146,6 +168,7 @@ void
 RXStats2OML::add_handlers()
 {
   add_read_handler("stats", RXStats2OML_read_param, H_STATS);
+  add_read_handler("drops", RXStats2OML_read_param, H_DROPS);
   add_write_handler("reset", RXStats2OML_write_param, H_RESET, Handler::BUTTON);
 
 }
@@ -4,6 +4,7 @@
 #include <click/etheraddress.hh>
 #include <click/bighashmap.hh>
 #include <click/glue.hh>
+#include "../roofnet/neighborstats.hh"
 
 #include <click/config.h>
 #ifdef CLICK_OML
@@ -21,13 +22,16 @@ class RXStats2OML : public Element { public:
   const char *port_count() const		{ return PORTS_1_1; }
   const char *processing() const		{ return AGNOSTIC; }
 
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+
   Packet *simple_action(Packet *);
 
   void add_handlers();
 
+  // Per-thread counters for one neighbor
   class DstInfo {
   public:
-    EtherAddress _eth;
     int _rate;
     int _noise;
     int _signal;
@@ -38,19 +42,33 @@ class RXStats2OML : public Element { public:
     Timestamp _last_received;
 
     DstInfo() {
-      memset(this, 0, sizeof(*this));
+      reset();
     }
 
-    DstInfo(EtherAddress eth) {
+    void reset() {
       memset(this, 0, sizeof(*this));
-      _eth = eth;
+    }
+
+    // the last values come from the thread that heard the neighbor last
+    void operator+=(const DstInfo &o) {
+      if (o._packets && (!_packets || _last_received < o._last_received)) {
+	_rate = o._rate;
+	_noise = o._noise;
+	_signal = o._signal;
+	_last_received = o._last_received;
+      }
+      _packets += o._packets;
+      _sum_signal += o._sum_signal;
+      _sum_noise += o._sum_noise;
     }
 
   };
-  typedef HashMap<EtherAddress, DstInfo> NeighborTable;
-  typedef NeighborTable::const_iterator NIter;
+  typedef NeighborStats<EtherAddress, DstInfo> NeighborTable;
 
+  // at most MAX_NEIGHBORS entries; packets from further neighbors are
+  // counted by the 'drops' handler
   NeighborTable _neighbors;
+  unsigned _max_neighbors;
   EtherAddress _bcast;
   int _tau;
 
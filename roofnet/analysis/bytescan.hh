@@ -0,0 +1,152 @@
+#ifndef CLICK_BYTESCAN_HH
+#define CLICK_BYTESCAN_HH
+#include <click/glue.hh>
+#if CLICK_USERLEVEL && defined(__AVX2__)
+# include <immintrin.h>
+# define BYTESCAN_WIDTH 32
+#elif CLICK_USERLEVEL && defined(__SSE2__)
+# include <emmintrin.h>
+# define BYTESCAN_WIDTH 16
+#else
+# define BYTESCAN_WIDTH 8
+#endif
+CLICK_DECLS
+
+/*
+ * Byte-error scanning for the calibration elements (CountErrors,
+ * LocationHistogram, CountFecBytes, ErrorThreshold).  A calibration packet
+ * is all 0xff bytes; any other byte, and any byte past the end of a short
+ * packet, is an error.  The kernels work BYTESCAN_WIDTH bytes at a time
+ * using AVX2 or SSE2 when the compiler targets them, and 64-bit words
+ * otherwise.
+ */
+class ByteScan { public:
+
+  // Bitmask of the error bytes among p[0..BYTESCAN_WIDTH-1], bit i for p[i]
+  static inline uint32_t chunk_errors(const unsigned char *p);
+
+  // Number of error bytes among the first len positions of a packet of
+  // plen bytes
+  static inline unsigned count_errors(const unsigned char *p, unsigned plen,
+				      unsigned len);
+
+  // As count_errors, but skips the positions [skip, skip + nskip)
+  static inline unsigned count_errors_skip(const unsigned char *p,
+					   unsigned plen, unsigned len,
+					   unsigned skip, unsigned nskip);
+
+  // Increments hist[x] for every error position x < len
+  static inline void histogram(const unsigned char *p, unsigned plen,
+			       unsigned len, int *hist);
+
+  // First position >= x and < len whose error status differs from
+  // 'error'; len if there is none.  Walking a packet with this yields its
+  // runs of good and bad bytes.
+  static inline unsigned next_change(const unsigned char *p, unsigned plen,
+				     unsigned len, unsigned x, bool error);
+
+ private:
+
+  static inline unsigned popcount(uint32_t m) {
+    return __builtin_popcount(m);
+  }
+  static inline unsigned scalar_errors(const unsigned char *p, unsigned n);
+
+};
+
+inline uint32_t
+ByteScan::chunk_errors(const unsigned char *p)
+{
+#if BYTESCAN_WIDTH == 32
+  __m256i v = _mm256_loadu_si256((const __m256i *) p);
+  __m256i ones = _mm256_set1_epi8((char) 0xff);
+  return ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, ones));
+#elif BYTESCAN_WIDTH == 16
+  __m128i v = _mm_loadu_si128((const __m128i *) p);
+  __m128i ones = _mm_set1_epi8((char) 0xff);
+  return ~(uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, ones)) & 0xffff;
+#else
+  uint64_t w;
+  memcpy(&w, p, 8);
+  if (w == ~(uint64_t) 0)
+    return 0;
+  uint32_t m = 0;
+  for (int i = 0; i < 8; i++)
+    if (p[i] != 0xff)
+      m |= 1U << i;
+  return m;
+#endif
+}
+
+inline unsigned
+ByteScan::scalar_errors(const unsigned char *p, unsigned n)
+{
+  unsigned errors = 0;
+  for (unsigned x = 0; x < n; x++)
+    errors += (p[x] != 0xff);
+  return errors;
+}
+
+inline unsigned
+ByteScan::count_errors(const unsigned char *p, unsigned plen, unsigned len)
+{
+  unsigned n = (plen < len ? plen : len);
+  unsigned errors = len - n;
+  unsigned x = 0;
+  for (; x + BYTESCAN_WIDTH <= n; x += BYTESCAN_WIDTH)
+    errors += popcount(chunk_errors(p + x));
+  return errors + scalar_errors(p + x, n - x);
+}
+
+inline unsigned
+ByteScan::count_errors_skip(const unsigned char *p, unsigned plen,
+			    unsigned len, unsigned skip, unsigned nskip)
+{
+  unsigned errors = count_errors(p, plen, len);
+  for (unsigned x = skip; x < skip + nskip && x < len; x++)
+    if (x >= plen || p[x] != 0xff)
+      errors--;
+  return errors;
+}
+
+inline void
+ByteScan::histogram(const unsigned char *p, unsigned plen, unsigned len,
+		    int *hist)
+{
+  unsigned n = (plen < len ? plen : len);
+  unsigned x = 0;
+  for (; x + BYTESCAN_WIDTH <= n; x += BYTESCAN_WIDTH)
+    for (uint32_t m = chunk_errors(p + x); m; m &= m - 1)
+      hist[x + __builtin_ctz(m)]++;
+  for (; x < n; x++)
+    if (p[x] != 0xff)
+      hist[x]++;
+  for (; x < len; x++)
+    hist[x]++;
+}
+
+inline unsigned
+ByteScan::next_change(const unsigned char *p, unsigned plen, unsigned len,
+		      unsigned x, bool error)
+{
+  unsigned n = (plen < len ? plen : len);
+  if (x >= n)			// past the packet everything is an error
+    return (error ? len : x);
+
+  uint32_t flip = (error ? ~(uint32_t) 0 : 0);
+  uint32_t full = (BYTESCAN_WIDTH == 32 ? ~(uint32_t) 0
+		   : (1U << BYTESCAN_WIDTH) - 1);
+  for (; x + BYTESCAN_WIDTH <= n; ) {
+    uint32_t m = (chunk_errors(p + x) ^ flip) & full;
+    if (m)
+      return x + __builtin_ctz(m);
+    x += BYTESCAN_WIDTH;
+  }
+  for (; x < n; x++)
+    if ((p[x] != 0xff) != error)
+      return x;
+  return (error ? len : n);
+}
+
+CLICK_ENDDECLS
+#endif
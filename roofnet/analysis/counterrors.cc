@@ -23,9 +23,11 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include "counterrors.hh"
+#include "bytescan.hh"
 CLICK_DECLS
 
 CountErrors::CountErrors()
+  : _packets(0), _bad_runs(0)
 {
   static unsigned char bcast_addr[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
   _bcast = EtherAddress(bcast_addr);
@@ -40,12 +42,14 @@ CountErrors::configure(Vector<String> &conf, ErrorHandler *errh)
 {
   _length = 0;
   _runs = true;
+  _chatter = true;
   _ok_bytes = 0;
   _error_bytes = 0;
 
   if (cp_va_kparse(conf, this, errh,
 		   "LENGTH", 0, cpUnsigned, &_length,
 		   "RUNS", 0, cpBool, &_runs,
+		   "CHATTER", 0, cpBool, &_chatter,
 		   cpEnd) < 0) {
     return -1;
   }
@@ -56,74 +60,50 @@ CountErrors::configure(Vector<String> &conf, ErrorHandler *errh)
 void
 CountErrors::push (int port, Packet *p_in)
 {
-  int errors = 0;
   unsigned const char *ptr = p_in->data();
-  int ok = 0;
-  int bad = 0;
+  unsigned plen = p_in->length();
+  int errors = ByteScan::count_errors(ptr, plen, _length);
+  int ok_bytes = _length - errors;
   int bad_runs = 0;
 
-  int ok_bytes = 0;
-
   StringAccum sa;
   if (_runs) {
-    sa << " [\n";
-  }
-  for (unsigned int x = 0; x < _length; x++) {
-    bool error = false;
-    if (x < p_in->length()) {
-      error = (ptr[x] != 0xff);
-    } else {
-      error = true;
+    if (_chatter) {
+      sa << " [\n";
     }
-    if (error) {
-      if (_runs && !bad && ok) {
-	sa << " ok " << ok << "\n";;
-      }
-
-      bad++;
-      errors++;
-      ok = 0;
-
-
-    } else {
-      ok_bytes++;
-      if (_runs && bad && !ok) {
-	sa << " bad " << bad << "\n";
+    bool error = (plen == 0 || ptr[0] != 0xff);
+    for (unsigned x = 0; x < _length; error = !error) {
+      unsigned next = ByteScan::next_change(ptr, plen, _length, x, error);
+      if (error) {
 	bad_runs++;
       }
-
-      ok++;
-      bad = 0;
-
+      if (_chatter) {
+	sa << (error ? " bad " : " ok ") << (next - x) << "\n";
+      }
+      x = next;
+    }
+    if (_chatter) {
+      sa << " ]\n";
     }
   }
 
-
-  if (_runs && ok) {
-    sa << " ok " << ok << "\n";
-  }
-  
-  if (_runs &&bad) {
-    sa << " bad " << bad << "\n";
-    bad_runs++;
-  }
-
-  if (_runs) {
-    sa << " ]\n";
-  }
-
+  _packets++;
+  _bad_runs += bad_runs;
   _error_bytes += errors;
   _ok_bytes += ok_bytes;
-  sa << "ok_bytes " << ok_bytes << "\n";
-  sa << "errors " << errors << "\n";
-  sa << "bad_runs " << bad_runs << "\n";
-  click_chatter("%s", sa.take_string().c_str());
+  if (_chatter) {
+    sa << "ok_bytes " << ok_bytes << "\n";
+    sa << "errors " << errors << "\n";
+    sa << "bad_runs " << bad_runs << "\n";
+    click_chatter("%s", sa.take_string().c_str());
+  }
 
   output(port).push(p_in);
   return;
 }
 
-enum {H_STATS, H_SIGNAL, H_NOISE, H_ERROR_BYTES, H_CORRECT_BYTES};
+enum {H_STATS, H_SIGNAL, H_NOISE, H_ERROR_BYTES, H_CORRECT_BYTES, H_PACKETS,
+      H_BAD_RUNS, H_RESET};
 
 static String
 CountErrors_read_param(Element *e, void *thunk)
@@ -132,17 +112,34 @@ CountErrors_read_param(Element *e, void *thunk)
   switch ((uintptr_t) thunk) {
   case H_ERROR_BYTES: return String(td->_error_bytes) + "\n";
   case H_CORRECT_BYTES: return String(td->_ok_bytes) + "\n";
+  case H_PACKETS: return String(td->_packets) + "\n";
+  case H_BAD_RUNS: return String(td->_bad_runs) + "\n";
   default:
     return String();
   }
   
 }  
+
+static int
+CountErrors_write_param(const String &, Element *e, void *thunk, ErrorHandler *)
+{
+  CountErrors *td = (CountErrors *)e;
+  switch ((uintptr_t) thunk) {
+  case H_RESET:
+    td->_packets = td->_bad_runs = td->_ok_bytes = td->_error_bytes = 0;
+    break;
+  }
+  return 0;
+}
 	  
 void
 CountErrors::add_handlers()
 {
   add_read_handler("error_bytes", CountErrors_read_param, (void *) H_ERROR_BYTES);
   add_read_handler("correct_bytes", CountErrors_read_param, (void *) H_CORRECT_BYTES);
+  add_read_handler("packets", CountErrors_read_param, (void *) H_PACKETS);
+  add_read_handler("bad_runs", CountErrors_read_param, (void *) H_BAD_RUNS);
+  add_write_handler("reset", CountErrors_write_param, (void *) H_RESET);
 
 }
 CLICK_ENDDECLS
@@ -33,7 +33,9 @@ class CountErrors : public Element { public:
   EtherAddress _src;
   int good_packet;
   bool _runs;
+  bool _chatter;
 
+  int _bad_runs;
   int _ok_bytes;
   int _error_bytes;
   int _correct_threshold;
@@ -23,9 +23,12 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include "countfecbytes.hh"
+#include "bytescan.hh"
 CLICK_DECLS
 
 CountFecBytes::CountFecBytes()
+  : _bytes(0), _min_errors(0), _max_errors(0), _sum_errors(0),
+    _packet_count(0), _drops(0)
 {
   static unsigned char bcast_addr[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
   _bcast = EtherAddress(bcast_addr);
@@ -44,11 +47,13 @@ CountFecBytes::configure(Vector<String> &conf, ErrorHandler *errh)
   _overhead = 0;
   _tolerate = 0;
   _adaptive = false;
+  _chatter = true;
   if (cp_va_kparse(conf, this, errh,
 		   "LENGTH", 0, cpUnsigned, &_length,
 		   "TOLERATE", 0, cpUnsigned, &_tolerate,
 		   "OVERHEAD", 0, cpUnsigned, &_overhead,
 		   "ADAPTIVE", 0, cpBool, &_adaptive,
+		   "CHATTER", 0, cpBool, &_chatter,
 		   cpEnd) < 0) {
     return -1;
   }
@@ -58,37 +63,21 @@ CountFecBytes::configure(Vector<String> &conf, ErrorHandler *errh)
 void
 CountFecBytes::push (int port, Packet *p_in)
 {
-  unsigned const char *ptr = p_in->data();
-
-  StringAccum sa;
-  sa << "[";
-
   _packets++;
   _packet_count++;
-  int errors = 0;
-  for (unsigned int x = 0; x < _length; x++) {
-    bool error = false;
-    if (x < p_in->length()) {
-      error = (ptr[x] != 0xff);
-    } else {
-      error = true;
-    }
-
-    if (error) {
-      errors++;
-      _sum_errors++;
-    }
-
-  }
+  int errors = ByteScan::count_errors(p_in->data(), p_in->length(), _length);
+  _sum_errors += errors;
 
 
   bool  packet_ok = (errors <= _tolerate);
   if (packet_ok) {
     _bytes += _length - _overhead;
   } else {
-    click_chatter("DROP %d vs %d\n", 
-		  errors,
-		  _tolerate);
+    _drops++;
+    if (_chatter)
+      click_chatter("DROP %d vs %d\n", 
+		    errors,
+		    _tolerate);
   }
   
 #define max(a, b) ((a) > (b) ? (a) : (b))
@@ -104,15 +93,17 @@ CountFecBytes::push (int port, Packet *p_in)
       _max_errors = max (_max_errors, errors);
     }
     
-    click_chatter("errors %d\n", errors);
+    if (_chatter)
+      click_chatter("errors %d\n", errors);
     
     
     if (_packet_count && _packet_count % window == 0) {
       int average_errors = _sum_errors / window;
-      click_chatter("errors %d / %d / %d\n",
-		    _min_errors,
-		    average_errors,
-		    _max_errors);
+      if (_chatter)
+	click_chatter("errors %d / %d / %d\n",
+		      _min_errors,
+		      average_errors,
+		      _max_errors);
       if (_adaptive) {
 	_tolerate = average_errors * 2 + 50;
 	_overhead = _tolerate * 2 +100;
@@ -124,7 +115,7 @@ CountFecBytes::push (int port, Packet *p_in)
   return;
 }
 
-enum {H_BYTES};
+enum {H_BYTES, H_PACKETS, H_DROPS, H_TOLERATE};
 
 static String
 CountFecBytes_read_param(Element *e, void *thunk)
@@ -132,6 +123,9 @@ CountFecBytes_read_param(Element *e, void *thunk)
   CountFecBytes *td = (CountFecBytes *)e;
   switch ((uintptr_t) thunk) {
   case H_BYTES: return String(td->_bytes) + "\n";
+  case H_PACKETS: return String(td->_packets) + "\n";
+  case H_DROPS: return String(td->_drops) + "\n";
+  case H_TOLERATE: return String(td->_tolerate) + "\n";
   default:
     return String();
   }
@@ -142,6 +136,9 @@ void
 CountFecBytes::add_handlers()
 {
   add_read_handler("byte_count", CountFecBytes_read_param, (void *) H_BYTES);
+  add_read_handler("packets", CountFecBytes_read_param, (void *) H_PACKETS);
+  add_read_handler("drops", CountFecBytes_read_param, (void *) H_DROPS);
+  add_read_handler("tolerate", CountFecBytes_read_param, (void *) H_TOLERATE);
 
 }
 CLICK_ENDDECLS
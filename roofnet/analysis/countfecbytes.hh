@@ -44,6 +44,8 @@ class CountFecBytes : public Element { public:
   int _max_errors;
   int _sum_errors;
   int _packet_count;
+  int _drops;
+  bool _chatter;
 };
 
 CLICK_ENDDECLS
@@ -23,6 +23,7 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include "errorthreshold.hh"
+#include "bytescan.hh"
 CLICK_DECLS
 
 ErrorThreshold::ErrorThreshold()
@@ -38,6 +39,7 @@ ErrorThreshold::configure(Vector<String> &conf, ErrorHandler *errh)
 {
 
   _correct_threshold = 0;
+  _length = 0;
 
   if (cp_va_kparse(conf, this, errh,
 		   "LENGTH", 0, cpUnsigned, &_length,
@@ -52,27 +54,11 @@ ErrorThreshold::configure(Vector<String> &conf, ErrorHandler *errh)
 void
 ErrorThreshold::push (int, Packet *p_in)
 {
-  unsigned const char *ptr = p_in->data();
-  unsigned ok = 0;
-
-
-  for (unsigned int x = 0; x < _length; x++) {
-    if (x == 23 || x == 24) {
-      /* 802.11 sequence bytes */
-      continue;
-    }
-
-    bool error = false;
-    if (x < p_in->length()) {
-      error = (ptr[x] != 0xff);
-    } else {
-      error = true;
-    }
-    if (!error) {
-      ok++;
-    }
-  }
-
+  /* bytes 23 and 24 are the 802.11 sequence number */
+  unsigned counted = _length - (_length > 24 ? 2 : _length > 23 ? 1 : 0);
+  unsigned ok = counted - ByteScan::count_errors_skip(p_in->data(),
+						      p_in->length(),
+						      _length, 23, 2);
 
   if (_correct_threshold && 
       ok * 100 < _length * _correct_threshold) {
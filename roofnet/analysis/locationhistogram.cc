@@ -23,6 +23,7 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include "locationhistogram.hh"
+#include "bytescan.hh"
 CLICK_DECLS
 
 LocationHistogram::LocationHistogram()
@@ -53,20 +54,8 @@ LocationHistogram::configure(Vector<String> &conf, ErrorHandler *errh)
 void
 LocationHistogram::push (int port, Packet *p_in)
 {
-  unsigned const char *ptr = p_in->data();
-
-  for (unsigned int x = 0; x < _length; x++) {
-    bool error = false;
-    if (x < p_in->length()) {
-      error = (ptr[x] != 0xff);
-    } else {
-      error = true;
-    }
-
-    if (error) {
-      _byte_errors[x]++;
-    }
-  }
+  ByteScan::histogram(p_in->data(), p_in->length(), _length,
+		      _byte_errors.begin());
   output(port).push(p_in);
   return;
 }
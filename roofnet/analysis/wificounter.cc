@@ -33,6 +33,29 @@ WifiCounter::~WifiCounter()
 {
 }
 
+int
+WifiCounter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _max_pairs = 1024;
+  if (cp_va_kparse(conf, this, errh,
+		   "MAX_PAIRS", 0, cpUnsigned, &_max_pairs,
+		   cpEnd) < 0) {
+    return -1;
+  }
+  if (!_max_pairs)
+    return errh->error("MAX_PAIRS must be positive");
+  return 0;
+}
+
+int
+WifiCounter::initialize(ErrorHandler *)
+{
+  // not in configure(), so a live reconfigure keeps the counts
+  _pairs.configure(_max_pairs);
+  _types.configure();
+  return 0;
+}
+
 Packet *
 WifiCounter::simple_action (Packet *p_in)
 {
@@ -45,8 +68,7 @@ WifiCounter::simple_action (Packet *p_in)
   
   int type = wh->i_fc[0] & WIFI_FC0_TYPE_MASK;
   int subtype = (wh->i_fc[0] & WIFI_FC0_SUBTYPE_MASK) >> 4;
-  totals.count++;
-  totals.bytes += p_in->length();
+  TypeCounts &tc = _types.local();
   
   int type_ndx = 3;
   switch (type) {
@@ -56,25 +78,20 @@ WifiCounter::simple_action (Packet *p_in)
 	  break;
   }
 
-  types[type_ndx][subtype].count++;
-  types[type_ndx][subtype].bytes += p_in->length();
+  tc.types[type_ndx][subtype].count++;
+  tc.types[type_ndx][subtype].bytes += p_in->length();
 
-  totals.count++;
-  totals.bytes += p_in->length();
-
-  EtherPair pair = EtherPair(src, dst);
-  EtherPairCount *c = _pairs.findp(pair);
-  if (!c) {
-	  _pairs.insert(pair, EtherPairCount(pair));
-	  c = _pairs.findp(pair);
-  }
+  tc.totals.count++;
+  tc.totals.bytes += p_in->length();
 
-  c->_count++;
+  int i = _pairs.insert(EtherPair(src, dst));
+  if (i >= 0)
+	  _pairs.local(i)._count++;
 
   return p_in;
 }
 
-enum {H_STATS, H_TYPES};
+enum {H_STATS, H_TYPES, H_DROPS};
 
 static String
 WifiCounter_read_param(Element *e, void *thunk)
@@ -83,11 +100,11 @@ WifiCounter_read_param(Element *e, void *thunk)
   switch ((uintptr_t) thunk) {
   case H_STATS: {
 	StringAccum sa;
-	for (WifiCounter::ETIter iter = td->_pairs.begin(); iter.live(); iter++) {
-		WifiCounter::EtherPairCount c = iter.value();
-		sa << c._pair._src.unparse().c_str() << " ";
-		sa << c._pair._dst.unparse().c_str() << " ";
-		sa << c._count;
+	for (int i = 0; i < td->_pairs.size(); i++) {
+		const EtherPair &pair = td->_pairs.key(i);
+		sa << pair._src.unparse().c_str() << " ";
+		sa << pair._dst.unparse().c_str() << " ";
+		sa << td->_pairs.sum(i)._count;
 		sa << "\n";
 	}
 	return sa.take_string();
@@ -95,6 +112,7 @@ WifiCounter_read_param(Element *e, void *thunk)
   }
   case H_TYPES: {
 	StringAccum sa;
+	WifiCounter::TypeCounts tc = td->_types.sum();
 
 	for (int x = 0; x < 3; x++) {
 		for (int y = 0; y < 16; y++) {
@@ -107,11 +125,13 @@ WifiCounter_read_param(Element *e, void *thunk)
 				sa << " data ";
 			}
 			
-			sa << y << " " << td->types[x][y].s() << "\n";
+			sa << y << " " << tc.types[x][y].s() << "\n";
 		}
 	}
 	return sa.take_string();
   }
+  case H_DROPS:
+	return String(td->_pairs.drops()) + "\n";
   default:
     return String();
   }  
@@ -122,6 +142,7 @@ WifiCounter::add_handlers()
 {
 	add_read_handler("stats", WifiCounter_read_param, (void *) H_STATS);
 	add_read_handler("types", WifiCounter_read_param, (void *) H_TYPES);
+	add_read_handler("drops", WifiCounter_read_param, (void *) H_DROPS);
 }
 
 CLICK_ENDDECLS
@@ -4,6 +4,7 @@
 #include <click/etheraddress.hh>
 #include <click/bighashmap.hh>
 #include <click/glue.hh>
+#include "../neighborstats.hh"
 CLICK_DECLS
 
 /*
@@ -14,8 +15,25 @@ CLICK_DECLS
  * =s Wifi
  * 
  * Accumulate wificounter for each ethernet src you hear a packet from.
+ *
+ * Keyword arguments are:
+ *
  * =over 8
  *
+ * =item MAX_PAIRS
+ *
+ * Number of source/destination pairs to count.  Defaults to 1024.
+ *
+ * =back
+ *
+ * Counters are kept per thread and added up when a handler is read.
+ *
+ * =h stats read-only
+ * =h types read-only
+ * =h drops read-only
+ * Returns the number of frames whose source/destination pair was not
+ * counted because MAX_PAIRS pairs were already tracked.  They still
+ * count in 'types'.
  *
  */
 
@@ -48,6 +66,8 @@ class WifiCounter : public Element { public:
   const char *port_count() const		{ return PORTS_1_1; }
   const char *processing() const		{ return AGNOSTIC; }
   
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
   bool can_live_reconfigure() const		{ return true; }
 
   Packet *simple_action (Packet *p_in);
@@ -66,6 +86,12 @@ class WifiCounter : public Element { public:
       tx_time = 0;
     }
 
+    void operator+=(const WifiPacketCount &o) {
+      count += o.count;
+      bytes += o.bytes;
+      tx_time += o.tx_time;
+    }
+
     String s() {
       return String(count) + " " +
 	String(bytes) + " " +
@@ -83,26 +109,35 @@ class WifiCounter : public Element { public:
     DstInfo(EtherAddress e) { eth = e; } 
   };
 
-  WifiPacketCount types[4][16];
-  WifiPacketCount totals;
+  class TypeCounts {
+  public:
+    WifiPacketCount types[4][16];
+    WifiPacketCount totals;
+
+    void reset() {
+      *this = TypeCounts();
+    }
+    void operator+=(const TypeCounts &o) {
+      for (int x = 0; x < 4; x++)
+	for (int y = 0; y < 16; y++)
+	  types[x][y] += o.types[x][y];
+      totals += o.totals;
+    }
+  };
 
-  class EtherPairCount {
+  class PairCount {
   public:
-	  EtherPair _pair;
 	  int _count;
-	  EtherPairCount() {_count = 0; }
-	  EtherPairCount(EtherPair p) {
-		  _pair = p;
-		  _count = 0;
-	  }
-	  inline bool operator==(EtherPairCount other) {
-		  return _pair == other._pair;
-	  }
+	  PairCount() {_count = 0; }
+	  void reset() { _count = 0; }
+	  void operator+=(const PairCount &o) { _count += o._count; }
   };
-  typedef HashMap<EtherPair, EtherPairCount> EtherTable;
-  typedef EtherTable::const_iterator ETIter;
+  typedef NeighborStats<EtherPair, PairCount> EtherTable;
   
   EtherTable _pairs;
+  unsigned _max_pairs;
+
+  StatShards<TypeCounts> _types;
 
 };
 
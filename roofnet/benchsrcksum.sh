@@ -0,0 +1,137 @@
+#! /bin/sh
+
+# benchsrcksum.sh -- compare SR and SR2 checksum modes on large frames
+#
+# Pushes copies of one SR or SR2 data packet through a chain of HOPS
+# CheckSRHeader -> SetSRChecksum pairs (SR2CheckHeader -> SR2SetChecksum for
+# SR2), as a packet forwarded HOPS times is checked and checksummed again at
+# each hop, and reports packets and gigabits per second for each frame size.
+# The modes are:
+#
+#   full    checksum over the header and data (SR only; SR2 data packets
+#           carried no checksum before the header-only flag)
+#   header  checksum over the header only, with FLAG_HEADER_CKSUM or
+#           SR2_FLAG_HEADER_CKSUM set
+#   none    no checksum (SR2 only)
+#
+# Needs a click built with the roofnet package installed, and a date that
+# prints nanoseconds.
+
+usage () {
+    echo "Usage: benchsrcksum.sh [--packets N] [--hops N] [--links N] [--family sr|sr2|both] [SIZE...]" 1>&2
+    echo "SIZE is the frame length in bytes, Ethernet header included; defaults to 1500 4000 9000" 1>&2
+    exit 1
+}
+
+packets=1000000
+hops=4
+links=4
+families="sr sr2"
+
+while test $# -gt 0; do
+    case "$1" in
+      --packets)
+	test $# -ge 2 || usage
+	packets="$2"; shift 2;;
+      --hops)
+	test $# -ge 2 || usage
+	hops="$2"; shift 2;;
+      --links)
+	test $# -ge 2 || usage
+	links="$2"; shift 2;;
+      --family)
+	test $# -ge 2 || usage
+	case "$2" in
+	  sr|sr2) families="$2";;
+	  both) families="sr sr2";;
+	  *) usage;;
+	esac
+	shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+sizes="$*"
+test -z "$sizes" && sizes="1500 4000 9000"
+
+# hdrlen FAMILY -- length of the SR or SR2 header with $links links
+hdrlen () {
+    case "$1" in
+      sr)	echo `expr 46 + 4 + $links \* 20`;;
+      sr2)	echo `expr 20 + 4 + $links \* 20`;;
+    esac
+}
+
+# packethex FAMILY SIZE -- the frame, in hex: Ethernet header, SR or SR2
+# data header with $links links and next hop 1, and zero data
+packethex () {
+    h=`hdrlen $1`
+    awk -v fam=$1 -v size=$2 -v h=$h -v links=$links 'BEGIN {
+	dlen = size - 14 - h;
+	s = "000000000002" "000000000001" "0941";
+	s = s (fam == "sr" ? "0b" : "0c") "04" sprintf("%02x%02x", links, 1);
+	s = s "0000" "0000" "0000" sprintf("%04x", dlen);
+	for (i = 12; i < h; i++)
+	    s = s "00";
+	for (i = 0; i < dlen; i++)
+	    s = s "00";
+	print s;
+    }'
+}
+
+# makeconfig FAMILY MODE SIZE
+makeconfig () {
+    case "$1" in
+      sr)	check=CheckSRHeader; set=SetSRChecksum;;
+      sr2)	check=SR2CheckHeader; set=SR2SetChecksum;;
+    esac
+    case "$2" in
+      header)	setter="$set(HEADER_ONLY true)";;
+      *)	setter="$set";;
+    esac
+    echo "require(roofnet)"
+    echo "InfiniteSource(DATA \\<`packethex $1 $3`>, LIMIT $packets, BURST 32, STOP true)"
+    echo "    -> $setter"
+    i=0
+    while test $i -lt $hops; do
+	echo "    -> $check -> $set"
+	i=`expr $i + 1`
+    done
+    echo "    -> Discard;"
+}
+
+status=0
+printf '%-4s %-7s %6s %9s %10s %8s\n' fam mode size packets pkts/sec Gbit/s
+
+for f in $families; do
+    case "$f" in
+      sr)	modes="full header";;
+      sr2)	modes="none header";;
+    esac
+    for size in $sizes; do
+	if test $size -lt `expr 14 + \`hdrlen $f\``; then
+	    echo "benchsrcksum.sh: $f: $size bytes is too small for $links links" 1>&2
+	    status=1
+	    continue
+	fi
+	for m in $modes; do
+	    start=`date +%s.%N`
+	    if ! click -e "`makeconfig $f $m $size`"; then
+		echo "benchsrcksum.sh: $f $m $size: click failed" 1>&2
+		status=1
+		continue
+	    fi
+	    end=`date +%s.%N`
+	    echo "$start $end" | awk -v f=$f -v m=$m -v size=$size -v n=$packets '{
+		sec = $2 - $1;
+		rate = (sec > 0 ? n / sec : 0);
+		printf "%-4s %-7s %6d %9d %10.0f %8.2f\n", f, m, size, n, rate, rate * size * 8 / 1e9
+	    }'
+	done
+    done
+done
+
+exit $status
@@ -0,0 +1,229 @@
+#ifndef CLICK_NEIGHBORSTATS_HH
+#define CLICK_NEIGHBORSTATS_HH
+#include <click/glue.hh>
+#include <click/atomic.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+
+/*
+ * NeighborStats<K, C> -- per-neighbor statistics registry
+ *
+ * Keeps one counter block C per neighbor key K and per thread.  The packet
+ * path only touches the block of its own thread, so counters need no
+ * locking or atomic operations; readers add the shards up.  Neighbors are
+ * kept in a fixed-size open-addressed table, so lookups never see a table
+ * being resized.  Only inserts take a lock.  An insert writes the new
+ * neighbor's key and clears its counters, then publishes the slot behind a
+ * full memory barrier; size() puts a barrier after reading the count, so a
+ * reader walking neighbors 0 to size()-1 sees their keys.  find() reaches
+ * the key through the slot it read, which orders the two loads.
+ *
+ * Once the table is full new neighbors are not tracked: insert returns -1
+ * and adds one to drops().  Elements export that count in a 'drops'
+ * handler, so a MAX_NEIGHBORS that is too small shows up.
+ *
+ * C must be default-constructible and provide reset().  Readers may see a
+ * counter block while another thread is updating it; that is fine for
+ * monitoring, which is all these elements do.
+ *
+ * StatShards<C> is the same per-thread arrangement for a single counter
+ * block that is not tied to a neighbor.
+ *
+ * StatRing<T, N> is a fixed-size history: push() overwrites the oldest
+ * entry once N entries are held, so recording a sample never allocates.
+ */
+
+template <typename T, int N>
+class StatRing { public:
+
+  StatRing() : _head(0), _size(0) { }
+
+  void push(const T &x) {
+    _e[_head] = x;
+    _head = (_head + 1) % N;
+    if (_size < N)
+      _size++;
+  }
+
+  // Entry i, 0 being the most recent
+  const T &operator[](int i) const {
+    return _e[(_head + N - 1 - i) % N];
+  }
+
+  int size() const		{ return _size; }
+  static int capacity()		{ return N; }
+  void clear()			{ _head = _size = 0; }
+
+ private:
+
+  T _e[N];
+  int _head;
+  int _size;
+
+};
+
+template <typename C>
+class StatShards { public:
+
+  StatShards() : _c(0), _n(0) { }
+  ~StatShards()			{ delete[] _c; }
+
+  void configure() {
+    delete[] _c;
+    _n = click_max_cpu_ids();
+    _c = new C[_n];
+    reset();
+  }
+
+  C &local()			{ return _c[click_current_cpu_id()]; }
+
+  C sum() const {
+    C c;
+    c.reset();
+    for (int s = 0; s < _n; s++)
+      c += _c[s];
+    return c;
+  }
+
+  void reset() {
+    for (int s = 0; s < _n; s++)
+      _c[s].reset();
+  }
+
+ private:
+
+  C *_c;
+  int _n;
+
+  StatShards(const StatShards<C> &);
+  StatShards<C> &operator=(const StatShards<C> &);
+
+};
+
+template <typename K, typename C>
+class NeighborStats { public:
+
+  NeighborStats()
+    : _keys(0), _slots(0), _counters(0), _capacity(0), _nslots(0),
+      _nshards(0), _n(0) {
+    _drops = 0;
+  }
+
+  ~NeighborStats() {
+    delete[] _keys;
+    delete[] _slots;
+    delete[] _counters;
+  }
+
+  // Allocates room for 'capacity' neighbors.  Call from configure() or
+  // initialize(), before packets flow.
+  void configure(int capacity) {
+    delete[] _keys;
+    delete[] _slots;
+    delete[] _counters;
+    _capacity = capacity;
+    for (_nslots = 16; _nslots < 2 * capacity; _nslots *= 2)
+      /* nada */;
+    _nshards = click_max_cpu_ids();
+    _keys = new K[capacity];
+    _slots = new int[_nslots];
+    _counters = new C[_nshards * capacity];
+    _n = 0;
+    _drops = 0;
+    for (int i = 0; i < _nslots; i++)
+      _slots[i] = 0;
+  }
+
+  // Index of k, or -1 if it is not known
+  int find(const K &k) const {
+    for (unsigned h = hashcode(k) & (_nslots - 1); ; h = (h + 1) & (_nslots - 1)) {
+      int i = _slots[h];
+      if (!i)
+	return -1;
+      if (_keys[i - 1] == k)
+	return i - 1;
+    }
+  }
+
+  // Index of k, adding it if needed; -1 if the table is full
+  int insert(const K &k) {
+    int i = find(k);
+    if (i >= 0)
+      return i;
+    if (_n == _capacity) {
+      _drops++;
+      return -1;
+    }
+    SpinlockIRQ::flags_t flags = _lock.acquire();
+    unsigned h = hashcode(k) & (_nslots - 1);
+    for (; _slots[h]; h = (h + 1) & (_nslots - 1))
+      if (_keys[_slots[h] - 1] == k) {
+	_lock.release(flags);
+	return _slots[h] - 1;
+      }
+    if (_n < _capacity) {
+      i = _n;
+      _keys[i] = k;
+      for (int s = 0; s < _nshards; s++)
+	_counters[s * _capacity + i].reset();
+      click_fence();
+      _slots[h] = i + 1;
+      _n = i + 1;
+    } else
+      _drops++;
+    _lock.release(flags);
+    return i;
+  }
+
+  // The calling thread's counters for neighbor i
+  C &local(int i) {
+    return _counters[click_current_cpu_id() * _capacity + i];
+  }
+
+  // Neighbors are numbered 0 to size()-1 in the order they were added
+  int size() const {
+    int n = _n;
+    click_fence();
+    return n;
+  }
+  const K &key(int i) const	{ return _keys[i]; }
+  int nshards() const		{ return _nshards; }
+  const C &shard(int s, int i) const { return _counters[s * _capacity + i]; }
+
+  // Sum of neighbor i's counters over all threads; C must provide +=
+  C sum(int i) const {
+    C c;
+    c.reset();
+    for (int s = 0; s < _nshards; s++)
+      c += _counters[s * _capacity + i];
+    return c;
+  }
+
+  // Number of neighbors not tracked because the table was full
+  uint32_t drops() const	{ return _drops.value(); }
+
+  // Zeroes every counter but keeps the neighbors
+  void reset() {
+    for (int i = 0; i < _nshards * _capacity; i++)
+      _counters[i].reset();
+  }
+
+ private:
+
+  K *_keys;
+  int *_slots;			// index + 1 into _keys, 0 if empty
+  C *_counters;			// _nshards rows of _capacity blocks
+  int _capacity;
+  int _nslots;
+  int _nshards;
+  int _n;
+  atomic_uint32_t _drops;
+  SpinlockIRQ _lock;
+
+  NeighborStats(const NeighborStats<K, C> &);
+  NeighborStats<K, C> &operator=(const NeighborStats<K, C> &);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,472 @@
+/*
+ * routecache.{cc,hh} -- shared shortest-path cache over a LinkTable
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <click/straccum.hh>
+#include <elements/wifi/linktable.hh>
+#include "routecache.hh"
+CLICK_DECLS
+
+RouteCache::RouteCache()
+  : _link_table(0),
+    _period(1000),
+    _max_changes(25),
+    _timer(this),
+    _me(-1),
+    _epoch(0),
+    _valid(false),
+    _dirty(false),
+    _lookups(0),
+    _hits(0),
+    _full(0),
+    _incremental(0)
+{
+}
+
+RouteCache::~RouteCache()
+{
+}
+
+int
+RouteCache::configure (Vector<String> &conf, ErrorHandler *errh)
+{
+  int ret;
+  ret = cp_va_kparse(conf, this, errh,
+		     "LT", cpkP+cpkM, cpElement, &_link_table,
+		     "IP", cpkP+cpkM, cpIPAddress, &_ip,
+		     /* below not required */
+		     "PERIOD", 0, cpUnsigned, &_period,
+		     "MAX_CHANGES", 0, cpUnsigned, &_max_changes,
+		     cpEnd);
+  if (ret < 0)
+    return ret;
+
+  if (_link_table->cast("LinkTable") == 0)
+    return errh->error("LinkTable element is not a LinkTable");
+  if (_max_changes > 100)
+    return errh->error("MAX_CHANGES must be a percentage");
+
+  return ret;
+}
+
+int
+RouteCache::initialize (ErrorHandler *)
+{
+  _timer.initialize(this);
+  if (_period)
+    _timer.schedule_after_msec(_period);
+  return 0;
+}
+
+void
+RouteCache::run_timer (Timer *)
+{
+  refresh();
+  _timer.schedule_after_msec(_period);
+}
+
+void
+RouteCache::snapshot(Vector<IPAddress> &hosts, Vector<int> &out_start,
+		     Vector<int> &edge_to, Vector<unsigned> &edge_metric)
+{
+  hosts = _link_table->get_hosts();
+  HashMap<IPAddress, int> index;
+  for (int i = 0; i < hosts.size(); i++)
+    index.insert(hosts[i], i);
+
+  for (int i = 0; i < hosts.size(); i++) {
+    out_start.push_back(edge_to.size());
+    Vector<IPAddress> neighbors = _link_table->get_neighbors(hosts[i]);
+    for (int x = 0; x < neighbors.size(); x++) {
+      unsigned metric = _link_table->get_link_metric(hosts[i], neighbors[x]);
+      int *j = index.findp(neighbors[x]);
+      if (!metric || !j)
+	continue;
+      edge_to.push_back(*j);
+      edge_metric.push_back(metric);
+    }
+  }
+  out_start.push_back(edge_to.size());
+}
+
+void
+RouteCache::build_index()
+{
+  int n = _hosts.size();
+  _index.clear();
+  for (int i = 0; i < n; i++)
+    _index.insert(_hosts[i], i);
+  int *me = _index.findp(_ip);
+  _me = (me ? *me : -1);
+
+  _edge_from.resize(_edge_to.size());
+  Vector<int> in_count(n, 0);
+  for (int i = 0; i < n; i++)
+    for (int e = _out_start[i]; e < _out_start[i+1]; e++) {
+      _edge_from[e] = i;
+      in_count[_edge_to[e]]++;
+    }
+
+  _in_start.resize(n + 1);
+  _in_start[0] = 0;
+  for (int i = 0; i < n; i++)
+    _in_start[i+1] = _in_start[i] + in_count[i];
+  _in_edge.resize(_edge_to.size());
+  for (int e = 0; e < _edge_to.size(); e++) {
+    int to = _edge_to[e];
+    _in_edge[_in_start[to+1] - in_count[to]] = e;
+    in_count[to]--;
+  }
+}
+
+bool
+RouteCache::refresh()
+{
+  Vector<IPAddress> hosts;
+  Vector<int> out_start;
+  Vector<int> edge_to;
+  Vector<unsigned> edge_metric;
+  snapshot(hosts, out_start, edge_to, edge_metric);
+  _dirty = false;
+
+  bool same = _valid && hosts.size() == _hosts.size()
+    && edge_to.size() == _edge_to.size();
+  for (int i = 0; same && i < hosts.size(); i++)
+    same = (hosts[i] == _hosts[i] && out_start[i+1] == _out_start[i+1]);
+  for (int e = 0; same && e < edge_to.size(); e++)
+    same = (edge_to[e] == _edge_to[e]);
+
+  Vector<int> changed;
+  Vector<unsigned> old_metric;
+  if (same) {
+    for (int e = 0; e < edge_metric.size(); e++)
+      if (edge_metric[e] != _edge_metric[e]) {
+	changed.push_back(e);
+	old_metric.push_back(_edge_metric[e]);
+      }
+    if (!changed.size())
+      return false;
+  }
+
+  Timestamp start = Timestamp::now();
+  _epoch++;
+  _from_paths.clear();
+  _to_paths.clear();
+  _edge_metric.swap(edge_metric);
+
+  if (same && changed.size() * 100 <= _max_changes * _edge_to.size()
+      && update_tree(_from_me, changed, old_metric, false)
+      && update_tree(_to_me, changed, old_metric, true))
+    _incremental++;
+  else {
+    if (!same) {
+      _hosts.swap(hosts);
+      _out_start.swap(out_start);
+      _edge_to.swap(edge_to);
+      build_index();
+    }
+    full_recompute();
+    _full++;
+  }
+  _valid = true;
+
+  _last_time = Timestamp::now() - start;
+  _total_time += _last_time;
+  return true;
+}
+
+void
+RouteCache::note_link(IPAddress from, IPAddress to, unsigned metric)
+{
+  if (!_valid || _dirty)
+    return;
+  int *i = _index.findp(from);
+  int *j = _index.findp(to);
+  if (i && j)
+    for (int e = _out_start[*i]; e < _out_start[*i + 1]; e++)
+      if (_edge_to[e] == *j) {
+	_dirty = (_edge_metric[e] != metric);
+	return;
+      }
+  _dirty = true;
+}
+
+void
+RouteCache::full_recompute()
+{
+  Vector<HeapEntry> heap;
+  for (int r = 0; r < 2; r++) {
+    Tree &t = (r ? _to_me : _from_me);
+    t._dist.assign(_hosts.size(), (unsigned) INFINITE);
+    t._prev.assign(_hosts.size(), -1);
+    if (_me >= 0) {
+      t._dist[_me] = 0;
+      heap_push(heap, HeapEntry(0, _me));
+    }
+    dijkstra(t, heap, r);
+  }
+}
+
+/*
+ * Applies metric changes to a tree already matching the old metrics.  A
+ * decrease can only shorten routes, so Dijkstra restarts from the far end
+ * of each such link that now gives a shorter path.  An increase on a link
+ * the tree does not use changes nothing.  Returns false when some change
+ * needs a full recompute.
+ */
+bool
+RouteCache::update_tree(Tree &t, const Vector<int> &changed,
+			const Vector<unsigned> &old_metric, bool reverse)
+{
+  Vector<HeapEntry> heap;
+  for (int c = 0; c < changed.size(); c++) {
+    int e = changed[c];
+    int near = (reverse ? _edge_to[e] : _edge_from[e]);
+    int far = (reverse ? _edge_from[e] : _edge_to[e]);
+    unsigned metric = _edge_metric[e];
+    if (metric > old_metric[c]) {
+      if (t._prev[far] == near)
+	return false;
+    } else if (t._dist[near] != INFINITE
+	       && t._dist[near] + metric < t._dist[far]) {
+      t._dist[far] = t._dist[near] + metric;
+      t._prev[far] = near;
+      heap_push(heap, HeapEntry(t._dist[far], far));
+    }
+  }
+  dijkstra(t, heap, reverse);
+  return true;
+}
+
+void
+RouteCache::dijkstra(Tree &t, Vector<HeapEntry> &heap, bool reverse)
+{
+  while (heap.size()) {
+    HeapEntry h = heap_pop(heap);
+    if (h._dist != t._dist[h._node])
+      continue;
+    int n = h._node;
+    int first = (reverse ? _in_start[n] : _out_start[n]);
+    int last = (reverse ? _in_start[n+1] : _out_start[n+1]);
+    for (int k = first; k < last; k++) {
+      int e = (reverse ? _in_edge[k] : k);
+      int x = (reverse ? _edge_from[e] : _edge_to[e]);
+      unsigned d = h._dist + _edge_metric[e];
+      if (d < t._dist[x]) {
+	t._dist[x] = d;
+	t._prev[x] = n;
+	heap_push(heap, HeapEntry(d, x));
+      }
+    }
+  }
+}
+
+void
+RouteCache::heap_push(Vector<HeapEntry> &heap, const HeapEntry &h)
+{
+  int i = heap.size();
+  heap.push_back(h);
+  while (i > 0 && heap[(i - 1) / 2]._dist > h._dist) {
+    heap[i] = heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap[i] = h;
+}
+
+RouteCache::HeapEntry
+RouteCache::heap_pop(Vector<HeapEntry> &heap)
+{
+  HeapEntry top = heap[0];
+  HeapEntry last = heap.back();
+  heap.pop_back();
+  int n = heap.size();
+  int i = 0;
+  while (n) {
+    int c = 2 * i + 1;
+    if (c >= n)
+      break;
+    if (c + 1 < n && heap[c + 1]._dist < heap[c]._dist)
+      c++;
+    if (heap[c]._dist >= last._dist)
+      break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  if (n)
+    heap[i] = last;
+  return top;
+}
+
+Path
+RouteCache::build_path(int i, bool from_me)
+{
+  const Tree &t = (from_me ? _from_me : _to_me);
+  Path walk;
+  if (_me < 0 || t._dist[i] == INFINITE)
+    return walk;
+  for (int n = i; n != _me; n = t._prev[n])
+    walk.push_back(_hosts[n]);
+  walk.push_back(_ip);
+  if (!from_me)
+    return walk;
+  Path route;
+  for (int x = walk.size() - 1; x >= 0; x--)
+    route.push_back(walk[x]);
+  return route;
+}
+
+Path
+RouteCache::best_route(IPAddress dst, bool from_me)
+{
+  if (!_valid || _dirty)
+    refresh();
+  _lookups++;
+  HashMap<IPAddress, Path> &paths = (from_me ? _from_paths : _to_paths);
+  if (Path *p = paths.findp(dst)) {
+    _hits++;
+    return *p;
+  }
+  int *i = _index.findp(dst);
+  if (!i)
+    return Path();
+  Path p = build_path(*i, from_me);
+  paths.insert(dst, p);
+  return p;
+}
+
+unsigned
+RouteCache::get_route_metric(IPAddress dst, bool from_me)
+{
+  if (!_valid || _dirty)
+    refresh();
+  int *i = _index.findp(dst);
+  if (!i)
+    return 0;
+  unsigned d = (from_me ? _from_me : _to_me)._dist[*i];
+  return (d == INFINITE ? 0 : d);
+}
+
+void
+RouteCache::reset()
+{
+  _hosts.clear();
+  _index.clear();
+  _out_start.clear();
+  _edge_from.clear();
+  _edge_to.clear();
+  _edge_metric.clear();
+  _in_start.clear();
+  _in_edge.clear();
+  _me = -1;
+  _from_me = Tree();
+  _to_me = Tree();
+  _from_paths.clear();
+  _to_paths.clear();
+  _valid = false;
+  _dirty = false;
+  _lookups = _hits = _full = _incremental = 0;
+  _last_time = _total_time = Timestamp();
+}
+
+String
+RouteCache::print_routes()
+{
+  StringAccum sa;
+  for (int i = 0; i < _hosts.size(); i++) {
+    if (i == _me || _from_me._dist[i] == INFINITE)
+      continue;
+    Path p = build_path(i, true);
+    sa << _hosts[i] << " metric " << _from_me._dist[i] << " [ ";
+    for (int x = 0; x < p.size(); x++)
+      sa << p[x] << " ";
+    sa << "]\n";
+  }
+  return sa.take_string();
+}
+
+String
+RouteCache::print_hit_rate()
+{
+  StringAccum sa;
+  sa << "lookups " << _lookups << "\n";
+  sa << "hits " << _hits << "\n";
+  sa << "hit_rate " << (_lookups ? (100 * (uint64_t) _hits) / _lookups : 0) << "%\n";
+  return sa.take_string();
+}
+
+String
+RouteCache::print_recompute_time()
+{
+  StringAccum sa;
+  sa << "last " << _last_time.usecval() << "\n";
+  sa << "total " << _total_time.usecval() << "\n";
+  sa << "full " << _full << "\n";
+  sa << "incremental " << _incremental << "\n";
+  return sa.take_string();
+}
+
+enum {H_EPOCH, H_HIT_RATE, H_RECOMPUTE_TIME, H_ROUTES, H_REFRESH, H_RESET};
+
+static String
+read_param(Element *e, void *thunk)
+{
+  RouteCache *rc = (RouteCache *)e;
+  switch ((uintptr_t) thunk) {
+  case H_EPOCH:
+    return String(rc->epoch()) + "\n";
+  case H_HIT_RATE:
+    return rc->print_hit_rate();
+  case H_RECOMPUTE_TIME:
+    return rc->print_recompute_time();
+  case H_ROUTES:
+    return rc->print_routes();
+  default:
+    return String();
+  }
+}
+
+static int
+write_param(const String &, Element *e, void *vparam,
+	    ErrorHandler *)
+{
+  RouteCache *rc = (RouteCache *)e;
+  switch((intptr_t)vparam) {
+  case H_REFRESH:
+    rc->refresh();
+    break;
+  case H_RESET:
+    rc->reset();
+    break;
+  }
+  return 0;
+}
+
+void
+RouteCache::add_handlers()
+{
+  add_read_handler("epoch", read_param, (void *) H_EPOCH);
+  add_read_handler("hit_rate", read_param, (void *) H_HIT_RATE);
+  add_read_handler("recompute_time", read_param, (void *) H_RECOMPUTE_TIME);
+  add_read_handler("routes", read_param, (void *) H_ROUTES);
+
+  add_write_handler("refresh", write_param, (void *) H_REFRESH);
+  add_write_handler("reset", write_param, (void *) H_RESET);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(LinkTable)
+EXPORT_ELEMENT(RouteCache)
@@ -0,0 +1,192 @@
+#ifndef CLICK_ROUTECACHE_HH
+#define CLICK_ROUTECACHE_HH
+#include <click/element.hh>
+#include <click/glue.hh>
+#include <click/timer.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+#include <click/hashmap.hh>
+#include <elements/wifi/path.hh>
+CLICK_DECLS
+
+/*
+=c
+
+RouteCache(LT, IP, [I<KEYWORDS>])
+
+=s Roofnet
+
+Shared shortest-path cache over a LinkTable.
+
+=d
+
+Keeps the shortest-path trees from and to IP over the links in LinkTable
+LT, and serves best routes and route metrics out of them, so that elements
+asking for routes do not each run a Dijkstra pass over the link table.
+
+Every PERIOD RouteCache compares the links in LT with its own copy.
+Elements that add links to LT report them with note_link(); a link that is
+new or has a different metric than in the copy makes the next lookup
+compare the links first, so lookups only pay for re-reading LT after it
+changed.  Links changed by elements that do not report them are seen at
+the next PERIOD.  If nothing changed the trees are kept.  Otherwise the
+topology epoch is incremented and the trees are updated: incrementally
+when only link metrics changed and every change is a decrease or an
+increase on a link neither tree uses, and with a full Dijkstra pass
+otherwise.  Paths built for lookups are cached until the next epoch.
+
+A metric of 0 means there is no route, as with LinkTable.
+
+Keyword arguments are:
+
+=over 8
+
+=item PERIOD
+
+Unsigned integer.  Milliseconds between checks of the link table.  0 means
+RouteCache only checks when asked to.  Defaults to 1000.
+
+=item MAX_CHANGES
+
+Unsigned integer.  Percentage of links that may change metric in one epoch
+before the trees are recomputed from scratch.  Defaults to 25.
+
+=back
+
+=h epoch read-only
+
+The current topology epoch.
+
+=h hit_rate read-only
+
+Route lookups, lookups answered from the path cache, and the hit rate.
+
+=h recompute_time read-only
+
+Time spent on the last tree update and on all updates, in microseconds,
+and the number of full and incremental updates.
+
+=h routes read-only
+
+The best route from IP to every reachable host, with its metric.
+
+=h refresh write-only
+
+Checks the link table now.
+
+=h reset write-only
+
+Forgets the trees and the statistics; the next check recomputes from
+scratch.
+
+=a LinkTable, SRQuerier, SRQueryForwarder, SRQueryResponder, GatewaySelector,
+MetricFlood, SR1GatewayResponder
+
+*/
+
+class RouteCache : public Element { public:
+
+  RouteCache();
+  ~RouteCache();
+
+  const char *class_name() const	{ return "RouteCache"; }
+  const char *port_count() const	{ return PORTS_0_0; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void run_timer(Timer *);
+  void add_handlers();
+
+  // Re-reads the link table; returns true if the topology changed.
+  bool refresh();
+
+  // Called after the link from->to was set to metric in the link table.
+  // Cheap; if the link differs from the cached copy, the next lookup or
+  // epoch() refreshes first.
+  void note_link(IPAddress from, IPAddress to, unsigned metric);
+
+  // Same orders as LinkTable::best_route(): me first when from_me, me
+  // last otherwise.  Empty if there is no route.
+  Path best_route(IPAddress, bool from_me);
+  unsigned get_route_metric(IPAddress, bool from_me);
+
+  uint32_t epoch() {
+    if (_dirty)
+      refresh();
+    return _epoch;
+  }
+
+  String print_routes();
+  String print_hit_rate();
+  String print_recompute_time();
+  void reset();
+
+ private:
+
+  enum { INFINITE = 0xFFFFFFFFU };
+
+  // A shortest-path tree, indexed like _hosts.  _prev is the neighbor
+  // towards IP: the predecessor for the tree from IP, the next hop for
+  // the tree to IP.
+  struct Tree {
+    Vector<unsigned> _dist;
+    Vector<int> _prev;
+  };
+
+  struct HeapEntry {
+    unsigned _dist;
+    int _node;
+    HeapEntry(unsigned d, int n) : _dist(d), _node(n) { }
+  };
+
+  class LinkTable *_link_table;
+  IPAddress _ip;
+  uint32_t _period;
+  uint32_t _max_changes;
+  Timer _timer;
+
+  // The link table as of the last check.  Out-links of host i are
+  // _edge_to/_edge_metric[_out_start[i] .. _out_start[i+1]); in-links are
+  // the edge indexes _in_edge[_in_start[i] .. _in_start[i+1]).
+  Vector<IPAddress> _hosts;
+  HashMap<IPAddress, int> _index;
+  Vector<int> _out_start;
+  Vector<int> _edge_from;
+  Vector<int> _edge_to;
+  Vector<unsigned> _edge_metric;
+  Vector<int> _in_start;
+  Vector<int> _in_edge;
+  int _me;
+
+  Tree _from_me;
+  Tree _to_me;
+  uint32_t _epoch;
+  bool _valid;
+  bool _dirty;
+
+  HashMap<IPAddress, Path> _from_paths;
+  HashMap<IPAddress, Path> _to_paths;
+
+  uint32_t _lookups;
+  uint32_t _hits;
+  uint32_t _full;
+  uint32_t _incremental;
+  Timestamp _last_time;
+  Timestamp _total_time;
+
+  void snapshot(Vector<IPAddress> &, Vector<int> &, Vector<int> &,
+		Vector<unsigned> &);
+  void build_index();
+  void full_recompute();
+  bool update_tree(Tree &, const Vector<int> &, const Vector<unsigned> &,
+		   bool reverse);
+  void dijkstra(Tree &, Vector<HeapEntry> &, bool reverse);
+  Path build_path(int, bool from_me);
+
+  static void heap_push(Vector<HeapEntry> &, const HeapEntry &);
+  static HeapEntry heap_pop(Vector<HeapEntry> &);
+
+};
+
+CLICK_ENDDECLS
+#endif
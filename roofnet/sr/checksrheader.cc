@@ -98,9 +98,9 @@ CheckSRHeader::simple_action(Packet *p)
     goto bad;
   }
 
-  if (click_in_cksum((unsigned char *) pk, tlen) != 0) {
+  if (!pk->check_checksum()) {
 	  click_chatter("%{element}: bad SR checksum", this);
-	  click_chatter("%{element}: length: %d, cksum: 0x%.4x", this, tlen, (unsigned long) ntohs(pk->_cksum));
+	  click_chatter("%{element}: length: %d, cksum: 0x%.4x", this, (int) pk->cksum_len(), (unsigned long) ntohs(pk->_cksum));
     goto bad;
   }
 
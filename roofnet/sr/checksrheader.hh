@@ -19,7 +19,9 @@ Check the Source Route header of a packet.
 Expects SR packets as input.
 Checks that the packet's length is reasonable,
 and that the SR header length, length, and
-checksum fields are valid.
+checksum fields are valid.  The checksum of a data packet
+covers its data too, unless the packet has FLAG_HEADER_CKSUM
+(0x100) set; packets of both kinds are accepted.
 
 =a SetSRChecksum
  */
@@ -23,6 +23,7 @@
 #include <click/ipaddress.hh>
 #include <clicknet/ether.h>
 #include "srpacket.hh"
+#include "../routecache.hh"
 #include "gatewayselector.hh"
 
 CLICK_DECLS
@@ -32,8 +33,13 @@ GatewaySelector::GatewaySelector()
      _en(),
      _et(0),
      _link_table(0),
+     _route_cache(0),
      _arp_table(0),
-     _timer(this)
+     _timer(this),
+     _best_valid(false),
+     _recomputes(0),
+     _cache_hits(0),
+     _rc_epoch(0)
 {
 
   MaxSeen = 200;
@@ -63,6 +69,7 @@ GatewaySelector::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "LT", 0, cpElement, &_link_table,
 		     "ARP", 0, cpElement, &_arp_table,
 		     /* not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "PERIOD", 0, cpUnsigned, &_period,
 		     "GW", 0, cpBool, &_is_gw,
 		     cpEnd);
@@ -79,6 +86,8 @@ GatewaySelector::configure (Vector<String> &conf, ErrorHandler *errh)
 
   if (_link_table->cast("LinkTable") == 0) 
     return errh->error("LinkTable element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RouteCache element is not a RouteCache");
   if (_arp_table && _arp_table->cast("ARPTable") == 0) 
     return errh->error("ARPTable element is not an ARPtable");
 
@@ -155,6 +164,8 @@ GatewaySelector::update_link(IPAddress from, IPAddress to, uint32_t seq,
 		  to.unparse().c_str());
     return false;
   }
+  if (_route_cache)
+    _route_cache->note_link(from, to, metric);
   return true;
 }
 
@@ -173,9 +184,11 @@ GatewaySelector::forward_ad(Seen *s)
 {
 
   s->_forwarded = true;
-  _link_table->dijkstra(false);
+  if (!_route_cache)
+    _link_table->dijkstra(false);
   IPAddress src = s->_gw;
-  Path best = _link_table->best_route(src, false);
+  Path best = (_route_cache ? _route_cache->best_route(src, false)
+	       : _link_table->best_route(src, false));
   bool best_valid = _link_table->valid_route(best);
   
   if (!best_valid) {
@@ -223,18 +236,57 @@ GatewaySelector::forward_ad(Seen *s)
 }
 
 
-IPAddress
-GatewaySelector::best_gateway() 
+// Metric of the best route from gw to us, 0 if there is none
+int
+GatewaySelector::route_metric(IPAddress gw)
+{
+  if (_route_cache)
+    return _route_cache->get_route_metric(gw, false);
+  return _link_table->get_route_metric(_link_table->best_route(gw, false));
+}
+
+// Check of the cached selection.  RouteCache's epoch changes with any
+// link.  LinkTable keeps no generation count, so without RC each gateway's
+// host metric shows a new Dijkstra run, and re-adding the link metrics
+// along its saved route shows a link change since; that is what an uncached
+// best_route() and get_route_metric() would have seen, without building
+// the routes again.
+bool
+GatewaySelector::topology_changed()
+{
+  if (_route_cache)
+    return _route_cache->epoch() != _rc_epoch;
+  for(GWTable::iterator iter = _gateways.begin(); iter.live(); iter++) {
+    const GWInfo &nfo = iter.value();
+    if (_link_table->get_host_metric_to_me(iter.key()) != nfo._host_metric
+	|| (int) _link_table->get_route_metric(nfo._path) != nfo._metric)
+      return true;
+  }
+  return false;
+}
+
+void
+GatewaySelector::recompute_best_gateway(const Timestamp &now)
 {
   IPAddress best_gw = IPAddress();
   int best_metric = 0;
-  Timestamp now = Timestamp::now();
+  _best_expire = Timestamp();
+  if (_route_cache)
+    _rc_epoch = _route_cache->epoch();
   
-  for(GWIter iter = _gateways.begin(); iter.live(); iter++) {
-    GWInfo nfo = iter.value();
+  for(GWTable::iterator iter = _gateways.begin(); iter.live(); iter++) {
+    GWInfo &nfo = iter.value();
     Timestamp expire = nfo._last_update + _gw_expire;
-    Path p = _link_table->best_route(nfo._ip, false);
-    int metric = _link_table->get_route_metric(p);
+    if (_route_cache)
+      nfo._metric = _route_cache->get_route_metric(nfo._ip, false);
+    else {
+      nfo._path = _link_table->best_route(nfo._ip, false);
+      nfo._metric = _link_table->get_route_metric(nfo._path);
+      nfo._host_metric = _link_table->get_host_metric_to_me(nfo._ip);
+    }
+    int metric = nfo._metric;
+    if (now < expire && (!_best_expire || expire < _best_expire))
+      _best_expire = expire;
     if (now < expire &&
 	metric && 
 	((!best_metric) || best_metric > metric) &&
@@ -244,8 +296,24 @@ GatewaySelector::best_gateway()
       best_metric = metric;
     }
   }
+
+  _best_gw = best_gw;
+  _best_valid = true;
+  _recomputes++;
+}
+
+IPAddress
+GatewaySelector::best_gateway() 
+{
+  Timestamp now = Timestamp::now();
+  if (!_best_valid ||
+      (_best_expire && now >= _best_expire) ||
+      topology_changed())
+    recompute_best_gateway(now);
+  else
+    _cache_hits++;
   
-  return best_gw;
+  return _best_gw;
 
 }
 bool
@@ -366,6 +434,10 @@ GatewaySelector::push(int port, Packet *p_in)
 	  _gateways.insert(gw, GWInfo());
 	  nfo = _gateways.findp(gw);
 	  nfo->_first_update = Timestamp::now();
+	  _best_valid = false;
+  } else if (Timestamp::now() >= nfo->_last_update + _gw_expire) {
+	  /* an expired gateway is usable again */
+	  _best_valid = false;
   }
   
   nfo->_ip = gw;
@@ -407,9 +479,9 @@ GatewaySelector::print_gateway_stats()
       sa << "first_update " << now - nfo._first_update << " ";
       sa << "last_update " << now - nfo._last_update << " ";
       
-      Path p = _link_table->best_route(nfo._ip, false);
-      int metric = _link_table->get_route_metric(p);
-      sa << "current_metric " << metric << "\n";
+      int metric = route_metric(nfo._ip);
+      sa << "current_metric " << metric << " ";
+      sa << "cached_metric " << nfo._metric << "\n";
     }
     
   return sa.take_string();
@@ -442,6 +514,13 @@ GatewaySelector::read_param(Element *e, void *vparam)
     }
     return sa.take_string();
   }
+
+  case 4: { //recomputes
+    StringAccum sa;
+    sa << "recomputes " << f->_recomputes << "\n";
+    sa << "cache_hits " << f->_cache_hits << "\n";
+    return sa.take_string();
+  }
     
   default:
     return "";
@@ -469,6 +548,7 @@ GatewaySelector::write_param(const String &in_s, Element *e, void *vparam,
       return errh->error("ignore_add parameter must be IPAddress");
     }
     f->_ignore.insert(ip, ip);
+    f->_best_valid = false;
     break;
   }
 
@@ -478,11 +558,13 @@ GatewaySelector::write_param(const String &in_s, Element *e, void *vparam,
       return errh->error("ignore_del parameter must be IPAddress");
     }
     f->_ignore.remove(ip);
+    f->_best_valid = false;
     break;
   }
 
   case 3: { //ignore_clear
     f->_ignore.clear();
+    f->_best_valid = false;
     break;
   }
 
@@ -492,6 +574,7 @@ GatewaySelector::write_param(const String &in_s, Element *e, void *vparam,
       return errh->error("allow_add parameter must be IPAddress");
     }
     f->_allow.insert(ip, ip);
+    f->_best_valid = false;
     break;
   }
 
@@ -501,11 +584,13 @@ GatewaySelector::write_param(const String &in_s, Element *e, void *vparam,
       return errh->error("allow_del parameter must be IPAddress");
     }
     f->_allow.remove(ip);
+    f->_best_valid = false;
     break;
   }
 
   case 6: { //allow_clear
     f->_allow.clear();
+    f->_best_valid = false;
     break;
   }
     
@@ -521,6 +606,7 @@ GatewaySelector::add_handlers()
   add_read_handler("stats", read_param, (void *) 1);
   add_read_handler("ignore", read_param, (void *) 2);
   add_read_handler("allow", read_param, (void *) 3);
+  add_read_handler("recomputes", read_param, (void *) 4);
   
   add_write_handler("is_gateway", write_param, (void *) 0);
   add_write_handler("ignore_add", write_param, (void *) 1);
@@ -17,7 +17,7 @@ CLICK_DECLS
 =c
 GatewaySelector(IP, ETH, ETHERTYPE, LinkTable, ARPTable, 
                 [PERIOD timeout], [GW is_gateway], 
-                [METRIC GridGenericMetric])
+                [METRIC GridGenericMetric], [RC RouteCache element])
 
 =s Roofnet
 
@@ -36,6 +36,19 @@ Each gateway broadcasts an ad every PERIOD seconds.
 Non-gateway nodes select the gateway with the best metric
 and forward ads.
 
+The selected gateway is cached.  It is recomputed only when a new
+gateway is heard, a usable gateway expires, the ignore or allow lists
+change, LinkTable's metric to some gateway changes, or the metric of a
+link on the route to some gateway changes.
+
+With RC, routes and metrics to gateways come from that RouteCache, and
+the selection is recomputed when its topology epoch changes instead.
+
+=h recomputes read-only
+
+Returns how many times the gateway selection was recomputed and how
+many selections were answered from the cache.
+
  */
 
 
@@ -106,7 +119,10 @@ private:
     Timestamp _first_update;
     Timestamp _last_update;
     int _seen;
-    GWInfo() {memset(this,0,sizeof(*this)); }
+    int _metric;           // route metric at the last recomputation
+    unsigned _host_metric; // LinkTable's metric to this gateway then
+    Path _path;            // and the route it was measured on (without RC)
+    GWInfo() : _seen(0), _metric(0), _host_metric(0) { }
   };
 
   typedef HashMap<IPAddress, GWInfo> GWTable;
@@ -127,9 +143,18 @@ private:
   bool _is_gw;
 
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
   class ARPTable *_arp_table;
   Timer _timer;
 
+  // Cached gateway selection
+  IPAddress _best_gw;
+  bool _best_valid;
+  Timestamp _best_expire; // when the first usable gateway expires
+  uint32_t _recomputes;
+  uint32_t _cache_hits;
+  uint32_t _rc_epoch;   // RouteCache epoch at the last recomputation
+
 
   
 
@@ -144,6 +169,9 @@ private:
   void send(WritablePacket *);
   void process_data(Packet *p_in);
   bool pick_new_gateway();
+  int route_metric(IPAddress);
+  bool topology_changed();
+  void recompute_best_gateway(const Timestamp &now);
   bool valid_gateway(IPAddress);
   static void static_forward_ad_hook(Timer *, void *e) { 
     ((GatewaySelector *) e)->forward_ad_hook(); 
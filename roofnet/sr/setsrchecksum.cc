@@ -27,6 +27,7 @@
 CLICK_DECLS
 
 SetSRChecksum::SetSRChecksum()
+  : _header_only(false)
 {
 }
 
@@ -34,6 +35,14 @@ SetSRChecksum::~SetSRChecksum()
 {
 }
 
+int
+SetSRChecksum::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  return cp_va_kparse(conf, this, errh,
+		      "HEADER_ONLY", 0, cpBool, &_header_only,
+		      cpEnd);
+}
+
 Packet *
 SetSRChecksum::simple_action(Packet *xp)
 {
@@ -58,6 +67,8 @@ SetSRChecksum::simple_action(Packet *xp)
     goto bad;
 
   pk->_version = _sr_version;
+  if (_header_only && (pk->_type & PT_DATA))
+    pk->set_flag(FLAG_HEADER_CKSUM);
   pk->set_checksum();
 
   return xp;
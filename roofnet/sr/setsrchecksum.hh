@@ -4,7 +4,7 @@
 /*
 =c
 
-SetSRChecksum()
+SetSRChecksum([I<KEYWORDS>])
 
 =s Roofnet
 
@@ -15,7 +15,24 @@ Set Checksum for Source Routed packet.
 Expects a SR MAC packet as input. Calculates the SR header's checksum
 and sets the version and checksum header fields.
 
-=a CheckSRHeader 
+The checksum of a data packet covers its data too, unless the packet
+has FLAG_HEADER_CKSUM (0x100) set, in which case it covers only the SR
+header and the integrity of the data is left to the link layer and the
+transport protocol.  Nodes that predate the flag reject such packets,
+so HEADER_ONLY should be turned on only when every node understands it.
+
+Keyword arguments are:
+
+=over 8
+
+=item HEADER_ONLY
+
+Boolean.  If true, set FLAG_HEADER_CKSUM on data packets.  If false,
+leave the flag as it is.  Defaults to false.
+
+=back
+
+=a CheckSRHeader, SRForwarder
 */
 
 #include <click/element.hh>
@@ -31,7 +48,12 @@ public:
   const char *port_count() const		{ return PORTS_1_1; }
   const char *processing() const		{ return AGNOSTIC; }
 
+  int configure(Vector<String> &, ErrorHandler *);
+
   Packet *simple_action(Packet *);
+
+ private:
+  bool _header_only;
 };
 
 CLICK_ENDDECLS
@@ -18,12 +18,15 @@ CLICK_DECLS
 =c
 
 SR1GatewayResponder(IP, ETH, ETHERTYPE, SR1GatewayResponder element, LinkTable element, ARPtable element, 
-   [METRIC GridGenericMetric], [WARMUP period in seconds])
+   [METRIC GridGenericMetric], [WARMUP period in seconds], [RC RouteCache element])
 
 =s Roofnet
 
 Responds to queries destined for this node.
 
+With RC, the route to the gateway comes from that RouteCache instead of a
+Dijkstra pass over the LinkTable every PERIOD.
+
  */
 
 
@@ -49,6 +52,7 @@ class SR1GatewayResponder : public Element {
   bool _debug;
 
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
   class ARPTable *_arp_table;
   class GatewaySelector *_gw_sel;
 
@@ -291,13 +291,15 @@ SRForwarder::push(int port, Packet *p_in)
 	  uint32_t seq = (_link_table) ? _link_table->get_link_seq(_ip, prev) : 0;
 	  uint32_t age = (_link_table) ? _link_table->get_link_age(_ip, prev) : 0;
 	  
-	  pk->set_link(pk->next()-1,
-		       pk->get_link_node(pk->next()-1), _ip,
-		       prev_fwd_metric, prev_rev_metric,
-		       seq,age);
+	  pk->set_link_cksum(pk->next()-1,
+			     pk->get_link_node(pk->next()-1), _ip,
+			     prev_fwd_metric, prev_rev_metric,
+			     seq,age);
   }
 
-  pk->set_next(pk->next() + 1);
+  /* only the header changes here, so patch the checksum rather than
+     leave SetSRChecksum to sum the whole packet again */
+  pk->set_next_cksum(pk->next() + 1);
   IPAddress nxt = pk->get_link_node(pk->next());
   
   edst = _arp_table->lookup(nxt);
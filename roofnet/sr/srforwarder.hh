@@ -29,6 +29,10 @@ Output 1: packets that were addressed to me.
 
 Normally used in conjuction with ETT element
 
+The checksum of forwarded packets is updated incrementally for the
+header fields changed at this hop, so output 0 need not go through
+SetSRChecksum.
+
  */
 
 
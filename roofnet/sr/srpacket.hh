@@ -25,7 +25,8 @@ enum SRCRPacketFlags {
   FLAG_SCHEDULE = (1<<4),
   FLAG_SCHEDULE_TOKEN = (1<<5),
   FLAG_SCHEDULE_FAKE = (1<<6),
-  FLAG_ECN = (1<<7)
+  FLAG_ECN = (1<<7),
+  FLAG_HEADER_CKSUM = (1<<8)	/* checksum leaves out the data */
 };
 
 static const uint8_t _sr_version = 0x0b;
@@ -253,15 +254,56 @@ struct srpacket {,
   u_char *data() { return (((u_char *)this) + len_wo_data(num_links())); }
 
 
+  /* bytes covered by the checksum: the data too, for data packets
+   * without FLAG_HEADER_CKSUM */
+  size_t cksum_len() const {
+    if ((_type & PT_DATA) && !(ntohs(_flags) & FLAG_HEADER_CKSUM))
+      return hlen_with_data();
+    return hlen_wo_data();
+  }
+
   void set_checksum() {
-    unsigned int tlen = 0;
-    if (_type & PT_DATA) {
-      tlen = hlen_with_data();
-    } else {
-      tlen = hlen_wo_data();
-    }
     _cksum = 0;
-    _cksum = click_in_cksum((unsigned char *) this, tlen);
+    _cksum = click_in_cksum((unsigned char *) this, cksum_len());
+  }
+  bool check_checksum() {
+    return click_in_cksum((unsigned char *) this, cksum_len()) == 0;
+  }
+
+  /* RFC 1624 incremental update, for the len bytes at p having changed
+   * from the bytes at old.  p must be at an even offset in the header
+   * and len must be even. */
+  void update_checksum(const void *old, const void *p, int len) {
+    const u_char *o = (const u_char *) old;
+    const u_char *n = (const u_char *) p;
+    uint32_t sum = (uint16_t) ~_cksum;
+    for (int i = 0; i < len; i += 2) {
+      uint16_t ow, nw;
+      memcpy(&ow, o + i, 2);
+      memcpy(&nw, n + i, 2);
+      sum += (uint16_t) ~ow + nw;
+    }
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    _cksum = ~sum;
+  }
+
+  /* set_next and set_link that keep a valid checksum valid */
+  void set_next_cksum(uint8_t n) {
+    u_char old[2] = { _nlinks, _next };
+    _next = n;
+    update_checksum(old, &_nlinks, 2);
+  }
+  void set_link_cksum(int link,
+		      IPAddress a, IPAddress b,
+		      uint32_t fwd, uint32_t rev,
+		      uint32_t seq,
+		      uint32_t age) {
+    u_char *ndx = (u_char *) ((uint32_t *) (this+1) + link * 5);
+    u_char old[6 * sizeof(uint32_t)];
+    memcpy(old, ndx, sizeof(old));
+    set_link(link, a, b, fwd, rev, seq, age);
+    update_checksum(old, ndx, sizeof(old));
   }
 });
 
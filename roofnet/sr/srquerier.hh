@@ -18,11 +18,14 @@ CLICK_DECLS
 =c
 
 SRQuerier(IP, ETH, ETHERTYPE, SRQuerier element, LinkTable element, ARPtable element, 
-   [METRIC GridGenericMetric], [WARMUP period in seconds])
+   [METRIC GridGenericMetric], [WARMUP period in seconds], [RC RouteCache element])
 
 =s Roofnet
 Sends route queries if it can't find a valid source route.
 
+With RC, best routes and their metrics come from that RouteCache instead
+of from the LinkTable.
+
  */
 
 
@@ -76,6 +79,7 @@ class SRQuerier : public Element {
 
   class SRForwarder *_sr_forwarder;
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
 
   bool _route_dampening;
   bool _debug;
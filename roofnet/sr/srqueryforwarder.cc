@@ -24,6 +24,7 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include "srpacket.hh"
+#include "../routecache.hh"
 CLICK_DECLS
 
 
@@ -33,6 +34,7 @@ SRQueryForwarder::SRQueryForwarder()
      _en(),
      _et(0),
      _link_table(0),
+     _route_cache(0),
      _arp_table(0)
 {
 
@@ -65,6 +67,7 @@ SRQueryForwarder::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "LT", 0, cpElement, &_link_table,
 		     "ARP", 0, cpElement, &_arp_table,
 		     /* below not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     cpEnd);
 
@@ -83,6 +86,8 @@ SRQueryForwarder::configure (Vector<String> &conf, ErrorHandler *errh)
 
   if (_link_table->cast("LinkTable") == 0) 
     return errh->error("LinkTable element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RouteCache element is not a RouteCache");
   if (_arp_table->cast("ARPTable") == 0) 
     return errh->error("ARPTable element is not a ARPTable");
 
@@ -122,6 +127,8 @@ SRQueryForwarder::update_link(IPAddress from, IPAddress to,
 		  to.unparse().c_str());
     return false;
   }
+  if (_route_cache)
+    _route_cache->note_link(from, to, metric);
   return true;
 }
 
@@ -193,7 +200,8 @@ SRQueryForwarder::forward_query(Seen *s)
 {
 
   s->_forwarded = true;
-  _link_table->dijkstra(false);
+  if (!_route_cache)
+    _link_table->dijkstra(false);
   if (0) {
     StringAccum sa;
     sa << (Timestamp::now() - s->_when);
@@ -204,7 +212,8 @@ SRQueryForwarder::forward_query(Seen *s)
   }
 
   IPAddress src = s->_src;
-  Path best = _link_table->best_route(src, false);
+  Path best = (_route_cache ? _route_cache->best_route(src, false)
+	       : _link_table->best_route(src, false));
   bool best_valid = _link_table->valid_route(best);
 
   if (!best_valid) {
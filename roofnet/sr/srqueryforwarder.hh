@@ -18,12 +18,16 @@ CLICK_DECLS
 /*
 =c
 SRQueryForwarder(IP, ETH, ETHERTYPE, SRQueryForwarder element, LinkTable element, ARPtable element, 
-   [METRIC GridGenericMetric], [WARMUP period in seconds])
+   [METRIC GridGenericMetric], [WARMUP period in seconds], [RC RouteCache element])
 
 =s Roofnet
 
 Forwards Route Queries
 
+With RC, the route back to the query source comes from that RouteCache,
+which only reruns Dijkstra when the links learned from the query changed
+the topology.
+
 
 */
 
@@ -96,6 +100,7 @@ class SRQueryForwarder : public Element {
   EtherAddress _bcast;
 
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
   class ARPTable *_arp_table;
 
   bool _debug;
@@ -19,12 +19,16 @@ CLICK_DECLS
 =c
 
 SRQueryResponder(IP, ETH, ETHERTYPE, SRQueryResponder element, LinkTable element, ARPtable element, 
-   [METRIC GridGenericMetric], [WARMUP period in seconds])
+   [METRIC GridGenericMetric], [WARMUP period in seconds], [RC RouteCache element])
 
 =s Roofnet
 
 Responds to queries destined for this node.
 
+With RC, the route back to the query source comes from that RouteCache,
+and links learned from queries and replies make it check the link table
+instead of rerunning LinkTable's Dijkstra.
+
  */
 
 
@@ -73,6 +77,7 @@ class SRQueryResponder : public Element {
   Deque<Seen> _seen;
 
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
   class ARPTable *_arp_table;
 
   bool _debug;
@@ -98,9 +98,10 @@ SR2CheckHeader::simple_action(Packet *p)
     goto bad;
   }
 
-  if (0 && !pk->check_checksum()) {
+  /* only packets that say so carry a checksum */
+  if (pk->flag(SR2_FLAG_HEADER_CKSUM) && !pk->check_checksum()) {
     click_chatter("%s: bad SR checksum", name().c_str());
-    click_chatter("%s: length: %d", name().c_str(), tlen);
+    click_chatter("%s: length: %d", name().c_str(), (int) pk->cksum_len());
     goto bad;
   }
 
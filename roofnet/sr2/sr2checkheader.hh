@@ -19,7 +19,9 @@ Check the Source Route header of a packet.
 Expects SR packets as input.
 Checks that the packet's length is reasonable,
 and that the SR header length, length, and
-checksum fields are valid.
+checksum fields are valid.  Only packets with
+SR2_FLAG_HEADER_CKSUM (0x04) set carry a checksum, covering
+the SR2 header; others are accepted unchecked.
 
 =a SetSRChecksum
  */
@@ -185,7 +185,7 @@ SR2Forwarder::push(int port, Packet *p_in)
 		output(1).push(p);
 		return;
 	} 
-	pk->set_next(pk->next() + 1);
+	pk->set_next_cksum(pk->next() + 1);
 	eth_dest = _arp_table->lookup(pk->get_link_node(pk->next()));
 	if (eth_dest.is_group()) {
 		click_chatter("%{element}::%s arp lookup failed for %s",
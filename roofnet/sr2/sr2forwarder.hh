@@ -29,6 +29,9 @@ Output 1: packets that were addressed to me.
 
 Normally used in conjuction with ETT element
 
+The checksum of forwarded packets that carry one is updated
+incrementally for the next hop field, rather than recomputed.
+
  */
 
 
@@ -23,6 +23,7 @@
 #include <click/glue.hh>
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
+#include "../routecache.hh"
 #include "sr2packet.hh"
 CLICK_DECLS
 
@@ -33,6 +34,7 @@ SR2GatewayResponder::SR2GatewayResponder()
      _en(),
      _et(0),
      _link_table(0),
+     _route_cache(0),
      _arp_table(0),
      _timer(this)
 {
@@ -57,6 +59,7 @@ SR2GatewayResponder::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "PERIOD", 0, cpUnsigned, &_period,
 		     "SEL", 0, cpElement, &_gw_sel,
 		     /* below not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     cpEnd);
 
@@ -77,6 +80,8 @@ SR2GatewayResponder::configure (Vector<String> &conf, ErrorHandler *errh)
     return errh->error("LinkTable element is not a LinkTable");
   if (_arp_table->cast("ARPTable") == 0) 
     return errh->error("ARPTable element is not a ARPTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RouteCache element is not a RouteCache");
 
   return ret;
 }
@@ -95,8 +100,10 @@ SR2GatewayResponder::run_timer(Timer *)
 {
 	if (!_gw_sel->is_gateway()) {
 		IPAddress gateway = _gw_sel->best_gateway();
-		_link_table->dijkstra(false);
-		Path best = _link_table->best_route(gateway, false);
+		if (!_route_cache)
+			_link_table->dijkstra(false);
+		Path best = (_route_cache ? _route_cache->best_route(gateway, false)
+			     : _link_table->best_route(gateway, false));
 		bool best_valid = _link_table->valid_route(best);
 		
 		if (best_valid) {
@@ -23,6 +23,7 @@
 #include <click/glue.hh>
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
+#include "../routecache.hh"
 #include "sr2packet.hh"
 CLICK_DECLS
 
@@ -33,6 +34,7 @@ SR2MetricFlood::SR2MetricFlood()
      _en(),
      _et(0),
      _link_table(0),
+     _route_cache(0),
      _arp_table(0)
 {
 
@@ -65,6 +67,7 @@ SR2MetricFlood::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "LT", 0, cpElement, &_link_table,
 		     /* below not required */
 		     "ARP", 0, cpElement, &_arp_table,
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     cpEnd);
 
@@ -83,6 +86,8 @@ SR2MetricFlood::configure (Vector<String> &conf, ErrorHandler *errh)
     return errh->error("LinkTable element is not a LinkTable");
   if (_arp_table && _arp_table->cast("ARPTable") == 0) 
     return errh->error("ARPTable element is not a ARPTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RouteCache element is not a RouteCache");
 
   return ret;
 }
@@ -120,6 +125,8 @@ SR2MetricFlood::update_link(IPAddress from, IPAddress to,
 		  to.unparse().c_str());
     return false;
   }
+  if (_route_cache)
+    _route_cache->note_link(from, to, metric);
   return true;
 }
 
@@ -138,7 +145,8 @@ SR2MetricFlood::forward_query(Seen *s)
 {
 
   s->_forwarded = true;
-  _link_table->dijkstra(false);
+  if (!_route_cache)
+    _link_table->dijkstra(false);
 
   Packet *p_in = s->_p;
   s->_p = 0;
@@ -157,7 +165,8 @@ SR2MetricFlood::forward_query(Seen *s)
   }
 
   IPAddress src = s->_src;
-  Path best = _link_table->best_route(src, false);
+  Path best = (_route_cache ? _route_cache->best_route(src, false)
+	       : _link_table->best_route(src, false));
   bool best_valid = _link_table->valid_route(best);
 
   if (!best_valid) {
@@ -18,12 +18,16 @@ CLICK_DECLS
 /*
 =c
 SR2MetricFlood(IP, ETH, ETHERTYPE, SR2MetricFlood element, LinkTable element, ARPtable element, 
-   [METRIC GridGenericMetric], [WARMUP period in seconds])
+   [METRIC GridGenericMetric], [WARMUP period in seconds], [RC RouteCache element])
 
 =s Roofnet
 
 Floods a packet with previous hops based on Link Metrics.
 
+With RC, the route back to the flood source comes from that RouteCache,
+which only reruns Dijkstra when the links learned from the flood changed
+the topology.
+
 
  */
 
@@ -99,6 +103,7 @@ class SR2MetricFlood : public Element {
   EtherAddress _bcast;
 
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
   class ARPTable *_arp_table;
 
   bool _debug;
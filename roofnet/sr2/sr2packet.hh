@@ -20,6 +20,7 @@ enum sr2packet_type {
 enum sr2packet_flags {
 	SR2_FLAG_ERROR = (1<<0),
 	SR2_FLAG_UPDATE = (1<<1),
+	SR2_FLAG_HEADER_CKSUM = (1<<2),	/* checksummed, leaving out the data */
 };
 
 static const uint8_t _sr2_version = 0x0c;
@@ -35,6 +36,11 @@ struct sr2packet {,
 	int    num_links()              { return _nlinks; }
 	int    next()                   { return _next; }
 	void   set_next(uint8_t n)      { _next = n; }
+	void   set_next_cksum(uint8_t n) {
+		u_char old[2] = { _nlinks, _next };
+		_next = n;
+		update_checksum(old, &_nlinks, 2);
+	}
 	void   set_num_links(uint8_t n) { _nlinks = n; }
 
 	/* packet length functions */
@@ -79,14 +85,38 @@ public:
 	 */
 	u_char *data() { return (((u_char *)this) + len_wo_data(num_links())); }
 
+	/* bytes covered by the checksum: the data too, for data packets
+	 * without SR2_FLAG_HEADER_CKSUM
+	 */
+	size_t cksum_len() const {
+		if ((_type & SR2_PT_DATA) && !(ntohs(_flags) & SR2_FLAG_HEADER_CKSUM))
+			return hlen_with_data();
+		return hlen_wo_data();
+	}
 	void set_checksum() {
-		unsigned int tlen = (_type & SR2_PT_DATA) ? hlen_with_data() : hlen_wo_data();
 		_cksum = 0;
-		_cksum = click_in_cksum((unsigned char *) this, tlen);
+		_cksum = click_in_cksum((unsigned char *) this, cksum_len());
 	}	
 	bool check_checksum() {
-		unsigned int tlen = (_type & SR2_PT_DATA) ? hlen_with_data() : hlen_wo_data();
-		return click_in_cksum((unsigned char *) this, tlen) == 0;
+		return click_in_cksum((unsigned char *) this, cksum_len()) == 0;
+	}
+	/* RFC 1624 incremental update, for the len bytes at p having
+	 * changed from the bytes at old.  p must be at an even offset in
+	 * the header and len must be even.
+	 */
+	void update_checksum(const void *old, const void *p, int len) {
+		const u_char *o = (const u_char *) old;
+		const u_char *n = (const u_char *) p;
+		uint32_t sum = (uint16_t) ~_cksum;
+		for (int i = 0; i < len; i += 2) {
+			uint16_t ow, nw;
+			memcpy(&ow, o + i, 2);
+			memcpy(&nw, n + i, 2);
+			sum += (uint16_t) ~ow + nw;
+		}
+		sum = (sum & 0xFFFF) + (sum >> 16);
+		sum = (sum & 0xFFFF) + (sum >> 16);
+		_cksum = ~sum;
 	}
 	/* the rest of the packet is variable length based on _nlinks.
 	 * for each link, the following packet structure exists: 
@@ -26,6 +26,7 @@
 #include <clicknet/ether.h>
 #include "sr2packet.hh"
 #include "sr2forwarder.hh"
+#include "../routecache.hh"
 CLICK_DECLS
 
 
@@ -33,7 +34,8 @@ CLICK_DECLS
 SR2Querier::SR2Querier()
   :  _en(),
      _sr_forwarder(0),
-     _link_table(0)
+     _link_table(0),
+     _route_cache(0)
 {
 
   // Pick a starting sequence number that we have not used before.
@@ -61,6 +63,7 @@ SR2Querier::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "SR", 0, cpElement, &_sr_forwarder,
 		     "LT", 0, cpElement, &_link_table,
 		     /* below not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     "ROUTE_DAMPENING", 0, cpBool, &_route_dampening,
 		     "TIME_BEFORE_SWITCH", 0, cpUnsigned, &_time_before_switch_sec,
@@ -78,6 +81,8 @@ SR2Querier::configure (Vector<String> &conf, ErrorHandler *errh)
     return errh->error("SR2Forwarder element is not a SR2Forwarder");
   if (_link_table->cast("LinkTable") == 0) 
     return errh->error("LinkTable element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RouteCache element is not a RouteCache");
 
   return ret;
 }
@@ -135,7 +140,8 @@ SR2Querier::push(int, Packet *p_in)
 	
 	
 	if (!q->_best_metric || !q->_p.size() || expire < now) {
-		Path best = _link_table->best_route(dst, true);
+		Path best = (_route_cache ? _route_cache->best_route(dst, true)
+			     : _link_table->best_route(dst, true));
 		bool valid = _link_table->valid_route(best);
 		q->_last_switch = now;
 		if (valid) {
@@ -143,7 +149,8 @@ SR2Querier::push(int, Packet *p_in)
 				q->_first_selected = now;
 			}
 			q->_p = best;
-			q->_best_metric = _link_table->get_route_metric(best);
+			q->_best_metric = (_route_cache ? _route_cache->get_route_metric(dst, true)
+						    : _link_table->get_route_metric(best));
 		} else {
 			do_query = true;
 			q->_p = Path();
@@ -202,8 +209,11 @@ read_param(Element *e, void *thunk)
 	  sa << " [ ";
 	  sa << path_to_string(dst._p);
 	  sa << " ]";
-	  Path best = td->_link_table->best_route(dst._ip, true);
-	  int best_metric = td->_link_table->get_route_metric(best);
+	  Path best = (td->_route_cache ? td->_route_cache->best_route(dst._ip, true)
+		       : td->_link_table->best_route(dst._ip, true));
+	  int best_metric = (td->_route_cache
+			     ? td->_route_cache->get_route_metric(dst._ip, true)
+			     : td->_link_table->get_route_metric(best));
 	  sa << " best_metric " << best_metric;
 	  sa << " best_route [ ";
 	  sa << path_to_string(best);
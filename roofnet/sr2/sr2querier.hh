@@ -18,11 +18,14 @@ CLICK_DECLS
 =c
 
 SR2Querier(IP, ETH, ETHERTYPE, SR2Querier element, LinkTable element, ARPtable element, 
-   [METRIC GridGenericMetric], [WARMUP period in seconds])
+   [METRIC GridGenericMetric], [WARMUP period in seconds], [RC RouteCache element])
 
 =s Roofnet
 Sends route queries if it can't find a valid source route.
 
+With RC, best routes and their metrics come from that RouteCache instead
+of from the LinkTable.
+
  */
 
 
@@ -76,6 +79,7 @@ class SR2Querier : public Element {
 
   class SR2Forwarder *_sr_forwarder;
   class LinkTable *_link_table;
+  class RouteCache *_route_cache;
 
   bool _route_dampening;
   bool _debug;
@@ -24,6 +24,7 @@
 #include <click/straccum.hh>
 #include <clicknet/ether.h>
 #include "sr2packet.hh"
+#include "../routecache.hh"
 CLICK_DECLS
 
 
@@ -33,6 +34,7 @@ SR2QueryResponder::SR2QueryResponder()
      _en(),
      _et(0),
      _link_table(0),
+     _route_cache(0),
      _arp_table(0)
 {
 }
@@ -53,6 +55,7 @@ SR2QueryResponder::configure (Vector<String> &conf, ErrorHandler *errh)
 		     "LT", 0, cpElement, &_link_table,
 		     "ARP", 0, cpElement, &_arp_table,
 		     /* below not required */
+		     "RC", 0, cpElement, &_route_cache,
 		     "DEBUG", 0, cpBool, &_debug,
 		     cpEnd);
 
@@ -70,6 +73,8 @@ SR2QueryResponder::configure (Vector<String> &conf, ErrorHandler *errh)
 
   if (_link_table->cast("LinkTable") == 0) 
     return errh->error("LinkTable element is not a LinkTable");
+  if (_route_cache && _route_cache->cast("RouteCache") == 0) 
+    return errh->error("RouteCache element is not a RouteCache");
   if (_arp_table->cast("ARPTable") == 0) 
     return errh->error("ARPTable element is not a ARPTable");
 
@@ -114,6 +119,8 @@ SR2QueryResponder::update_link(IPAddress from, IPAddress to, uint32_t seq, int m
 		  to.unparse().c_str());
     return false;
   }
+  if (_route_cache)
+    _route_cache->note_link(from, to, metric);
   return true;
 }
 
@@ -124,7 +131,8 @@ SR2QueryResponder::forward_reply(struct sr2packet *pk1)
 	uint8_t type = pk1->_type;
 	assert(type == SR2_PT_REPLY);
 	
-  _link_table->dijkstra(true);
+  if (!_route_cache)
+    _link_table->dijkstra(true);
   if (_debug) {
     click_chatter("%{element}: forward_reply %s <- %s\n", 
 		  this,
@@ -163,8 +171,10 @@ SR2QueryResponder::forward_reply(struct sr2packet *pk1)
 void 
 SR2QueryResponder::start_reply(IPAddress src, IPAddress qdst, uint32_t seq)
 {
-  _link_table->dijkstra(false);
-  Path best = _link_table->best_route(src, false);
+  if (!_route_cache)
+    _link_table->dijkstra(false);
+  Path best = (_route_cache ? _route_cache->best_route(src, false)
+	       : _link_table->best_route(src, false));
   bool best_valid = _link_table->valid_route(best);
 
   
@@ -255,7 +265,8 @@ SR2QueryResponder::got_reply(struct sr2packet *pk)
 			      _ip.unparse().c_str(),
 			      dst.unparse().c_str());
 	}
-	_link_table->dijkstra(true);
+	if (!_route_cache)
+	  _link_table->dijkstra(true);
 }
 
 
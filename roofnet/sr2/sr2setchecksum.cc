@@ -27,6 +27,7 @@
 CLICK_DECLS
 
 SR2SetChecksum::SR2SetChecksum()
+  : _header_only(false)
 {
 }
 
@@ -34,6 +35,14 @@ SR2SetChecksum::~SR2SetChecksum()
 {
 }
 
+int
+SR2SetChecksum::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  return cp_va_kparse(conf, this, errh,
+		      "HEADER_ONLY", 0, cpBool, &_header_only,
+		      cpEnd);
+}
+
 Packet *
 SR2SetChecksum::simple_action(Packet *xp)
 {
@@ -58,7 +67,10 @@ SR2SetChecksum::simple_action(Packet *xp)
     goto bad;
 
   pk->_version = _sr2_version;
-  //pk->set_checksum();
+  if (_header_only)
+    pk->set_flag(SR2_FLAG_HEADER_CKSUM);
+  if (pk->flag(SR2_FLAG_HEADER_CKSUM))
+    pk->set_checksum();
 
   return xp;
 
@@ -4,7 +4,7 @@
 /*
 =c
 
-SR2SetChecksum()
+SR2SetChecksum([I<KEYWORDS>])
 
 =s Roofnet
 
@@ -12,10 +12,26 @@ Set Checksum for Source Routed packet.
 
 =d
 
-Expects a SR MAC packet as input. Calculates the SR header's checksum
-and sets the version and checksum header fields.
+Expects a SR MAC packet as input. Sets the version header field, and
+the checksum of packets with SR2_FLAG_HEADER_CKSUM (0x04) set.  That
+checksum covers only the SR2 header; the integrity of the data is left
+to the link layer and the transport protocol.  Packets without the flag
+carry no checksum.  Nodes that predate the flag do not keep the
+checksum up to date when they forward, so HEADER_ONLY should be turned
+on only when every node on the path understands it.
 
-=a CheckSRHeader 
+Keyword arguments are:
+
+=over 8
+
+=item HEADER_ONLY
+
+Boolean.  If true, set SR2_FLAG_HEADER_CKSUM on every packet.  If
+false, leave the flag as it is.  Defaults to false.
+
+=back
+
+=a SR2CheckHeader, SR2Forwarder
 */
 
 #include <click/element.hh>
@@ -31,7 +47,12 @@ public:
   const char *port_count() const		{ return PORTS_1_1; }
   const char *processing() const		{ return AGNOSTIC; }
 
+  int configure(Vector<String> &, ErrorHandler *);
+
   Packet *simple_action(Packet *);
+
+ private:
+  bool _header_only;
 };
 
 CLICK_ENDDECLS
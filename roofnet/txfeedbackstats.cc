@@ -22,12 +22,12 @@
 #include <click/glue.hh>
 #include <click/timer.hh>
 #include <click/straccum.hh>
-#include <elements/wifi/txfeedbackstats.hh>
+#include "txfeedbackstats.hh"
 #include <elements/grid/timeutils.hh>
 CLICK_DECLS
 
 TXFeedbackStats::TXFeedbackStats()
-  : _tau(10000), _min_pkts(10)
+  : _tau(10000), _min_pkts(10), _max_neighbors(256)
 {
 }
 
@@ -41,12 +41,16 @@ TXFeedbackStats::configure(Vector<String> &conf, ErrorHandler *errh)
   int res = cp_va_kparse(conf, this, errh,
 			 "TAU", 0, cpUnsigned, &_tau,
 			 "MIN_PKTS", 0, cpUnsigned, &_min_pkts,
+			 "MAX_NEIGHBORS", 0, cpUnsigned, &_max_neighbors,
 			 cpEnd);
   if (res < 0)
     return res;
 
   if (_min_pkts < 1)
     return errh->error("MIN_PKTS must be >= 1");
+  if (_max_neighbors < 1)
+    return errh->error("MAX_NEIGHBORS must be >= 1");
+  _stat_map.configure(_max_neighbors);
   return 0;
 }
 
@@ -106,34 +110,13 @@ void
 TXFeedbackStats::add_stat(const EtherAddress &dest, int sz, const Timestamp &when, 
 			  tx_result_t res, unsigned data_attempts, unsigned  rts_attempts)
 {
-  StatQ *q = cleanup_map(dest);
-  if (!q) {
-    _stat_map.insert(dest, StatQ());
-    q = _stat_map.findp(dest);
-  }
-
-  q->push_front(stat_t(when, sz, res, data_attempts, rts_attempts));
-}
-
-TXFeedbackStats::StatQ *
-TXFeedbackStats::cleanup_map(const EtherAddress &dest)
-{
-  Timestamp oldest = Timestamp::now() - _tau_tv;
+  int i = _stat_map.insert(dest);
+  if (i < 0)
+    return;
 
-
-  StatQ *q = _stat_map.findp(dest);
-  if (!q)
-    return 0;
-
-  // discard too-old stats
-  while (q->size() > 0 && q->back().when < oldest)
-    q->pop_back();
-
-  // could also remove StatQs for dests with no data.  for now we'll
-  // pretend that there are only a limited number of neighbors we'll
-  // ever see.
-  
-  return q;
+  // the ring drops the oldest entry itself; stale entries are skipped
+  // when counting
+  _stat_map.local(i).q.push(stat_t(when, sz, res, data_attempts, rts_attempts));
 }
 
 bool
@@ -154,16 +137,22 @@ TXFeedbackStats::est_tx_count(const EtherAddress &dest, unsigned &etx)
 bool
 TXFeedbackStats::get_counts(const EtherAddress &dest, unsigned &n_data, unsigned &n_rts, unsigned &n_pkts)
 {
-  StatQ *q = cleanup_map(dest);
-  if (!q)
+  int i = _stat_map.find(dest);
+  if (i < 0)
     return false;
 
-  n_pkts = (unsigned) q->size();
+  Timestamp oldest = Timestamp::now() - _tau_tv;
+  n_pkts = 0;
   n_data = 0;
   n_rts = 0;
-  for (StatQ::const_iterator i = q->begin(); i != q->end(); i++) {
-    n_data += i->n_data;
-    n_rts += i->n_rts;
+  for (int s = 0; s < _stat_map.nshards(); s++) {
+    const StatRing<stat_t, HISTORY> &q = _stat_map.shard(s, i).q;
+    // newest first, so stop at the first too-old stat
+    for (int j = 0; j < q.size() && !(q[j].when < oldest); j++) {
+      n_pkts++;
+      n_data += q[j].n_data;
+      n_rts += q[j].n_rts;
+    }
   }
   return true;
 }
@@ -172,8 +161,8 @@ String
 TXFeedbackStats::print_stats()
 {
   Vector<EtherAddress> v;
-  for (StatMap::const_iterator i = _stat_map.begin(); i.live(); i++)
-    v.push_back(i.key());
+  for (int i = 0; i < _stat_map.size(); i++)
+    v.push_back(_stat_map.key(i));
 
   StringAccum sa;
 
@@ -202,6 +191,7 @@ TXFeedbackStats::read_params(Element *xf, void *n)
   case 0: return String(f->_tau) + "\n";
   case 1: return String(f->_min_pkts) + "\n";
   case 2: return f->print_stats();
+  case 3: return String(f->_stat_map.drops()) + "\n";
   default:
   return "<unknown parameter>";
   }
@@ -214,6 +204,7 @@ TXFeedbackStats::add_handlers()
   add_read_handler("tau", read_params, (void *)0);
   add_read_handler("min_pkts", read_params, (void *)1);
   add_read_handler("stats", read_params, (void *)2);
+  add_read_handler("drops", read_params, (void *)3);
 }
 
 EXPORT_ELEMENT(TXFeedbackStats)
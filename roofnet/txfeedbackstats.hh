@@ -28,13 +28,24 @@
  * last TAU seconds in order to generate a transmission count
  * estimate.  Defaults to 10 packets.  Must be >= 1.
  *
+ * =item MAX_NEIGHBORS
+ *
+ * Unsigned integer.  Number of destinations to keep statistics for.
+ * Defaults to 256.
+ *
  * =back
  *
+ * Each thread remembers at most the last 64 packets to each destination,
+ * so at high packet rates the estimate covers less than TAU.
+ *
  * =h tau read-only
  * =h min_pkts read-only
  * =h stats read-only
  * Returns current stats, one line per destination, in this format:
  * <eth> <num_data_tries> <num_rts_tries> <num_pkts> <est_tx_count>
+ * =h drops read-only
+ * Returns the number of packets that were not recorded because
+ * MAX_NEIGHBORS destinations were already tracked.
  * =a
  * LinkStat */
 
@@ -42,7 +53,7 @@
 #include <click/element.hh>
 #include <click/glue.hh>
 #include <click/etheraddress.hh>
-#include <click/dequeue.hh>
+#include "neighborstats.hh"
 
 CLICK_DECLS
 
@@ -89,25 +100,28 @@ private:
     tx_result_t res;
     unsigned n_data; // number data transmissions
     unsigned n_rts;  // number rts transmissions
+    stat_t() : sz(0), res(TxUnknownResult), n_data(0), n_rts(0) { }
     stat_t(const Timestamp &w, int s, tx_result_t r, unsigned nl, unsigned ns) :
       when(w), sz(s), res(r), n_data(nl), n_rts(ns) { }
   };
 
-  // most recent data goes on to head, oldest is at tail
-  typedef DEQueue<stat_t> StatQ;
-  typedef HashMap<EtherAddress, StatQ> StatMap;
+  enum { HISTORY = 64 };
+  struct StatQ {
+    StatRing<stat_t, HISTORY> q;
+    void reset() { q.clear(); }
+  };
+  typedef NeighborStats<EtherAddress, StatQ> StatMap;
   StatMap _stat_map;
 
   void add_stat(const EtherAddress &, int, const Timestamp &, tx_result_t, unsigned, unsigned);
   bool get_counts(const EtherAddress &, unsigned &, unsigned  &, unsigned &);
 
-  StatQ *cleanup_map(const EtherAddress &);
-
   String print_stats();
 
   unsigned _tau;
   Timestamp _tau_tv;
   unsigned _min_pkts;
+  unsigned _max_neighbors;
 };
 
 CLICK_ENDDECLS
@@ -40,9 +40,16 @@ TXStat::~TXStat()
 int
 TXStat::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+  _max_neighbors = 256;
   int res = cp_va_kparse(conf, this, errh,
 			 "SRCETH", cpkP+cpkM, cpEtherAddress, &_eth,
+			 "MAX_NEIGHBORS", 0, cpUnsigned, &_max_neighbors,
 			 cpEnd);
+  if (res < 0)
+    return res;
+  if (!_max_neighbors)
+    return errh->error("MAX_NEIGHBORS must be positive");
+  _neighbors.configure(_max_neighbors);
   return res;
   
 
@@ -77,12 +84,12 @@ TXStat::simple_action(Packet *p_in)
   //int long_retries = p_in->user_anno_c (TX_ANNO_LONG_RETRIES);
   bool success = !(ceh->flags & WIFI_EXTRA_TX_FAIL);
   int rate = ceh->rate;
-  TXNeighborInfo *nfo = _neighbors.findp(dst);
-  if (!nfo) {
-    TXNeighborInfo foo = TXNeighborInfo(dst);
-    _neighbors.insert(dst, foo);
-    nfo = _neighbors.findp(dst);
+  int i = _neighbors.insert(dst);
+  if (i < 0) {
+    p_in->kill();
+    return 0;
   }
+  TXNeighborInfo *nfo = &_neighbors.local(i);
   
   nfo->_packets_sent++;
   //nfo->_long_retries += long_retries;
@@ -108,9 +115,9 @@ String
 TXStat::print_tx_stats() 
 {
   StringAccum sa;
-  for (TXNIter iter = _neighbors.begin(); iter.live(); iter++) {
-    TXNeighborInfo nfo = iter.value();
-    sa << nfo._eth.unparse() << "\n";
+  for (int i = 0; i < _neighbors.size(); i++) {
+    TXNeighborInfo nfo = _neighbors.sum(i);
+    sa << _neighbors.key(i).unparse() << "\n";
     sa << " packets sent :" << nfo._packets_sent << "\n";
     sa << " failures     :" << nfo._failures << "\n";
     sa << " long_retries :" << nfo._long_retries << "\n";
@@ -121,11 +128,18 @@ TXStat::print_tx_stats()
   return sa.take_string();
 }
 
+String
+TXStat::static_print_drops(Element *e, void *)
+{
+  TXStat *n = (TXStat *) e;
+  return String(n->_neighbors.drops()) + "\n";
+}
 
 void
 TXStat::add_handlers()
 {
   add_read_handler("tx_stats", static_print_tx_stats, 0);
+  add_read_handler("drops", static_print_drops, 0);
 }
 
 EXPORT_ELEMENT(TXStat)
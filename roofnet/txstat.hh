@@ -20,9 +20,17 @@
  * Ethernet and IP addresses of this node, respectively; required if
  * output is connected.
  *
+ * =item MAX_NEIGHBORS
+ *
+ * Number of neighbors to keep counters for.  Defaults to 256.
  *
  * =back
  *
+ * =h tx_stats read-only
+ * =h drops read-only
+ * Returns the number of packets to neighbors that were not counted
+ * because MAX_NEIGHBORS neighbors were already tracked.
+ *
  */
 
 #include <click/bighashmap.hh>
@@ -32,6 +40,7 @@
 #include <click/etheraddress.hh>
 #include <elements/grid/timeutils.hh>
 #include <elements/grid/grid.hh>
+#include "neighborstats.hh"
 
 CLICK_DECLS
 
@@ -63,12 +72,23 @@ private:
       _packets_sent = 0;
 
     }
+
+    // _rate is the last rate seen by some thread
+    TXNeighborInfo &operator+=(const TXNeighborInfo &o) {
+      _long_retries += o._long_retries;
+      _short_retries += o._short_retries;
+      _failures += o._failures;
+      if (o._packets_sent)
+	_rate = o._rate;
+      _packets_sent += o._packets_sent;
+      return *this;
+    }
   };
-  typedef HashMap<EtherAddress, TXNeighborInfo> TXNeighborTable;
-  typedef TXNeighborTable::const_iterator TXNIter;
+  typedef NeighborStats<EtherAddress, TXNeighborInfo> TXNeighborTable;
 
 
   TXNeighborTable _neighbors;
+  unsigned _max_neighbors;
 
   EtherAddress _eth;
   EtherAddress _bcast;
@@ -93,6 +113,7 @@ public:
 
 
   static String static_print_tx_stats(Element *e, void *);
+  static String static_print_drops(Element *e, void *);
   String print_tx_stats();
 };
 
@@ -0,0 +1,135 @@
+#! /bin/sh
+
+# benchsnmpagent.sh -- measure SNMPAgent request throughput
+#
+# Defines VARS Counter32 variables with SNMPVariableInfo, then pushes
+# requests from SNMPRequestSource through SNMPAgent and back, as UDP-in-IP
+# packets, and reports requests per second, nanoseconds per request,
+# bindings per response, and how many handler reads the agent made per
+# binding.  The request types are:
+#
+#   get       GET of the first variable's instance
+#   getnext   GETNEXT walk over all the variables, one per request
+#   getbulk   GETBULK walk, --repetitions variables per request
+#   overlap   GETBULK walk with --repeaters repeaters starting at the same
+#             OID, so each variable's value is sent more than once per
+#             response but read once
+#
+# Needs a click built with the snmp package installed.
+
+usage () {
+    echo "Usage: benchsnmpagent.sh [--requests N] [--vars N] [--repetitions N] [--repeaters N] [--workdir DIR] [TYPE...]" 1>&2
+    echo "Types: get getnext getbulk overlap (default all)" 1>&2
+    exit 1
+}
+
+workdir="${TMPDIR:-/tmp}/benchsnmpagent.$$"
+keepwork=0
+requests=200000
+vars=100
+repetitions=20
+repeaters=4
+
+while test $# -gt 0; do
+    case "$1" in
+      --requests)
+	test $# -ge 2 || usage
+	requests="$2"; shift 2;;
+      --vars)
+	test $# -ge 2 || usage
+	vars="$2"; shift 2;;
+      --repetitions)
+	test $# -ge 2 || usage
+	repetitions="$2"; shift 2;;
+      --repeaters)
+	test $# -ge 2 || usage
+	repeaters="$2"; shift 2;;
+      --workdir)
+	test $# -ge 2 || usage
+	workdir="$2"; keepwork=1; shift 2;;
+      -*)
+	usage;;
+      *)
+	break;;
+    esac
+done
+
+types="$*"
+test -z "$types" && types="get getnext getbulk overlap"
+
+for t in $types; do
+    case "$t" in
+      get|getnext|getbulk|overlap) ;;
+      *) echo "benchsnmpagent.sh: unknown type '$t'" 1>&2; usage;;
+    esac
+done
+
+mkdir -p "$workdir" || exit 1
+test $keepwork = 1 || trap 'rm -rf "$workdir"' 0
+
+# makeconfig TYPE
+makeconfig () {
+    case "$1" in
+      get)	req="OID clicktest.1.0, TYPE get";;
+      getnext)	req="OID clicktest, TYPE getnext";;
+      getbulk)	req="OID clicktest, TYPE getbulk, MAX_REPETITIONS $repetitions";;
+      overlap)
+	req="TYPE getbulk, MAX_REPETITIONS $repetitions"
+	i=0
+	while test $i -lt $repeaters; do
+	    req="$req, OID clicktest"
+	    i=`expr $i + 1`
+	done;;
+    esac
+    echo "require(snmp)"
+    echo "SNMPOidInfo(clicktest private.244);"
+    awk -v n=$vars 'BEGIN {
+	printf "SNMPVariableInfo(";
+	for (i = 1; i <= n; i++)
+	    printf "%sclicktest.%d Counter32 src.count", (i > 1 ? ", " : ""), i;
+	print ");";
+    }'
+    echo "src :: SNMPRequestSource($req, LIMIT $requests, BURST 32, STOP true, ACTIVE false)
+    -> agent :: SNMPAgent(MAX_REPETITIONS 1000) -> src;
+DriverManager(write src.active true, wait, print src.rate, print src.stats,
+    print agent.stats, stop)"
+}
+
+# field FILE KEY -- value of the "KEY value" line in FILE
+field () {
+    awk -v k="$2" '$1 == k { print $2; exit }' "$1"
+}
+
+status=0
+printf '%-8s %5s %9s %10s %8s %9s %11s %7s\n' \
+    type vars requests reqs/sec ns/req bind/resp reads/bind errors
+
+for t in $types; do
+    out="$workdir/$t.out"
+    if ! click -e "`makeconfig $t`" > "$out"; then
+	echo "benchsnmpagent.sh: $t: click failed" 1>&2
+	status=1
+	continue
+    fi
+
+    sent=`field "$out" requests`
+    rate=`field "$out" rate`
+    sec=`field "$out" seconds`
+    responses=`field "$out" responses`
+    bindings=`field "$out" bindings`
+    reads=`field "$out" reads`
+    errors=`field "$out" errors`
+
+    echo "$sent $rate $sec $responses $bindings $reads $errors" | awk -v t=$t -v v=$vars '{
+	nsreq = ($1 > 0 ? $3 * 1e9 / $1 : 0);
+	perresp = ($4 > 0 ? $5 / $4 : 0);
+	perbind = ($5 > 0 ? $6 / $5 : 0);
+	printf "%-8s %5d %9d %10.0f %8.0f %9.2f %11.3f %7d\n", t, v, $1, $2, nsreq, perresp, perbind, $7
+    }'
+    if test "$responses" != "$sent"; then
+	echo "benchsnmpagent.sh: $t: $sent requests but $responses responses" 1>&2
+	status=1
+    fi
+done
+
+exit $status
@@ -0,0 +1,456 @@
+/*
+ * snmpagent.{cc,hh} -- element answers SNMP GET, GETNEXT and GETBULK
+ * requests
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "snmpagent.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+
+SNMPAgent::SNMPAgent()
+  : _id(0), _version(SNMP_VERSION_1), _gen(0)
+{
+  memset(_stats, 0, sizeof(_stats));
+}
+
+SNMPAgent::~SNMPAgent()
+{
+}
+
+int
+SNMPAgent::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _udp_encap = true;
+  _community = "public";
+  _ip_ttl = 255;
+  _max_response = 1472;
+  _max_repetitions = 64;
+
+  if (Args(conf, this, errh)
+      .read("UDP", _udp_encap)
+      .read("COMMUNITY", _community)
+      .read("TTL", _ip_ttl)
+      .read("MAX_RESPONSE", _max_response)
+      .read("MAX_REPETITIONS", _max_repetitions)
+      .complete() < 0)
+    return -1;
+
+  // room for the message header and one small binding
+  if (_max_response < 64 + (unsigned)_community.length())
+    return errh->error("MAX_RESPONSE too small");
+  if (_max_response > SNMPBEREncoder::LEN_3_MAX)
+    return errh->error("MAX_RESPONSE too large");
+  return 0;
+}
+
+int
+SNMPAgent::initialize(ErrorHandler *errh)
+{
+  if (!SNMPVariableInfo::find_element(this))
+    errh->warning("no SNMPVariableInfo element; all requests will fail");
+  _id = click_random();
+  return 0;
+}
+
+void
+SNMPAgent::drop(Packet *p, int stat)
+{
+  _stats[stat]++;
+  checked_output_push(1, p);
+}
+
+// Parses the SNMP message in data and stores its OIDs in _oids.  Returns
+// the number of OIDs, -1 if the message is malformed or unsupported, or -2
+// if it has the wrong community.
+int
+SNMPAgent::parse_request(const unsigned char *data, int len, int *pdu,
+			 int32_t *reqid, int32_t *nonrep, int32_t *maxrep)
+{
+  SNMPBERDecoder d(data, len);
+  const unsigned char *community;
+  int community_len;
+
+  if (d.enter_sequence() != SNMP_TAG_SEQUENCE
+      || !d.decode_integer(&_version)
+      || (_version != SNMP_VERSION_1 && _version != SNMP_VERSION_2C)
+      || !d.decode_octet_string(&community, &community_len))
+    return -1;
+  if (community_len != _community.length()
+      || memcmp(community, _community.data(), community_len) != 0)
+    return -2;
+
+  *pdu = d.enter_sequence();
+  if (*pdu != SNMP_TAG_V1_GET && *pdu != SNMP_TAG_V1_GETNEXT
+      && (*pdu != SNMP_TAG_V2_GETBULK || _version == SNMP_VERSION_1))
+    return -1;
+  // for GETBULK, error-status and error-index are non-repeaters and
+  // max-repetitions
+  if (!d.decode_integer(reqid) || !d.decode_integer(nonrep)
+      || !d.decode_integer(maxrep)
+      || d.enter_sequence() != SNMP_TAG_SEQUENCE)
+    return -1;
+
+  // reuse the OIDs left from earlier requests
+  int noids = 0;
+  while (!d.done()) {
+    if (noids == MAX_VARBINDS)
+      return -1;
+    if (noids == _oids.size())
+      _oids.push_back(SNMPOid());
+    SNMPOid &oid = _oids[noids];
+    // the value is ignored; it should be NULL
+    if (d.enter_sequence() != SNMP_TAG_SEQUENCE
+	|| !d.decode_snmp_oid(oid) || oid[1] >= 40)
+      return -1;
+    d.leave_sequence();
+    noids++;
+  }
+  return noids;
+}
+
+const String &
+SNMPAgent::value(SNMPVariable var)
+{
+  if (var >= _cache.size()) {
+    _cache.resize(var + 1);
+    _cache_gen.resize(var + 1, 0);
+  }
+  if (_cache_gen[var] != _gen) {
+    _cache[var] = SNMPVariableInfo::read_value(var, this);
+    _cache_gen[var] = _gen;
+    _stats[S_READS]++;
+  }
+  return _cache[var];
+}
+
+// Each encode function returns SNMP_ERR_NOERROR, or the error status the
+// response should carry.
+
+int
+SNMPAgent::encode_binding(SNMPBEREncoder &ber, SNMPVariable var)
+{
+  bool ok = SNMPVariableInfo::encode_binding(var, value(var), ber, this);
+  if (ber.error())
+    return SNMP_ERR_TOOBIG;
+  else if (!ok)
+    return SNMP_ERR_GENERR;
+  _stats[S_BINDINGS]++;
+  return SNMP_ERR_NOERROR;
+}
+
+int
+SNMPAgent::encode_exception(SNMPBEREncoder &ber, const SNMPOid &oid, SNMPTag tag)
+{
+  ber.push_sequence();
+  ber.encode_snmp_oid(oid);
+  ber.encode_octet_string(tag, (const unsigned char *)"", 0);
+  ber.pop_sequence();
+  return ber.error() ? SNMP_ERR_TOOBIG : SNMP_ERR_NOERROR;
+}
+
+int
+SNMPAgent::encode_get(SNMPBEREncoder &ber, int pdu, int noids, int *index)
+{
+  for (int i = 0; i < noids; i++) {
+    const SNMPOid &oid = _oids[i];
+    SNMPVariable var;
+    SNMPTag miss;
+    if (pdu == SNMP_TAG_V1_GET) {
+      var = SNMPVariableInfo::query(oid, this);
+      miss = SNMP_TAG_NO_SUCH_OBJECT;
+      if (var < 0) {
+	// the variable itself, not its instance?
+	_instance = oid;
+	_instance.push_back(0);
+	if (SNMPVariableInfo::query(_instance, this) >= 0)
+	  miss = SNMP_TAG_NO_SUCH_INSTANCE;
+      }
+    } else {
+      var = SNMPVariableInfo::query_next(oid, this);
+      miss = SNMP_TAG_END_OF_MIB_VIEW;
+    }
+
+    int status;
+    if (var >= 0)
+      status = encode_binding(ber, var);
+    else if (_version == SNMP_VERSION_1)
+      status = SNMP_ERR_NOSUCHNAME;
+    else
+      status = encode_exception(ber, oid, miss);
+    if (status != SNMP_ERR_NOERROR) {
+      *index = i + 1;
+      return status;
+    }
+  }
+  return SNMP_ERR_NOERROR;
+}
+
+// A GETBULK response too large for MAX_RESPONSE is cut short after its last
+// whole binding, rather than failing with tooBig.
+int
+SNMPAgent::encode_bulk(SNMPBEREncoder &ber, int32_t nonrep, int32_t maxrep,
+		       int noids, int *index)
+{
+  if (nonrep < 0)
+    nonrep = 0;
+  else if (nonrep > noids)
+    nonrep = noids;
+  if (maxrep < 0)
+    maxrep = 0;
+  else if ((uint32_t)maxrep > _max_repetitions)
+    maxrep = _max_repetitions;
+
+  // each repeater walks on from the instance it returned last
+  if (_cursors.size() < noids)
+    _cursors.resize(noids);
+  for (int i = nonrep; i < noids; i++)
+    _cursors[i] = _oids[i];
+
+  SNMPBEREncoder::Mark m = ber.mark();
+  int status = SNMP_ERR_NOERROR;
+
+  for (int i = 0; i < nonrep && status == SNMP_ERR_NOERROR; i++) {
+    m = ber.mark();
+    SNMPVariable var = SNMPVariableInfo::query_next(_oids[i], this);
+    if (var >= 0)
+      status = encode_binding(ber, var);
+    else
+      status = encode_exception(ber, _oids[i], SNMP_TAG_END_OF_MIB_VIEW);
+    if (status == SNMP_ERR_GENERR)
+      *index = i + 1;
+  }
+
+  for (int r = 0; r < maxrep && status == SNMP_ERR_NOERROR; r++) {
+    bool any = false;
+    for (int i = nonrep; i < noids && status == SNMP_ERR_NOERROR; i++) {
+      m = ber.mark();
+      SNMPOid &cursor = _cursors[i];
+      SNMPVariable var = SNMPVariableInfo::query_next(cursor, this, &cursor);
+      if (var >= 0) {
+	status = encode_binding(ber, var);
+	any = true;
+      } else
+	status = encode_exception(ber, cursor, SNMP_TAG_END_OF_MIB_VIEW);
+      if (status == SNMP_ERR_GENERR)
+	*index = i + 1;
+    }
+    // every repeater has reached the end of the MIB
+    if (!any)
+      break;
+  }
+
+  if (status == SNMP_ERR_TOOBIG) {
+    ber.rewind(m);
+    status = SNMP_ERR_NOERROR;
+  }
+  return status;
+}
+
+// Rewinds the response to m, just after its request-id, and encodes an
+// error response that echoes the request's OIDs with NULL values, or has no
+// bindings if that does not fit either.
+void
+SNMPAgent::encode_error(SNMPBEREncoder &ber, const SNMPBEREncoder::Mark &m,
+			int status, int index, int noids)
+{
+  if (status != SNMP_ERR_TOOBIG) {
+    ber.rewind(m);
+    ber.encode_integer(status);
+    ber.encode_integer(index);
+    ber.push_long_sequence();
+    for (int i = 0; i < noids; i++) {
+      ber.push_sequence();
+      ber.encode_snmp_oid(_oids[i]);
+      ber.encode_null();
+      ber.pop_sequence();
+    }
+    ber.pop_sequence();
+    if (!ber.error())
+      return;
+  }
+
+  _stats[S_TOOBIG]++;
+  ber.rewind(m);
+  ber.encode_integer(SNMP_ERR_TOOBIG);
+  ber.encode_integer(0);
+  ber.push_long_sequence();
+  ber.pop_sequence();
+}
+
+Packet *
+SNMPAgent::simple_action(Packet *p)
+{
+  const unsigned char *data = p->data();
+  int len = p->length();
+  const click_ip *iph = 0;
+  const click_udp *udph = 0;
+
+  if (_udp_encap) {
+    iph = p->ip_header();
+    if (!iph || iph->ip_p != IP_PROTO_UDP || !p->has_transport_header()
+	|| p->transport_length() < (int)sizeof(click_udp)) {
+      drop(p, S_BAD);
+      return 0;
+    }
+    udph = p->udp_header();
+    data = (const unsigned char *)(udph + 1);
+    len = ntohs(udph->uh_ulen) - sizeof(click_udp);
+    if (len < 0 || len > p->transport_length() - (int)sizeof(click_udp)) {
+      drop(p, S_BAD);
+      return 0;
+    }
+  }
+
+  int pdu;
+  int32_t reqid, a, b;
+  int noids = parse_request(data, len, &pdu, &reqid, &a, &b);
+  if (noids < 0) {
+    drop(p, noids == -2 ? S_BAD_COMMUNITY : S_BAD);
+    return 0;
+  }
+
+  int hlen = (_udp_encap ? sizeof(click_ip) + sizeof(click_udp) : 0);
+  WritablePacket *q = Packet::make(Packet::DEFAULT_HEADROOM, 0,
+				   hlen + _max_response, 0);
+  if (!q) {
+    p->kill();
+    return 0;
+  }
+
+  // encode the response in place; the long sequences have room for any
+  // length up to MAX_RESPONSE, so closing them never moves data
+  SNMPBEREncoder ber(q->data() + hlen, _max_response);
+  ber.push_long_sequence();
+  ber.encode_integer(_version);
+  ber.encode_octet_string(_community);
+  ber.push_long_sequence(SNMP_TAG_V1_RESPONSE);
+  ber.encode_integer(reqid);
+  SNMPBEREncoder::Mark m = ber.mark();
+  ber.encode_integer(SNMP_ERR_NOERROR);
+  ber.encode_integer(0);
+  ber.push_long_sequence();
+
+  if (++_gen == 0) {
+    for (int i = 0; i < _cache_gen.size(); i++)
+      _cache_gen[i] = 0;
+    _gen = 1;
+  }
+
+  int status, index = 0;
+  if (pdu == SNMP_TAG_V2_GETBULK) {
+    status = encode_bulk(ber, a, b, noids, &index);
+    _stats[S_GETBULK]++;
+  } else {
+    status = encode_get(ber, pdu, noids, &index);
+    _stats[pdu == SNMP_TAG_V1_GET ? S_GET : S_GETNEXT]++;
+  }
+
+  ber.pop_sequence();
+  if (status != SNMP_ERR_NOERROR)
+    encode_error(ber, m, status, index, noids);
+  ber.pop_sequence();
+  ber.pop_sequence();
+  if (ber.error()) {
+    q->kill();
+    drop(p, S_TOOBIG);
+    return 0;
+  }
+  q->take(_max_response - ber.length());
+
+  if (_udp_encap) {
+    click_ip *qiph = (click_ip *)q->data();
+    qiph->ip_v = 4;
+    qiph->ip_hl = sizeof(click_ip) >> 2;
+    qiph->ip_len = htons(q->length());
+    qiph->ip_id = htons(_id++);
+    qiph->ip_p = IP_PROTO_UDP;
+    qiph->ip_src = iph->ip_dst;
+    qiph->ip_dst = iph->ip_src;
+    qiph->ip_tos = 0;
+    qiph->ip_off = 0;
+    qiph->ip_ttl = _ip_ttl;
+
+    qiph->ip_sum = 0;
+#if HAVE_FAST_CHECKSUM
+    qiph->ip_sum = ip_fast_csum((unsigned char *)qiph, sizeof(click_ip) >> 2);
+#else
+    qiph->ip_sum = click_in_cksum((unsigned char *)qiph, sizeof(click_ip));
+#endif
+
+    q->set_dst_ip_anno(IPAddress(qiph->ip_dst));
+    q->set_ip_header(qiph, sizeof(click_ip));
+
+    click_udp *qudph = (click_udp *)(qiph + 1);
+    int ulen = ber.length() + sizeof(click_udp);
+    qudph->uh_sport = udph->uh_dport;
+    qudph->uh_dport = udph->uh_sport;
+    qudph->uh_ulen = htons(ulen);
+    qudph->uh_sum = 0;
+
+    unsigned csum = click_in_cksum((unsigned char *)qudph, ulen);
+    qudph->uh_sum = click_in_cksum_pseudohdr(csum, qiph, ulen);
+  } else
+    q->copy_annotations(p);
+
+  p->kill();
+  return q;
+}
+
+String
+SNMPAgent::read_handler(Element *e, void *thunk)
+{
+  SNMPAgent *sa = (SNMPAgent *)e;
+  switch (reinterpret_cast<intptr_t>(thunk)) {
+   case H_stats: {
+     StringAccum s;
+     s << "get " << sa->_stats[S_GET] << "\n"
+       << "getnext " << sa->_stats[S_GETNEXT] << "\n"
+       << "getbulk " << sa->_stats[S_GETBULK] << "\n"
+       << "bad " << sa->_stats[S_BAD] << "\n"
+       << "bad_community " << sa->_stats[S_BAD_COMMUNITY] << "\n"
+       << "toobig " << sa->_stats[S_TOOBIG] << "\n"
+       << "bindings " << sa->_stats[S_BINDINGS] << "\n"
+       << "reads " << sa->_stats[S_READS] << "\n";
+     return s.take_string();
+   }
+   default:
+    return String();
+  }
+}
+
+int
+SNMPAgent::write_handler(const String &, Element *e, void *thunk, ErrorHandler *)
+{
+  SNMPAgent *sa = (SNMPAgent *)e;
+  switch (reinterpret_cast<intptr_t>(thunk)) {
+   case H_reset_counts:
+    memset(sa->_stats, 0, sizeof(sa->_stats));
+    return 0;
+   default:
+    return -1;
+  }
+}
+
+void
+SNMPAgent::add_handlers()
+{
+  add_read_handler("stats", read_handler, H_stats);
+  add_write_handler("reset_counts", write_handler, H_reset_counts, Handler::BUTTON);
+}
+
+ELEMENT_REQUIRES(SNMPBasics SNMPBER SNMPVariableInfo)
+EXPORT_ELEMENT(SNMPAgent)
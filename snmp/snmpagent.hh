@@ -0,0 +1,155 @@
+#ifndef CLICK_SNMPAGENT_HH
+#define CLICK_SNMPAGENT_HH
+#include <click/element.hh>
+#include "snmpbasics.hh"
+#include "snmpber.hh"
+#include "snmpvarinfo.hh"
+
+/*
+=c
+
+SNMPAgent(I<KEYWORDS>)
+
+=s SNMP
+
+answers SNMP GET, GETNEXT and GETBULK requests
+
+=d
+
+SNMPAgent answers SNMPv1 and SNMPv2c requests for the variables defined by
+SNMPVariableInfo.  Requests arrive on its input; each is answered with a
+response packet on output 0, and the request is dropped.  GET returns the
+named instances, GETNEXT the instances that follow the named OIDs in
+lexicographic order, and GETBULK (SNMPv2c only) the non-repeaters' next
+instances and then up to max-repetitions instances following each of the
+other OIDs.  Variables are scalars, so a variable's only instance is its OID
+followed by ".0".
+
+Each variable's handler is read at most once per request, however many
+times a GETBULK walk passes its instance.  The response is encoded straight
+into a packet allocated for MAX_RESPONSE bytes.  A GETBULK response that
+would be larger is cut short after the last whole variable binding that
+fits; any other response that would be larger is answered with a tooBig
+error.
+
+Malformed requests, requests of unknown versions or types, and requests
+with the wrong community are dropped, or emitted on output 1 if it is
+connected.
+
+Keyword arguments are:
+
+=over 8
+
+=item UDP
+
+Boolean. If true, then requests are UDP-in-IP packets with their IP header
+annotations set, and responses are UDP-in-IP packets sent back to the
+request's source address and port.  If false, then requests and responses
+are bare SNMP messages, and responses carry their requests' annotations.
+Default is true.
+
+=item COMMUNITY
+
+String. The SNMP community requests must carry. Default is C<"public">.
+
+=item TTL
+
+Byte. The time-to-live of responses' IP headers (if UDP is true). Default
+is 255.
+
+=item MAX_RESPONSE
+
+Unsigned. Largest SNMP message to send, in bytes, not counting IP and UDP
+headers. Default is 1472.
+
+=item MAX_REPETITIONS
+
+Unsigned. Cap on GETBULK requests' max-repetitions. Default is 64.
+
+=back
+
+=h stats read-only
+
+Requests answered, by type; requests dropped, as malformed or for a wrong
+community; tooBig responses; variable bindings sent; and handler reads.
+
+=h reset_counts write-only
+
+Zeroes the counters.
+
+=e
+
+  SNMPOidInfo(clicktest private.244);
+  SNMPVariableInfo(clicktest.1 Counter32 q.drops, clicktest.2 Counter32 c.count);
+
+  FromDevice(eth0) -> Strip(14) -> CheckIPHeader
+    -> IPClassifier(udp dst port 161)
+    -> SNMPAgent(COMMUNITY monitor)
+    -> EtherEncap(0x0800, 1:1:1:1:1:1, 2:2:2:2:2:2) -> Queue -> ToDevice(eth0);
+
+=a
+
+SNMPVariableInfo, SNMPOidInfo, SNMPRequestSource */
+
+class SNMPAgent : public Element { public:
+
+  SNMPAgent();
+  ~SNMPAgent();
+
+  const char *class_name() const	{ return "SNMPAgent"; }
+  const char *port_count() const	{ return "1/1-2"; }
+  const char *processing() const	{ return "a/ah"; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+ private:
+
+  enum { MAX_VARBINDS = 128 };
+  enum { S_GET, S_GETNEXT, S_GETBULK, S_BAD, S_BAD_COMMUNITY, S_TOOBIG,
+	 S_BINDINGS, S_READS, NSTATS };
+  enum { H_stats, H_reset_counts };
+
+  bool _udp_encap;
+  String _community;
+  unsigned char _ip_ttl;
+  unsigned _max_response;
+  unsigned _max_repetitions;
+  uint16_t _id;
+
+  // request being answered: its version and the OIDs of its bindings;
+  // _cursors follow GETBULK walks
+  int32_t _version;
+  Vector<SNMPOid> _oids;
+  Vector<SNMPOid> _cursors;
+  SNMPOid _instance;
+
+  // handler values read for the request being answered, by variable;
+  // _cache[v] is current if _cache_gen[v] == _gen
+  Vector<String> _cache;
+  Vector<uint32_t> _cache_gen;
+  uint32_t _gen;
+
+  uint32_t _stats[NSTATS];
+
+  void drop(Packet *, int);
+  int parse_request(const unsigned char *, int, int *pdu, int32_t *reqid,
+		    int32_t *nonrep, int32_t *maxrep);
+  const String &value(SNMPVariable);
+  int encode_binding(SNMPBEREncoder &, SNMPVariable);
+  int encode_exception(SNMPBEREncoder &, const SNMPOid &, SNMPTag);
+  int encode_get(SNMPBEREncoder &, int pdu, int noids, int *index);
+  int encode_bulk(SNMPBEREncoder &, int32_t nonrep, int32_t maxrep,
+		  int noids, int *index);
+  void encode_error(SNMPBEREncoder &, const SNMPBEREncoder::Mark &,
+		    int status, int index, int noids);
+
+  static String read_handler(Element *, void *);
+  static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+#endif
@@ -29,6 +29,16 @@ uint32_t snmp_time_ticks_since(uint32_t);
 
 enum {
   SNMP_VERSION_1 = 0,
+  SNMP_VERSION_2C = 1,
+};
+
+enum SNMPErrorStatus {
+  SNMP_ERR_NOERROR = 0,
+  SNMP_ERR_TOOBIG = 1,
+  SNMP_ERR_NOSUCHNAME = 2,
+  SNMP_ERR_BADVALUE = 3,
+  SNMP_ERR_READONLY = 4,
+  SNMP_ERR_GENERR = 5,
 };
 
 enum SNMPTag {
@@ -49,6 +59,11 @@ enum SNMPTag {
   SNMP_TAG_V1_RESPONSE = 0xA2,
   SNMP_TAG_V1_SET = 0xA3,
   SNMP_TAG_V1_TRAP = 0xA4,
+  SNMP_TAG_V2_GETBULK = 0xA5,
+  // SNMPv2 exceptions, in place of a variable's value
+  SNMP_TAG_NO_SUCH_OBJECT = 0x80,
+  SNMP_TAG_NO_SUCH_INSTANCE = 0x81,
+  SNMP_TAG_END_OF_MIB_VIEW = 0x82,
   // fake tags: values > 256, truncated on assignment
   SNMP_TAG_DISPLAYSTRING = 0x104,
 };
@@ -25,19 +25,56 @@
 #define BER_LEN_4_MAX_OID_COMPONENT 0x0FFFFFFF
 
 SNMPBEREncoder::SNMPBEREncoder()
-  : _mem_err(ERR_OK)
+  : _buf(0), _len(0), _cap(0), _mem_err(ERR_OK)
+{
+}
+
+SNMPBEREncoder::SNMPBEREncoder(unsigned char *buf, int capacity)
+  : _buf(buf), _len(0), _cap(capacity), _mem_err(ERR_OK)
 {
 }
 
 unsigned char *
 SNMPBEREncoder::extend(int i)
 {
-  if (unsigned char *x = (unsigned char *)_sa.extend(i))
+  if (_buf) {
+    if (_len + i > _cap)
+      return (_mem_err = ERR_TOOBIG, (unsigned char *)0);
+    _len += i;
+    return _buf + _len - i;
+  } else if (unsigned char *x = (unsigned char *)_sa.extend(i))
     return x;
   else
     return (_mem_err = ERR_MEM, (unsigned char *)0);
 }
 
+void
+SNMPBEREncoder::truncate(int len)
+{
+  if (_buf)
+    _len = len;
+  else
+    _sa.pop_back(_sa.length() - len);
+}
+
+void
+SNMPBEREncoder::rewind(const Mark &m)
+{
+  truncate(m.length);
+  _sequence_start.resize(m.depth);
+  _sequence_len_len.resize(m.depth);
+  _mem_err = m.error;
+}
+
+void
+SNMPBEREncoder::clear()
+{
+  Mark m;
+  m.length = m.depth = 0;
+  m.error = ERR_OK;
+  rewind(m);
+}
+
 unsigned char *
 SNMPBEREncoder::encode_len(unsigned char *storage, int len)
 {
@@ -76,11 +113,15 @@ SNMPBEREncoder::encode_len_by_len_len(unsigned char *storage, int len, int len_l
 SNMPBEREncoder::Status
 SNMPBEREncoder::push_sequence(SNMPTag tag)
 {
-  unsigned char *storage = (unsigned char *)_sa.extend(2);
-  if (!storage)
-    return (_mem_err = ERR_MEM);
+  unsigned char *storage = extend(2);
+  if (!storage) {
+    // keep pushes and pops balanced; pop_sequence will skip this one
+    _sequence_start.push_back(-1);
+    _sequence_len_len.push_back(0);
+    return _mem_err;
+  }
   storage[0] = tag;
-  _sequence_start.push_back(_sa.length() - 2);
+  _sequence_start.push_back(length() - 2);
   _sequence_len_len.push_back(1);
   return ERR_OK;
 }
@@ -88,11 +129,15 @@ SNMPBEREncoder::push_sequence(SNMPTag tag)
 SNMPBEREncoder::Status
 SNMPBEREncoder::push_long_sequence(SNMPTag tag)
 {
-  unsigned char *storage = (unsigned char *)_sa.extend(4);
-  if (!storage)
-    return (_mem_err = ERR_MEM);
+  unsigned char *storage = extend(4);
+  if (!storage) {
+    // keep pushes and pops balanced; pop_sequence will skip this one
+    _sequence_start.push_back(-1);
+    _sequence_len_len.push_back(0);
+    return _mem_err;
+  }
   storage[0] = tag;
-  _sequence_start.push_back(_sa.length() - 4);
+  _sequence_start.push_back(length() - 4);
   _sequence_len_len.push_back(3);
   return ERR_OK;
 }
@@ -105,17 +150,19 @@ SNMPBEREncoder::pop_sequence()
   int expect_len_len = _sequence_len_len.back();
   _sequence_start.pop_back();
   _sequence_len_len.pop_back();
+  if (start < 0)
+    return _mem_err;
 
-  int len = _sa.length() - (start + 1 + expect_len_len);
+  int len = length() - (start + 1 + expect_len_len);
   int len_len = calculate_len_len(len);
   if (len_len > expect_len_len) {
-    if (!_sa.extend(len_len - expect_len_len))
-      return (_mem_err = ERR_MEM);
-    memmove(_sa.data() + start + len_len, _sa.data() + start + expect_len_len, len);
+    if (!extend(len_len - expect_len_len))
+      return _mem_err;
+    memmove(wdata() + start + 1 + len_len, wdata() + start + 1 + expect_len_len, len);
   } else
     len_len = expect_len_len;
 
-  encode_len_by_len_len((unsigned char *)_sa.data() + start + 1, len, len_len);
+  encode_len_by_len_len(wdata() + start + 1, len, len_len);
   return ERR_OK;
 }
 
@@ -126,7 +173,8 @@ SNMPBEREncoder::abort_sequence()
   int start = _sequence_start.back();
   _sequence_start.pop_back();
   _sequence_len_len.pop_back();
-  _sa.pop_back(_sa.length() - start);
+  if (start >= 0)
+    truncate(start);
   return ERR_INVALID;
 }
 
@@ -155,9 +203,9 @@ SNMPBEREncoder::encode_snmp_oid(const SNMPOid &oid)
   if (len_len < 0)
     return (Status)len_len;
 
-  unsigned char *storage = (unsigned char *)_sa.extend(1 + len_len + len);
+  unsigned char *storage = extend(1 + len_len + len);
   if (!storage)
-    return (_mem_err = ERR_MEM);
+    return _mem_err;
 
   // store tag and length
   *storage++ = SNMP_TAG_OID;
@@ -205,9 +253,9 @@ SNMPBEREncoder::encode_octet_string(SNMPTag tag, const unsigned char *s, int len
   if (len_len < 0)
     return (Status)len_len;
 
-  unsigned char *storage = (unsigned char *)_sa.extend(1 + len_len + len);
+  unsigned char *storage = extend(1 + len_len + len);
   if (!storage)
-    return (_mem_err = ERR_MEM);
+    return _mem_err;
 
   // store tag and length
   *storage++ = tag;
@@ -222,9 +270,9 @@ SNMPBEREncoder::encode_octet_string(SNMPTag tag, const unsigned char *s, int len
 SNMPBEREncoder::Status
 SNMPBEREncoder::encode_null()
 {
-  unsigned char *storage = (unsigned char *)_sa.extend(2);
+  unsigned char *storage = extend(2);
   if (!storage)
-    return (_mem_err = ERR_MEM);
+    return _mem_err;
 
   // store tag and length
   storage[0] = SNMP_TAG_NULL;
@@ -248,9 +296,9 @@ SNMPBEREncoder::encode_integer(SNMPTag tag, String::uint_large_t x,
     while (x2 > 0x7F)
 	len++, x2 >>= 8;
 
-    unsigned char *storage = (unsigned char *) _sa.extend(len);
+    unsigned char *storage = extend(len);
     if (!storage)
-	return (_mem_err = ERR_MEM);
+	return _mem_err;
 
     storage[0] = tag;
     storage[1] = len - 2;
@@ -263,5 +311,143 @@ SNMPBEREncoder::encode_integer(SNMPTag tag, String::uint_large_t x,
     return ERR_OK;
 }
 
+
+
+SNMPBERDecoder::SNMPBERDecoder(const unsigned char *data, int len)
+  : _s(data), _depth(0)
+{
+  _end[0] = data + len;
+}
+
+bool
+SNMPBERDecoder::header(int *tag, const unsigned char **content, int *len) const
+{
+  const unsigned char *s = _s, *end = _end[_depth];
+  if (end - s < 2)
+    return false;
+  *tag = *s++;
+  int l = *s++;
+  if (l & 0x80) {
+    // long form with up to 3 length bytes; indefinite lengths are not
+    // allowed in SNMP
+    int nbytes = l & 0x7F;
+    if (nbytes < 1 || nbytes > 3 || end - s < nbytes)
+      return false;
+    for (l = 0; nbytes > 0; nbytes--)
+      l = (l << 8) | *s++;
+  }
+  if (end - s < l)
+    return false;
+  *content = s;
+  *len = l;
+  return true;
+}
+
+int
+SNMPBERDecoder::next_tag() const
+{
+  int tag, len;
+  const unsigned char *content;
+  return header(&tag, &content, &len) ? tag : -1;
+}
+
+int
+SNMPBERDecoder::enter_sequence()
+{
+  int tag, len;
+  const unsigned char *content;
+  // constructed tags only: SEQUENCE and the PDUs
+  if (_depth == MAX_DEPTH || !header(&tag, &content, &len) || !(tag & 0x20))
+    return -1;
+  _s = content;
+  _end[++_depth] = content + len;
+  return tag;
+}
+
+bool
+SNMPBERDecoder::leave_sequence()
+{
+  if (_depth == 0)
+    return false;
+  _s = _end[_depth--];
+  return true;
+}
+
+bool
+SNMPBERDecoder::skip()
+{
+  int tag, len;
+  const unsigned char *content;
+  if (!header(&tag, &content, &len))
+    return false;
+  _s = content + len;
+  return true;
+}
+
+bool
+SNMPBERDecoder::decode_integer(int32_t *x)
+{
+  int tag, len;
+  const unsigned char *content;
+  if (!header(&tag, &content, &len) || tag != SNMP_TAG_INTEGER
+      || len < 1 || len > 4)
+    return false;
+  uint32_t v = (content[0] & 0x80 ? ~0U : 0);
+  for (int i = 0; i < len; i++)
+    v = (v << 8) | content[i];
+  *x = v;
+  _s = content + len;
+  return true;
+}
+
+bool
+SNMPBERDecoder::decode_octet_string(const unsigned char **data, int *len)
+{
+  int tag;
+  const unsigned char *content;
+  if (!header(&tag, &content, len) || tag != SNMP_TAG_OCTET_STRING)
+    return false;
+  *data = content;
+  _s = content + *len;
+  return true;
+}
+
+bool
+SNMPBERDecoder::decode_snmp_oid(SNMPOid &oid)
+{
+  int tag, len;
+  const unsigned char *content;
+  if (!header(&tag, &content, &len) || tag != SNMP_TAG_OID || len < 1)
+    return false;
+
+  oid.clear();
+  // first two components share the first byte
+  if (content[0] < 40)
+    oid.push_back(0);
+  else if (content[0] < 80)
+    oid.push_back(1);
+  else
+    oid.push_back(2);
+  oid.push_back(content[0] - 40 * oid[0]);
+
+  uint32_t component = 0;
+  int nbytes = 0;
+  for (int i = 1; i < len; i++) {
+    if (++nbytes > 5 || (component >> 25) != 0)
+      return false;
+    component = (component << 7) | (content[i] & 0x7F);
+    if (!(content[i] & 0x80)) {
+      oid.push_back(component);
+      component = 0;
+      nbytes = 0;
+    }
+  }
+  if (nbytes)			// last component unterminated
+    return false;
+
+  _s = content + len;
+  return true;
+}
+
 ELEMENT_REQUIRES(SNMPBasics)
 ELEMENT_PROVIDES(SNMPBER)
@@ -13,13 +13,26 @@ class SNMPBEREncoder { public:
     };
 
     SNMPBEREncoder();
+    SNMPBEREncoder(unsigned char *buf, int capacity);
 
     inline const unsigned char *data() const;
     inline int length() const;
     inline bool memory_error() const;
+    inline Status error() const;
 
     unsigned char *extend(int);
 
+    // A point to which the encoder can be wound back, dropping everything
+    // encoded since, open sequences included, and any error since.
+    struct Mark {
+	int length;
+	int depth;
+	Status error;
+    };
+    inline Mark mark() const;
+    void rewind(const Mark &);
+    void clear();
+
     Status push_sequence(SNMPTag);
     inline Status push_sequence();
     Status push_long_sequence(SNMPTag);
@@ -93,6 +106,9 @@ class SNMPBEREncoder { public:
   private:
 
     StringAccum _sa;
+    unsigned char *_buf;		// fixed buffer; if null, encode into _sa
+    int _len;				// bytes used in _buf
+    int _cap;				// size of _buf
     Vector<int> _sequence_start;
     Vector<int> _sequence_len_len;
     Status _mem_err;
@@ -101,6 +117,42 @@ class SNMPBEREncoder { public:
     static unsigned char *encode_len(unsigned char *, int);
     static void encode_len_by_len_len(unsigned char *, int, int);
     Status encode_integer(SNMPTag tag, String::uint_large_t x, bool as_signed);
+    inline unsigned char *wdata();
+    void truncate(int);
+
+};
+
+/*
+ * SNMPBERDecoder reads a BER-encoded SNMP message in place.  Each decode
+ * function consumes one element and returns false, consuming nothing, if
+ * the next element has the wrong tag or is malformed.  enter_sequence()
+ * makes the decoder read the elements of a sequence; done() is then true
+ * at its end, and leave_sequence() skips what is left of it.
+ */
+class SNMPBERDecoder { public:
+
+    SNMPBERDecoder(const unsigned char *data, int len);
+
+    inline bool done() const;
+    int next_tag() const;
+
+    int enter_sequence();		// returns the sequence's tag or -1
+    bool leave_sequence();
+
+    bool decode_integer(int32_t *);
+    bool decode_octet_string(const unsigned char **, int *);
+    bool decode_snmp_oid(SNMPOid &);
+    bool skip();
+
+  private:
+
+    enum { MAX_DEPTH = 8 };
+
+    const unsigned char *_s;
+    const unsigned char *_end[MAX_DEPTH + 1];
+    int _depth;
+
+    bool header(int *tag, const unsigned char **content, int *len) const;
 
 };
 
@@ -108,21 +160,44 @@ class SNMPBEREncoder { public:
 inline const unsigned char *
 SNMPBEREncoder::data() const
 {
-    return (const unsigned char *)_sa.data();
+    return _buf ? _buf : (const unsigned char *)_sa.data();
+}
+
+inline unsigned char *
+SNMPBEREncoder::wdata()
+{
+    return _buf ? _buf : (unsigned char *)_sa.data();
 }
 
 inline int
 SNMPBEREncoder::length() const
 {
-    return _sa.length();
+    return _buf ? _len : _sa.length();
 }
 
+// also true when a fixed buffer has run out of room (ERR_TOOBIG)
 inline bool
 SNMPBEREncoder::memory_error() const
 {
     return _mem_err < 0;
 }
 
+inline SNMPBEREncoder::Status
+SNMPBEREncoder::error() const
+{
+    return _mem_err;
+}
+
+inline SNMPBEREncoder::Mark
+SNMPBEREncoder::mark() const
+{
+    Mark m;
+    m.length = length();
+    m.depth = _sequence_start.size();
+    m.error = _mem_err;
+    return m;
+}
+
 inline SNMPBEREncoder::Status
 SNMPBEREncoder::push_sequence()
 {
@@ -178,6 +253,12 @@ SNMPBEREncoder::calculate_len_len(int len)
     return ERR_TOOBIG;
 }
 
+inline bool
+SNMPBERDecoder::done() const
+{
+    return _s >= _end[_depth];
+}
+
 inline SNMPBEREncoder &
 operator<<(SNMPBEREncoder &ber, const SNMPOid &oid)
 {
@@ -47,7 +47,7 @@ SNMPOidTree::alloc_node(uint32_t suffix, Node *parent, Node *sibling)
       return 0;
     }
     memcpy(new_nodes, _nodes, sizeof(Node *) * (_nodes_cap / NODES_PER_GROUP));
-    _nodes[_nodes_cap / NODES_PER_GROUP] = new_group;
+    new_nodes[_nodes_cap / NODES_PER_GROUP] = new_group;
     delete[] _nodes;
     _nodes = new_nodes;
     _nodes_cap += NODES_PER_GROUP;
@@ -118,6 +118,81 @@ SNMPOidTree::find_prefix(const SNMPOid &oid, int *prefix_len) const
   return np->data;
 }
 
+// Siblings are kept in the order they were inserted, not sorted, so the
+// walks below pick the smallest suitable suffix among them each time.
+
+// The first node, in lexicographic order, of the subtree rooted at n that
+// has data >= 0
+const SNMPOidTree::Node *
+SNMPOidTree::first_in(const Node *n) const
+{
+  if (n->data >= 0)
+    return n;
+  return first_among(n->child, 0, false);
+}
+
+// The first node with data >= 0 in the subtrees of sib and its siblings,
+// leaving out those whose suffix is not above 'after' if 'strict'
+const SNMPOidTree::Node *
+SNMPOidTree::first_among(const Node *sib, uint32_t after, bool strict) const
+{
+  while (1) {
+    const Node *best = 0;
+    for (const Node *np = sib; np; np = np->sibling)
+      if ((!strict || np->suffix > after)
+	  && (!best || np->suffix < best->suffix))
+	best = np;
+    if (!best)
+      return 0;
+    if (const Node *r = first_in(best))
+      return r;
+    after = best->suffix;
+    strict = true;
+  }
+}
+
+// Finds the first node after oid, in lexicographic order, that has data
+// >= 0.  Returns its data and sets *next to its OID, or returns -1.
+int
+SNMPOidTree::find_next(const SNMPOid &oid, SNMPOid *next) const
+{
+  if (_nnodes == 0)
+    return -1;
+
+  // follow oid as far as the tree goes
+  const Node *last = 0;
+  const Node *level = root_node();
+  int pos = 0;
+  for (; pos < oid.size(); pos++) {
+    const Node *np = level;
+    while (np && np->suffix != oid[pos])
+      np = np->sibling;
+    if (!np)
+      break;
+    last = np;
+    level = np->child;
+  }
+
+  const Node *r;
+  if (pos == oid.size())
+    // oid is in the tree: its descendants come next
+    r = (level ? first_among(level, 0, false) : 0);
+  else
+    // then the siblings after where oid left the tree
+    r = first_among(level, oid[pos], true);
+
+  // then the siblings after each of oid's ancestors
+  for (const Node *np = last; !r && np; np = np->parent)
+    r = first_among(np->parent ? np->parent->child : root_node(),
+		    np->suffix, true);
+
+  if (!r)
+    return -1;
+  if (next)
+    extract_oid(const_cast<Node *>(r), next);
+  return r->data;
+}
+
 SNMPOidTree::Node *
 SNMPOidTree::force_node(const SNMPOid &oid)
 {
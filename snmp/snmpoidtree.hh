@@ -12,6 +12,7 @@ class SNMPOidTree { public:
 
   int find(const SNMPOid &) const;
   int find_prefix(const SNMPOid &, int *prefix_length) const;
+  int find_next(const SNMPOid &, SNMPOid *next) const;
   Node *insert(const SNMPOid &, int);
 
   void extract_oid(Node *, SNMPOid *) const;
@@ -42,6 +43,8 @@ class SNMPOidTree { public:
 
   Node *root_node() const;
   Node *alloc_node(uint32_t, Node *, Node *);
+  const Node *first_in(const Node *) const;
+  const Node *first_among(const Node *, uint32_t, bool) const;
 
 };
 
@@ -0,0 +1,370 @@
+/*
+ * snmprequestsource.{cc,hh} -- element generates SNMP requests for load
+ * testing
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "snmprequestsource.hh"
+#include "snmpber.hh"
+#include <click/args.hh>
+#include <click/router.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+
+SNMPRequestSource::SNMPRequestSource()
+  : _id(0), _task(this)
+{
+  reset();
+}
+
+SNMPRequestSource::~SNMPRequestSource()
+{
+}
+
+int
+SNMPRequestSource::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  String type = "get", version = "2c";
+  _non_repeaters = 0;
+  _max_repetitions = 10;
+  _community = "public";
+  _udp_encap = true;
+  _src = _dst = IPAddress(String("127.0.0.1"));
+  _sport = 1024;
+  _dport = 161;
+  _limit = 1000000;
+  _burst = 32;
+  _stop = false;
+  _active = true;
+
+  Vector<SNMPOid> oids;
+  if (Args(conf, this, errh)
+      .read_all_with("OID", SNMPOidArg(), oids)
+      .read("TYPE", WordArg(), type)
+      .read("VERSION", WordArg(), version)
+      .read("NON_REPEATERS", _non_repeaters)
+      .read("MAX_REPETITIONS", _max_repetitions)
+      .read("COMMUNITY", _community)
+      .read("UDP", _udp_encap)
+      .read("SRC", _src)
+      .read("SPORT", IPPortArg(IP_PROTO_UDP), _sport)
+      .read("DST", _dst)
+      .read("DPORT", IPPortArg(IP_PROTO_UDP), _dport)
+      .read("LIMIT", _limit)
+      .read("BURST", _burst)
+      .read("STOP", _stop)
+      .read("ACTIVE", _active)
+      .complete() < 0)
+    return -1;
+
+  if (oids.size() == 0)
+    return errh->error("must specify at least one OID");
+  if (type == "get")
+    _pdu = SNMP_TAG_V1_GET;
+  else if (type == "getnext")
+    _pdu = SNMP_TAG_V1_GETNEXT;
+  else if (type == "getbulk")
+    _pdu = SNMP_TAG_V2_GETBULK;
+  else
+    return errh->error("TYPE must be get, getnext or getbulk");
+  if (version == "1")
+    _version = SNMP_VERSION_1;
+  else if (version == "2c")
+    _version = SNMP_VERSION_2C;
+  else
+    return errh->error("VERSION must be 1 or 2c");
+  if (_pdu == SNMP_TAG_V2_GETBULK && _version == SNMP_VERSION_1)
+    return errh->error("getbulk needs VERSION 2c");
+  if (_burst == 0)
+    return errh->error("BURST must be positive");
+  if (_non_repeaters > 0x7FFFFFFF || _max_repetitions > 0x7FFFFFFF)
+    return errh->error("NON_REPEATERS and MAX_REPETITIONS must fit in 31 bits");
+
+  _oids.swap(oids);
+  _walk = _oids;
+  return 0;
+}
+
+int
+SNMPRequestSource::initialize(ErrorHandler *)
+{
+  _id = click_random();
+  _task.initialize(this, _active);
+  return 0;
+}
+
+WritablePacket *
+SNMPRequestSource::make_request()
+{
+  int hlen = (_udp_encap ? sizeof(click_ip) + sizeof(click_udp) : 0);
+  WritablePacket *p = Packet::make(Packet::DEFAULT_HEADROOM, 0,
+				   hlen + MAX_REQUEST, 0);
+  if (!p)
+    return 0;
+
+  SNMPBEREncoder ber(p->data() + hlen, MAX_REQUEST);
+  ber.push_long_sequence();
+  ber.encode_integer(_version);
+  ber.encode_octet_string(_community);
+  ber.push_long_sequence((SNMPTag)_pdu);
+  ber.encode_integer((int)(_count & 0x7FFFFFFF));
+  if (_pdu == SNMP_TAG_V2_GETBULK) {
+    ber.encode_integer((int)_non_repeaters);
+    ber.encode_integer((int)_max_repetitions);
+  } else {
+    ber.encode_integer(SNMP_ERR_NOERROR);
+    ber.encode_integer(0);
+  }
+  ber.push_long_sequence();
+  for (int i = 0; i < _walk.size(); i++) {
+    ber.push_sequence();
+    ber.encode_snmp_oid(_walk[i]);
+    ber.encode_null();
+    ber.pop_sequence();
+  }
+  ber.pop_sequence();
+  ber.pop_sequence();
+  ber.pop_sequence();
+
+  if (ber.error()) {
+    p->kill();
+    return 0;
+  }
+  p->take(MAX_REQUEST - ber.length());
+
+  if (_udp_encap) {
+    click_ip *iph = (click_ip *)p->data();
+    iph->ip_v = 4;
+    iph->ip_hl = sizeof(click_ip) >> 2;
+    iph->ip_len = htons(p->length());
+    iph->ip_id = htons(_id++);
+    iph->ip_p = IP_PROTO_UDP;
+    iph->ip_src = _src;
+    iph->ip_dst = _dst;
+    iph->ip_tos = 0;
+    iph->ip_off = 0;
+    iph->ip_ttl = 64;
+
+    iph->ip_sum = 0;
+#if HAVE_FAST_CHECKSUM
+    iph->ip_sum = ip_fast_csum((unsigned char *)iph, sizeof(click_ip) >> 2);
+#else
+    iph->ip_sum = click_in_cksum((unsigned char *)iph, sizeof(click_ip));
+#endif
+
+    p->set_dst_ip_anno(_dst);
+    p->set_ip_header(iph, sizeof(click_ip));
+
+    click_udp *udph = (click_udp *)(iph + 1);
+    int ulen = ber.length() + sizeof(click_udp);
+    udph->uh_sport = htons(_sport);
+    udph->uh_dport = htons(_dport);
+    udph->uh_ulen = htons(ulen);
+    udph->uh_sum = 0;
+
+    unsigned csum = click_in_cksum((unsigned char *)udph, ulen);
+    udph->uh_sum = click_in_cksum_pseudohdr(csum, iph, ulen);
+  }
+
+  return p;
+}
+
+bool
+SNMPRequestSource::run_task(Task *)
+{
+  if (!_active)
+    return false;
+  if (_limit && _count >= _limit) {
+    if (_stop)
+      router()->please_stop_driver();
+    return false;
+  }
+
+  uint32_t n = _burst;
+  if (_limit && _limit - _count < n)
+    n = _limit - _count;
+  if (_count == 0)
+    _first = Timestamp::now();
+
+  for (uint32_t i = 0; i < n; i++) {
+    WritablePacket *p = make_request();
+    if (!p)
+      break;
+    _count++;
+    output(0).push(p);
+  }
+
+  _last = Timestamp::now();
+  _task.fast_reschedule();
+  return true;
+}
+
+// Decodes a response, counting its bindings and moving each walk on to the
+// last instance returned for it.  Returns false if it is malformed.
+bool
+SNMPRequestSource::handle_response(const unsigned char *data, int len)
+{
+  SNMPBERDecoder d(data, len);
+  const unsigned char *community;
+  int community_len;
+  int32_t version, reqid, status, index;
+
+  if (d.enter_sequence() != SNMP_TAG_SEQUENCE
+      || !d.decode_integer(&version)
+      || !d.decode_octet_string(&community, &community_len)
+      || d.enter_sequence() != SNMP_TAG_V1_RESPONSE
+      || !d.decode_integer(&reqid)
+      || !d.decode_integer(&status)
+      || !d.decode_integer(&index)
+      || d.enter_sequence() != SNMP_TAG_SEQUENCE)
+    return false;
+
+  _stats[S_RESPONSES]++;
+  bool restart = (status != SNMP_ERR_NOERROR);
+  if (restart)
+    _stats[S_ERRORS]++;
+
+  // GETBULK bindings come non-repeaters first, then one row of repeaters
+  // per repetition
+  int nonrep = 0;
+  if (_pdu == SNMP_TAG_V2_GETBULK)
+    nonrep = (_non_repeaters < (uint32_t)_walk.size() ? _non_repeaters : _walk.size());
+  int nrep = _walk.size() - nonrep;
+
+  for (int b = 0; !d.done(); b++) {
+    if (d.enter_sequence() != SNMP_TAG_SEQUENCE || !d.decode_snmp_oid(_oid))
+      return false;
+    int tag = d.next_tag();
+    if (tag == SNMP_TAG_END_OF_MIB_VIEW)
+      restart = true;
+    else if (tag != SNMP_TAG_NO_SUCH_OBJECT && tag != SNMP_TAG_NO_SUCH_INSTANCE)
+      _stats[S_BINDINGS]++;
+    if (!restart && _pdu != SNMP_TAG_V1_GET) {
+      if (b < nonrep || _pdu == SNMP_TAG_V1_GETNEXT) {
+	if (b < _walk.size())
+	  _walk[b] = _oid;
+      } else if (nrep > 0)
+	_walk[nonrep + (b - nonrep) % nrep] = _oid;
+    }
+    d.leave_sequence();
+  }
+
+  if (restart && _pdu != SNMP_TAG_V1_GET) {
+    if (status == SNMP_ERR_NOERROR)
+      _stats[S_RESTARTS]++;
+    _walk = _oids;
+  }
+  return true;
+}
+
+void
+SNMPRequestSource::push(int, Packet *p)
+{
+  const unsigned char *data = p->data();
+  int len = p->length();
+  if (_udp_encap) {
+    if (!p->has_transport_header()
+	|| p->transport_length() < (int)sizeof(click_udp)) {
+      _stats[S_BAD]++;
+      p->kill();
+      return;
+    }
+    data = p->transport_header() + sizeof(click_udp);
+    len = p->transport_length() - sizeof(click_udp);
+  }
+  if (!handle_response(data, len))
+    _stats[S_BAD]++;
+  p->kill();
+}
+
+void
+SNMPRequestSource::reset()
+{
+  _count = 0;
+  _first = _last = Timestamp();
+  memset(_stats, 0, sizeof(_stats));
+  _walk = _oids;
+}
+
+String
+SNMPRequestSource::read_handler(Element *e, void *thunk)
+{
+  SNMPRequestSource *rs = (SNMPRequestSource *)e;
+  switch (reinterpret_cast<intptr_t>(thunk)) {
+   case H_count:
+    return String(rs->_count);
+   case H_rate: {
+     double sec = (rs->_last - rs->_first).doubleval();
+     StringAccum sa;
+     sa << "requests " << rs->_count << "\n"
+	<< "seconds " << sec << "\n"
+	<< "rate " << (sec > 0 ? rs->_count / sec : 0) << "\n";
+     return sa.take_string();
+   }
+   case H_stats: {
+     StringAccum sa;
+     sa << "responses " << rs->_stats[S_RESPONSES] << "\n"
+	<< "bindings " << rs->_stats[S_BINDINGS] << "\n"
+	<< "errors " << rs->_stats[S_ERRORS] << "\n"
+	<< "restarts " << rs->_stats[S_RESTARTS] << "\n"
+	<< "bad " << rs->_stats[S_BAD] << "\n";
+     return sa.take_string();
+   }
+   case H_active:
+    return cp_unparse_bool(rs->_active);
+   default:
+    return String();
+  }
+}
+
+int
+SNMPRequestSource::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+  SNMPRequestSource *rs = (SNMPRequestSource *)e;
+  switch (reinterpret_cast<intptr_t>(thunk)) {
+
+   case H_reset:
+    rs->reset();
+    return 0;
+
+   case H_active: {
+     bool x;
+     if (!cp_bool(cp_uncomment(str), &x))
+       return errh->error("expected boolean value");
+     rs->_active = x;
+     if (x)
+       rs->_task.reschedule();
+     return 0;
+   }
+
+   default:
+    return -EINVAL;
+
+  }
+}
+
+void
+SNMPRequestSource::add_handlers()
+{
+  add_read_handler("count", read_handler, H_count);
+  add_read_handler("rate", read_handler, H_rate);
+  add_read_handler("stats", read_handler, H_stats);
+  add_write_handler("reset", write_handler, H_reset, Handler::BUTTON);
+  add_read_handler("active", read_handler, H_active);
+  add_write_handler("active", write_handler, H_active, Handler::CHECKBOX);
+}
+
+ELEMENT_REQUIRES(SNMPBasics SNMPBER)
+EXPORT_ELEMENT(SNMPRequestSource)
@@ -0,0 +1,182 @@
+#ifndef CLICK_SNMPREQUESTSOURCE_HH
+#define CLICK_SNMPREQUESTSOURCE_HH
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/task.hh>
+#include <click/timestamp.hh>
+#include "snmpbasics.hh"
+
+/*
+=c
+
+SNMPRequestSource(I<KEYWORDS>)
+
+=s SNMP
+
+generates SNMP requests for load testing
+
+=d
+
+SNMPRequestSource sends SNMP GET, GETNEXT or GETBULK requests for a list of
+OIDs on its output as fast as it can, BURST at a time, for benchmarking
+SNMPAgent.  Each request has a new request-id.
+
+Responses pushed into its optional input are decoded and counted, then
+dropped.  When they come back, GETNEXT and GETBULK requests walk the MIB:
+each requested OID is replaced by the last instance returned for it, and
+the walk starts again from the configured OIDs when a response reports an
+error or reaches the end of the MIB.  Without responses, every request
+names the configured OIDs.
+
+Keyword arguments are:
+
+=over 8
+
+=item OID
+
+SNMP OID. An OID to request. May be given more than once; at least one is
+required.
+
+=item TYPE
+
+One of C<get>, C<getnext> and C<getbulk>. Default is C<get>.
+
+=item VERSION
+
+C<1> or C<2c>. GETBULK needs C<2c>. Default is C<2c>.
+
+=item NON_REPEATERS, MAX_REPETITIONS
+
+Unsigned. The GETBULK fields of those names. Defaults are 0 and 10.
+
+=item COMMUNITY
+
+String. The SNMP community. Default is C<"public">.
+
+=item UDP
+
+Boolean. If true, then requests are UDP-in-IP packets. If false, then they
+are bare SNMP messages. Default is true.
+
+=item SRC, SPORT, DST, DPORT
+
+IP addresses and UDP ports of requests (if UDP is true). Defaults are
+127.0.0.1, 1024, 127.0.0.1 and 161.
+
+=item LIMIT
+
+Unsigned. Number of requests to send; 0 means no limit. Default is
+1000000.
+
+=item BURST
+
+Unsigned. Requests sent per task run. Default is 32.
+
+=item STOP
+
+Boolean. If true, stop the driver after LIMIT requests. Default is false.
+
+=item ACTIVE
+
+Boolean. If false, send nothing until the active handler is set to true.
+Default is true.
+
+=back
+
+=h count read-only
+
+Requests sent so far.
+
+=h rate read-only
+
+Requests sent, seconds from the first to the last, and requests per
+second.
+
+=h stats read-only
+
+Responses received; variable bindings received; responses with an error
+status; walks restarted at the end of the MIB; and malformed responses.
+
+=h reset write-only
+
+Zeroes the counters and restarts walks.  Writing true to active afterwards
+sends LIMIT more requests.
+
+=h active read/write
+
+Starts or stops sending.
+
+=e
+
+  SNMPOidInfo(clicktest private.244);
+  SNMPVariableInfo(clicktest.1 Counter32 src.count);
+
+  src :: SNMPRequestSource(OID clicktest, TYPE getbulk, MAX_REPETITIONS 20,
+                           LIMIT 100000, STOP true)
+    -> agent :: SNMPAgent -> src;
+  DriverManager(wait, print src.rate, print src.stats, print agent.stats, stop);
+
+=a
+
+SNMPAgent, SNMPVariableInfo */
+
+class SNMPRequestSource : public Element { public:
+
+  SNMPRequestSource();
+  ~SNMPRequestSource();
+
+  const char *class_name() const	{ return "SNMPRequestSource"; }
+  const char *port_count() const	{ return "0-1/1"; }
+  const char *processing() const	{ return PUSH; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  bool run_task(Task *);
+  void push(int, Packet *);
+
+ private:
+
+  enum { MAX_REQUEST = 1472 };
+  enum { S_RESPONSES, S_BINDINGS, S_ERRORS, S_RESTARTS, S_BAD, NSTATS };
+  enum { H_count, H_rate, H_stats, H_reset, H_active };
+
+  Vector<SNMPOid> _oids;
+  Vector<SNMPOid> _walk;		// OIDs the next request names
+  SNMPOid _oid;				// scratch for responses
+  int _pdu;
+  int32_t _version;
+  uint32_t _non_repeaters;
+  uint32_t _max_repetitions;
+  String _community;
+
+  bool _udp_encap;
+  IPAddress _src;
+  IPAddress _dst;
+  uint16_t _sport;
+  uint16_t _dport;
+  uint16_t _id;
+
+  uint32_t _limit;
+  uint32_t _burst;
+  bool _stop;
+  bool _active;
+
+  uint32_t _count;
+  Timestamp _first;
+  Timestamp _last;
+  uint32_t _stats[NSTATS];
+
+  Task _task;
+
+  WritablePacket *make_request();
+  bool handle_response(const unsigned char *, int);
+  void reset();
+
+  static String read_handler(Element *, void *);
+  static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+#endif
@@ -154,6 +154,27 @@ SNMPVariableInfo::query(const SNMPOid &oid, const Element *context)
     return data;
 }
 
+// The variable whose instance, OID.0, comes first after oid in
+// lexicographic order, or -1.  Sets *instance to that instance's OID.
+SNMPVariable
+SNMPVariableInfo::query_next(const SNMPOid &oid, const Element *context, SNMPOid *instance)
+{
+  SNMPVariableInfo *v = find_element(context);
+  if (!v)
+    return -1;
+
+  // a variable's own OID comes right before its instance
+  int data = v->_tree.find(oid);
+  if (data >= 0) {
+    if (instance)
+      *instance = oid;
+  } else if ((data = v->_tree.find_next(oid, instance)) < 0)
+    return -1;
+  if (instance)
+    instance->push_back(0);
+  return data;
+}
+
 bool
 SNMPVariableInfo::int_value(SNMPVariable var, const Element *context, int *result)
 {
@@ -180,20 +201,33 @@ SNMPVariableInfo::unsigned_value(SNMPVariable var, const Element *context, unsig
     return false;
 }
 
+String
+SNMPVariableInfo::read_value(SNMPVariable var, const Element *context)
+{
+  SNMPVariableInfo *v = find_element(context);
+  if (!v || v->_tags[var] == SNMP_TAG_NULL)
+    return String();
+  if (const Handler *h = v->_handlers[var])
+    return h->call_read(v->_handler_elements[var]);
+  return String();
+}
+
 bool
 SNMPVariableInfo::encode_binding(SNMPVariable var, SNMPBEREncoder &ber, const Element *context)
+{
+  return encode_binding(var, read_value(var, context), ber, context);
+}
+
+// Encodes var's binding with value, a string read from its handler earlier
+bool
+SNMPVariableInfo::encode_binding(SNMPVariable var, const String &value, SNMPBEREncoder &ber, const Element *context)
 {
   SNMPVariableInfo *v = find_element(context);
   if (!v)
     return false;
 
   SNMPTag tag = (SNMPTag)v->_tags[var];
-
-  String str;
-  if (tag != SNMP_TAG_NULL) {
-    if (const Handler *h = v->_handlers[var])
-      str = h->call_read(v->_handler_elements[var]);
-  }
+  String str = value;
 
   ber.push_sequence();
 
@@ -87,7 +87,7 @@ elements, for example.
 
 =a
 
-SNMPOidInfo, SNMPTrapSource */
+SNMPOidInfo, SNMPTrapSource, SNMPAgent */
 
 typedef int SNMPVariable;
 
@@ -104,9 +104,12 @@ class SNMPVariableInfo : public Element { public:
   int add_info(const String &, const String &prefix, ErrorHandler *);
 
   static SNMPVariable query(const SNMPOid &, const Element *context);
+  static SNMPVariable query_next(const SNMPOid &, const Element *context, SNMPOid *instance = 0);
   static bool int_value(SNMPVariable, const Element *context, int *);
   static bool unsigned_value(SNMPVariable, const Element *context, unsigned *);
+  static String read_value(SNMPVariable, const Element *context);
   static bool encode_binding(SNMPVariable, SNMPBEREncoder &, const Element *context);
+  static bool encode_binding(SNMPVariable, const String &value, SNMPBEREncoder &, const Element *context);
   static SNMPVariableInfo *find_element(const Element *context);
 
  private: